@@ -55,9 +55,55 @@ namespace gstio { namespace chain {
       set_abi(abi, max_serialization_time);
    }
 
+   // plans refer into the maps of the serializer that compiled them, so copies point them at their own maps
+   abi_serializer::abi_serializer( const abi_serializer& other )
+   :typedefs(other.typedefs)
+   ,structs(other.structs)
+   ,actions(other.actions)
+   ,tables(other.tables)
+   ,error_messages(other.error_messages)
+   ,variants(other.variants)
+   ,built_in_types(other.built_in_types)
+   ,type_plans(other.type_plans)
+   ,type_plan_ids(other.type_plan_ids)
+   {
+      for( auto& plan : type_plans ) {
+         switch( plan.kind ) {
+            case type_plan::kind_type::built_in:
+               plan.built_in = &built_in_types.find( fundamental_type( plan.name ) )->second;
+               break;
+            case type_plan::kind_type::structure:
+               plan.struct_itr = structs.find( plan.struct_itr->first );
+               break;
+            case type_plan::kind_type::variant:
+               plan.variant_itr = variants.find( plan.variant_itr->first );
+               break;
+            default:
+               break;
+         }
+      }
+   }
+
+   abi_serializer& abi_serializer::operator=( const abi_serializer& other ) {
+      if( this != &other )
+         *this = abi_serializer( other );
+      return *this;
+   }
+
    void abi_serializer::add_specialized_unpack_pack( const string& name,
                                                      std::pair<abi_serializer::unpack_function, abi_serializer::pack_function> unpack_pack ) {
-      built_in_types[name] = std::move( unpack_pack );
+      auto itr = built_in_types.find( name );
+      if( itr != built_in_types.end() ) {
+         // assigned in place, so the plans already pointing at it stay valid
+         itr->second = std::move( unpack_pack );
+         return;
+      }
+      built_in_types.emplace( name, std::move( unpack_pack ) );
+      // a new built in type only changes the plans when it shadows a type they resolved otherwise
+      if( type_plan_ids.find( name ) != type_plan_ids.end() ) {
+         impl::abi_traverse_context ctx( fc::microseconds::maximum() );
+         compile_plans( ctx );
+      }
    }
 
    void abi_serializer::configure_built_in_types() {
@@ -114,6 +160,8 @@ namespace gstio { namespace chain {
       tables.clear();
       error_messages.clear();
       variants.clear();
+      type_plans.clear();
+      type_plan_ids.clear();
 
       for( const auto& st : abi.structs )
          structs[st.name] = st;
@@ -148,6 +196,113 @@ namespace gstio { namespace chain {
       GST_ASSERT( variants.size() == abi.variants.value.size(), duplicate_abi_variant_def_exception, "duplicate variant definition detected" );
 
       validate(ctx);
+      compile_plans(ctx);
+   }
+
+   /**
+    *  Types nested deeper than max_recursion_depth below a root are left without a plan, together with everything
+    *  compiled for that root, so they take the path by name which fails at the same depth when serializing.
+    */
+   void abi_serializer::compile_plans( impl::abi_traverse_context& ctx ) {
+      type_plans.clear();
+      type_plan_ids.clear();
+
+      auto compile_root = [&]( const type_name& type ) {
+         auto plans = type_plans.size();
+         try {
+            compile_plan( type, ctx );
+         } catch( const abi_recursion_depth_exception& ) {
+            type_plans.resize( plans );
+            for( auto itr = type_plan_ids.begin(); itr != type_plan_ids.end(); ) {
+               if( itr->second >= plans )
+                  itr = type_plan_ids.erase( itr );
+               else
+                  ++itr;
+            }
+         }
+      };
+
+      for( const auto& s : structs )
+         compile_root( s.first );
+      for( const auto& v : variants )
+         compile_root( v.first );
+      for( const auto& t : typedefs )
+         compile_root( t.first );
+      for( const auto& a : actions )
+         compile_root( a.second );
+      for( const auto& t : tables )
+         compile_root( t.second );
+   }
+
+   /**
+    *  Resolves type the same way _binary_to_variant and _variant_to_binary do by name. Types are registered
+    *  before their members are compiled so that self referencing structs and variants terminate.
+    */
+   uint32_t abi_serializer::compile_plan( const type_name& type, impl::abi_traverse_context& ctx ) {
+      auto itr = type_plan_ids.find( type );
+      if( itr != type_plan_ids.end() ) return itr->second;
+
+      auto h = ctx.enter_scope();
+
+      auto rtype = resolve_type( type );
+      if( rtype != type ) {
+         auto id = compile_plan( rtype, ctx );
+         type_plan_ids.emplace( type, id );
+         return id;
+      }
+
+      auto id = static_cast<uint32_t>( type_plans.size() );
+      type_plan_ids.emplace( type, id );
+      type_plans.emplace_back();
+      type_plans[id].name = type;
+
+      auto ftype = fundamental_type( type );
+      auto btype = built_in_types.find( ftype );
+      if( btype != built_in_types.end() ) {
+         auto& plan = type_plans[id];
+         plan.kind = type_plan::kind_type::built_in;
+         plan.built_in = &btype->second;
+         plan.built_in_array = is_array( type );
+         plan.built_in_optional = is_optional( type );
+      } else if( is_array( type ) || is_optional( type ) ) {
+         auto element = compile_plan( ftype, ctx );
+         auto& plan = type_plans[id];
+         plan.kind = is_array( type ) ? type_plan::kind_type::array : type_plan::kind_type::optional;
+         plan.element = element;
+      } else if( variants.find( type ) != variants.end() ) {
+         auto v_itr = variants.find( type );
+         vector<uint32_t> alternatives;
+         alternatives.reserve( v_itr->second.types.size() );
+         for( const auto& t : v_itr->second.types )
+            alternatives.push_back( compile_plan( t, ctx ) );
+         auto& plan = type_plans[id];
+         plan.kind = type_plan::kind_type::variant;
+         plan.variant_itr = v_itr;
+         plan.alternatives = std::move( alternatives );
+      } else if( structs.find( type ) != structs.end() ) {
+         auto s_itr = structs.find( type );
+         const auto& st = s_itr->second;
+         auto base = type_plan::no_base;
+         if( st.base != type_name() )
+            base = compile_plan( st.base, ctx );
+         vector<type_plan::field> fields;
+         fields.reserve( st.fields.size() );
+         for( const auto& f : st.fields ) {
+            type_plan::field field;
+            field.extension = ends_with( f.type, "$" );
+            field.type = compile_plan( _remove_bin_extension( f.type ), ctx );
+            field.last = ( &f == &st.fields.back() );
+            fields.push_back( field );
+         }
+         auto& plan = type_plans[id];
+         plan.kind = type_plan::kind_type::structure;
+         plan.struct_itr = s_itr;
+         plan.base = base;
+         plan.fields = std::move( fields );
+      } else {
+         GST_THROW( invalid_type_inside_abi, "Unknown type ${type}", ("type",type) );
+      }
+      return id;
    }
 
    bool abi_serializer::is_builtin_type(const type_name& type)const {
@@ -315,6 +470,10 @@ namespace gstio { namespace chain {
    fc::variant abi_serializer::_binary_to_variant( const type_name& type, fc::datastream<const char *>& stream,
                                                    impl::binary_to_variant_context& ctx )const
    {
+      auto plan_itr = type_plan_ids.find( type );
+      if( plan_itr != type_plan_ids.end() )
+         return _binary_to_variant( type_plans[plan_itr->second], stream, ctx );
+
       auto h = ctx.enter_scope();
       type_name rtype = resolve_type(type);
       auto ftype = fundamental_type(rtype);
@@ -396,8 +555,30 @@ namespace gstio { namespace chain {
       return _binary_to_variant(type, binary, ctx);
    }
 
+   void abi_serializer::binary_to_json( const type_name& type, const bytes& binary, string& out, const fc::microseconds& max_serialization_time, bool short_path )const {
+      impl::binary_to_variant_context ctx(*this, max_serialization_time, type);
+      ctx.short_path = short_path;
+      auto h = ctx.enter_scope();
+      fc::datastream<const char*> ds( binary.data(), binary.size() );
+      _binary_to_json(type, ds, out, ctx);
+   }
+
+   void abi_serializer::_binary_to_json( const type_name& type, fc::datastream<const char *>& stream, string& out,
+                                         impl::binary_to_variant_context& ctx )const
+   {
+      auto plan_itr = type_plan_ids.find( type );
+      if( plan_itr != type_plan_ids.end() )
+         return _binary_to_json( type_plans[plan_itr->second], stream, out, ctx );
+      // types the ABI does not name, such as arrays of built-in types, are small enough for the variant path
+      fc::json::append( out, _binary_to_variant( type, stream, ctx ) );
+   }
+
    void abi_serializer::_variant_to_binary( const type_name& type, const fc::variant& var, fc::datastream<char *>& ds, impl::variant_to_binary_context& ctx )const
    { try {
+      auto plan_itr = type_plan_ids.find( type );
+      if( plan_itr != type_plan_ids.end() )
+         return _variant_to_binary( type_plans[plan_itr->second], var, ds, ctx );
+
       auto h = ctx.enter_scope();
       auto rtype = resolve_type(type);
 
@@ -495,6 +676,312 @@ namespace gstio { namespace chain {
       }
    } FC_CAPTURE_AND_RETHROW( (type)(var) ) }
 
+   void abi_serializer::_binary_to_variant( const type_plan& plan, fc::datastream<const char *>& stream,
+                                            fc::mutable_variant_object& obj, impl::binary_to_variant_context& ctx )const
+   {
+      auto h = ctx.enter_scope();
+      ctx.hint_struct_type_if_in_array( plan.struct_itr );
+      const auto& st = plan.struct_itr->second;
+      if( plan.base != type_plan::no_base ) {
+         _binary_to_variant(type_plans[plan.base], stream, obj, ctx);
+      }
+      bool encountered_extension = false;
+      for( uint32_t i = 0; i < plan.fields.size(); ++i ) {
+         const auto& field = plan.fields[i];
+         encountered_extension |= field.extension;
+         if( !stream.remaining() ) {
+            if( field.extension ) {
+               continue;
+            }
+            if( encountered_extension ) {
+               GST_THROW( abi_exception, "Encountered field '${f}' without binary extension designation while processing struct '${p}'",
+                          ("f", ctx.maybe_shorten(st.fields[i].name))("p", ctx.get_path_string()) );
+            }
+            GST_THROW( unpack_exception, "Stream unexpectedly ended; unable to unpack field '${f}' of struct '${p}'",
+                       ("f", ctx.maybe_shorten(st.fields[i].name))("p", ctx.get_path_string()) );
+
+         }
+         auto h1 = ctx.push_to_path( impl::field_path_item{ .parent_struct_itr = plan.struct_itr, .field_ordinal = i } );
+         obj( st.fields[i].name, _binary_to_variant(type_plans[field.type], stream, ctx) );
+      }
+   }
+
+   fc::variant abi_serializer::_binary_to_variant( const type_plan& plan, fc::datastream<const char *>& stream,
+                                                   impl::binary_to_variant_context& ctx )const
+   {
+      auto h = ctx.enter_scope();
+      switch( plan.kind ) {
+         case type_plan::kind_type::built_in:
+            try {
+               return plan.built_in->first(stream, plan.built_in_array, plan.built_in_optional);
+            } GST_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack ${class} type '${type}' while processing '${p}'",
+                                      ("class", plan.built_in_array ? "array of built-in" : plan.built_in_optional ? "optional of built-in" : "built-in")
+                                      ("type", fundamental_type(plan.name))("p", ctx.get_path_string()) )
+         case type_plan::kind_type::array: {
+            ctx.hint_array_type_if_in_array();
+            fc::unsigned_int size;
+            try {
+               fc::raw::unpack(stream, size);
+            } GST_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack size of array '${p}'", ("p", ctx.get_path_string()) )
+            const auto& element = type_plans[plan.element];
+            vector<fc::variant> vars;
+            vars.reserve( std::min<size_t>( size.value, stream.remaining() ) );
+            auto h1 = ctx.push_to_path( impl::array_index_path_item{} );
+            for( decltype(size.value) i = 0; i < size; ++i ) {
+               ctx.set_array_index_of_path_back(i);
+               auto v = _binary_to_variant(element, stream, ctx);
+               GST_ASSERT( !v.is_null(), unpack_exception, "Invalid packed array '${p}'", ("p", ctx.get_path_string()) );
+               vars.emplace_back(std::move(v));
+            }
+            return fc::variant( std::move(vars) );
+         }
+         case type_plan::kind_type::optional: {
+            char flag;
+            try {
+               fc::raw::unpack(stream, flag);
+            } GST_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack presence flag of optional '${p}'", ("p", ctx.get_path_string()) )
+            return flag ? _binary_to_variant(type_plans[plan.element], stream, ctx) : fc::variant();
+         }
+         case type_plan::kind_type::variant: {
+            ctx.hint_variant_type_if_in_array( plan.variant_itr );
+            const auto& v = plan.variant_itr->second;
+            fc::unsigned_int select;
+            try {
+               fc::raw::unpack(stream, select);
+            } GST_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack tag of variant '${p}'", ("p", ctx.get_path_string()) )
+            GST_ASSERT( (size_t)select < v.types.size(), unpack_exception,
+                        "Unpacked invalid tag (${select}) for variant '${p}'", ("select", select.value)("p",ctx.get_path_string()) );
+            auto h1 = ctx.push_to_path( impl::variant_path_item{ .variant_itr = plan.variant_itr, .variant_ordinal = static_cast<uint32_t>(select) } );
+            return vector<fc::variant>{v.types[select], _binary_to_variant(type_plans[plan.alternatives[select]], stream, ctx)};
+         }
+         case type_plan::kind_type::structure:
+            break;
+      }
+
+      fc::mutable_variant_object mvo;
+      _binary_to_variant(plan, stream, mvo, ctx);
+      GST_ASSERT( mvo.size() > 0, unpack_exception, "Unable to unpack '${p}' from stream", ("p", ctx.get_path_string()) );
+      return fc::variant( std::move(mvo) );
+   }
+
+   void abi_serializer::_binary_to_json( const type_plan& plan, fc::datastream<const char *>& stream, string& out, bool& first,
+                                         impl::binary_to_variant_context& ctx )const
+   {
+      auto h = ctx.enter_scope();
+      ctx.hint_struct_type_if_in_array( plan.struct_itr );
+      const auto& st = plan.struct_itr->second;
+      if( plan.base != type_plan::no_base ) {
+         _binary_to_json(type_plans[plan.base], stream, out, first, ctx);
+      }
+      bool encountered_extension = false;
+      for( uint32_t i = 0; i < plan.fields.size(); ++i ) {
+         const auto& field = plan.fields[i];
+         encountered_extension |= field.extension;
+         if( !stream.remaining() ) {
+            if( field.extension ) {
+               continue;
+            }
+            if( encountered_extension ) {
+               GST_THROW( abi_exception, "Encountered field '${f}' without binary extension designation while processing struct '${p}'",
+                          ("f", ctx.maybe_shorten(st.fields[i].name))("p", ctx.get_path_string()) );
+            }
+            GST_THROW( unpack_exception, "Stream unexpectedly ended; unable to unpack field '${f}' of struct '${p}'",
+                       ("f", ctx.maybe_shorten(st.fields[i].name))("p", ctx.get_path_string()) );
+
+         }
+         auto h1 = ctx.push_to_path( impl::field_path_item{ .parent_struct_itr = plan.struct_itr, .field_ordinal = i } );
+         if( !first ) out += ',';
+         first = false;
+         fc::json::append_string( out, st.fields[i].name );
+         out += ':';
+         _binary_to_json(type_plans[field.type], stream, out, ctx);
+      }
+   }
+
+   /// mirrors _binary_to_variant( const type_plan&, ... ) and writes what fc::json::to_string() makes of its result
+   void abi_serializer::_binary_to_json( const type_plan& plan, fc::datastream<const char *>& stream, string& out,
+                                         impl::binary_to_variant_context& ctx )const
+   {
+      auto h = ctx.enter_scope();
+      switch( plan.kind ) {
+         case type_plan::kind_type::built_in: {
+            fc::variant v;
+            try {
+               v = plan.built_in->first(stream, plan.built_in_array, plan.built_in_optional);
+            } GST_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack ${class} type '${type}' while processing '${p}'",
+                                      ("class", plan.built_in_array ? "array of built-in" : plan.built_in_optional ? "optional of built-in" : "built-in")
+                                      ("type", fundamental_type(plan.name))("p", ctx.get_path_string()) )
+            fc::json::append( out, v );
+            return;
+         }
+         case type_plan::kind_type::array: {
+            ctx.hint_array_type_if_in_array();
+            fc::unsigned_int size;
+            try {
+               fc::raw::unpack(stream, size);
+            } GST_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack size of array '${p}'", ("p", ctx.get_path_string()) )
+            const auto& element = type_plans[plan.element];
+            out += '[';
+            auto h1 = ctx.push_to_path( impl::array_index_path_item{} );
+            for( decltype(size.value) i = 0; i < size; ++i ) {
+               ctx.set_array_index_of_path_back(i);
+               if( i ) out += ',';
+               auto pos = out.size();
+               _binary_to_json(element, stream, out, ctx);
+               GST_ASSERT( out.compare( pos, string::npos, "null" ) != 0, unpack_exception, "Invalid packed array '${p}'", ("p", ctx.get_path_string()) );
+            }
+            out += ']';
+            return;
+         }
+         case type_plan::kind_type::optional: {
+            char flag;
+            try {
+               fc::raw::unpack(stream, flag);
+            } GST_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack presence flag of optional '${p}'", ("p", ctx.get_path_string()) )
+            if( flag )
+               _binary_to_json(type_plans[plan.element], stream, out, ctx);
+            else
+               out += "null";
+            return;
+         }
+         case type_plan::kind_type::variant: {
+            ctx.hint_variant_type_if_in_array( plan.variant_itr );
+            const auto& v = plan.variant_itr->second;
+            fc::unsigned_int select;
+            try {
+               fc::raw::unpack(stream, select);
+            } GST_RETHROW_EXCEPTIONS( unpack_exception, "Unable to unpack tag of variant '${p}'", ("p", ctx.get_path_string()) )
+            GST_ASSERT( (size_t)select < v.types.size(), unpack_exception,
+                        "Unpacked invalid tag (${select}) for variant '${p}'", ("select", select.value)("p",ctx.get_path_string()) );
+            auto h1 = ctx.push_to_path( impl::variant_path_item{ .variant_itr = plan.variant_itr, .variant_ordinal = static_cast<uint32_t>(select) } );
+            out += '[';
+            fc::json::append_string( out, v.types[select] );
+            out += ',';
+            _binary_to_json(type_plans[plan.alternatives[select]], stream, out, ctx);
+            out += ']';
+            return;
+         }
+         case type_plan::kind_type::structure:
+            break;
+      }
+
+      bool first = true;
+      out += '{';
+      _binary_to_json(plan, stream, out, first, ctx);
+      GST_ASSERT( !first, unpack_exception, "Unable to unpack '${p}' from stream", ("p", ctx.get_path_string()) );
+      out += '}';
+   }
+
+   void abi_serializer::_variant_to_binary( const type_plan& plan, const fc::variant& var, fc::datastream<char *>& ds, impl::variant_to_binary_context& ctx )const
+   {
+      const auto& type = plan.name;
+      try {
+         auto h = ctx.enter_scope();
+
+         switch( plan.kind ) {
+            case type_plan::kind_type::built_in:
+               plan.built_in->second(var, ds, plan.built_in_array, plan.built_in_optional);
+               break;
+            case type_plan::kind_type::array: {
+               ctx.hint_array_type_if_in_array();
+               const auto& vars = var.get_array();
+               fc::raw::pack(ds, (fc::unsigned_int)vars.size());
+
+               auto h1 = ctx.push_to_path( impl::array_index_path_item{} );
+               auto h2 = ctx.disallow_extensions_unless(false);
+
+               const auto& element = type_plans[plan.element];
+               int64_t i = 0;
+               for (const auto& var : vars) {
+                  ctx.set_array_index_of_path_back(i);
+                  _variant_to_binary(element, var, ds, ctx);
+                  ++i;
+               }
+               break;
+            }
+            case type_plan::kind_type::optional:
+               // optionals of non built-in types have never been packable by name either
+               GST_THROW( invalid_type_inside_abi, "Unknown type ${type}", ("type",ctx.maybe_shorten(type)) );
+            case type_plan::kind_type::variant: {
+               ctx.hint_variant_type_if_in_array( plan.variant_itr );
+               const auto& v = plan.variant_itr->second;
+               GST_ASSERT( var.is_array() && var.size() == 2, pack_exception,
+                          "Expected input to be an array of two items while processing variant '${p}'", ("p", ctx.get_path_string()) );
+               GST_ASSERT( var[size_t(0)].is_string(), pack_exception,
+                          "Encountered non-string as first item of input array while processing variant '${p}'", ("p", ctx.get_path_string()) );
+               const auto& variant_type_str = var[size_t(0)].get_string();
+               auto it = find(v.types.begin(), v.types.end(), variant_type_str);
+               GST_ASSERT( it != v.types.end(), pack_exception,
+                           "Specified type '${t}' in input array is not valid within the variant '${p}'",
+                           ("t", ctx.maybe_shorten(variant_type_str))("p", ctx.get_path_string()) );
+               auto select = static_cast<uint32_t>(it - v.types.begin());
+               fc::raw::pack(ds, fc::unsigned_int(select));
+               auto h1 = ctx.push_to_path( impl::variant_path_item{ .variant_itr = plan.variant_itr, .variant_ordinal = select } );
+               _variant_to_binary( type_plans[plan.alternatives[select]], var[size_t(1)], ds, ctx );
+               break;
+            }
+            case type_plan::kind_type::structure: {
+               ctx.hint_struct_type_if_in_array( plan.struct_itr );
+               const auto& st = plan.struct_itr->second;
+
+               if( var.is_object() ) {
+                  const auto& vo = var.get_object();
+
+                  if( plan.base != type_plan::no_base ) {
+                     auto h2 = ctx.disallow_extensions_unless(false);
+                     _variant_to_binary(type_plans[plan.base], var, ds, ctx);
+                  }
+                  bool disallow_additional_fields = false;
+                  for( uint32_t i = 0; i < plan.fields.size(); ++i ) {
+                     const auto& field = plan.fields[i];
+                     const auto& field_name = st.fields[i].name;
+                     auto value = vo.find( field_name );
+                     if( value != vo.end() ) {
+                        if( disallow_additional_fields )
+                           GST_THROW( pack_exception, "Unexpected field '${f}' found in input object while processing struct '${p}'",
+                                      ("f", ctx.maybe_shorten(field_name))("p", ctx.get_path_string()) );
+                        {
+                           auto h1 = ctx.push_to_path( impl::field_path_item{ .parent_struct_itr = plan.struct_itr, .field_ordinal = i } );
+                           auto h2 = ctx.disallow_extensions_unless( field.last );
+                           _variant_to_binary(type_plans[field.type], value->value(), ds, ctx);
+                        }
+                     } else if( field.extension && ctx.extensions_allowed() ) {
+                        disallow_additional_fields = true;
+                     } else if( disallow_additional_fields ) {
+                        GST_THROW( abi_exception, "Encountered field '${f}' without binary extension designation while processing struct '${p}'",
+                                   ("f", ctx.maybe_shorten(field_name))("p", ctx.get_path_string()) );
+                     } else {
+                        GST_THROW( pack_exception, "Missing field '${f}' in input object while processing struct '${p}'",
+                                   ("f", ctx.maybe_shorten(field_name))("p", ctx.get_path_string()) );
+                     }
+                  }
+               } else if( var.is_array() ) {
+                  const auto& va = var.get_array();
+                  GST_ASSERT( plan.base == type_plan::no_base, invalid_type_inside_abi,
+                              "Using input array to specify the fields of the derived struct '${p}'; input arrays are currently only allowed for structs without a base",
+                              ("p",ctx.get_path_string()) );
+                  for( uint32_t i = 0; i < plan.fields.size(); ++i ) {
+                     const auto& field = plan.fields[i];
+                     if( va.size() > i ) {
+                        auto h1 = ctx.push_to_path( impl::field_path_item{ .parent_struct_itr = plan.struct_itr, .field_ordinal = i } );
+                        auto h2 = ctx.disallow_extensions_unless( field.last );
+                        _variant_to_binary(type_plans[field.type], va[i], ds, ctx);
+                     } else if( field.extension && ctx.extensions_allowed() ) {
+                        break;
+                     } else {
+                        GST_THROW( pack_exception, "Early end to input array specifying the fields of struct '${p}'; require input for field '${f}'",
+                                   ("p", ctx.get_path_string())("f", ctx.maybe_shorten(st.fields[i].name)) );
+                     }
+                  }
+               } else {
+                  GST_THROW( pack_exception, "Unexpected input encountered while processing struct '${p}'", ("p",ctx.get_path_string()) );
+               }
+               break;
+            }
+         }
+      } FC_CAPTURE_AND_RETHROW( (type)(var) )
+   }
+
    bytes abi_serializer::_variant_to_binary( const type_name& type, const fc::variant& var, impl::variant_to_binary_context& ctx )const
    { try {
       auto h = ctx.enter_scope();
@@ -0,0 +1,107 @@
+#include <gstio/chain/abi_serializer_cache.hpp>
+#include <gstio/chain/account_object.hpp>
+
+#include <cstring>
+
+namespace gstio { namespace chain {
+
+   abi_serializer_cache::abi_serializer_cache( uint32_t max_entries )
+   :max_entries( max_entries )
+   {}
+
+   abi_serializer_cache::abi_serializer_ptr abi_serializer_cache::get( const chainbase::database& db, account_name account,
+                                                                      const fc::microseconds& max_serialization_time ) {
+      const auto* seq = db.find<account_sequence_object, by_name>( account );
+      const auto* accnt = db.find<account_object, by_name>( account );
+      if( seq == nullptr || accnt == nullptr ) return abi_serializer_ptr();
+
+      return get( account, seq->abi_sequence, accnt->abi.data(), accnt->abi.size(),
+                  [&]() { return create( db, account, max_serialization_time ); } );
+   }
+
+   abi_serializer_cache::abi_serializer_ptr abi_serializer_cache::get( account_name account, uint64_t sequence, const make_function& make ) {
+      return get( account, sequence, nullptr, 0, make );
+   }
+
+   abi_serializer_cache::abi_serializer_ptr abi_serializer_cache::get( account_name account, uint64_t sequence,
+                                                                      const char* packed_abi, size_t packed_abi_size,
+                                                                      const make_function& make ) {
+      auto matches = [&]( const entry& e ) {
+         return e.sequence == sequence &&
+                e.packed_abi.size() == packed_abi_size &&
+                ( packed_abi_size == 0 || memcmp( e.packed_abi.data(), packed_abi, packed_abi_size ) == 0 );
+      };
+
+      {
+         std::lock_guard<std::mutex> g( mtx );
+         auto& idx = entries.get<by_account>();
+         auto itr = idx.find( account );
+         if( itr != idx.end() && matches( *itr ) ) {
+            entries.relocate( entries.begin(), entries.project<0>( itr ) );
+            ++counters.hits;
+            return itr->serializer;
+         }
+         ++counters.misses;
+      }
+
+      // validation can take a while for large ABIs, do not hold up other lookups meanwhile
+      auto serializer = make();
+      if( max_entries == 0 ) return serializer;
+      // on chain the ABI of the entry tells when to retry, off chain a missing ABI would be cached for good
+      if( !serializer && packed_abi == nullptr ) return serializer;
+
+      std::lock_guard<std::mutex> g( mtx );
+      auto& idx = entries.get<by_account>();
+      auto itr = idx.find( account );
+      if( itr != idx.end() ) {
+         if( itr->sequence > sequence ) return serializer; // a newer ABI was cached in the meantime
+         idx.modify( itr, [&]( entry& e ) {
+            e.sequence = sequence;
+            e.packed_abi.assign( packed_abi, packed_abi + packed_abi_size );
+            e.serializer = serializer;
+         });
+         entries.relocate( entries.begin(), entries.project<0>( itr ) );
+      } else {
+         entry e;
+         e.account = account;
+         e.sequence = sequence;
+         e.packed_abi.assign( packed_abi, packed_abi + packed_abi_size );
+         e.serializer = serializer;
+         entries.push_front( std::move( e ) );
+         while( entries.size() > max_entries ) {
+            entries.pop_back();
+            ++counters.evictions;
+         }
+      }
+      return serializer;
+   }
+
+   void abi_serializer_cache::erase( account_name account ) {
+      std::lock_guard<std::mutex> g( mtx );
+      entries.get<by_account>().erase( account );
+   }
+
+   void abi_serializer_cache::clear() {
+      std::lock_guard<std::mutex> g( mtx );
+      entries.clear();
+   }
+
+   abi_serializer_cache::stats abi_serializer_cache::get_stats()const {
+      std::lock_guard<std::mutex> g( mtx );
+      stats s = counters;
+      s.size = entries.size();
+      return s;
+   }
+
+   abi_serializer_cache::abi_serializer_ptr abi_serializer_cache::create( const chainbase::database& db, account_name account,
+                                                                         const fc::microseconds& max_serialization_time ) {
+      const auto* accnt = db.find<account_object, by_name>( account );
+      if( accnt == nullptr ) return abi_serializer_ptr();
+
+      abi_def abi;
+      if( !abi_serializer::to_abi( accnt->abi, abi ) ) return abi_serializer_ptr();
+
+      return std::make_shared<abi_serializer>( abi, max_serialization_time );
+   }
+
+} } // gstio::chain
@@ -13,17 +13,11 @@
 #include <gstio/chain/contract_types.hpp>
 #include <gstio/chain/generated_transaction_object.hpp>
 #include <boost/tuple/tuple_io.hpp>
-#include <gstio/chain/database_utils.hpp>
+#include <gstio/chain/state_index_set.hpp>
 
 
 namespace gstio { namespace chain {
 
-   using authorization_index_set = index_set<
-      permission_index,
-      permission_usage_index,
-      permission_link_index
-   >;
-
    authorization_manager::authorization_manager(controller& c, database& d)
    :_control(c),_db(d){}
 
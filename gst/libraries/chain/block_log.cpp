@@ -3,10 +3,24 @@
  *  @copyright defined in gst/LICENSE
  */
 #include <gstio/chain/block_log.hpp>
+#include <gstio/chain/config.hpp>
 #include <gstio/chain/exceptions.hpp>
+#include <gstio/chain/thread_utils.hpp>
+#include <atomic>
 #include <fstream>
+#include <list>
+#include <mutex>
+#include <thread>
 #include <fc/io/raw.hpp>
 
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/iostreams/copy.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/device/file.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+
 #define LOG_READ  (std::ios::in | std::ios::binary)
 #define LOG_WRITE (std::ios::out | std::ios::binary | std::ios::app)
 #define LOG_RW ( std::ios::in | std::ios::out | std::ios::binary )
@@ -24,18 +38,395 @@ namespace gstio { namespace chain {
    const uint32_t block_log::max_supported_version = 2;
 
    namespace detail {
+      namespace bip = boost::interprocess;
+      namespace bio = boost::iostreams;
+
+      /**
+       * Read-only view of a block log and its index as they were when the view was created. Blocks are appended after
+       * the mapped part of the files, so a mapping stays valid while the log grows. Compressed segments are
+       * decompressed into memory instead of being mapped; their size is added to decompressed_usage while they live.
+       */
+      struct block_log_mapping {
+         block_log_mapping( const fc::path& block_file, const fc::path& index_file, uint32_t first_block_num );
+         block_log_mapping( std::vector<char>&& decompressed, const fc::path& index_file, uint32_t first_block_num,
+                            std::shared_ptr<std::atomic<uint64_t>> decompressed_usage );
+         ~block_log_mapping() {
+            if( decompressed_usage )
+               *decompressed_usage -= block_buffer.size();
+         }
+
+         void load( uint32_t block_num, block_log_entry& entry )const;
+         genesis_state genesis()const;
+
+         uint64_t index_at( uint32_t block_num )const {
+            uint64_t pos;
+            memcpy( &pos, index + sizeof(uint64_t) * (block_num - first_block_num), sizeof(pos) );
+            return pos;
+         }
+
+         bip::file_mapping   block_mapping;
+         bip::mapped_region  block_region;
+         bip::file_mapping   index_mapping;
+         bip::mapped_region  index_region;
+         std::vector<char>   block_buffer;
+         std::shared_ptr<std::atomic<uint64_t>> decompressed_usage;
+         const char*         blocks = nullptr;
+         const char*         index = nullptr;
+         uint64_t            block_size = 0;
+         uint32_t            first_block_num = 0;
+         uint32_t            last_block_num = 0;
+
+         private:
+            void map_index( const fc::path& index_file );
+      };
+
+      block_log_mapping::block_log_mapping( const fc::path& block_file, const fc::path& index_file, uint32_t first_block_num )
+      :first_block_num(first_block_num), last_block_num(first_block_num - 1) {
+         block_size = fc::file_size(block_file);
+         if( block_size == 0 )
+            return;
+
+         block_mapping = bip::file_mapping( block_file.generic_string().c_str(), bip::read_only );
+         block_region  = bip::mapped_region( block_mapping, bip::read_only, 0, block_size );
+         block_region.advise( bip::mapped_region::advice_sequential );
+         blocks = static_cast<const char*>(block_region.get_address());
+         map_index( index_file );
+      }
+
+      block_log_mapping::block_log_mapping( std::vector<char>&& decompressed, const fc::path& index_file, uint32_t first_block_num,
+                                            std::shared_ptr<std::atomic<uint64_t>> usage )
+      :block_buffer(std::move(decompressed)), decompressed_usage(std::move(usage)), first_block_num(first_block_num), last_block_num(first_block_num - 1) {
+         if( decompressed_usage )
+            *decompressed_usage += block_buffer.size();
+         blocks = block_buffer.data();
+         block_size = block_buffer.size();
+         map_index( index_file );
+      }
+
+      void block_log_mapping::map_index( const fc::path& index_file ) {
+         auto index_size = fc::file_size(index_file) / sizeof(uint64_t) * sizeof(uint64_t);
+         if( index_size == 0 )
+            return;
+
+         index_mapping = bip::file_mapping( index_file.generic_string().c_str(), bip::read_only );
+         index_region  = bip::mapped_region( index_mapping, bip::read_only, 0, index_size );
+         index = static_cast<const char*>(index_region.get_address());
+         last_block_num = first_block_num + index_size / sizeof(uint64_t) - 1;
+      }
+
+      void block_log_mapping::load( uint32_t block_num, block_log_entry& entry )const {
+         GST_ASSERT( block_num >= first_block_num && block_num <= last_block_num, block_log_exception,
+                     "Block ${n} is outside of the mapped block log", ("n", block_num)("first", first_block_num)("last", last_block_num) );
+
+         // every block is followed by its own position, so the next block starts 8 bytes after this one ends
+         uint64_t pos = index_at( block_num );
+         uint64_t end = (block_num < last_block_num ? index_at( block_num + 1 ) : block_size) - sizeof(uint64_t);
+         GST_ASSERT( pos < end && end + sizeof(uint64_t) <= block_size, block_log_exception,
+                     "Block log index is inconsistent with the block log", ("block_num", block_num)("pos", pos)("end", end) );
+
+         uint64_t trailer;
+         memcpy( &trailer, blocks + end, sizeof(trailer) );
+         GST_ASSERT( trailer == pos, block_log_exception,
+                     "Block log index is inconsistent with the block log", ("block_num", block_num)("pos", pos)("trailer", trailer) );
+
+         entry.block_num = block_num;
+         entry.pos       = pos;
+         entry.data      = blocks + pos;
+         entry.size      = end - pos;
+      }
+
+      static std::vector<char> zlib_decompress_file( const fc::path& file ) {
+         std::vector<char> out;
+         bio::filtering_istream decomp;
+         decomp.push( bio::zlib_decompressor() );
+         decomp.push( bio::file_source( file.generic_string(), LOG_READ ) );
+         bio::copy( decomp, bio::back_inserter(out) );
+         return out;
+      }
+
+      static void zlib_compress_file( const fc::path& from, const fc::path& to ) {
+         std::ofstream out( to.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+         bio::filtering_ostream comp;
+         comp.push( bio::zlib_compressor( bio::zlib::default_compression ) );
+         comp.push( out );
+         bio::file_source in( from.generic_string(), LOG_READ );
+         bio::copy( in, comp );
+         out.flush();
+         GST_ASSERT( out.good(), block_log_exception, "Unable to write compressed block log segment ${f}", ("f", to) );
+      }
+
+      /// reads the genesis state from the header of a block log
+      template<typename Stream>
+      static genesis_state read_genesis( Stream& block_stream, uint32_t& first_block_num ) {
+         uint32_t version = 0;
+         block_stream.read( (char*)&version, sizeof(version) );
+         GST_ASSERT( version > 0, block_log_exception, "Block log was not setup properly." );
+         GST_ASSERT( version >= block_log::min_supported_version && version <= block_log::max_supported_version, block_log_unsupported_version,
+                    "Unsupported version of block log. Block log version is ${version} while code supports version(s) [${min},${max}]",
+                    ("version", version)("min", block_log::min_supported_version)("max", block_log::max_supported_version) );
+
+         first_block_num = 1;
+         if (version != 1) {
+            block_stream.read( (char*)&first_block_num, sizeof(first_block_num) );
+         }
+
+         genesis_state gs;
+         fc::raw::unpack(block_stream, gs);
+         return gs;
+      }
+
+      genesis_state block_log_mapping::genesis()const {
+         fc::datastream<const char*> ds( blocks, block_size );
+         uint32_t first;
+         return read_genesis( ds, first );
+      }
+
+      /**
+       * A sealed segment of the block log. Its files are named after the blocks it holds; the log file of a compressed
+       * segment is the zlib compressed block log while the index still refers to positions in the uncompressed log.
+       */
+      struct log_segment {
+         uint32_t  first_block_num = 0;
+         uint32_t  last_block_num = 0;
+         fc::path  log_file;
+         fc::path  index_file;
+         bool      compressed = false;
+         bool      archived = false;
+
+         static const char* log_suffix()        { return ".log"; }
+         static const char* compressed_suffix() { return ".log.zlib"; }
+         static const char* index_suffix()      { return ".index"; }
+
+         static fc::path file_name( const fc::path& dir, uint32_t first, uint32_t last, const char* suffix ) {
+            char name[64];
+            snprintf( name, sizeof(name), "blocks-%010u-%010u%s", first, last, suffix );
+            return dir / name;
+         }
+
+         /// parses blocks-<first>-<last>.log[.zlib], returns false for any other file
+         static bool parse( const fc::path& file, log_segment& seg ) {
+            auto name = file.filename().generic_string();
+            unsigned first = 0, last = 0;
+            int consumed = 0;
+            if( sscanf( name.c_str(), "blocks-%u-%u%n", &first, &last, &consumed ) != 2 || first == 0 || first > last )
+               return false;
+            auto suffix = name.substr( consumed );
+            if( suffix != log_suffix() && suffix != compressed_suffix() )
+               return false;
+            seg.first_block_num = first;
+            seg.last_block_num  = last;
+            seg.log_file        = file;
+            seg.index_file      = file_name( file.parent_path(), first, last, index_suffix() );
+            seg.compressed      = suffix == compressed_suffix();
+            return true;
+         }
+
+         uint64_t block_count()const { return uint64_t(last_block_num) - first_block_num + 1; }
+
+         std::shared_ptr<const block_log_mapping> map( const std::shared_ptr<std::atomic<uint64_t>>& decompressed_usage = {} )const {
+            if( compressed )
+               return std::make_shared<block_log_mapping>( zlib_decompress_file( log_file ), index_file, first_block_num, decompressed_usage );
+            return std::make_shared<block_log_mapping>( log_file, index_file, first_block_num );
+         }
+
+         /// rebuilds the index by following the position stored after every block backwards from the end of the log
+         void construct_index()const {
+            ilog( "Reconstructing index of block log segment ${f}", ("f", log_file) );
+            std::vector<char> decompressed;
+            bip::file_mapping file;
+            bip::mapped_region region;
+            const char* data = nullptr;
+            uint64_t end = 0;
+            if( compressed ) {
+               decompressed = zlib_decompress_file( log_file );
+               data = decompressed.data();
+               end = decompressed.size();
+            } else {
+               end = fc::file_size( log_file );
+               GST_ASSERT( end > 0, block_log_exception, "Block log segment ${f} is empty", ("f", log_file) );
+               file = bip::file_mapping( log_file.generic_string().c_str(), bip::read_only );
+               region = bip::mapped_region( file, bip::read_only, 0, end );
+               data = static_cast<const char*>(region.get_address());
+            }
+
+            std::vector<uint64_t> positions( block_count() );
+            for( auto i = positions.size(); i-- > 0; ) {
+               uint64_t pos = block_log::npos;
+               if( end >= sizeof(pos) )
+                  memcpy( &pos, data + end - sizeof(pos), sizeof(pos) );
+               GST_ASSERT( pos < end - sizeof(pos), block_log_exception,
+                           "Block log segment ${f} holds fewer blocks than its name claims", ("f", log_file)("missing", i + 1) );
+               positions[i] = pos;
+               end = pos;
+            }
+
+            auto tmp = index_file.generic_string() + ".tmp";
+            {
+               std::ofstream out( tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+               out.write( (const char*)positions.data(), positions.size() * sizeof(uint64_t) );
+               out.flush();
+               GST_ASSERT( out.good(), block_log_exception, "Unable to write block log index ${f}", ("f", index_file) );
+            }
+            fc::rename( tmp, index_file );
+         }
+      };
+
+      /**
+       * The sealed segments of a block log. Shared with block_log_range so ranges keep working while segments are
+       * compressed or archived; the catalog mutex serializes those file moves with the mapping of segments.
+       *
+       * Mapped segments are shared through a small LRU. Decompressed segments stay in memory for as long as a range
+       * reads them, so their total size is capped by decompressed_limit: loading another one fails while the segments
+       * already in use exceed it. A single segment is always allowed, whatever its size.
+       */
+      class block_log_catalog {
+         public:
+            static const size_t max_cached_segments = 8;
+
+            explicit block_log_catalog( uint64_t decompressed_limit ) : decompressed_limit(decompressed_limit) {}
+
+            std::shared_ptr<const block_log_mapping> load( uint32_t block_num ) {
+               std::lock_guard<std::mutex> g( mtx );
+               for( auto itr = cached.begin(); itr != cached.end(); ++itr ) {
+                  if( (*itr)->first_block_num <= block_num && block_num <= (*itr)->last_block_num ) {
+                     cached.splice( cached.begin(), cached, itr );
+                     return cached.front();
+                  }
+               }
+
+               auto itr = find( block_num );
+               GST_ASSERT( itr != segments.end(), block_log_exception, "Block ${n} is not in any block log segment", ("n", block_num) );
+               auto m = itr->map( decompressed_usage );
+               GST_ASSERT( m->last_block_num == itr->last_block_num, block_log_exception,
+                           "Index of block log segment ${f} is incomplete", ("f", itr->log_file) );
+
+               // segments dropped from the cache are freed now, unless a range still reads them
+               while( cached.size() >= max_cached_segments || (!cached.empty() && *decompressed_usage > decompressed_limit) )
+                  cached.pop_back();
+               GST_ASSERT( !m->decompressed_usage || *decompressed_usage <= decompressed_limit || *decompressed_usage == m->block_buffer.size(),
+                           block_log_exception, "Decompressed block log segments in use exceed ${limit} bytes, unable to read block ${n}",
+                           ("limit", decompressed_limit)("n", block_num) );
+               cached.push_front( m );
+               return m;
+            }
+
+            uint32_t first_block_num() {
+               std::lock_guard<std::mutex> g( mtx );
+               return segments.empty() ? 0 : segments.front().first_block_num;
+            }
+
+            uint32_t last_block_num() {
+               std::lock_guard<std::mutex> g( mtx );
+               return segments.empty() ? 0 : segments.back().last_block_num;
+            }
+
+            void add( log_segment seg ) {
+               std::lock_guard<std::mutex> g( mtx );
+               segments.push_back( std::move(seg) );
+            }
+
+            /// compresses sealed segments and moves the oldest ones to the archive directory; runs on the worker thread
+            void maintain( const block_log_config& cfg );
+
+            std::vector<log_segment>::iterator find( uint32_t block_num ) {
+               auto itr = std::upper_bound( segments.begin(), segments.end(), block_num,
+                                            []( uint32_t n, const log_segment& s ) { return n < s.first_block_num; } );
+               if( itr == segments.begin() || (--itr)->last_block_num < block_num )
+                  return segments.end();
+               return itr;
+            }
+
+            std::mutex                                mtx;
+            std::vector<log_segment>                  segments; ///< ordered by block number
+            std::list<std::shared_ptr<const block_log_mapping>> cached;   ///< most recently read first
+            const uint64_t                            decompressed_limit;
+            /// bytes of decompressed segments alive, including those only kept by ranges
+            std::shared_ptr<std::atomic<uint64_t>>    decompressed_usage = std::make_shared<std::atomic<uint64_t>>(0);
+
+         private:
+            /// replaces the files of the segment holding first_block_num once the new files are in place
+            void replace( uint32_t first_block_num, const log_segment& updated ) {
+               std::lock_guard<std::mutex> g( mtx );
+               auto itr = find( first_block_num );
+               if( itr == segments.end() )
+                  return;
+               if( itr->log_file != updated.log_file )
+                  fc::remove( itr->log_file );
+               if( itr->index_file != updated.index_file )
+                  fc::remove( itr->index_file );
+               *itr = updated;
+            }
+      };
+
+      void block_log_catalog::maintain( const block_log_config& cfg ) {
+         std::vector<log_segment> current;
+         {
+            std::lock_guard<std::mutex> g( mtx );
+            current = segments;
+         }
+
+         if( cfg.compress_segments ) {
+            for( auto& seg : current ) {
+               if( seg.compressed || seg.archived )
+                  continue;
+               auto updated = seg;
+               updated.log_file = log_segment::file_name( seg.log_file.parent_path(), seg.first_block_num, seg.last_block_num,
+                                                          log_segment::compressed_suffix() );
+               updated.compressed = true;
+               auto tmp = updated.log_file.generic_string() + ".tmp";
+               zlib_compress_file( seg.log_file, tmp );
+               fc::rename( tmp, updated.log_file );
+               replace( seg.first_block_num, updated );
+               ilog( "Compressed block log segment ${f}", ("f", updated.log_file) );
+               seg = updated;
+            }
+         }
+
+         if( cfg.retained_segments ) {
+            auto retained = std::count_if( current.begin(), current.end(), []( const log_segment& s ) { return !s.archived; } );
+            for( auto& seg : current ) {
+               if( retained <= cfg.retained_segments )
+                  break;
+               if( seg.archived )
+                  continue;
+               if( !fc::is_directory( cfg.archive_dir ) )
+                  fc::create_directories( cfg.archive_dir );
+
+               // copy rather than rename, the archive is usually on another file system
+               auto updated = seg;
+               updated.log_file   = cfg.archive_dir / seg.log_file.filename();
+               updated.index_file = cfg.archive_dir / seg.index_file.filename();
+               updated.archived   = true;
+               for( const auto& f : { std::make_pair( seg.log_file, updated.log_file ), std::make_pair( seg.index_file, updated.index_file ) } ) {
+                  auto tmp = f.second.generic_string() + ".tmp";
+                  fc::remove( tmp );
+                  fc::copy( f.first, tmp );
+                  fc::rename( tmp, f.second );
+               }
+               replace( seg.first_block_num, updated );
+               ilog( "Archived block log segment ${f}", ("f", updated.log_file) );
+               --retained;
+            }
+         }
+      }
+
       class block_log_impl {
          public:
             signed_block_ptr         head;
             block_id_type            head_id;
             std::fstream             block_stream;
             std::fstream             index_stream;
+            fc::path                 data_dir;
             fc::path                 block_file;
             fc::path                 index_file;
             bool                     open_files = false;
             bool                     genesis_written_to_block_log = false;
             uint32_t                 version = 0;
             uint32_t                 first_block_num = 0;
+            std::shared_ptr<const block_log_mapping> mapping;
+            block_log_config                   cfg;
+            std::shared_ptr<block_log_catalog> catalog;
+            boost::asio::thread_pool           worker{1};
 
             inline void check_open_files() {
                if( !open_files ) {
@@ -44,13 +435,61 @@ namespace gstio { namespace chain {
             }
             void reopen();
 
+            void set_head( const signed_block_ptr& b ) {
+               head = b;
+               head_id = b ? b->id() : block_id_type();
+            }
+
+            /// remaps the log if blocks up to through_num were appended since the current mapping was taken
+            const std::shared_ptr<const block_log_mapping>& mapping_through( uint32_t through_num ) {
+               if( !mapping || mapping->last_block_num < through_num ) {
+                  mapping = std::make_shared<block_log_mapping>( block_file, index_file, first_block_num );
+               }
+               return mapping;
+            }
+
             void close() {
+               mapping.reset();
                if( block_stream.is_open() )
                   block_stream.close();
                if( index_stream.is_open() )
                   index_stream.close();
                open_files = false;
             }
+
+            void load_segments();
+            std::pair<signed_block_ptr, uint64_t> read_block( uint64_t pos );
+            void seal_segment();
+            void start_log( const genesis_state& gs, uint32_t first_block );
+
+            /// last block of the newest sealed segment
+            signed_block_ptr read_sealed_head()const {
+               auto last = catalog->last_block_num();
+               if( !last )
+                  return {};
+               block_log_entry entry;
+               catalog->load( last )->load( last, entry );
+               return entry.block();
+            }
+
+            void schedule_maintenance() {
+               if( !cfg.compress_segments && !cfg.retained_segments )
+                  return;
+               boost::asio::post( worker, [catalog = catalog, cfg = cfg]() {
+                  try {
+                     catalog->maintain( cfg );
+                  } catch( const fc::exception& e ) {
+                     elog( "Block log segment maintenance failed: ${e}", ("e", e.to_detail_string()) );
+                  } catch( const std::exception& e ) {
+                     elog( "Block log segment maintenance failed: ${e}", ("e", e.what()) );
+                  }
+               } );
+            }
+
+            /// waits for maintenance that was scheduled so far
+            void wait_for_maintenance() {
+               async_thread_pool( worker, [](){} ).wait();
+            }
       };
 
       void block_log_impl::reopen() {
@@ -68,13 +507,165 @@ namespace gstio { namespace chain {
 
          open_files = true;
       }
+
+      void block_log_impl::load_segments() {
+         std::map<uint32_t, log_segment> found;
+         auto scan = [&]( const fc::path& dir, bool archived ) {
+            if( !fc::is_directory( dir ) )
+               return;
+            for( fc::directory_iterator itr( dir ), end; itr != end; ++itr ) {
+               log_segment seg;
+               if( !log_segment::parse( *itr, seg ) )
+                  continue;
+               seg.archived = archived;
+               auto res = found.emplace( seg.first_block_num, seg );
+               if( res.second )
+                  continue;
+
+               // left behind by an interrupted compression or archival: the archived copy and the compressed log are only
+               // renamed into place once complete, so they are kept and the other copy is removed
+               auto& existing = res.first->second;
+               bool keep_new = seg.archived != existing.archived ? seg.archived : seg.compressed;
+               auto& dropped = keep_new ? existing : seg;
+               wlog( "Removing superseded block log segment ${f}", ("f", dropped.log_file) );
+               fc::remove( dropped.log_file );
+               if( dropped.archived != (keep_new ? seg : existing).archived )
+                  fc::remove( dropped.index_file );
+               if( keep_new )
+                  existing = seg;
+            }
+         };
+         scan( data_dir, false );
+         if( cfg.archive_dir != data_dir )
+            scan( cfg.archive_dir, true );
+
+         std::vector<log_segment> segments;
+         for( auto& f : found ) {
+            if( !segments.empty() ) {
+               GST_ASSERT( segments.back().last_block_num + 1 == f.second.first_block_num, block_log_exception,
+                           "Block log segments ${a} and ${b} are not contiguous", ("a", segments.back().log_file)("b", f.second.log_file) );
+            }
+            segments.push_back( std::move(f.second) );
+         }
+
+         // segments are independent, so lost indices are rebuilt in parallel
+         std::vector<const log_segment*> unindexed;
+         for( const auto& seg : segments ) {
+            if( !fc::exists( seg.index_file ) || fc::file_size( seg.index_file ) != seg.block_count() * sizeof(uint64_t) )
+               unindexed.push_back( &seg );
+         }
+         if( !unindexed.empty() ) {
+            boost::asio::thread_pool pool( std::max<size_t>( 1, std::min<size_t>( unindexed.size(), std::thread::hardware_concurrency() ) ) );
+            std::vector<std::future<void>> rebuilt;
+            for( auto seg : unindexed )
+               rebuilt.emplace_back( async_thread_pool( pool, [seg]() { seg->construct_index(); } ) );
+            for( auto& f : rebuilt )
+               f.get();
+            pool.join();
+         }
+
+         std::lock_guard<std::mutex> g( catalog->mtx );
+         catalog->segments = std::move(segments);
+         catalog->cached.clear();
+      }
+
+      void block_log_impl::seal_segment() {
+         uint32_t last = block_header::num_from_id( head_id );
+         uint32_t first;
+         genesis_state gs;
+         {
+            std::fstream log( block_file.generic_string().c_str(), LOG_READ );
+            gs = read_genesis( log, first );
+         }
+         close();
+
+         log_segment seg;
+         seg.first_block_num = first_block_num;
+         seg.last_block_num  = last;
+         seg.log_file        = log_segment::file_name( data_dir, first_block_num, last, log_segment::log_suffix() );
+         seg.index_file      = log_segment::file_name( data_dir, first_block_num, last, log_segment::index_suffix() );
+         fc::rename( index_file, seg.index_file );
+         fc::rename( block_file, seg.log_file );
+         catalog->add( std::move(seg) );
+         ilog( "Sealed block log segment of blocks ${f} through ${l}", ("f", first_block_num)("l", last) );
+
+         start_log( gs, last + 1 );
+         schedule_maintenance();
+      }
+
+      void block_log_impl::start_log( const genesis_state& gs, uint32_t first_block ) {
+         close();
+         fc::remove_all( block_file );
+         fc::remove_all( index_file );
+         reopen();
+
+         version = block_log::max_supported_version;
+         first_block_num = first_block;
+         auto data = fc::raw::pack( gs );
+         auto totem = block_log::npos;
+         block_stream.seekp( 0, std::ios::end );
+         block_stream.write( (char*)&version, sizeof(version) );
+         block_stream.write( (char*)&first_block_num, sizeof(first_block_num) );
+         block_stream.write( data.data(), data.size() );
+         block_stream.write( (char*)&totem, sizeof(totem) );
+         block_stream.flush();
+         genesis_written_to_block_log = true;
+      }
+   }
+
+   signed_block_ptr block_log_entry::block()const {
+      auto b = std::make_shared<signed_block>();
+      fc::datastream<const char*> ds( data, size );
+      fc::raw::unpack( ds, *b );
+      return b;
+   }
+
+   block_log_range::block_log_range( std::shared_ptr<detail::block_log_catalog> catalog, std::shared_ptr<const detail::block_log_mapping> active,
+                                     uint32_t first, uint32_t last )
+   :_catalog(std::move(catalog)), _active(std::move(active)), _first(first), _last(last) {}
+
+   std::shared_ptr<const detail::block_log_mapping> block_log_range::mapping_for( uint32_t block_num )const {
+      if( _active && block_num >= _active->first_block_num )
+         return _active;
+      return _catalog->load( block_num );
+   }
+
+   block_log_range::iterator block_log_range::begin()const {
+      return iterator( this, _first );
+   }
+
+   block_log_range::iterator block_log_range::end()const {
+      return iterator( this, _last + 1 );
+   }
+
+   block_log_range::iterator::iterator( const block_log_range* range, uint32_t block_num )
+   :_range(range) {
+      _entry.block_num = block_num;
+      load();
+   }
+
+   void block_log_range::iterator::load() {
+      if( _entry.block_num > _range->_last )
+         return;
+      if( !_mapping || _entry.block_num > _mapping->last_block_num ) {
+         // released first, so a decompressed segment left behind does not count against the catalog's memory cap
+         _mapping.reset();
+         _mapping = _range->mapping_for( _entry.block_num );
+      }
+      _mapping->load( _entry.block_num, _entry );
+   }
+
+   block_log_range::iterator& block_log_range::iterator::operator++() {
+      ++_entry.block_num;
+      load();
+      return *this;
    }
 
-   block_log::block_log(const fc::path& data_dir)
+   block_log::block_log(const fc::path& data_dir, const block_log_config& cfg)
    :my(new detail::block_log_impl()) {
       my->block_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
       my->index_stream.exceptions(std::fstream::failbit | std::fstream::badbit);
-      open(data_dir);
+      open(data_dir, cfg);
    }
 
    block_log::block_log(block_log&& other) {
@@ -89,16 +680,22 @@ namespace gstio { namespace chain {
       }
    }
 
-   void block_log::open(const fc::path& data_dir) {
+   void block_log::open(const fc::path& data_dir, const block_log_config& cfg) {
       my->close();
 
       if (!fc::is_directory(data_dir))
          fc::create_directories(data_dir);
 
+      my->data_dir = data_dir;
       my->block_file = data_dir / "blocks.log";
       my->index_file = data_dir / "blocks.index";
+      my->cfg = cfg;
+      if (my->cfg.archive_dir == fc::path())
+         my->cfg.archive_dir = data_dir / config::default_blocks_archive_dir_name;
 
+      my->catalog = std::make_shared<detail::block_log_catalog>( cfg.decompressed_cache_size );
       my->reopen();
+      my->load_segments();
 
       /* On startup of the block log, there are several states the log file and the index file can be
        * in relation to each other.
@@ -141,12 +738,7 @@ namespace gstio { namespace chain {
             my->first_block_num = 1;
          }
 
-         my->head = read_head();
-         if( my->head ) {
-            my->head_id = my->head->id();
-         } else {
-            my->head_id = {};
-         }
+         my->set_head( read_head() );
 
          if (index_size) {
             ilog("Index is nonempty");
@@ -169,12 +761,24 @@ namespace gstio { namespace chain {
             ilog("Index is empty");
             construct_index();
          }
+      } else if (auto sealed = my->catalog->last_block_num()) {
+         // the log was sealed but the next one was not started
+         ilog("Starting block log after sealed segment ending at block ${n}", ("n", sealed));
+         my->start_log(my->catalog->load(sealed)->genesis(), sealed + 1);
+         my->set_head( my->read_sealed_head() );
       } else if (index_size) {
          ilog("Index is nonempty, remove and recreate it");
          my->close();
          fc::remove_all(my->index_file);
          my->reopen();
       }
+
+      if (auto sealed = my->catalog->last_block_num()) {
+         GST_ASSERT(sealed + 1 == my->first_block_num, block_log_exception,
+                    "Block log starting at block ${first} does not continue the sealed segment ending at block ${last}",
+                    ("first", my->first_block_num)("last", sealed));
+      }
+      my->schedule_maintenance();
    }
 
    uint64_t block_log::append(const signed_block_ptr& b) {
@@ -183,6 +787,10 @@ namespace gstio { namespace chain {
 
          my->check_open_files();
 
+         if (my->cfg.blocks_per_segment && b->block_num() > my->first_block_num && (b->block_num() - 1) % my->cfg.blocks_per_segment == 0) {
+            my->seal_segment();
+         }
+
          my->block_stream.seekp(0, std::ios::end);
          my->index_stream.seekp(0, std::ios::end);
          uint64_t pos = my->block_stream.tellp();
@@ -195,8 +803,7 @@ namespace gstio { namespace chain {
          my->block_stream.write(data.data(), data.size());
          my->block_stream.write((char*)&pos, sizeof(pos));
          my->index_stream.write((char*)&pos, sizeof(pos));
-         my->head = b;
-         my->head_id = b->id();
+         my->set_head( b );
 
          flush();
 
@@ -211,11 +818,35 @@ namespace gstio { namespace chain {
    }
 
    void block_log::reset( const genesis_state& gs, const signed_block_ptr& first_block, uint32_t first_block_num ) {
+      my->wait_for_maintenance();
+      {
+         // archived segments may be the only copy of old blocks, so they are only dropped when explicitly configured
+         std::lock_guard<std::mutex> g( my->catalog->mtx );
+         auto archived = std::find_if( my->catalog->segments.begin(), my->catalog->segments.end(),
+                                       []( const detail::log_segment& s ) { return s.archived; } );
+         GST_ASSERT( archived == my->catalog->segments.end() || my->cfg.remove_archive_on_reset, block_log_exception,
+                     "Block log archive ${dir} holds blocks starting at ${n} which a reset of the block log would discard; "
+                     "move the archive away or allow its removal on reset",
+                     ("dir", my->cfg.archive_dir)("n", archived == my->catalog->segments.end() ? 0 : archived->first_block_num) );
+      }
+
       my->close();
 
       fc::remove_all(my->block_file);
       fc::remove_all(my->index_file);
 
+      {
+         std::lock_guard<std::mutex> g( my->catalog->mtx );
+         for( const auto& seg : my->catalog->segments ) {
+            if( seg.archived )
+               wlog( "Removing archived block log segment ${f}", ("f", seg.log_file) );
+            fc::remove( seg.log_file );
+            fc::remove( seg.index_file );
+         }
+      }
+      my->catalog = std::make_shared<detail::block_log_catalog>( my->cfg.decompressed_cache_size );
+      my->set_head( signed_block_ptr() );
+
       my->reopen();
 
       auto data = fc::raw::pack(gs);
@@ -245,23 +876,23 @@ namespace gstio { namespace chain {
       flush();
    }
 
-   std::pair<signed_block_ptr, uint64_t> block_log::read_block(uint64_t pos)const {
-      my->check_open_files();
+   std::pair<signed_block_ptr, uint64_t> detail::block_log_impl::read_block(uint64_t pos) {
+      check_open_files();
 
-      my->block_stream.seekg(pos);
+      block_stream.seekg(pos);
       std::pair<signed_block_ptr,uint64_t> result;
       result.first = std::make_shared<signed_block>();
-      fc::raw::unpack(my->block_stream, *result.first);
-      result.second = uint64_t(my->block_stream.tellg()) + 8;
+      fc::raw::unpack(block_stream, *result.first);
+      result.second = uint64_t(block_stream.tellg()) + 8;
       return result;
    }
 
    signed_block_ptr block_log::read_block_by_num(uint32_t block_num)const {
       try {
          signed_block_ptr b;
-         uint64_t pos = get_block_pos(block_num);
-         if (pos != npos) {
-            b = read_block(pos).first;
+         auto range = read_block_range(block_num, block_num);
+         if (!range.empty()) {
+            b = range.begin()->block();
             GST_ASSERT(b->block_num() == block_num, reversible_blocks_exception,
                       "Wrong block was read from block log.", ("returned", b->block_num())("expected", block_num));
          }
@@ -269,10 +900,29 @@ namespace gstio { namespace chain {
       } FC_LOG_AND_RETHROW()
    }
 
+   block_log_range block_log::read_block_range(uint32_t first, uint32_t last)const {
+      my->check_open_files();
+      if (!my->head)
+         return {};
+      uint32_t head_num = block_header::num_from_id(my->head_id);
+
+      first = std::max(first, first_block_num());
+      last = std::min(last, head_num);
+      if (first > last)
+         return {};
+
+      std::shared_ptr<const detail::block_log_mapping> active;
+      if (last >= my->first_block_num)
+         active = my->mapping_through(head_num);
+      return block_log_range(my->catalog, std::move(active), first, last);
+   }
+
    uint64_t block_log::get_block_pos(uint32_t block_num) const {
       my->check_open_files();
-      if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num >= my->first_block_num))
+      if (!(my->head && block_num <= block_header::num_from_id(my->head_id) && block_num >= first_block_num()))
          return npos;
+      if (block_num < my->first_block_num)
+         return my->catalog->load(block_num)->index_at(block_num);
       my->index_stream.seekg(sizeof(uint64_t) * (block_num - my->first_block_num));
       uint64_t pos;
       my->index_stream.read((char*)&pos, sizeof(pos));
@@ -287,14 +937,14 @@ namespace gstio { namespace chain {
       // Check that the file is not empty
       my->block_stream.seekg(0, std::ios::end);
       if (my->block_stream.tellg() <= sizeof(pos))
-         return {};
+         return my->read_sealed_head();
 
       my->block_stream.seekg(-sizeof(pos), std::ios::end);
       my->block_stream.read((char*)&pos, sizeof(pos));
       if (pos != npos) {
-         return read_block(pos).first;
+         return my->read_block(pos).first;
       } else {
-         return {};
+         return my->read_sealed_head();
       }
    }
 
@@ -303,7 +953,8 @@ namespace gstio { namespace chain {
    }
 
    uint32_t block_log::first_block_num() const {
-      return my->first_block_num;
+      auto sealed = my->catalog->first_block_num();
+      return sealed ? sealed : my->first_block_num;
    }
 
    void block_log::construct_index() {
@@ -379,6 +1030,19 @@ namespace gstio { namespace chain {
       fc::create_directories(blocks_dir);
       auto block_log_path = blocks_dir / "blocks.log";
 
+      // sealed segments are never written after sealing, only the current log needs to be recovered
+      for( fc::directory_iterator itr( backup_dir ), end; itr != end; ++itr ) {
+         detail::log_segment seg;
+         if( detail::log_segment::parse( *itr, seg ) ) {
+            fc::rename( seg.log_file, blocks_dir / seg.log_file.filename() );
+            if( fc::exists( seg.index_file ) )
+               fc::rename( seg.index_file, blocks_dir / seg.index_file.filename() );
+         }
+      }
+      if( fc::is_directory( backup_dir / config::default_blocks_archive_dir_name ) ) {
+         fc::rename( backup_dir / config::default_blocks_archive_dir_name, blocks_dir / config::default_blocks_archive_dir_name );
+      }
+
       ilog( "Reconstructing '${new_block_log}' from backed up block log", ("new_block_log", block_log_path) );
 
       std::fstream  old_block_stream;
@@ -523,21 +1187,8 @@ namespace gstio { namespace chain {
       std::fstream  block_stream;
       block_stream.open( (data_dir / "blocks.log").generic_string().c_str(), LOG_READ );
 
-      uint32_t version = 0;
-      block_stream.read( (char*)&version, sizeof(version) );
-      GST_ASSERT( version > 0, block_log_exception, "Block log was not setup properly." );
-      GST_ASSERT( version >= min_supported_version && version <= max_supported_version, block_log_unsupported_version,
-                 "Unsupported version of block log. Block log version is ${version} while code supports version(s) [${min},${max}]",
-                 ("version", version)("min", block_log::min_supported_version)("max", block_log::max_supported_version) );
-
-      uint32_t first_block_num = 1;
-      if (version != 1) {
-         block_stream.read ( (char*)&first_block_num, sizeof(first_block_num) );
-      }
-
-      genesis_state gs;
-      fc::raw::unpack(block_stream, gs);
-      return gs;
+      uint32_t first_block_num;
+      return detail::read_genesis( block_stream, first_block_num );
    }
 
 } } /// gstio::chain
@@ -13,6 +13,7 @@
 #include <gstio/chain/generated_transaction_object.hpp>
 #include <gstio/chain/transaction_object.hpp>
 #include <gstio/chain/reversible_block_object.hpp>
+#include <gstio/chain/state_index_set.hpp>
 
 #include <gstio/chain/authorization_manager.hpp>
 #include <gstio/chain/resource_limits.hpp>
@@ -28,26 +29,6 @@ namespace gstio { namespace chain {
 
 using resource_limits::resource_limits_manager;
 
-using controller_index_set = index_set<
-   account_index,
-   account_sequence_index,
-   global_property_multi_index,
-   dynamic_global_property_multi_index,
-   block_summary_multi_index,
-   transaction_multi_index,
-   generated_transaction_multi_index,
-   table_id_multi_index
->;
-
-using contract_database_index_set = index_set<
-   key_value_index,
-   index64_index,
-   index128_index,
-   index256_index,
-   index_double_index,
-   index_long_double_index
->;
-
 class maybe_session {
    public:
       maybe_session() = default;
@@ -134,6 +115,14 @@ struct controller_impl {
    uint32_t                       snapshot_head_block = 0;
    boost::asio::thread_pool       thread_pool;
 
+   /// a block read ahead of execution by the replay pipeline, with its transactions already unpacked
+   struct replay_block {
+      signed_block_ptr                       block;
+      std::vector<transaction_metadata_ptr>  trxs;
+   };
+   replay_block                   replay_prepared; ///< consumed by apply_block when it applies replay_prepared.block
+   state_delta_source             replay_state_delta_source;
+
    typedef pair<scope_name,action_name>                   handler_key;
    map< account_name, map<handler_key, apply_handler> >   apply_handlers;
 
@@ -172,13 +161,15 @@ struct controller_impl {
    :self(s),
     db( cfg.state_dir,
         cfg.read_only ? database::read_only : database::read_write,
-        cfg.state_size ),
+        cfg.state_size, false, cfg.state_undo_mode, cfg.state_map_mode, cfg.state_hugepage_size ),
     reversible_blocks( cfg.blocks_dir/config::reversible_blocks_dir_name,
         cfg.read_only ? database::read_only : database::read_write,
         cfg.reversible_cache_size ),
-    blog( cfg.blocks_dir ),
+    blog( cfg.blocks_dir, block_log_config{ cfg.blocks_log_segment_size, cfg.compress_blocks_log_segments,
+                                            cfg.blocks_log_retained_segments, cfg.blocks_archive_dir,
+                                            cfg.remove_blocks_archive_on_reset, cfg.blocks_decompressed_cache_size } ),
     fork_db( cfg.state_dir ),
-    wasmif( cfg.wasm_runtime ),
+    wasmif( cfg.wasm_runtime, wasm_interface::cache_config{ cfg.wasm_cache_size, cfg.wasm_cache_max_entries, cfg.wasm_cache_pinned_accounts, cfg.wasm_code_cache_dir, cfg.wasm_code_cache_size } ),
     resource_limits( db ),
     authorization( s, db ),
     conf( cfg ),
@@ -310,11 +301,17 @@ struct controller_impl {
             ("s", start_block_num)("n", blog_head->block_num()) );
 
       auto start = fc::time_point::now();
-      while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
-         replay_push_block( next, controller::block_status::irreversible );
-         if( next->block_num() % 500 == 0 ) {
-            ilog( "${n} of ${head}", ("n", next->block_num())("head", blog_head->block_num()) );
-            if( shutdown() ) break;
+      if( replay_state_delta_source && read_mode != db_read_mode::IRREVERSIBLE ) {
+         replay_state_deltas( blog_head->block_num(), shutdown );
+      } else if( conf.replay_lookahead_blocks > 0 ) {
+         replay_pipelined( blog_head->block_num(), shutdown );
+      } else {
+         while( auto next = blog.read_block_by_num( head->block_num + 1 ) ) {
+            replay_push_block( next, controller::block_status::irreversible );
+            if( next->block_num() % 500 == 0 ) {
+               ilog( "${n} of ${head}", ("n", next->block_num())("head", blog_head->block_num()) );
+               if( shutdown() ) break;
+            }
          }
       }
       ilog( "${n} blocks replayed", ("n", head->block_num - start_block_num) );
@@ -339,6 +336,104 @@ struct controller_impl {
       replay_head_time.reset();
    }
 
+   /**
+    * Replays the irreversible blocks of the block log up to last_block_num in three stages: blocks are unpacked
+    * on the thread pool up to replay_lookahead_blocks ahead of execution, signing keys of their transactions are
+    * recovered on the thread pool (when force_all_checks is set) for up to another replay_lookahead_blocks, and
+    * the main thread only executes the blocks.
+    */
+   void replay_pipelined( uint32_t last_block_num, const std::function<bool()>& shutdown ) {
+      const uint32_t lookahead = conf.replay_lookahead_blocks;
+      auto range = blog.read_block_range( head->block_num + 1, last_block_num );
+      auto next_entry = range.begin();
+
+      deque<std::future<replay_block>> unpacking;
+      deque<replay_block>              recovering;
+
+      auto report_time = fc::time_point::now();
+      uint32_t report_block_num = head->block_num;
+      while( true ) {
+         while( unpacking.size() < lookahead && next_entry != range.end() ) {
+            // the copied iterator keeps the mapping the entry points into alive until the task has run
+            unpacking.emplace_back( async_thread_pool( thread_pool, [entry = next_entry]() {
+               replay_block rb{ entry->block() };
+               rb.trxs.reserve( rb.block->transactions.size() );
+               for( const auto& receipt : rb.block->transactions ) {
+                  if( receipt.trx.contains<packed_transaction>() ) {
+                     rb.trxs.emplace_back( std::make_shared<transaction_metadata>(
+                           std::make_shared<packed_transaction>( receipt.trx.get<packed_transaction>() ) ) );
+                  }
+               }
+               return rb;
+            } ) );
+            ++next_entry;
+         }
+         // only wait for an unpacked block when there is nothing else to execute
+         while( !unpacking.empty() && recovering.size() < lookahead &&
+                (recovering.empty() || unpacking.front().wait_for( std::chrono::seconds( 0 ) ) == std::future_status::ready) ) {
+            recovering.emplace_back( unpacking.front().get() );
+            unpacking.pop_front();
+            if( conf.force_all_checks ) {
+               for( const auto& mtrx : recovering.back().trxs ) {
+                  transaction_metadata::start_recover_keys( mtrx, thread_pool, chain_id, microseconds::maximum() );
+               }
+            }
+         }
+         if( recovering.empty() )
+            break;
+
+         replay_prepared = std::move( recovering.front() );
+         recovering.pop_front();
+         auto block = replay_prepared.block;
+         replay_push_block( block, controller::block_status::irreversible );
+         replay_prepared = replay_block();
+
+         if( block->block_num() % 500 == 0 ) {
+            auto now = fc::time_point::now();
+            auto elapsed_us = std::max<int64_t>( (now - report_time).count(), 1 );
+            ilog( "${n} of ${head}, ${bps} blocks/sec, ${ahead} blocks read ahead",
+                  ("n", block->block_num())("head", last_block_num)
+                  ("bps", (block->block_num() - report_block_num) * 1000000 / elapsed_us)
+                  ("ahead", unpacking.size() + recovering.size()) );
+            report_time = now;
+            report_block_num = block->block_num();
+            if( shutdown() ) break;
+         }
+      }
+   }
+
+   /**
+    * Replays the irreversible blocks of the block log up to last_block_num without executing the blocks for which
+    * replay_state_delta_source has recorded state changes, those changes are applied to the database instead.
+    */
+   void replay_state_deltas( uint32_t last_block_num, const std::function<bool()>& shutdown ) {
+      uint32_t applied = 0;
+      uint32_t executed = 0;
+      uint32_t verified = 0;
+      auto range = blog.read_block_range( head->block_num + 1, last_block_num );
+      for( auto itr = range.begin(); itr != range.end(); ++itr ) {
+         auto block = itr->block();
+         auto recorded = replay_state_delta_source( block );
+         if( recorded ) {
+            replay_push_block_state( block, *recorded );
+            ++applied;
+            if( recorded->integrity_hash )
+               ++verified;
+         } else {
+            replay_push_block( block, controller::block_status::irreversible );
+            ++executed;
+         }
+
+         if( block->block_num() % 500 == 0 ) {
+            ilog( "${n} of ${head}, ${a} blocks applied from state deltas, ${e} executed",
+                  ("n", block->block_num())("head", last_block_num)("a", applied)("e", executed) );
+            if( shutdown() ) break;
+         }
+      }
+      ilog( "${a} blocks applied from state deltas, ${v} of them verified against their recorded integrity hash, ${e} blocks executed",
+            ("a", applied)("v", verified)("e", executed) );
+   }
+
    void init(std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot) {
 
       bool report_integrity_hash = !!snapshot;
@@ -1248,15 +1343,25 @@ struct controller_impl {
          start_block( b->timestamp, b->confirmed, s , producer_block_id);
 
          std::vector<transaction_metadata_ptr> packed_transactions;
-         packed_transactions.reserve( b->transactions.size() );
-         for( const auto& receipt : b->transactions ) {
-            if( receipt.trx.contains<packed_transaction>()) {
-               auto& pt = receipt.trx.get<packed_transaction>();
-               auto mtrx = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( pt ) );
-               if( !self.skip_auth_check() ) {
-                  transaction_metadata::start_recover_keys( mtrx, thread_pool, chain_id, microseconds::maximum() );
+         if( replay_prepared.block == b ) {
+            packed_transactions = std::move( replay_prepared.trxs );
+            if( !self.skip_auth_check() ) {
+               for( const auto& mtrx : packed_transactions ) {
+                  if( !mtrx->signing_keys_future.valid() )
+                     transaction_metadata::start_recover_keys( mtrx, thread_pool, chain_id, microseconds::maximum() );
+               }
+            }
+         } else {
+            packed_transactions.reserve( b->transactions.size() );
+            for( const auto& receipt : b->transactions ) {
+               if( receipt.trx.contains<packed_transaction>()) {
+                  auto& pt = receipt.trx.get<packed_transaction>();
+                  auto mtrx = std::make_shared<transaction_metadata>( std::make_shared<packed_transaction>( pt ) );
+                  if( !self.skip_auth_check() ) {
+                     transaction_metadata::start_recover_keys( mtrx, thread_pool, chain_id, microseconds::maximum() );
+                  }
+                  packed_transactions.emplace_back( std::move( mtrx ) );
                }
-               packed_transactions.emplace_back( std::move( mtrx ) );
             }
          }
 
@@ -1321,6 +1426,25 @@ struct controller_impl {
       }
    } FC_CAPTURE_AND_RETHROW() } /// apply_block
 
+   /// starts preparing contracts set by a received block so they are ready when the block is applied
+   void precompile_new_code( const signed_block& b ) {
+      for( const auto& receipt : b.transactions ) {
+         if( !receipt.trx.contains<packed_transaction>() )
+            continue;
+         for( const auto& act : receipt.trx.get<packed_transaction>().get_transaction().actions ) {
+            if( act.account != config::system_account_name || act.name != setcode::get_name() )
+               continue;
+            try {
+               auto sc = act.data_as<setcode>();
+               if( sc.code.size() > 0 )
+                  wasmif.precompile( fc::sha256::hash( sc.code.data(), (uint32_t)sc.code.size() ), sc.code, thread_pool );
+            } catch( const fc::exception& ) {
+               // malformed setcode is rejected when the block is applied
+            }
+         }
+      }
+   }
+
    std::future<block_state_ptr> create_block_state_future( const signed_block_ptr& b ) {
       GST_ASSERT( b, block_validate_exception, "null block" );
 
@@ -1333,7 +1457,8 @@ struct controller_impl {
       auto prev = fork_db.get_block( b->previous );
       GST_ASSERT( prev, unlinkable_block_exception, "unlinkable block ${id}", ("id", id)("previous", b->previous) );
 
-      return async_thread_pool( thread_pool, [b, prev]() {
+      return async_thread_pool( thread_pool, [b, prev, this]() {
+         precompile_new_code( *b );
          const bool skip_validate_signee = false;
          return std::make_shared<block_state>( *prev, move( b ), skip_validate_signee );
       } );
@@ -1392,6 +1517,48 @@ struct controller_impl {
       } FC_LOG_AND_RETHROW( )
    }
 
+   /**
+    * Makes b the head block by applying the state changes recorded for it rather than executing it. The block header
+    * is still validated by the fork database. Like replay_push_block with block_status::irreversible, but neither
+    * applied_transaction nor accepted_block are emitted as there are no traces to report.
+    */
+   void replay_push_block_state( const signed_block_ptr& b, const block_state_deltas& recorded ) {
+      self.validate_db_available_size();
+
+      GST_ASSERT(!pending, block_validate_exception, "it is not valid to push a block when there is a pending block");
+
+      try {
+         GST_ASSERT( b, block_validate_exception, "trying to push empty block" );
+         emit( self.pre_accepted_block, b );
+         const bool skip_validate_signee = !conf.force_all_checks;
+         auto new_header_state = fork_db.add( b, skip_validate_signee );
+
+         emit( self.accepted_block_header, new_header_state );
+
+         GST_ASSERT( new_header_state->header.previous == head->id, block_validate_exception,
+                     "recorded state changes of block ${n} do not apply on top of the head block", ("n", b->block_num()) );
+
+         auto session = self.skip_db_sessions( controller::block_status::irreversible ) ? maybe_session() : maybe_session(db);
+         apply_state_deltas( db, recorded.deltas );
+         session.push();
+
+         new_header_state->validated = true;
+         fork_db.mark_in_current_chain( new_header_state, true );
+         fork_db.set_validity( new_header_state, true );
+         head = new_header_state;
+
+         if( recorded.integrity_hash ) {
+            const auto hash = calculate_integrity_hash();
+            GST_ASSERT( hash == *recorded.integrity_hash, block_validate_exception,
+                        "state after applying the recorded changes of block ${n} has hash ${hash}, the recorded hash is ${recorded}",
+                        ("n", b->block_num())("hash", hash)("recorded", *recorded.integrity_hash) );
+         }
+
+         emit( self.irreversible_block, new_header_state );
+
+      } FC_LOG_AND_RETHROW( )
+   }
+
    void maybe_switch_forks( controller::block_status s ) {
       auto new_head = fork_db.head();
 
@@ -1788,6 +1955,10 @@ void controller::add_indices() {
    my->add_indices();
 }
 
+void controller::set_replay_state_delta_source( state_delta_source source ) {
+   my->replay_state_delta_source = std::move( source );
+}
+
 void controller::startup( std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot ) {
    my->head = my->fork_db.head();
    if( snapshot ) {
@@ -1816,28 +1987,32 @@ chainbase::database& controller::mutable_db()const { return my->db; }
 const fork_database& controller::fork_db()const { return my->fork_db; }
 
 
+// everything that changes chain state holds the state write lock, so read only API threads see it between changes
+
 void controller::start_block( block_timestamp_type when, uint16_t confirm_block_count) {
    validate_db_available_size();
-   my->start_block(when, confirm_block_count, block_status::incomplete, optional<block_id_type>() );
+   my->db.with_write_lock( [&]() {
+      my->start_block(when, confirm_block_count, block_status::incomplete, optional<block_id_type>() );
+   } );
 }
 
 void controller::finalize_block() {
    validate_db_available_size();
-   my->finalize_block();
+   my->db.with_write_lock( [&]() { my->finalize_block(); } );
 }
 
 void controller::sign_block( const std::function<signature_type( const digest_type& )>& signer_callback ) {
-   my->sign_block( signer_callback );
+   my->db.with_write_lock( [&]() { my->sign_block( signer_callback ); } );
 }
 
 void controller::commit_block() {
    validate_db_available_size();
    validate_reversible_available_size();
-   my->commit_block(true);
+   my->db.with_write_lock( [&]() { my->commit_block(true); } );
 }
 
 void controller::abort_block() {
-   my->abort_block();
+   my->db.with_write_lock( [&]() { my->abort_block(); } );
 }
 
 boost::asio::thread_pool& controller::get_thread_pool() {
@@ -1851,20 +2026,24 @@ std::future<block_state_ptr> controller::create_block_state_future( const signed
 void controller::push_block( std::future<block_state_ptr>& block_state_future ) {
    validate_db_available_size();
    validate_reversible_available_size();
-   my->push_block( block_state_future );
+   my->db.with_write_lock( [&]() { my->push_block( block_state_future ); } );
 }
 
 transaction_trace_ptr controller::push_transaction( const transaction_metadata_ptr& trx, fc::time_point deadline, uint32_t billed_cpu_time_us ) {
    validate_db_available_size();
    GST_ASSERT( get_read_mode() != chain::db_read_mode::READ_ONLY, transaction_type_exception, "push transaction not allowed in read-only mode" );
    GST_ASSERT( trx && !trx->implicit && !trx->scheduled, transaction_type_exception, "Implicit/Scheduled transaction not allowed" );
-   return my->push_transaction(trx, deadline, billed_cpu_time_us, billed_cpu_time_us > 0 );
+   return my->db.with_write_lock( [&]() {
+      return my->push_transaction(trx, deadline, billed_cpu_time_us, billed_cpu_time_us > 0 );
+   } );
 }
 
 transaction_trace_ptr controller::push_scheduled_transaction( const transaction_id_type& trxid, fc::time_point deadline, uint32_t billed_cpu_time_us )
 {
    validate_db_available_size();
-   return my->push_scheduled_transaction( trxid, deadline, billed_cpu_time_us, billed_cpu_time_us > 0 );
+   return my->db.with_write_lock( [&]() {
+      return my->push_scheduled_transaction( trxid, deadline, billed_cpu_time_us, billed_cpu_time_us > 0 );
+   } );
 }
 
 const flat_set<account_name>& controller::get_actor_whitelist() const {
@@ -1997,6 +2176,10 @@ signed_block_ptr controller::fetch_block_by_number( uint32_t block_num )const  {
    return my->blog.read_block_by_num(block_num);
 } FC_CAPTURE_AND_RETHROW( (block_num) ) }
 
+block_log_range controller::fetch_block_log_range( uint32_t first, uint32_t last )const {
+   return my->blog.read_block_range( first, last );
+}
+
 block_state_ptr controller::fetch_block_state_by_id( block_id_type id )const {
    auto state = my->fork_db.get_block(id);
    return state;
@@ -2031,7 +2214,7 @@ void controller::write_snapshot( const snapshot_writer_ptr& snapshot ) const {
 }
 
 void controller::pop_block() {
-   my->pop_block();
+   my->db.with_write_lock( [&]() { my->pop_block(); } );
 }
 
 int64_t controller::set_proposed_producers( vector<producer_key> producers ) {
@@ -2169,6 +2352,10 @@ wasm_interface& controller::get_wasm_interface() {
    return my->wasmif;
 }
 
+const wasm_interface& controller::get_wasm_interface()const {
+   return my->wasmif;
+}
+
 const account_object& controller::get_account( account_name name )const
 { try {
    return my->db.get<account_object, by_name>(name);
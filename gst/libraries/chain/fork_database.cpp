@@ -42,10 +42,49 @@ namespace gstio { namespace chain {
    > fork_multi_index_type;
 
 
+   /**
+    *  Kinds of records in the fork database journal. Each record is the kind, the size of
+    *  its payload and the payload; they describe changes to the index rather than calls
+    *  so replaying them never emits signals or repeats validation.
+    */
+   enum class journal_record : uint8_t {
+      insert           = 0, ///< block_state
+      erase            = 1, ///< block_id_type
+      head             = 2, ///< block_id_type
+      in_current_chain = 3, ///< pair<block_id_type,bool>
+      validated        = 4, ///< block_id_type
+      confirmation     = 5, ///< header_confirmation
+      bft_irreversible = 6  ///< block_id_type
+   };
+
    struct fork_database_impl {
+      /// the journal is rewritten once it holds this many records more than twice the live blocks
+      static constexpr uint64_t journal_slack = 1024;
+
       fork_multi_index_type index;
       block_state_ptr       head;
       fc::path              datadir;
+
+      std::ofstream         journal;
+      uint64_t              journal_records = 0;
+      block_id_type         journal_head_id;
+
+      template<typename T>
+      void append( journal_record kind, const T& payload ) {
+         if( !journal.is_open() ) return;
+
+         auto size = fc::raw::pack_size( payload );
+         vector<char> record( sizeof(uint8_t) + sizeof(uint32_t) + size );
+         fc::datastream<char*> ds( record.data(), record.size() );
+         fc::raw::pack( ds, static_cast<uint8_t>(kind) );
+         fc::raw::pack( ds, static_cast<uint32_t>(size) );
+         fc::raw::pack( ds, payload );
+
+         journal.write( record.data(), record.size() );
+         journal.flush();
+         GST_ASSERT( journal.good(), fork_database_exception, "unable to write fork database journal" );
+         ++journal_records;
+      }
    };
 
 
@@ -55,8 +94,11 @@ namespace gstio { namespace chain {
       if (!fc::is_directory(my->datadir))
          fc::create_directories(my->datadir);
 
+      auto fork_db_journal = my->datadir / config::forkdb_journal_filename;
       auto fork_db_dat = my->datadir / config::forkdb_filename;
-      if( fc::exists( fork_db_dat ) ) {
+      if( fc::exists( fork_db_journal ) ) {
+         replay_journal( fork_db_journal );
+      } else if( fc::exists( fork_db_dat ) ) {
          string content;
          fc::read_file_contents( fork_db_dat, content );
 
@@ -71,30 +113,136 @@ namespace gstio { namespace chain {
          fc::raw::unpack( ds, head_id );
 
          my->head = get_block( head_id );
+      }
 
+      // start from a journal holding only the live blocks, which also drops a torn last record
+      compact_journal();
+      if( fc::exists( fork_db_dat ) )
          fc::remove( fork_db_dat );
+   }
+
+   void fork_database::replay_journal( const fc::path& journal ) {
+      string content;
+      fc::read_file_contents( journal, content );
+
+      fc::datastream<const char*> ds( content.data(), content.size() );
+      uint64_t records = 0;
+      while( ds.remaining() >= sizeof(uint8_t) + sizeof(uint32_t) ) {
+         uint8_t kind; uint32_t size;
+         fc::raw::unpack( ds, kind );
+         fc::raw::unpack( ds, size );
+         if( ds.remaining() < size ) break;
+
+         fc::datastream<const char*> payload( ds.pos(), size );
+         ds.skip( size );
+         ++records;
+
+         switch( static_cast<journal_record>(kind) ) {
+            case journal_record::insert: {
+               block_state s;
+               fc::raw::unpack( payload, s );
+               my->index.insert( std::make_shared<block_state>( move( s ) ) );
+               break;
+            }
+            case journal_record::erase: {
+               block_id_type id;
+               fc::raw::unpack( payload, id );
+               my->index.erase( id );
+               break;
+            }
+            case journal_record::head: {
+               block_id_type id;
+               fc::raw::unpack( payload, id );
+               my->head = get_block( id );
+               break;
+            }
+            case journal_record::in_current_chain: {
+               pair<block_id_type,bool> change;
+               fc::raw::unpack( payload, change );
+               auto itr = my->index.find( change.first );
+               if( itr != my->index.end() )
+                  my->index.modify( itr, [&]( auto& bsp ) { bsp->in_current_chain = change.second; } );
+               break;
+            }
+            case journal_record::validated: {
+               block_id_type id;
+               fc::raw::unpack( payload, id );
+               if( auto b = get_block( id ) )
+                  b->validated = true;
+               break;
+            }
+            case journal_record::confirmation: {
+               header_confirmation c;
+               fc::raw::unpack( payload, c );
+               if( auto b = get_block( c.block_id ) )
+                  b->add_confirmation( c );
+               break;
+            }
+            case journal_record::bft_irreversible: {
+               block_id_type id;
+               fc::raw::unpack( payload, id );
+               if( get_block( id ) )
+                  set_bft_irreversible( id );
+               break;
+            }
+            default:
+               GST_THROW( fork_database_exception, "unknown record kind ${k} in fork database journal", ("k", kind) );
+         }
       }
+
+      if( ds.remaining() )
+         wlog( "ignoring incomplete record at the end of the fork database journal" );
+      ilog( "restored ${n} blocks from ${r} fork database journal records", ("n", my->index.size())("r", records) );
    }
 
-   void fork_database::close() {
-      if( my->index.size() == 0 ) return;
+   void fork_database::compact_journal() {
+      auto journal = my->datadir / config::forkdb_journal_filename;
+      auto tmp = my->datadir / (string(config::forkdb_journal_filename) + ".tmp");
 
-      auto fork_db_dat = my->datadir / config::forkdb_filename;
-      std::ofstream out( fork_db_dat.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
-      uint32_t num_blocks_in_fork_db = my->index.size();
-      fc::raw::pack( out, unsigned_int{num_blocks_in_fork_db} );
-      for( const auto& s : my->index ) {
-         fc::raw::pack( out, *s );
+      if( my->journal.is_open() )
+         my->journal.close();
+
+      my->journal.open( tmp.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
+      my->journal_records = 0;
+      my->journal_head_id = block_id_type();
+
+      // parents first so the journal can always be replayed in order
+      for( const auto& s : my->index.get<by_block_num>() )
+         my->append( journal_record::insert, *s );
+      if( my->head ) {
+         my->append( journal_record::head, my->head->id );
+         my->journal_head_id = my->head->id;
+      }
+      my->journal.close();
+
+      fc::rename( tmp, journal );
+      my->journal.open( journal.generic_string().c_str(), std::ios::out | std::ios::binary | std::ios::app );
+      GST_ASSERT( my->journal.good(), fork_database_exception, "unable to open fork database journal" );
+   }
+
+   /// records a change of head, the point after which every public change is complete
+   void fork_database::journal_head() {
+      auto id = my->head ? my->head->id : block_id_type();
+      if( id != my->journal_head_id ) {
+         my->append( journal_record::head, id );
+         my->journal_head_id = id;
       }
-      if( my->head )
-         fc::raw::pack( out, my->head->id );
-      else
-         fc::raw::pack( out, block_id_type() );
+
+      if( my->journal.is_open() && my->journal_records > 2 * my->index.size() + fork_database_impl::journal_slack )
+         compact_journal();
+   }
+
+   void fork_database::close() {
+      if( !my->journal.is_open() ) return;
+      my->journal.close();
+
+      if( my->index.size() == 0 ) return;
 
       /// we don't normally indicate the head block as irreversible
       /// we cannot normally prune the lib if it is the head block because
       /// the next block needs to build off of the head block. We are exiting
       /// now so we can prune this block as irreversible before exiting.
+      /// The journal is already closed, so the block is still there after a restart.
       auto lib    = my->head->dpos_irreversible_blocknum;
       auto oldest = *my->index.get<by_block_num>().begin();
       if( oldest->block_num <= lib ) {
@@ -104,6 +252,7 @@ namespace gstio { namespace chain {
       my->index.clear();
    }
 
+
    fork_database::~fork_database() {
       close();
    }
@@ -116,11 +265,13 @@ namespace gstio { namespace chain {
          //FC_ASSERT( s->block_num == s->header.block_num() );
 
       GST_ASSERT( result.second, fork_database_exception, "unable to insert block state, duplicate state detected" );
+      my->append( journal_record::insert, *s );
       if( !my->head ) {
          my->head =  s;
       } else if( my->head->block_num < s->block_num ) {
          my->head =  s;
       }
+      journal_head();
    }
 
    block_state_ptr fork_database::add( const block_state_ptr& n, bool skip_validate_previous ) {
@@ -135,6 +286,7 @@ namespace gstio { namespace chain {
 
       auto inserted = my->index.insert(n);
       GST_ASSERT( inserted.second, fork_database_exception, "duplicate block added?" );
+      my->append( journal_record::insert, *n );
 
       my->head = *my->index.get<by_lib_block_num>().begin();
 
@@ -144,6 +296,7 @@ namespace gstio { namespace chain {
       if( oldest->block_num < lib ) {
          prune( oldest );
       }
+      journal_head();
 
       return n;
    }
@@ -215,8 +368,10 @@ namespace gstio { namespace chain {
 
       for( uint32_t i = 0; i < remove_queue.size(); ++i ) {
          auto itr = my->index.find( remove_queue[i] );
-         if( itr != my->index.end() )
+         if( itr != my->index.end() ) {
             my->index.erase(itr);
+            my->append( journal_record::erase, remove_queue[i] );
+         }
 
          auto& previdx = my->index.get<by_prev>();
          auto  previtr = previdx.lower_bound(remove_queue[i]);
@@ -227,6 +382,7 @@ namespace gstio { namespace chain {
       }
       //wdump((my->index.size()));
       my->head = *my->index.get<by_lib_block_num>().begin();
+      journal_head();
    }
 
    void fork_database::set_validity( const block_state_ptr& h, bool valid ) {
@@ -235,6 +391,7 @@ namespace gstio { namespace chain {
       } else {
          /// remove older than irreversible and mark block as valid
          h->validated = true;
+         my->append( journal_record::validated, h->id );
       }
    }
 
@@ -249,6 +406,7 @@ namespace gstio { namespace chain {
       by_id_idx.modify( itr, [&]( auto& bsp ) { // Need to modify this way rather than directly so that Boost MultiIndex can re-sort
          bsp->in_current_chain = in_current_chain;
       });
+      my->append( journal_record::in_current_chain, std::make_pair( h->id, in_current_chain ) );
    }
 
    void fork_database::prune( const block_state_ptr& h ) {
@@ -265,6 +423,7 @@ namespace gstio { namespace chain {
       if( itr != my->index.end() ) {
          irreversible(*itr);
          my->index.erase(itr);
+         my->append( journal_record::erase, h->id );
       }
 
       auto& numidx = my->index.get<by_block_num>();
@@ -301,6 +460,7 @@ namespace gstio { namespace chain {
       auto b = get_block( c.block_id );
       GST_ASSERT( b, fork_db_block_not_found, "unable to find block id ${id}", ("id",c.block_id));
       b->add_confirmation( c );
+      my->append( journal_record::confirmation, c );
 
       if( b->bft_irreversible_blocknum < b->block_num &&
          b->confirmations.size() >= ((b->active_schedule.producers.size() * 2) / 3 + 1) ) {
@@ -316,6 +476,8 @@ namespace gstio { namespace chain {
     *  This will require a search over all forks
     */
    void fork_database::set_bft_irreversible( block_id_type id ) {
+      my->append( journal_record::bft_irreversible, id );
+
       auto& idx = my->index.get<by_block_id>();
       auto itr = idx.find(id);
       uint32_t block_num = (*itr)->block_num;
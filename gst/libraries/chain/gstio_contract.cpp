@@ -170,6 +170,10 @@ void apply_gstio_setcode(apply_context& context) {
    if (new_size != old_size) {
       context.add_ram_usage( act.account, new_size - old_size );
    }
+
+   if( code_size > 0 ) {
+      context.control.get_wasm_interface().precompile( code_id, act.code, context.control.get_thread_pool() );
+   }
 }
 
 void apply_gstio_setabi(apply_context& context) {
@@ -7,6 +7,7 @@
 #include <gstio/chain/trace.hpp>
 #include <gstio/chain/exceptions.hpp>
 #include <fc/variant_object.hpp>
+#include <fc/io/json.hpp>
 #include <fc/scoped_exit.hpp>
 
 namespace gstio { namespace chain {
@@ -20,6 +21,7 @@ using namespace fc;
 namespace impl {
    struct abi_from_variant;
    struct abi_to_variant;
+   struct abi_to_json;
 
    struct abi_traverse_context;
    struct abi_traverse_context_with_path;
@@ -34,6 +36,10 @@ namespace impl {
 struct abi_serializer {
    abi_serializer(){ configure_built_in_types(); }
    abi_serializer( const abi_def& abi, const fc::microseconds& max_serialization_time );
+   abi_serializer( const abi_serializer& other );
+   abi_serializer( abi_serializer&& other ) = default;
+   abi_serializer& operator=( const abi_serializer& other );
+   abi_serializer& operator=( abi_serializer&& other ) = default;
    void set_abi(const abi_def& abi, const fc::microseconds& max_serialization_time);
 
    type_name resolve_type(const type_name& t)const;
@@ -56,12 +62,25 @@ struct abi_serializer {
    fc::variant binary_to_variant( const type_name& type, const bytes& binary, const fc::microseconds& max_serialization_time, bool short_path = false )const;
    fc::variant binary_to_variant( const type_name& type, fc::datastream<const char*>& binary, const fc::microseconds& max_serialization_time, bool short_path = false )const;
 
+   /**
+    *  Appends to out the json that fc::json::to_string( binary_to_variant( type, binary, ... ) ) returns, without
+    *  building the variant. On failure out holds a partial document.
+    */
+   void        binary_to_json( const type_name& type, const bytes& binary, string& out, const fc::microseconds& max_serialization_time, bool short_path = false )const;
+
    bytes       variant_to_binary( const type_name& type, const fc::variant& var, const fc::microseconds& max_serialization_time, bool short_path = false )const;
    void        variant_to_binary( const type_name& type, const fc::variant& var, fc::datastream<char*>& ds, const fc::microseconds& max_serialization_time, bool short_path = false )const;
 
    template<typename T, typename Resolver>
    static void to_variant( const T& o, fc::variant& vo, Resolver resolver, const fc::microseconds& max_serialization_time );
 
+   /**
+    *  Appends to out the json of the variant that to_variant() produces, decoding action data straight from its
+    *  binary form
+    */
+   template<typename T, typename Resolver>
+   static void to_json( const T& o, string& out, Resolver resolver, const fc::microseconds& max_serialization_time );
+
    template<typename T, typename Resolver>
    static void from_variant( const fc::variant& v, T& o, Resolver resolver, const fc::microseconds& max_serialization_time );
 
@@ -91,6 +110,34 @@ struct abi_serializer {
 
 private:
 
+   /**
+    *  A type resolved once by set_abi: typedefs are followed, array/optional wrappers are split off and
+    *  every referenced type is named by its index into type_plans rather than by its string name.
+    */
+   struct type_plan {
+      enum class kind_type : uint8_t { built_in, array, optional, variant, structure };
+
+      struct field {
+         uint32_t type      = 0;
+         bool     extension = false;
+         bool     last      = false;
+      };
+
+      static constexpr uint32_t no_base = ~uint32_t(0);
+
+      type_name                                   name;
+      kind_type                                   kind = kind_type::built_in;
+      const pair<unpack_function, pack_function>* built_in = nullptr;
+      bool                                        built_in_array = false;
+      bool                                        built_in_optional = false;
+      uint32_t                                    element = 0;         ///< array or optional element
+      uint32_t                                    base = no_base;      ///< struct base
+      vector<field>                               fields;              ///< struct fields, excluding the base
+      vector<uint32_t>                            alternatives;        ///< variant types
+      map<type_name, struct_def>::const_iterator  struct_itr;
+      map<type_name, variant_def>::const_iterator variant_itr;
+   };
+
    map<type_name, type_name>     typedefs;
    map<type_name, struct_def>    structs;
    map<name,type_name>           actions;
@@ -101,6 +148,11 @@ private:
    map<type_name, pair<unpack_function, pack_function>> built_in_types;
    void configure_built_in_types();
 
+   vector<type_plan>             type_plans;
+   map<type_name, uint32_t>      type_plan_ids;
+   void     compile_plans( impl::abi_traverse_context& ctx );
+   uint32_t compile_plan( const type_name& type, impl::abi_traverse_context& ctx );
+
    fc::variant _binary_to_variant( const type_name& type, const bytes& binary, impl::binary_to_variant_context& ctx )const;
    fc::variant _binary_to_variant( const type_name& type, fc::datastream<const char*>& binary, impl::binary_to_variant_context& ctx )const;
    void        _binary_to_variant( const type_name& type, fc::datastream<const char*>& stream,
@@ -110,6 +162,17 @@ private:
    void        _variant_to_binary( const type_name& type, const fc::variant& var,
                                    fc::datastream<char*>& ds, impl::variant_to_binary_context& ctx )const;
 
+   fc::variant _binary_to_variant( const type_plan& plan, fc::datastream<const char*>& stream, impl::binary_to_variant_context& ctx )const;
+   void        _binary_to_variant( const type_plan& plan, fc::datastream<const char*>& stream,
+                                   fc::mutable_variant_object& obj, impl::binary_to_variant_context& ctx )const;
+   void        _variant_to_binary( const type_plan& plan, const fc::variant& var,
+                                   fc::datastream<char*>& ds, impl::variant_to_binary_context& ctx )const;
+
+   void        _binary_to_json( const type_name& type, fc::datastream<const char*>& stream, string& out, impl::binary_to_variant_context& ctx )const;
+   void        _binary_to_json( const type_plan& plan, fc::datastream<const char*>& stream, string& out, impl::binary_to_variant_context& ctx )const;
+   void        _binary_to_json( const type_plan& plan, fc::datastream<const char*>& stream, string& out, bool& first,
+                                impl::binary_to_variant_context& ctx )const;
+
    static type_name _remove_bin_extension(const type_name& type);
    bool _is_type( const type_name& type, impl::abi_traverse_context& ctx )const;
 
@@ -117,6 +180,7 @@ private:
 
    friend struct impl::abi_from_variant;
    friend struct impl::abi_to_variant;
+   friend struct impl::abi_to_json;
    friend struct impl::abi_traverse_context_with_path;
 };
 
@@ -388,7 +452,7 @@ namespace impl {
 
          try {
             auto abi = resolver(act.account);
-            if (abi.valid()) {
+            if (abi) {
                auto type = abi->get_action_type(act.name);
                if (!type.empty()) {
                   try {
@@ -475,6 +539,181 @@ namespace impl {
          abi_traverse_context& _ctx;
    };
 
+   /**
+    * Writes the json of the variants abi_to_variant builds. write() appends a value, add() a member of the object
+    * being written, preceded by a comma unless it is the first one.
+    */
+   struct abi_to_json {
+      static void add_key( string& out, bool& first, const char* name )
+      {
+         if( !first ) out += ',';
+         first = false;
+         fc::json::append_string( out, name );
+         out += ':';
+      }
+
+      template<typename M, typename Resolver, not_require_abi_t<M> = 1>
+      static void write( string& out, const M& v, Resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         fc::json::append( out, fc::variant( v ) );
+      }
+
+      template<typename M, typename Resolver, require_abi_t<M> = 1>
+      static void write( string& out, const M& v, Resolver resolver, abi_traverse_context& ctx );
+
+      template<typename M, typename Resolver, require_abi_t<M> = 1>
+      static void write( string& out, const vector<M>& v, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         out += '[';
+         for( auto itr = v.begin(); itr != v.end(); ++itr ) {
+            if( itr != v.begin() ) out += ',';
+            write( out, *itr, resolver, ctx );
+         }
+         out += ']';
+      }
+
+      template<typename M, typename Resolver, require_abi_t<M> = 1>
+      static void write( string& out, const std::shared_ptr<M>& v, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         if( !v ) {
+            out += "null";
+            return;
+         }
+         write( out, *v, resolver, ctx );
+      }
+
+      template<typename Resolver>
+      struct write_static_variant
+      {
+         string& out;
+         Resolver& resolver;
+         abi_traverse_context& ctx;
+
+         typedef void result_type;
+         template<typename T> void operator()( T& v )const
+         {
+            write(out, v, resolver, ctx);
+         }
+      };
+
+      template<typename Resolver, typename... Args>
+      static void write( string& out, const fc::static_variant<Args...>& v, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         v.visit( write_static_variant<Resolver>{ out, resolver, ctx } );
+      }
+
+      template<typename Resolver>
+      static void write( string& out, const action& act, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         bool first = true;
+         out += '{';
+         add_key( out, first, "account" );
+         fc::json::append( out, fc::variant( act.account ) );
+         add_key( out, first, "name" );
+         fc::json::append( out, fc::variant( act.name ) );
+         add_key( out, first, "authorization" );
+         fc::json::append( out, fc::variant( act.authorization ) );
+
+         auto data_pos = out.size();
+         bool decoded = false;
+         try {
+            auto abi = resolver(act.account);
+            if (abi) {
+               auto type = abi->get_action_type(act.name);
+               if (!type.empty()) {
+                  binary_to_variant_context _ctx(*abi, ctx, type);
+                  _ctx.short_path = true;
+                  fc::datastream<const char*> ds( act.data.data(), act.data.size() );
+                  add_key( out, first, "data" );
+                  abi->_binary_to_json( type, ds, out, _ctx );
+                  add_key( out, first, "hex_data" );
+                  fc::json::append( out, fc::variant( act.data ) );
+                  decoded = true;
+               }
+            }
+         } catch(...) {
+            // any failure to serialize data, then leave as not serailzed
+         }
+         if( !decoded ) {
+            out.resize( data_pos );
+            add_key( out, first, "data" );
+            fc::json::append( out, fc::variant( act.data ) );
+         }
+         out += '}';
+      }
+
+      template<typename Resolver>
+      static void write( string& out, const packed_transaction& ptrx, Resolver resolver, abi_traverse_context& ctx )
+      {
+         auto h = ctx.enter_scope();
+         auto trx = ptrx.get_transaction();
+         bool first = true;
+         out += '{';
+         add_key( out, first, "id" );
+         fc::json::append( out, fc::variant( trx.id() ) );
+         add_key( out, first, "signatures" );
+         fc::json::append( out, fc::variant( ptrx.get_signatures() ) );
+         add_key( out, first, "compression" );
+         fc::json::append( out, fc::variant( ptrx.get_compression() ) );
+         add_key( out, first, "packed_context_free_data" );
+         fc::json::append( out, fc::variant( ptrx.get_packed_context_free_data() ) );
+         add_key( out, first, "context_free_data" );
+         fc::json::append( out, fc::variant( ptrx.get_context_free_data() ) );
+         add_key( out, first, "packed_trx" );
+         fc::json::append( out, fc::variant( ptrx.get_packed_transaction() ) );
+         add_key( out, first, "transaction" );
+         write( out, trx, resolver, ctx );
+         out += '}';
+      }
+
+      /// like abi_to_variant::add, members that are null shared_ptrs are left out
+      template<typename M, typename Resolver>
+      static void add( string& out, bool& first, const char* name, const M& v, Resolver resolver, abi_traverse_context& ctx )
+      {
+         add_key( out, first, name );
+         write( out, v, resolver, ctx );
+      }
+
+      template<typename M, typename Resolver, require_abi_t<M> = 1>
+      static void add( string& out, bool& first, const char* name, const std::shared_ptr<M>& v, Resolver resolver, abi_traverse_context& ctx )
+      {
+         if( !v ) return;
+         add_key( out, first, name );
+         write( out, v, resolver, ctx );
+      }
+   };
+
+   template<typename T, typename Resolver>
+   class abi_to_json_visitor
+   {
+      public:
+         abi_to_json_visitor( string& _out, bool& _first, const T& _val, Resolver _resolver, abi_traverse_context& _ctx )
+         :_out(_out)
+         ,_first(_first)
+         ,_val(_val)
+         ,_resolver(_resolver)
+         ,_ctx(_ctx)
+         {}
+
+         template<typename Member, class Class, Member (Class::*member) >
+         void operator()( const char* name )const
+         {
+            abi_to_json::add( _out, _first, name, (_val.*member), _resolver, _ctx );
+         }
+
+      private:
+         string& _out;
+         bool& _first;
+         const T& _val;
+         Resolver _resolver;
+         abi_traverse_context& _ctx;
+   };
+
    struct abi_from_variant {
       /**
        * template which overloads extract for types which are not relvant to ABI information
@@ -553,7 +792,7 @@ namespace impl {
                valid_empty_data = act.data.empty();
             } else if ( data.is_object() ) {
                auto abi = resolver(act.account);
-               if (abi.valid()) {
+               if (abi) {
                   auto type = abi->get_action_type(act.name);
                   if (!type.empty()) {
                      variant_to_binary_context _ctx(*abi, ctx, type);
@@ -673,6 +912,16 @@ namespace impl {
       mvo(name, std::move(member_mvo));
    }
 
+   template<typename M, typename Resolver, require_abi_t<M>>
+   void abi_to_json::write( string& out, const M& v, Resolver resolver, abi_traverse_context& ctx )
+   {
+      auto h = ctx.enter_scope();
+      bool first = true;
+      out += '{';
+      fc::reflector<M>::visit( impl::abi_to_json_visitor<M, Resolver>( out, first, v, resolver, ctx) );
+      out += '}';
+   }
+
    template<typename M, typename Resolver, require_abi_t<M>>
    void abi_from_variant::extract( const variant& v, M& o, Resolver resolver, abi_traverse_context& ctx )
    {
@@ -690,6 +939,12 @@ void abi_serializer::to_variant( const T& o, variant& vo, Resolver resolver, con
    vo = std::move(mvo["_"]);
 } FC_RETHROW_EXCEPTIONS(error, "Failed to serialize: ${type}", ("type", boost::core::demangle( typeid(o).name() ) ))
 
+template<typename T, typename Resolver>
+void abi_serializer::to_json( const T& o, string& out, Resolver resolver, const fc::microseconds& max_serialization_time ) try {
+   impl::abi_traverse_context ctx(max_serialization_time);
+   impl::abi_to_json::write(out, o, resolver, ctx);
+} FC_RETHROW_EXCEPTIONS(error, "Failed to serialize: ${type}", ("type", boost::core::demangle( typeid(o).name() ) ))
+
 template<typename T, typename Resolver>
 void abi_serializer::from_variant( const variant& v, T& o, Resolver resolver, const fc::microseconds& max_serialization_time ) try {
    impl::abi_traverse_context ctx(max_serialization_time);
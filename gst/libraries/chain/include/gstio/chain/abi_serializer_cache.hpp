@@ -0,0 +1,87 @@
+#pragma once
+#include <gstio/chain/abi_serializer.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace gstio { namespace chain {
+
+   /**
+    * @class abi_serializer_cache
+    * @brief Bounded, thread safe cache of validated abi_serializers shared by the API plugins
+    *
+    * Entries are keyed by account and a sequence number. For on chain ABIs the sequence is the
+    * account's abi_sequence, so a setabi makes the cached serializer stale without any explicit
+    * invalidation. As a fork switch can reuse an abi_sequence for a different ABI, on chain entries
+    * also keep the packed ABI and a hit requires it to be unchanged. The least recently used entry
+    * is evicted once max_entries is reached.
+    * Serializers are built outside of the lock and handed out as shared pointers to const, so
+    * callers never copy them and concurrent readers never block on ABI validation.
+    */
+   class abi_serializer_cache {
+      public:
+         using abi_serializer_ptr = std::shared_ptr<const abi_serializer>;
+         using make_function      = std::function<abi_serializer_ptr()>;
+
+         struct stats {
+            uint64_t hits      = 0;
+            uint64_t misses    = 0;
+            uint64_t evictions = 0;
+            uint32_t size      = 0;
+         };
+
+         /// a max_entries of 0 disables caching, every lookup then builds a new serializer
+         explicit abi_serializer_cache( uint32_t max_entries );
+
+         /// @return the serializer for the current ABI of account in db, or null if it has none
+         abi_serializer_ptr get( const chainbase::database& db, account_name account, const fc::microseconds& max_serialization_time );
+
+         /**
+          * @return the serializer cached for account at sequence, built by make on a miss. make may return null, which
+          * is not cached as the sequence does not tell when an ABI becomes available.
+          */
+         abi_serializer_ptr get( account_name account, uint64_t sequence, const make_function& make );
+
+         void erase( account_name account );
+         void clear();
+
+         stats get_stats()const;
+
+         /// builds an uncached serializer for the current ABI of account in db
+         static abi_serializer_ptr create( const chainbase::database& db, account_name account, const fc::microseconds& max_serialization_time );
+
+      private:
+         struct entry {
+            account_name        account;
+            uint64_t            sequence = 0;
+            bytes               packed_abi;  ///< only kept for on chain ABIs
+            abi_serializer_ptr  serializer;
+         };
+
+         abi_serializer_ptr get( account_name account, uint64_t sequence, const char* packed_abi, size_t packed_abi_size,
+                                 const make_function& make );
+
+         struct by_account;
+         typedef boost::multi_index_container<entry,
+            boost::multi_index::indexed_by<
+               boost::multi_index::sequenced<>,
+               boost::multi_index::ordered_unique< boost::multi_index::tag<by_account>,
+                  boost::multi_index::member<entry, account_name, &entry::account> >
+            >
+         > entry_index_type;
+
+         mutable std::mutex  mtx;
+         entry_index_type    entries;
+         uint32_t            max_entries = 0;
+         stats               counters;
+   };
+
+} } // gstio::chain
+
+FC_REFLECT( gstio::chain::abi_serializer_cache::stats, (hits)(misses)(evictions)(size) )
@@ -5,11 +5,94 @@
 #pragma once
 #include <fc/filesystem.hpp>
 #include <gstio/chain/block.hpp>
+#include <gstio/chain/config.hpp>
 #include <gstio/chain/genesis_state.hpp>
 
 namespace gstio { namespace chain {
 
-   namespace detail { class block_log_impl; }
+   namespace detail { class block_log_impl; struct block_log_mapping; class block_log_catalog; }
+
+   struct block_log_config {
+      uint32_t  blocks_per_segment = 0;     ///< blocks per sealed segment, 0 keeps every block in blocks.log
+      bool      compress_segments = false;  ///< compress sealed segments with zlib
+      uint32_t  retained_segments = 0;      ///< sealed segments kept in the blocks directory, 0 for no limit
+      fc::path  archive_dir;                ///< where older segments are moved, defaults to an archive directory in the blocks directory
+      bool      remove_archive_on_reset = false;  ///< let reset() remove archived segments, otherwise it fails while any exist
+      uint64_t  decompressed_cache_size = config::default_blocks_decompressed_cache_size; ///< bytes of compressed segments held decompressed
+   };
+
+   /**
+    * A block as stored in the block log. data points at the packed block inside a read-only mapping of the log which
+    * is kept alive by the block_log_range the entry was obtained from.
+    */
+   struct block_log_entry {
+      uint32_t     block_num = 0;
+      uint64_t     pos = 0;
+      const char*  data = nullptr;
+      size_t       size = 0;
+
+      /// unpacks the block; callers forwarding raw bytes never pay for decoding
+      signed_block_ptr block()const;
+   };
+
+   /**
+    * A contiguous range of blocks read directly from a memory mapping of the block log and its index. Iterating does
+    * not issue syscalls or allocate, except when entering a sealed segment, which is mapped or decompressed once.
+    * The range holds a snapshot of the log: blocks appended after it was created are not visible through it, and it
+    * stays valid after the block_log is closed. Iterators are valid while their range is.
+    */
+   class block_log_range {
+      public:
+         class iterator {
+            public:
+               using iterator_category = std::forward_iterator_tag;
+               using value_type        = block_log_entry;
+               using difference_type   = std::ptrdiff_t;
+               using pointer           = const block_log_entry*;
+               using reference         = const block_log_entry&;
+
+               iterator() = default;
+
+               reference operator*()const  { return _entry; }
+               pointer   operator->()const { return &_entry; }
+
+               iterator& operator++();
+               iterator  operator++(int) { auto tmp = *this; ++*this; return tmp; }
+
+               bool operator==(const iterator& other)const { return _entry.block_num == other._entry.block_num; }
+               bool operator!=(const iterator& other)const { return !(*this == other); }
+
+            private:
+               friend class block_log_range;
+               iterator(const block_log_range* range, uint32_t block_num);
+               void load();
+
+               const block_log_range*                           _range = nullptr;
+               std::shared_ptr<const detail::block_log_mapping> _mapping;
+               block_log_entry                                  _entry;
+         };
+
+         block_log_range() = default;
+
+         iterator begin()const;
+         iterator end()const;
+
+         bool     empty()const { return _first > _last; }
+         uint32_t first()const { return _first; }
+         uint32_t last()const  { return _last; }
+
+      private:
+         friend class block_log;
+         block_log_range(std::shared_ptr<detail::block_log_catalog> catalog, std::shared_ptr<const detail::block_log_mapping> active,
+                         uint32_t first, uint32_t last);
+
+         std::shared_ptr<const detail::block_log_mapping> mapping_for(uint32_t block_num)const;
+
+         std::shared_ptr<detail::block_log_catalog>       _catalog;
+         std::shared_ptr<const detail::block_log_mapping> _active;
+         uint32_t                                         _first = 1;
+         uint32_t                                         _last = 0;
+   };
 
    /* The block log is an external append only log of the blocks with a header. Blocks should only
     * be written to the log after they irreverisble as the log is append only. The log is a doubly
@@ -34,11 +117,18 @@ namespace gstio { namespace chain {
     *
     * The main file is the only file that needs to persist. The index file can be reconstructed during a
     * linear scan of the main file.
+    *
+    * When blocks_per_segment is configured, blocks.log is sealed once it holds the last block of a segment
+    * (block numbers 1..N, N+1..2N, ...) and renamed to blocks-<first>-<last>.log next to its own index. A new
+    * blocks.log starting at the next block is created with the same genesis state, so every segment is a complete
+    * block log on its own. Sealed segments are never written again: they may be compressed, moved to the archive
+    * directory once more than retained_segments are kept, and their indices are rebuilt in parallel by walking the
+    * block positions backwards instead of deserializing the blocks. Reads span segments transparently.
     */
 
    class block_log {
       public:
-         block_log(const fc::path& data_dir);
+         block_log(const fc::path& data_dir, const block_log_config& cfg = block_log_config());
          block_log(block_log&& other);
          ~block_log();
 
@@ -46,14 +136,18 @@ namespace gstio { namespace chain {
          void flush();
          void reset( const genesis_state& gs, const signed_block_ptr& genesis_block, uint32_t first_block_num = 1 );
 
-         std::pair<signed_block_ptr, uint64_t> read_block(uint64_t file_pos)const;
          signed_block_ptr read_block_by_num(uint32_t block_num)const;
          signed_block_ptr read_block_by_id(const block_id_type& id)const {
             return read_block_by_num(block_header::num_from_id(id));
          }
 
          /**
-          * Return offset of block in file, or block_log::npos if it does not exist.
+          * Return the blocks in [first, last] that are present in the log, clamped to the blocks it contains.
+          */
+         block_log_range read_block_range(uint32_t first, uint32_t last)const;
+
+         /**
+          * Return offset of block in the file of its segment, or block_log::npos if it does not exist.
           */
          uint64_t get_block_pos(uint32_t block_num) const;
          signed_block_ptr        read_head()const;
@@ -70,7 +164,7 @@ namespace gstio { namespace chain {
          static genesis_state extract_genesis_state( const fc::path& data_dir );
 
       private:
-         void open(const fc::path& data_dir);
+         void open(const fc::path& data_dir, const block_log_config& cfg);
          void construct_index();
 
          std::unique_ptr<detail::block_log_impl> my;
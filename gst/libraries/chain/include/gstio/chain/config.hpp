@@ -13,12 +13,16 @@ namespace gstio { namespace chain { namespace config {
 typedef __uint128_t uint128_t;
 
 const static auto default_blocks_dir_name    = "blocks";
+const static auto default_blocks_archive_dir_name = "archive";
+const static auto default_blocks_decompressed_cache_size = 512*1024*1024ll; ///< bytes of compressed block log segments held decompressed
 const static auto reversible_blocks_dir_name = "reversible";
 const static auto default_reversible_cache_size = 340*1024*1024ll;/// 1MB * 340 blocks based on 21 producer BFT delay
 const static auto default_reversible_guard_size = 2*1024*1024ll;/// 1MB * 340 blocks based on 21 producer BFT delay
 
 const static auto default_state_dir_name     = "state";
+const static auto default_wasm_code_cache_dir_name = "code_cache";
 const static auto forkdb_filename            = "forkdb.dat";
+const static auto forkdb_journal_filename    = "forkdb.log";
 const static auto default_state_size            = 1*1024*1024*1024ll;
 const static auto default_state_guard_size      =    128*1024*1024ll;
 
@@ -84,6 +88,7 @@ const static uint16_t   default_max_inline_action_depth        = 4;
 const static uint16_t   default_max_auth_depth                 = 6;
 const static uint32_t   default_sig_cpu_bill_pct               = 50 * percent_1; // billable percentage of signature recovery
 const static uint16_t   default_controller_thread_pool_size    = 2;
+const static uint32_t   default_replay_lookahead_blocks        = 256;
 
 const static uint32_t   min_net_usage_delta_between_base_and_max_for_trx  = 10*1024;
 // Should be large enough to allow recovery from badly set blockchain parameters without a hard fork
@@ -99,7 +104,12 @@ const static uint32_t   setcode_ram_bytes_multiplier       = 10;     ///< multip
 const static uint32_t   hashing_checktime_block_size       = 10*1024;  /// call checktime from hashing intrinsic once per this number of bytes
 
 const static gstio::chain::wasm_interface::vm_type default_wasm_runtime = gstio::chain::wasm_interface::vm_type::wabt;
+const static uint64_t   default_wasm_cache_size            = 512*1024*1024ll; ///< approximate bytes of unpinned instantiated modules
+const static uint32_t   default_wasm_cache_max_entries     = 1024;
+const static uint64_t   default_wasm_code_cache_size       = 1024*1024*1024ll; ///< bytes of injected contracts persisted on disk
+const static uint32_t   wasm_max_pending_precompiles       = 16;   ///< oldest precompiled modules not yet applied are dropped beyond this
 const static uint32_t   default_abi_serializer_max_time_ms = 15*1000; ///< default deadline for abi serialization methods
+const static uint32_t   default_abi_serializer_cache_size  = 1024; ///< validated contract ABIs kept by the chain plugin
 
 /**
  *  The number of sequential blocks produced by a single producer
@@ -8,6 +8,7 @@
 #include <gstio/chain/abi_serializer.hpp>
 #include <gstio/chain/account_object.hpp>
 #include <gstio/chain/snapshot.hpp>
+#include <gstio/chain/state_delta.hpp>
 
 namespace chainbase {
    class database;
@@ -35,8 +36,11 @@ namespace gstio { namespace chain {
    using resource_limits::resource_limits_manager;
    using apply_handler = std::function<void(apply_context&)>;
    using unapplied_transactions_type = map<transaction_id_type, transaction_metadata_ptr>;
+   /// returns the recorded state changes of an irreversible block, or nothing when they are not available
+   using state_delta_source = std::function<optional<block_state_deltas>( const signed_block_ptr& )>;
 
    class fork_database;
+   class block_log_range;
 
    enum class db_read_mode {
       SPECULATIVE,
@@ -62,13 +66,23 @@ namespace gstio { namespace chain {
             flat_set< pair<account_name, action_name> > action_blacklist;
             flat_set<public_key_type> key_blacklist;
             path                     blocks_dir             =  chain::config::default_blocks_dir_name;
+            uint32_t                 blocks_log_segment_size      = 0;     ///< blocks per sealed block log segment, 0 keeps all blocks in blocks.log
+            bool                     compress_blocks_log_segments = false;
+            uint32_t                 blocks_log_retained_segments = 0;     ///< sealed segments kept in blocks_dir, 0 for no limit
+            path                     blocks_archive_dir;                   ///< destination of older segments, defaults to blocks_dir/archive
+            bool                     remove_blocks_archive_on_reset = false;
+            uint64_t                 blocks_decompressed_cache_size = chain::config::default_blocks_decompressed_cache_size;
             path                     state_dir              =  chain::config::default_state_dir_name;
             uint64_t                 state_size             =  chain::config::default_state_size;
             uint64_t                 state_guard_size       =  chain::config::default_state_guard_size;
+            chainbase::undo_mode     state_undo_mode        =  chainbase::undo_mode::map;
+            chainbase::map_mode      state_map_mode         =  chainbase::map_mode::mapped;
+            uint64_t                 state_hugepage_size    =  0;   ///< page size backing the state in heap and locked modes, 0 for regular pages
             uint64_t                 reversible_cache_size  =  chain::config::default_reversible_cache_size;
             uint64_t                 reversible_guard_size  =  chain::config::default_reversible_guard_size;
             uint32_t                 sig_cpu_bill_pct       =  chain::config::default_sig_cpu_bill_pct;
             uint16_t                 thread_pool_size       =  chain::config::default_controller_thread_pool_size;
+            uint32_t                 replay_lookahead_blocks = chain::config::default_replay_lookahead_blocks; ///< 0 replays blocks serially
             bool                     read_only              =  false;
             bool                     force_all_checks       =  false;
             bool                     disable_replay_opts    =  false;
@@ -77,6 +91,11 @@ namespace gstio { namespace chain {
 
             genesis_state            genesis;
             wasm_interface::vm_type  wasm_runtime = chain::config::default_wasm_runtime;
+            uint64_t                 wasm_cache_size        =  chain::config::default_wasm_cache_size;
+            uint32_t                 wasm_cache_max_entries =  chain::config::default_wasm_cache_max_entries;
+            flat_set<account_name>   wasm_cache_pinned_accounts = { chain::config::system_account_name, N(gstio.token) };
+            path                     wasm_code_cache_dir;   ///< persistent cache of injected contracts, disabled when empty
+            uint64_t                 wasm_code_cache_size   =  chain::config::default_wasm_code_cache_size;
 
             db_read_mode             read_mode              = db_read_mode::SPECULATIVE;
             validation_mode          block_validation_mode  = validation_mode::FULL;
@@ -98,6 +117,12 @@ namespace gstio { namespace chain {
          void add_indices();
          void startup( std::function<bool()> shutdown, const snapshot_reader_ptr& snapshot = nullptr );
 
+         /**
+          * When set before startup(), replaying the block log applies the state changes returned by source instead
+          * of executing the blocks. Blocks the source has no changes for are executed as usual.
+          */
+         void set_replay_state_delta_source( state_delta_source source );
+
          /**
           * Starts a new pending block session upon which new transactions can
           * be pushed.
@@ -191,6 +216,8 @@ namespace gstio { namespace chain {
 
          signed_block_ptr fetch_block_by_number( uint32_t block_num )const;
          signed_block_ptr fetch_block_by_id( block_id_type id )const;
+         /// irreversible blocks in [first, last] as packed in the block log, clamped to the blocks it contains
+         block_log_range  fetch_block_log_range( uint32_t first, uint32_t last )const;
 
          block_state_ptr fetch_block_state_by_number( uint32_t block_num )const;
          block_state_ptr fetch_block_state_by_id( block_id_type id )const;
@@ -258,6 +285,7 @@ namespace gstio { namespace chain {
 
          const apply_handler* find_apply_handler( account_name contract, scope_name scope, action_name act )const;
          wasm_interface& get_wasm_interface();
+         const wasm_interface& get_wasm_interface()const;
 
 
          optional<abi_serializer> get_abi_serializer( account_name n, const fc::microseconds& max_serialization_time )const {
@@ -84,6 +84,30 @@ namespace gstio { namespace chain {
       }
    };
 
+   /**
+    * The indices of several index_sets, in the order of the sets.
+    */
+   template<typename ...IndexSets>
+   class index_sets;
+
+   template<typename IndexSet>
+   class index_sets<IndexSet> : public IndexSet {};
+
+   template<typename FirstSet, typename ...RemainingSets>
+   class index_sets<FirstSet, RemainingSets...> {
+   public:
+      static void add_indices( chainbase::database& db ) {
+         FirstSet::add_indices(db);
+         index_sets<RemainingSets...>::add_indices(db);
+      }
+
+      template<typename F>
+      static void walk_indices( F function ) {
+         FirstSet::walk_indices(function);
+         index_sets<RemainingSets...>::walk_indices(function);
+      }
+   };
+
    template<typename DataStream>
    DataStream& operator << ( DataStream& ds, const shared_blob& b ) {
       fc::raw::pack(ds, static_cast<const shared_string&>(b));
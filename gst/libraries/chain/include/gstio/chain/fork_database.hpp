@@ -18,6 +18,10 @@ namespace gstio { namespace chain {
     * database tracks the longest chain and the last irreversible block number. All
     * blocks older than the last irreversible block are freed after emitting the
     * irreversible signal.
+    *
+    * Every change is appended to a journal in the data directory as it happens and
+    * the journal is rewritten from the live blocks once it has grown well past them,
+    * so closing is cheap and the fork database survives an unclean shutdown.
     */
    class fork_database {
       public:
@@ -72,6 +76,10 @@ namespace gstio { namespace chain {
 
       private:
          void set_bft_irreversible( block_id_type id );
+         void replay_journal( const fc::path& journal );
+         void compact_journal();
+         void journal_head();
+
          unique_ptr<fork_database_impl> my;
    };
 
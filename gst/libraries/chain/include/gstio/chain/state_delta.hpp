@@ -0,0 +1,54 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+#pragma once
+
+#include <gstio/chain/types.hpp>
+#include <chainbase/chainbase.hpp>
+
+namespace gstio { namespace chain {
+
+   /**
+    * The changes one block made to one index of the state database, complete enough to redo them on a database that
+    * holds the state of the previous block. Rows keep their object ids and every field of the object, including the
+    * ones left out of snapshots, so that applying the deltas of a block yields the same database as executing it.
+    */
+   struct state_table_delta {
+      struct row {
+         int64_t  id = 0;
+         bytes    data;
+      };
+
+      string            name;           ///< snapshot section name of the object type
+      int64_t           next_id = 0;    ///< id the index assigns to its next object after the block
+      vector<row>       rows;           ///< created and modified rows with their value after the block
+      vector<int64_t>   removed_ids;
+   };
+
+   /**
+    * State changes of a block as recorded by state_history_plugin. When present, integrity_hash is the result of
+    * controller::calculate_integrity_hash() after the block and is checked once the deltas have been applied.
+    */
+   struct block_state_deltas {
+      vector<state_table_delta>   deltas;
+      optional<digest_type>       integrity_hash;
+   };
+
+   /**
+    * @return the changes recorded in the newest undo session of every index of db, which must keep its undo history
+    * in chainbase::undo_mode::map
+    */
+   vector<state_table_delta> extract_state_deltas( const chainbase::database& db );
+
+   /**
+    * Redoes changes returned by extract_state_deltas() on db. The rows of a table are removed before the others are
+    * written so that unique keys released by the block can be taken by the rows it created.
+    */
+   void apply_state_deltas( chainbase::database& db, const vector<state_table_delta>& deltas );
+
+} } // gstio::chain
+
+FC_REFLECT( gstio::chain::state_table_delta::row, (id)(data) )
+FC_REFLECT( gstio::chain::state_table_delta, (name)(next_id)(rows)(removed_ids) )
+FC_REFLECT( gstio::chain::block_state_deltas, (deltas)(integrity_hash) )
@@ -0,0 +1,66 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+#pragma once
+
+#include <gstio/chain/database_utils.hpp>
+#include <gstio/chain/account_object.hpp>
+#include <gstio/chain/block_summary_object.hpp>
+#include <gstio/chain/global_property_object.hpp>
+#include <gstio/chain/contract_table_objects.hpp>
+#include <gstio/chain/generated_transaction_object.hpp>
+#include <gstio/chain/transaction_object.hpp>
+#include <gstio/chain/permission_object.hpp>
+#include <gstio/chain/permission_link_object.hpp>
+#include <gstio/chain/resource_limits.hpp>
+#include <gstio/chain/resource_limits_private.hpp>
+
+namespace gstio { namespace chain {
+
+   using controller_index_set = index_set<
+      account_index,
+      account_sequence_index,
+      global_property_multi_index,
+      dynamic_global_property_multi_index,
+      block_summary_multi_index,
+      transaction_multi_index,
+      generated_transaction_multi_index,
+      table_id_multi_index
+   >;
+
+   using contract_database_index_set = index_set<
+      key_value_index,
+      index64_index,
+      index128_index,
+      index256_index,
+      index_double_index,
+      index_long_double_index
+   >;
+
+   using authorization_index_set = index_set<
+      permission_index,
+      permission_usage_index,
+      permission_link_index
+   >;
+
+   namespace resource_limits {
+      using resource_index_set = index_set<
+         resource_limits_index,
+         resource_usage_index,
+         resource_gst_index,
+         resource_activation_gst_index,
+         resource_limits_state_index,
+         resource_limits_config_index
+      >;
+   }
+
+   /// every index of the state database, in the order controller and its managers add them
+   using state_index_set = index_sets<
+      controller_index_set,
+      contract_database_index_set,
+      authorization_index_set,
+      resource_limits::resource_index_set
+   >;
+
+} } // gstio::chain
@@ -0,0 +1,75 @@
+#pragma once
+#include <gstio/chain/types.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+
+namespace gstio { namespace chain {
+
+   /**
+    * @class wasm_code_cache
+    * @brief Persists contract modules after injection so they survive restarts and replays
+    *
+    * Each entry is stored in its own file named after the code_id and is only reused when it was
+    * written by the same cache format and wasm_binary_injection version. The injected module is
+    * runtime independent; JIT output of WAVM embeds addresses of the live module instance and
+    * therefore cannot be persisted.
+    *
+    * The cache is bounded by max_size bytes of entry files. Reading an entry refreshes its
+    * modification time, and least recently used entries are deleted first when a write exceeds
+    * the bound, so the order survives restarts.
+    */
+   class wasm_code_cache {
+      public:
+         struct entry {
+            digest_type           code_id;
+            std::vector<uint8_t>  code;            ///< module bytes after wasm_binary_injection
+            std::vector<uint8_t>  initial_memory;  ///< image produced from the module's data segments
+         };
+
+         /// @param max_size bytes of entries kept on disk, 0 for unbounded
+         wasm_code_cache( const fc::path& dir, uint64_t max_size );
+
+         /// @return the cached entry, or an empty optional if it is missing, stale or corrupt
+         optional<entry> get( const digest_type& code_id );
+
+         /// failures to write are logged and otherwise ignored, the cache is only an optimization
+         void put( const entry& e );
+
+         const fc::path& directory()const { return dir; }
+         uint64_t        size()const      { return total_size; }
+         uint32_t        entries()const   { return files.size(); }
+
+         static const uint32_t format_version;
+
+      private:
+         struct file_entry {
+            digest_type code_id;
+            uint64_t    size = 0;
+         };
+         struct by_code_id;
+         typedef boost::multi_index::multi_index_container<
+            file_entry,
+            boost::multi_index::indexed_by<
+               boost::multi_index::sequenced<>,
+               boost::multi_index::hashed_unique< boost::multi_index::tag<by_code_id>,
+                  boost::multi_index::member<file_entry, digest_type, &file_entry::code_id>, std::hash<digest_type> >
+            >
+         > file_index;
+
+         fc::path entry_path( const digest_type& code_id )const;
+         void     load_index();
+         void     touch( const digest_type& code_id );
+         void     forget( const digest_type& code_id );
+         void     evict( const digest_type& keep_id );
+
+         fc::path   dir;
+         uint64_t   max_size = 0;
+         uint64_t   total_size = 0;
+         file_index files;   ///< least recently used entries first
+   };
+
+} } // gstio::chain
+
+FC_REFLECT( gstio::chain::wasm_code_cache::entry, (code_id)(code)(initial_memory) )
@@ -784,6 +784,9 @@ namespace gstio { namespace chain { namespace wasm_injections {
       using standard_module_injectors = module_injectors< max_memory_injection_visitor >;
 
       public:
+         /// must be incremented whenever the output of inject() changes for the same input; invalidates wasm_code_cache
+         static constexpr uint32_t version = 1;
+
          wasm_binary_injection( IR::Module& mod )  : _module( &mod ) { 
             _module_injectors.init();
             // initialize static fields of injectors
@@ -4,6 +4,10 @@
 #include "Runtime/Linker.h"
 #include "Runtime/Runtime.h"
 
+namespace boost { namespace asio {
+   class thread_pool;
+}}
+
 namespace gstio { namespace chain {
 
    class apply_context;
@@ -53,21 +57,53 @@ namespace gstio { namespace chain {
       public:
          enum class vm_type {
             wavm,
-            wabt
+            wabt,
+            wasm2c
+         };
+
+         /**
+          * Bounds on the cache of instantiated modules. A limit of 0 means unbounded. Modules of
+          * pinned accounts are never evicted and do not count against the limits. Injected modules
+          * are persisted in code_cache_dir unless it is empty; the wasm2c runtime keeps its shared
+          * objects in its wasm2c subdirectory.
+          */
+         struct cache_config {
+            uint64_t                max_size    = 0;   ///< approximate bytes of instantiated modules
+            uint32_t                max_entries = 0;
+            flat_set<account_name>  pinned_accounts;
+            fc::path                code_cache_dir;
+            uint64_t                code_cache_max_size = 0;   ///< bytes of persisted modules, 0 for unbounded
          };
 
-         wasm_interface(vm_type vm);
+         struct cache_stats {
+            uint64_t          hits = 0;
+            uint64_t          misses = 0;
+            uint64_t          evictions = 0;
+            uint64_t          disk_hits = 0;        ///< misses served from the persistent code cache
+            uint64_t          precompiled_hits = 0; ///< misses served by a module prepared in the background
+            fc::microseconds  compile_time;         ///< total time spent parsing, injecting and instantiating
+            uint32_t          entries = 0;
+            uint32_t          pinned_entries = 0;
+            uint64_t          size = 0;             ///< approximate bytes of instantiated modules, including pinned
+         };
+
+         wasm_interface(vm_type vm, const cache_config& cache);
          ~wasm_interface();
 
          //validates code -- does a WASM validation pass and checks the wasm against GSTIO specific constraints
          static void validate(const controller& control, const bytes& code);
 
+         //Parses and injects code on thread_pool so that its first apply does not have to; safe to call from any thread
+         void precompile(const digest_type& code_id, const bytes& code, boost::asio::thread_pool& thread_pool);
+
          //Calls apply or error on a given code
          void apply(const digest_type& code_id, const shared_string& code, apply_context& context);
 
          //Immediately exits currently running wasm. UB is called when no wasm running
          void exit();
 
+         cache_stats get_cache_stats()const;
+
       private:
          unique_ptr<struct wasm_interface_impl> my;
          friend class gstio::chain::webassembly::common::intrinsics_accessor;
@@ -79,4 +115,6 @@ namespace gstio{ namespace chain {
    std::istream& operator>>(std::istream& in, wasm_interface::vm_type& runtime);
 }}
 
-FC_REFLECT_ENUM( gstio::chain::wasm_interface::vm_type, (wavm)(wabt) )
+FC_REFLECT_ENUM( gstio::chain::wasm_interface::vm_type, (wavm)(wabt)(wasm2c) )
+FC_REFLECT( gstio::chain::wasm_interface::cache_stats,
+            (hits)(misses)(evictions)(disk_hits)(precompiled_hits)(compile_time)(entries)(pinned_entries)(size) )
@@ -3,12 +3,24 @@
 #include <gstio/chain/wasm_interface.hpp>
 #include <gstio/chain/webassembly/wavm.hpp>
 #include <gstio/chain/webassembly/wabt.hpp>
+#include <gstio/chain/webassembly/wasm2c.hpp>
 #include <gstio/chain/webassembly/runtime_interface.hpp>
 #include <gstio/chain/wasm_gstio_injection.hpp>
+#include <gstio/chain/wasm_code_cache.hpp>
 #include <gstio/chain/transaction_context.hpp>
 #include <gstio/chain/exceptions.hpp>
+#include <gstio/chain/thread_utils.hpp>
 #include <fc/scoped_exit.hpp>
 
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <deque>
+#include <future>
+#include <mutex>
+
 #include "IR/Module.h"
 #include "Runtime/Intrinsics.h"
 #include "Platform/Platform.h"
@@ -22,14 +34,39 @@ using namespace Runtime;
 
 namespace gstio { namespace chain {
 
+   namespace bmi = boost::multi_index;
+
+   struct wasm_cache_entry {
+      digest_type                                                 code_id;
+      mutable std::unique_ptr<wasm_instantiated_module_interface> module;
+      uint64_t                                                    size = 0;
+      mutable bool                                                pinned = false;
+   };
+
+   struct by_lru;
+   struct by_code_id;
+   typedef bmi::multi_index_container<
+      wasm_cache_entry,
+      bmi::indexed_by<
+         bmi::sequenced< bmi::tag<by_lru> >,
+         bmi::hashed_unique< bmi::tag<by_code_id>, bmi::member<wasm_cache_entry, digest_type, &wasm_cache_entry::code_id>, std::hash<digest_type> >
+      >
+   > wasm_cache_index;
+
    struct wasm_interface_impl {
-      wasm_interface_impl(wasm_interface::vm_type vm) {
+      wasm_interface_impl(wasm_interface::vm_type vm, const wasm_interface::cache_config& cache) : cache_conf(cache) {
          if(vm == wasm_interface::vm_type::wavm)
             runtime_interface = std::make_unique<webassembly::wavm::wavm_runtime>();
          else if(vm == wasm_interface::vm_type::wabt)
             runtime_interface = std::make_unique<webassembly::wabt_runtime::wabt_runtime>();
+         else if(vm == wasm_interface::vm_type::wasm2c)
+            runtime_interface = std::make_unique<webassembly::wasm2c::wasm2c_runtime>(
+               cache.code_cache_dir == fc::path() ? fc::path() : cache.code_cache_dir / "wasm2c");
          else
             GST_THROW(wasm_exception, "wasm_interface_impl fall through");
+
+         if(cache_conf.code_cache_dir != fc::path())
+            code_cache = std::make_unique<wasm_code_cache>(cache_conf.code_cache_dir, cache_conf.code_cache_max_size);
       }
 
       std::vector<uint8_t> parse_initial_memory(const Module& module) {
@@ -50,47 +87,195 @@ namespace gstio { namespace chain {
          return mem_image;
       }
 
+      /// parses and injects a module, producing everything a runtime needs to instantiate it
+      wasm_code_cache::entry prepare_module( const digest_type& code_id, const char* code, size_t code_size ) {
+         IR::Module module;
+         try {
+            Serialization::MemoryInputStream stream((const U8*)code, code_size);
+            WASM::serialize(stream, module);
+            module.userSections.clear();
+         } catch(const Serialization::FatalSerializationException& e) {
+            GST_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            GST_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+
+         wasm_injections::wasm_binary_injection injector(module);
+         injector.inject();
+
+         wasm_code_cache::entry prepared;
+         prepared.code_id = code_id;
+         try {
+            Serialization::ArrayOutputStream outstream;
+            WASM::serialize(outstream, module);
+            prepared.code = outstream.getBytes();
+         } catch(const Serialization::FatalSerializationException& e) {
+            GST_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         } catch(const IR::ValidationException& e) {
+            GST_ASSERT(false, wasm_serialization_error, e.message.c_str());
+         }
+         prepared.initial_memory = parse_initial_memory(module);
+         return prepared;
+      }
+
+      /// wasm_binary_injection keeps its state in statics, so modules are prepared one at a time
+      wasm_code_cache::entry load_or_prepare( const digest_type& code_id, const char* code, size_t code_size, bool& from_disk ) {
+         std::lock_guard<std::mutex> g(prepare_mutex);
+         from_disk = false;
+         if(code_cache) {
+            auto cached = code_cache->get(code_id);
+            if(cached) {
+               from_disk = true;
+               return std::move(*cached);
+            }
+         }
+         auto prepared = prepare_module(code_id, code, code_size);
+         if(code_cache)
+            code_cache->put(prepared);
+         return prepared;
+      }
+
+      void precompile( const digest_type& code_id, const bytes& code, boost::asio::thread_pool& thread_pool ) {
+         std::lock_guard<std::mutex> g(pending_mutex);
+         if(pending_precompiles.find(code_id) != pending_precompiles.end())
+            return;
+         if(pending_order.size() >= config::wasm_max_pending_precompiles) {
+            pending_precompiles.erase(pending_order.front());
+            pending_order.pop_front();
+         }
+         pending_precompiles.emplace(code_id, async_thread_pool(thread_pool, [this, code_id, code]() {
+            bool from_disk = false;
+            return load_or_prepare(code_id, code.data(), code.size(), from_disk);
+         }));
+         pending_order.push_back(code_id);
+      }
+
+      /// @return the pending precompilation of code_id, or an invalid future if there is none
+      std::future<wasm_code_cache::entry> take_precompiled( const digest_type& code_id ) {
+         std::lock_guard<std::mutex> g(pending_mutex);
+         auto itr = pending_precompiles.find(code_id);
+         if(itr == pending_precompiles.end())
+            return std::future<wasm_code_cache::entry>();
+         auto result = std::move(itr->second);
+         pending_precompiles.erase(itr);
+         pending_order.erase(std::find(pending_order.begin(), pending_order.end(), code_id));
+         return result;
+      }
+
       std::unique_ptr<wasm_instantiated_module_interface>& get_instantiated_module( const digest_type& code_id,
                                                                                     const shared_string& code,
+                                                                                    account_name receiver,
                                                                                     transaction_context& trx_context )
       {
-         auto it = instantiation_cache.find(code_id);
-         if(it == instantiation_cache.end()) {
+         auto& by_id = instantiation_cache.get<by_code_id>();
+         auto it = by_id.find(code_id);
+         if(it != by_id.end()) {
+            ++stats.hits;
+            // most recently used entries are kept at the back of the sequence
+            auto& lru = instantiation_cache.get<by_lru>();
+            lru.relocate(lru.end(), instantiation_cache.project<by_lru>(it));
+         } else {
+            ++stats.misses;
             auto timer_pause = fc::make_scoped_exit([&](){
                trx_context.resume_billing_timer();
             });
             trx_context.pause_billing_timer();
-            IR::Module module;
-            try {
-               Serialization::MemoryInputStream stream((const U8*)code.data(), code.size());
-               WASM::serialize(stream, module);
-               module.userSections.clear();
-            } catch(const Serialization::FatalSerializationException& e) {
-               GST_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               GST_ASSERT(false, wasm_serialization_error, e.message.c_str());
+            auto start = fc::time_point::now();
+            optional<wasm_code_cache::entry> prepared;
+            auto precompiled = take_precompiled(code_id);
+            if(precompiled.valid()) {
+               try {
+                  prepared = precompiled.get();
+                  ++stats.precompiled_hits;
+               } catch(...) {
+                  // a failed precompilation is retried below so its error surfaces in this transaction
+               }
             }
+            if(!prepared) {
+               bool from_disk = false;
+               prepared = load_or_prepare(code_id, code.data(), code.size(), from_disk);
+               if(from_disk)
+                  ++stats.disk_hits;
+            }
+
+            wasm_cache_entry entry;
+            entry.code_id = code_id;
+            entry.size = prepared->code.size() + prepared->initial_memory.size();
+            entry.module = runtime_interface->instantiate_module((const char*)prepared->code.data(), prepared->code.size(),
+                                                                 std::move(prepared->initial_memory));
+            stats.compile_time += fc::time_point::now() - start;
+            stats.size += entry.size;
+
+            it = instantiation_cache.project<by_code_id>( instantiation_cache.get<by_lru>().emplace_back(std::move(entry)).first );
+         }
+         update_pinning(*it, receiver);
+         evict(code_id);
+         return it->module;
+      }
+
+      /// only the most recent code of each pinned account stays pinned, code shared by several pinned accounts stays
+      /// pinned as long as one of them runs it
+      void update_pinning(const wasm_cache_entry& entry, account_name receiver) {
+         if(cache_conf.pinned_accounts.find(receiver) == cache_conf.pinned_accounts.end())
+            return;
+         auto pin = pinned_code.find(receiver);
+         if(pin != pinned_code.end() && pin->second == entry.code_id)
+            return;
+         optional<digest_type> old_id;
+         if(pin != pinned_code.end())
+            old_id = pin->second;
+         pinned_code[receiver] = entry.code_id;
+         if(!entry.pinned) {
+            entry.pinned = true;
+            ++stats.pinned_entries;
+            pinned_size += entry.size;
+         }
+         if(!old_id)
+            return;
+         for(const auto& p : pinned_code)
+            if(p.second == *old_id)
+               return;
+         auto& by_id = instantiation_cache.get<by_code_id>();
+         auto old = by_id.find(*old_id);
+         if(old != by_id.end() && old->pinned) {
+            old->pinned = false;
+            --stats.pinned_entries;
+            pinned_size -= old->size;
+         }
+      }
 
-            wasm_injections::wasm_binary_injection injector(module);
-            injector.inject();
-
-            std::vector<U8> bytes;
-            try {
-               Serialization::ArrayOutputStream outstream;
-               WASM::serialize(outstream, module);
-               bytes = outstream.getBytes();
-            } catch(const Serialization::FatalSerializationException& e) {
-               GST_ASSERT(false, wasm_serialization_error, e.message.c_str());
-            } catch(const IR::ValidationException& e) {
-               GST_ASSERT(false, wasm_serialization_error, e.message.c_str());
+      /// drops least recently used, unpinned modules until the cache is within its bounds; never evicts keep_id
+      void evict(const digest_type& keep_id) {
+         auto& lru = instantiation_cache.get<by_lru>();
+         auto over_limit = [&]() {
+            uint64_t unpinned_entries = lru.size() - stats.pinned_entries;
+            uint64_t unpinned_size = stats.size - pinned_size;
+            return (cache_conf.max_entries && unpinned_entries > cache_conf.max_entries) ||
+                   (cache_conf.max_size && unpinned_size > cache_conf.max_size);
+         };
+         for(auto itr = lru.begin(); itr != lru.end() && over_limit(); ) {
+            if(itr->pinned || itr->code_id == keep_id) {
+               ++itr;
+               continue;
             }
-            it = instantiation_cache.emplace(code_id, runtime_interface->instantiate_module((const char*)bytes.data(), bytes.size(), parse_initial_memory(module))).first;
+            stats.size -= itr->size;
+            ++stats.evictions;
+            itr = lru.erase(itr);
          }
-         return it->second;
+         stats.entries = lru.size();
       }
 
       std::unique_ptr<wasm_runtime_interface> runtime_interface;
-      map<digest_type, std::unique_ptr<wasm_instantiated_module_interface>> instantiation_cache;
+      wasm_interface::cache_config            cache_conf;
+      wasm_cache_index                        instantiation_cache;
+      std::unique_ptr<wasm_code_cache>        code_cache;
+      std::mutex                              prepare_mutex;
+      std::mutex                              pending_mutex;
+      map<digest_type, std::future<wasm_code_cache::entry>> pending_precompiles;
+      std::deque<digest_type>                 pending_order;
+      map<account_name, digest_type>          pinned_code;
+      uint64_t                                pinned_size = 0;
+      wasm_interface::cache_stats             stats;
    };
 
 #define _REGISTER_INTRINSIC_EXPLICIT(CLS, MOD, METHOD, WASM_SIG, NAME, SIG)\
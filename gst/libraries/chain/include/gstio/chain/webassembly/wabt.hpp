@@ -21,11 +21,17 @@ using namespace gstio::chain::webassembly::common;
 struct wabt_apply_instance_vars {
    Memory* memory;
    apply_context& ctx;
+   std::vector<char>* linear_memory = nullptr; ///< memory of runtimes that keep one per instance instead of wabt's static one
+
+   std::vector<char>& memory_data()const {
+      return linear_memory ? *linear_memory : memory->data;
+   }
 
    char* get_validated_pointer(uint32_t offset, uint32_t size) {
-      GST_ASSERT(memory, wasm_execution_error, "access violation");
-      GST_ASSERT(offset + size <= memory->data.size() && offset + size >= offset, wasm_execution_error, "access violation");
-      return memory->data.data() + offset;
+      GST_ASSERT(memory || linear_memory, wasm_execution_error, "access violation");
+      auto& data = memory_data();
+      GST_ASSERT(offset + size <= data.size() && offset + size >= offset, wasm_execution_error, "access violation");
+      return data.data() + offset;
    }
 };
 
@@ -79,7 +85,7 @@ inline null_terminated_ptr null_terminated_ptr_impl(wabt_apply_instance_vars& va
 {
    char *value = vars.get_validated_pointer(ptr, 1);
    const char* p = value;
-   const char* const top_of_memory = vars.memory->data.data() + vars.memory->data.size();
+   const char* const top_of_memory = vars.memory_data().data() + vars.memory_data().size();
    while(p < top_of_memory)
       if(*p++ == '\0')
          return null_terminated_ptr(value);
@@ -193,8 +199,8 @@ inline auto convert_native_to_literal(const wabt_apply_instance_vars&, const nam
 }
 
 inline auto convert_native_to_literal(const wabt_apply_instance_vars& vars, char* ptr) {
-   const char* base = vars.memory->data.data();
-   const char* top_of_memory = base + vars.memory->data.size();
+   const char* base = vars.memory_data().data();
+   const char* top_of_memory = base + vars.memory_data().size();
    GST_ASSERT(ptr >= base && ptr < top_of_memory, wasm_execution_error, "returning pointer not in linear memory");
    Value v;
    v.i32 = (int)(ptr - base);
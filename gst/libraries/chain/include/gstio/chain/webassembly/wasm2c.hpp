@@ -0,0 +1,51 @@
+#pragma once
+
+#include <gstio/chain/webassembly/runtime_interface.hpp>
+#include <gstio/chain/webassembly/wabt.hpp>
+#include <fc/filesystem.hpp>
+
+#include <boost/asio/thread_pool.hpp>
+#include <mutex>
+
+namespace gstio { namespace chain { namespace webassembly { namespace wasm2c {
+
+class native_module;
+
+/**
+ * @class wasm2c_runtime
+ * @brief Runs contracts as native code produced by wasm2c and the C compiler nodgst was built with
+ *
+ * Injected modules are translated to C and compiled into a shared object on a background worker. The compiler is
+ * pinned at build time by path and SHA-256 (GSTIO_WASM2C_COMPILER); if it is missing or has changed, every module
+ * runs on the wabt interpreter. Shared objects are stored in object_dir under the hash of the injected module and
+ * the toolchain, so they are reused across restarts but never across compilers or flags. Until the shared object
+ * of a module is ready, and whenever it cannot be built, the module runs on wabt. Native code calls the same host
+ * functions as wabt, so both paths share one set of intrinsics.
+ */
+class wasm2c_runtime : public gstio::chain::wasm_runtime_interface {
+   public:
+      /// an empty object_dir keeps shared objects in a temporary directory removed on shutdown
+      explicit wasm2c_runtime(const fc::path& object_dir);
+      ~wasm2c_runtime();
+      std::unique_ptr<wasm_instantiated_module_interface> instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory) override;
+
+      void immediately_exit_currently_running_module() override;
+
+      /// loads a shared object, sharing it with every other instance of the same module
+      std::shared_ptr<native_module> load(const fc::path& object);
+
+   private:
+      /// translates and compiles a module, returning the path of its shared object; runs on the compile worker
+      fc::path compile(const fc::sha256& module_id, const std::vector<char>& code);
+
+      std::unique_ptr<fc::temp_directory>  _temp_dir;
+      fc::path                             _object_dir;
+      fc::path                             _compiler;       ///< empty when native compilation is disabled
+      fc::sha256                           _toolchain_id;   ///< hash of the compiler binary, flags and wasm-rt.h
+      std::mutex                           _loaded_mutex;
+      std::map<string, std::weak_ptr<native_module>> _loaded;
+      wabt_runtime::wabt_runtime           _fallback;
+      boost::asio::thread_pool             _compile_pool{1};
+};
+
+} } } }// gstio::chain::webassembly::wasm2c
@@ -39,10 +39,14 @@ digest_type merkle(vector<digest_type> ids) {
       if( ids.size() % 2 )
          ids.push_back(ids.back());
 
-      for (size_t i = 0; i < ids.size() / 2; i++) {
-         ids[i] = digest_type::hash(make_canonical_pair(ids[2 * i], ids[(2 * i) + 1]));
+      for (size_t i = 0; i < ids.size(); i += 2) {
+         ids[i]     = make_canonical_left(ids[i]);
+         ids[i + 1] = make_canonical_right(ids[i + 1]);
       }
 
+      // hashes every pair of the level at once, the results replace the first half of ids
+      digest_type::hash_pairs(ids.data(), ids.data(), ids.size() / 2);
+
       ids.resize(ids.size() / 2);
    }
 
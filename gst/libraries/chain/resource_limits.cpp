@@ -4,20 +4,11 @@
 #include <gstio/chain/transaction_metadata.hpp>
 #include <gstio/chain/transaction.hpp>
 #include <boost/tuple/tuple_io.hpp>
-#include <gstio/chain/database_utils.hpp>
+#include <gstio/chain/state_index_set.hpp>
 #include <algorithm>
 
 namespace gstio { namespace chain { namespace resource_limits {
 
-using resource_index_set = index_set<
-   resource_limits_index,
-   resource_usage_index,
-   resource_gst_index,
-   resource_activation_gst_index,
-   resource_limits_state_index,
-   resource_limits_config_index
->;
-
 static_assert( config::rate_limiting_precision > 0, "config::rate_limiting_precision must be positive" );
 
 static uint64_t update_elastic_limit(uint64_t current_limit, uint64_t average_usage, const elastic_limit_parameters& params) {
@@ -0,0 +1,133 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+
+#include <gstio/chain/state_delta.hpp>
+#include <gstio/chain/exceptions.hpp>
+#include <gstio/chain/snapshot.hpp>
+
+#include <gstio/chain/state_index_set.hpp>
+
+namespace gstio { namespace chain {
+
+   using namespace resource_limits;
+
+   namespace {
+      // fields that are part of the object but not of its reflection
+
+      template<typename Stream, typename T>
+      auto pack_unreflected( Stream& ds, const T& row, int ) -> decltype( row.t_id, void() ) {
+         fc::raw::pack( ds, row.t_id._id );
+      }
+
+      template<typename Stream>
+      void pack_unreflected( Stream& ds, const resource_limits_object& row, int ) {
+         fc::raw::pack( ds, row.pending );
+      }
+
+      template<typename Stream, typename T>
+      void pack_unreflected( Stream&, const T&, long ) {}
+
+      template<typename Stream, typename T>
+      auto unpack_unreflected( Stream& ds, T& row, int ) -> decltype( row.t_id, void() ) {
+         fc::raw::unpack( ds, row.t_id._id );
+      }
+
+      template<typename Stream>
+      void unpack_unreflected( Stream& ds, resource_limits_object& row, int ) {
+         fc::raw::unpack( ds, row.pending );
+      }
+
+      template<typename Stream, typename T>
+      void unpack_unreflected( Stream&, T&, long ) {}
+
+      template<typename T>
+      bytes pack_row( const T& row ) {
+         fc::datastream<size_t> ps;
+         fc::raw::pack( ps, row );
+         pack_unreflected( ps, row, 0 );
+
+         bytes data( ps.tellp() );
+         fc::datastream<char*> ds( data.data(), data.size() );
+         fc::raw::pack( ds, row );
+         pack_unreflected( ds, row, 0 );
+         return data;
+      }
+
+      template<typename T>
+      void unpack_row( const bytes& data, T& row ) {
+         fc::datastream<const char*> ds( data.data(), data.size() );
+         fc::raw::unpack( ds, row );
+         unpack_unreflected( ds, row, 0 );
+      }
+   }
+
+   vector<state_table_delta> extract_state_deltas( const chainbase::database& db ) {
+      GST_ASSERT( db.get_undo_mode() == chainbase::undo_mode::map, database_exception,
+                  "state deltas can only be extracted from the undo history kept in undo_mode::map" );
+
+      vector<state_table_delta> result;
+      state_index_set::walk_indices( [&]( auto utils ) {
+         using index_t = typename decltype(utils)::index_t;
+         using value_t = typename index_t::value_type;
+
+         const auto& index = db.get_index<index_t>();
+         if( index.stack().empty() )
+            return;
+         const auto& undo = index.stack().back();
+         if( undo.old_values.empty() && undo.new_ids.empty() && undo.removed_values.empty() &&
+             index.next_id() == undo.old_next_id )
+            return;
+
+         result.emplace_back();
+         auto& delta = result.back();
+         delta.name = detail::snapshot_section_traits<value_t>::section_name();
+         delta.next_id = index.next_id()._id;
+         delta.rows.reserve( undo.old_values.size() + undo.new_ids.size() );
+         for( const auto& old : undo.old_values )
+            delta.rows.push_back( { old.first._id, pack_row( index.get( old.first ) ) } );
+         for( auto id : undo.new_ids )
+            delta.rows.push_back( { id._id, pack_row( index.get( id ) ) } );
+         delta.removed_ids.reserve( undo.removed_values.size() );
+         for( const auto& removed : undo.removed_values )
+            delta.removed_ids.push_back( removed.first._id );
+      });
+      return result;
+   }
+
+   void apply_state_deltas( chainbase::database& db, const vector<state_table_delta>& deltas ) {
+      size_t applied = 0;
+      state_index_set::walk_indices( [&]( auto utils ) {
+         using index_t = typename decltype(utils)::index_t;
+         using value_t = typename index_t::value_type;
+         using id_t    = typename value_t::id_type;
+
+         const auto name = detail::snapshot_section_traits<value_t>::section_name();
+         for( const auto& delta : deltas ) {
+            if( delta.name != name )
+               continue;
+
+            auto& index = db.get_mutable_index<index_t>();
+            for( auto id : delta.removed_ids )
+               index.remove_object( id );
+            for( const auto& row : delta.rows ) {
+               const auto* existing = index.find( id_t( row.id ) );
+               if( existing ) {
+                  index.modify( *existing, [&]( value_t& v ) {
+                     unpack_row( row.data, v );
+                  });
+               } else {
+                  index.emplace_with_id( id_t( row.id ), [&]( value_t& v ) {
+                     unpack_row( row.data, v );
+                  });
+               }
+            }
+            index.set_next_id( id_t( delta.next_id ) );
+            ++applied;
+         }
+      });
+      GST_ASSERT( applied == deltas.size(), database_exception, "state deltas contain an unknown table" );
+   }
+
+} } // gstio::chain
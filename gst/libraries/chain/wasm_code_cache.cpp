@@ -0,0 +1,175 @@
+#include <gstio/chain/wasm_code_cache.hpp>
+#include <gstio/chain/wasm_gstio_injection.hpp>
+#include <gstio/chain/exceptions.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/io/fstream.hpp>
+#include <boost/filesystem.hpp>
+#include <fstream>
+
+namespace gstio { namespace chain {
+
+   const uint32_t wasm_code_cache::format_version = 1;
+
+   namespace {
+      const uint32_t cache_magic = 0x43575347; // "GSWC"
+
+      struct entry_header {
+         uint32_t       magic             = cache_magic;
+         uint32_t       format_version    = 0;
+         uint32_t       injection_version = 0;
+         digest_type    checksum;          ///< sha256 of the packed entry that follows
+      };
+   }
+
+} } // gstio::chain
+
+FC_REFLECT( gstio::chain::entry_header, (magic)(format_version)(injection_version)(checksum) )
+
+namespace gstio { namespace chain {
+
+   wasm_code_cache::wasm_code_cache( const fc::path& d, uint64_t max_size ) : dir(d), max_size(max_size) {
+      if( !fc::is_directory( dir ) )
+         fc::create_directories( dir );
+      load_index();
+      evict( digest_type() );
+   }
+
+   /// orders the entries found on disk by their modification time, which get() refreshes on every use
+   void wasm_code_cache::load_index() {
+      namespace bfs = boost::filesystem;
+      vector<std::pair<std::time_t, file_entry>> found;
+      for( bfs::directory_iterator itr( dir ), end; itr != end; ++itr ) {
+         const auto& p = itr->path();
+         if( !bfs::is_regular_file( p ) )
+            continue;
+         if( p.extension() == ".tmp" ) {
+            // left behind by a crash while writing
+            fc::remove( p );
+            continue;
+         }
+         if( p.extension() != ".wasm" )
+            continue;
+         try {
+            file_entry e;
+            e.code_id = digest_type( p.stem().string() );
+            e.size = bfs::file_size( p );
+            found.emplace_back( bfs::last_write_time( p ), e );
+         } catch( ... ) {
+            fc::remove( p );
+         }
+      }
+      std::sort( found.begin(), found.end(), []( const auto& a, const auto& b ) { return a.first < b.first; } );
+      for( const auto& f : found ) {
+         if( files.push_back( f.second ).second )
+            total_size += f.second.size;
+      }
+   }
+
+   void wasm_code_cache::touch( const digest_type& code_id ) {
+      auto& by_id = files.get<by_code_id>();
+      auto itr = by_id.find( code_id );
+      if( itr == by_id.end() )
+         return;
+      files.relocate( files.end(), files.project<0>( itr ) );
+      boost::system::error_code ec;
+      boost::filesystem::last_write_time( entry_path( code_id ), std::time( nullptr ), ec );
+   }
+
+   void wasm_code_cache::forget( const digest_type& code_id ) {
+      auto& by_id = files.get<by_code_id>();
+      auto itr = by_id.find( code_id );
+      if( itr == by_id.end() )
+         return;
+      total_size -= itr->size;
+      by_id.erase( itr );
+   }
+
+   void wasm_code_cache::evict( const digest_type& keep_id ) {
+      if( !max_size )
+         return;
+      for( auto itr = files.begin(); itr != files.end() && total_size > max_size; ) {
+         if( itr->code_id == keep_id ) {
+            ++itr;
+            continue;
+         }
+         fc::remove( entry_path( itr->code_id ) );
+         total_size -= itr->size;
+         itr = files.erase( itr );
+      }
+   }
+
+   fc::path wasm_code_cache::entry_path( const digest_type& code_id )const {
+      return dir / (code_id.str() + ".wasm");
+   }
+
+   optional<wasm_code_cache::entry> wasm_code_cache::get( const digest_type& code_id ) {
+      const auto p = entry_path( code_id );
+      if( !fc::exists( p ) ) {
+         forget( code_id );
+         return optional<entry>();
+      }
+
+      try {
+         string content;
+         fc::read_file_contents( p, content );
+
+         fc::datastream<const char*> ds( content.data(), content.size() );
+         entry_header header;
+         fc::raw::unpack( ds, header );
+         if( header.magic != cache_magic || header.format_version != format_version ||
+             header.injection_version != wasm_injections::wasm_binary_injection::version ) {
+            forget( code_id );
+            fc::remove( p );
+            return optional<entry>();
+         }
+
+         GST_ASSERT( digest_type::hash( ds.pos(), ds.remaining() ) == header.checksum, wasm_exception,
+                     "checksum mismatch" );
+         entry e;
+         fc::raw::unpack( ds, e );
+         GST_ASSERT( e.code_id == code_id, wasm_exception, "entry is for code ${id}", ("id", e.code_id) );
+         touch( code_id );
+         return e;
+      } catch( const fc::exception& e ) {
+         wlog( "discarding corrupt WASM code cache entry ${p}: ${e}", ("p", p.generic_string())("e", e.to_string()) );
+      } catch( const std::exception& e ) {
+         wlog( "discarding corrupt WASM code cache entry ${p}: ${e}", ("p", p.generic_string())("e", e.what()) );
+      }
+      forget( code_id );
+      fc::remove( p );
+      return optional<entry>();
+   }
+
+   void wasm_code_cache::put( const entry& e ) {
+      const auto p   = entry_path( e.code_id );
+      const auto tmp = dir / (e.code_id.str() + ".tmp");
+      try {
+         auto packed = fc::raw::pack( e );
+         entry_header header;
+         header.format_version    = format_version;
+         header.injection_version = wasm_injections::wasm_binary_injection::version;
+         header.checksum          = digest_type::hash( packed.data(), packed.size() );
+
+         auto packed_header = fc::raw::pack( header );
+         {
+            std::ofstream out( tmp.generic_string().c_str(), std::ios::out | std::ios::binary | std::ofstream::trunc );
+            out.write( packed_header.data(), packed_header.size() );
+            out.write( packed.data(), packed.size() );
+            out.flush();
+            GST_ASSERT( out.good(), wasm_exception, "unable to write ${p}", ("p", tmp.generic_string()) );
+         }
+         // rename is atomic so a crash never leaves a partially written entry behind
+         fc::rename( tmp, p );
+
+         forget( e.code_id );
+         const uint64_t file_size = packed_header.size() + packed.size();
+         files.push_back( file_entry{ e.code_id, file_size } );
+         total_size += file_size;
+         evict( e.code_id );
+      } catch( const fc::exception& ex ) {
+         wlog( "unable to store WASM code cache entry ${p}: ${e}", ("p", p.generic_string())("e", ex.to_string()) );
+         fc::remove( tmp );
+      }
+   }
+
+} } // gstio::chain
@@ -28,7 +28,7 @@ namespace gstio { namespace chain {
    using namespace webassembly;
    using namespace webassembly::common;
 
-   wasm_interface::wasm_interface(vm_type vm) : my( new wasm_interface_impl(vm) ) {}
+   wasm_interface::wasm_interface(vm_type vm, const cache_config& cache) : my( new wasm_interface_impl(vm, cache) ) {}
 
    wasm_interface::~wasm_interface() {}
 
@@ -54,8 +54,16 @@ namespace gstio { namespace chain {
       //Hard: Kick off instantiation in a separate thread at this location
 	 }
 
+   void wasm_interface::precompile( const digest_type& code_id, const bytes& code, boost::asio::thread_pool& thread_pool ) {
+      my->precompile(code_id, code, thread_pool);
+   }
+
    void wasm_interface::apply( const digest_type& code_id, const shared_string& code, apply_context& context ) {
-      my->get_instantiated_module(code_id, code, context.trx_context)->apply(context);
+      my->get_instantiated_module(code_id, code, context.receiver, context.trx_context)->apply(context);
+   }
+
+   wasm_interface::cache_stats wasm_interface::get_cache_stats()const {
+      return my->stats;
    }
 
    void wasm_interface::exit() {
@@ -1925,6 +1933,8 @@ std::istream& operator>>(std::istream& in, wasm_interface::vm_type& runtime) {
       runtime = gstio::chain::wasm_interface::vm_type::wavm;
    else if (s == "wabt")
       runtime = gstio::chain::wasm_interface::vm_type::wabt;
+   else if (s == "wasm2c")
+      runtime = gstio::chain::wasm_interface::vm_type::wasm2c;
    else
       in.setstate(std::ios_base::failbit);
    return in;
@@ -0,0 +1,569 @@
+// boost::process fails to instantiate when included after chainbase with boost 1.74
+#include <boost/process.hpp>
+
+#include <gstio/chain/webassembly/wasm2c.hpp>
+#include <gstio/chain/webassembly/wasm2c_rt.hpp>
+#include <gstio/chain/apply_context.hpp>
+#include <gstio/chain/wasm_gstio_constraints.hpp>
+#include <gstio/chain/thread_utils.hpp>
+#include <gstio/chain/exceptions.hpp>
+#include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/scoped_exit.hpp>
+
+//wabt includes
+#include <src/apply-names.h>
+#include <src/binary-reader.h>
+#include <src/binary-reader-ir.h>
+#include <src/c-writer.h>
+#include <src/cast.h>
+#include <src/error-formatter.h>
+#include <src/generate-names.h>
+#include <src/ir.h>
+#include <src/stream.h>
+#include <src/validator.h>
+#include <wasm2c/wasm-rt.h>
+
+#include <dlfcn.h>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+namespace gstio { namespace chain { namespace webassembly { namespace wasm2c {
+
+using namespace gstio::chain::webassembly::wabt_runtime;
+namespace bp = boost::process;
+namespace wasm_constraints = gstio::chain::wasm_constraints;
+
+namespace {
+
+/**
+ * table of host callbacks handed to every shared object; the layout must match host_interface_source below. Every
+ * callback receives the context passed to gstio_wasm2c_apply, so no state of a running contract is kept in globals.
+ */
+struct host_interface {
+   void     (*trap)(void*, uint32_t);
+   void     (*allocate_memory)(void*, wasm_rt_memory_t*, uint32_t, uint32_t);
+   uint32_t (*grow_memory)(void*, wasm_rt_memory_t*, uint32_t);
+   uint64_t (*call)(void*, uint32_t, const uint64_t*);
+};
+
+const char* const host_interface_source =
+   "struct gstio_wasm2c_host {\n"
+   "   void     (*trap)(void*, uint32_t);\n"
+   "   void     (*allocate_memory)(void*, wasm_rt_memory_t*, uint32_t, uint32_t);\n"
+   "   uint32_t (*grow_memory)(void*, wasm_rt_memory_t*, uint32_t);\n"
+   "   uint64_t (*call)(void*, uint32_t, const uint64_t*);\n"
+   "};\n";
+
+typedef void (*bind_fn)(const host_interface*);
+typedef void (*apply_fn)(void*, uint64_t, uint64_t, uint64_t);
+
+using import_list = std::vector<const intrinsic_registrator::intrinsic_func_info*>;
+
+/// state of one apply on a native module, handed to the host callbacks as their context
+struct running_native_context {
+   const import_list&         imports;
+   std::vector<char>&         memory;
+   wabt_apply_instance_vars&  vars;
+};
+
+void host_trap(void*, uint32_t code) {
+   static const char* const reasons[] = { "none", "out of bounds memory access", "integer overflow",
+                                          "integer divide by zero", "invalid conversion to integer",
+                                          "unreachable executed", "indirect call signature mismatch",
+                                          "call stack exhausted" };
+   const char* reason = code < sizeof(reasons)/sizeof(reasons[0]) ? reasons[code] : "unknown";
+   FC_THROW_EXCEPTION( wasm_execution_error, "wasm2c trap: ${r}", ("r", reason) );
+}
+
+void host_allocate_memory(void* context, wasm_rt_memory_t* mem, uint32_t initial_pages, uint32_t max_pages) {
+   auto& ctx = *static_cast<running_native_context*>(context);
+   ctx.memory.assign(uint64_t(initial_pages) * WABT_PAGE_SIZE, 0);
+   ctx.vars.linear_memory = &ctx.memory;
+
+   mem->data      = (uint8_t*)ctx.memory.data();
+   mem->pages     = initial_pages;
+   mem->max_pages = max_pages;
+   mem->size      = ctx.memory.size();
+}
+
+uint32_t host_grow_memory(void* context, wasm_rt_memory_t* mem, uint32_t delta) {
+   const uint32_t old_pages = mem->pages;
+   const uint64_t new_pages = uint64_t(old_pages) + delta;
+   if(new_pages > mem->max_pages || new_pages * WABT_PAGE_SIZE > wasm_constraints::maximum_linear_memory)
+      return uint32_t(-1);
+
+   auto& ctx = *static_cast<running_native_context*>(context);
+   ctx.memory.resize(new_pages * WABT_PAGE_SIZE, 0);
+
+   mem->data  = (uint8_t*)ctx.memory.data();
+   mem->pages = new_pages;
+   mem->size  = ctx.memory.size();
+   return old_pages;
+}
+
+uint64_t host_call(void* context, uint32_t index, const uint64_t* args) {
+   auto& ctx = *static_cast<running_native_context*>(context);
+   const auto& info = *ctx.imports.at(index);
+
+   TypedValues values;
+   values.reserve(info.sig.param_types.size());
+   for(size_t i = 0; i < info.sig.param_types.size(); ++i) {
+      TypedValue v(info.sig.param_types[i]);
+      switch(v.type) {
+         case wabt::Type::I32: v.set_i32(uint32_t(args[i]));         break;
+         case wabt::Type::I64: v.set_i64(args[i]);                   break;
+         case wabt::Type::F32: v.value.f32_bits = uint32_t(args[i]); break;
+         case wabt::Type::F64: v.value.f64_bits = args[i];           break;
+         default: GST_ASSERT( false, wasm_execution_error, "unsupported host function parameter type" );
+      }
+      values.push_back(v);
+   }
+
+   TypedValue ret = info.func(ctx.vars, values);
+   if(info.sig.result_types.empty())
+      return 0;
+   switch(info.sig.result_types[0]) {
+      case wabt::Type::I32: return ret.get_i32();
+      case wabt::Type::I64: return ret.get_i64();
+      case wabt::Type::F32: return ret.value.f32_bits;
+      case wabt::Type::F64: return ret.value.f64_bits;
+      default: GST_ASSERT( false, wasm_execution_error, "unsupported host function result type" );
+   }
+   return 0;
+}
+
+const host_interface the_host_interface = { &host_trap, &host_allocate_memory, &host_grow_memory, &host_call };
+
+const intrinsic_registrator::intrinsic_func_info* find_intrinsic(const string& mod, const string& name) {
+   const auto& intrinsics = intrinsic_registrator::get_map();
+   auto m = intrinsics.find(mod);
+   if(m == intrinsics.end())
+      return nullptr;
+   auto f = m->second.find(name);
+   return f == m->second.end() ? nullptr : &f->second;
+}
+
+} // anonymous namespace
+
+/**
+ * A loaded shared object produced by wasm2c_runtime::compile. The generated code keeps the state of the module
+ * instance in globals of the shared object, so all users of one object share a native_module and apply() runs
+ * one action at a time.
+ */
+class native_module {
+   public:
+      explicit native_module(const fc::path& object) {
+         _handle.reset(dlopen(object.generic_string().c_str(), RTLD_NOW | RTLD_LOCAL));
+         GST_ASSERT( _handle, wasm_exception, "unable to load ${o}: ${e}", ("o", object.generic_string())("e", dlerror()) );
+
+         auto bind    = (bind_fn)dlsym(_handle.get(), "gstio_wasm2c_bind");
+         _apply       = (apply_fn)dlsym(_handle.get(), "gstio_wasm2c_apply");
+         auto count   = (const uint32_t*)dlsym(_handle.get(), "gstio_wasm2c_import_count");
+         auto modules = (const char* const*)dlsym(_handle.get(), "gstio_wasm2c_import_modules");
+         auto names   = (const char* const*)dlsym(_handle.get(), "gstio_wasm2c_import_names");
+         GST_ASSERT( bind && _apply && count && modules && names, wasm_exception,
+                     "${o} is not a wasm2c contract object", ("o", object.generic_string()) );
+
+         for(uint32_t i = 0; i < *count; ++i) {
+            auto info = find_intrinsic(modules[i], names[i]);
+            GST_ASSERT( info, wasm_exception, "${m}.${n} unresolveable", ("m", modules[i])("n", names[i]) );
+            _imports.push_back(info);
+         }
+         bind(&the_host_interface);
+      }
+
+      void apply(apply_context& context) {
+         std::lock_guard<std::mutex> g(_mutex);
+         wabt_apply_instance_vars this_run_vars{nullptr, context};
+         running_native_context running{_imports, _memory, this_run_vars};
+         _apply(&running, uint64_t(context.receiver), uint64_t(context.act.account), uint64_t(context.act.name));
+      }
+
+   private:
+      std::unique_ptr<void, int(*)(void*)>  _handle{nullptr, &dlclose};
+      apply_fn                              _apply = nullptr;
+      import_list                           _imports;
+      std::vector<char>                     _memory;
+      std::mutex                            _mutex;
+};
+
+namespace {
+
+/**
+ * Runs a module natively once its shared object is ready and on wabt before. The switch only happens on the first
+ * action of a transaction, so all actions of one transaction that run this module run on the same engine.
+ */
+class wasm2c_instantiated_module : public wasm_instantiated_module_interface {
+   public:
+      explicit wasm2c_instantiated_module(std::shared_ptr<native_module> native) : _native(std::move(native)) {}
+
+      wasm2c_instantiated_module(wasm2c_runtime& runtime, std::unique_ptr<wasm_instantiated_module_interface> fallback,
+                                 std::future<fc::path> object) :
+         _runtime(&runtime), _fallback(std::move(fallback)), _object(std::move(object)) {}
+
+      void apply(apply_context& context) override {
+         const bool new_transaction = context.trx_context.id != _last_trx_id;
+         _last_trx_id = context.trx_context.id;
+         if(!_native && new_transaction && _object.valid() && _object.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            try {
+               _native = _runtime->load(_object.get());
+               _fallback.reset();
+            } catch( const fc::exception& e ) {
+               wlog( "contract stays on wabt, wasm2c failed: ${e}", ("e", e.to_detail_string()) );
+            } catch( const std::exception& e ) {
+               wlog( "contract stays on wabt, wasm2c failed: ${e}", ("e", e.what()) );
+            }
+         }
+
+         if(_native)
+            _native->apply(context);
+         else
+            _fallback->apply(context);
+      }
+
+   private:
+      wasm2c_runtime*                                     _runtime = nullptr;
+      std::shared_ptr<native_module>                      _native;
+      std::unique_ptr<wasm_instantiated_module_interface> _fallback;
+      std::future<fc::path>                               _object;
+      transaction_id_type                                 _last_trx_id;
+};
+
+/// the name mangling of wabt's c-writer, which names imports after their module, field and signature
+std::string mangle_name(const string& name) {
+   std::string result = "Z_";
+   for(char c : name) {
+      if((isalnum(c) && c != 'Z') || c == '_') {
+         result += c;
+      } else {
+         char buf[4];
+         snprintf(buf, sizeof(buf), "Z%02X", static_cast<uint8_t>(c));
+         result += buf;
+      }
+   }
+   return result;
+}
+
+std::string mangle_types(const wabt::TypeVector& types) {
+   if(types.empty())
+      return "v";
+   std::string result;
+   for(auto type : types) {
+      switch(type) {
+         case wabt::Type::I32: result += 'i'; break;
+         case wabt::Type::I64: result += 'j'; break;
+         case wabt::Type::F32: result += 'f'; break;
+         case wabt::Type::F64: result += 'd'; break;
+         default: GST_ASSERT( false, wasm_serialization_error, "unsupported value type" );
+      }
+   }
+   return result;
+}
+
+const char* c_type(wabt::Type type) {
+   switch(type) {
+      case wabt::Type::I32: return "u32";
+      case wabt::Type::I64: return "u64";
+      case wabt::Type::F32: return "f32";
+      case wabt::Type::F64: return "f64";
+      default: GST_ASSERT( false, wasm_serialization_error, "unsupported value type" );
+   }
+   return nullptr;
+}
+
+std::string c_string_literal(const string& s) {
+   std::string result = "\"";
+   for(char c : s) {
+      if(isalnum(c) || c == '_' || c == '.') {
+         result += c;
+      } else {
+         char buf[5];
+         snprintf(buf, sizeof(buf), "\\%03o", static_cast<uint8_t>(c));
+         result += buf;
+      }
+   }
+   return result + "\"";
+}
+
+/**
+ * C source linked into every shared object next to the wasm2c output: it implements the wasm-rt.h runtime on top of
+ * the host callbacks, forwards every import to the host and exports the entry points native_module looks up.
+ */
+std::string glue_source(const wabt::Module& module, const string& header_name) {
+   std::ostringstream out;
+   out << "/* generated by nodgst for wasm2c, do not edit */\n"
+       << "#include <stdarg.h>\n#include <stdlib.h>\n#include <string.h>\n"
+       << "#include \"" << header_name << "\"\n\n"
+       << "#define GSTIO_EXPORT __attribute__((visibility(\"default\")))\n\n"
+       << host_interface_source << "\n"
+       << "static const struct gstio_wasm2c_host* host;\n"
+       << "static void* host_context;\n"
+       << "static wasm_rt_elem_t* table_data;\n"
+       << "uint32_t wasm_rt_call_stack_depth;\n\n";
+
+   out << "void wasm_rt_trap(wasm_rt_trap_t code) {\n"
+       << "   host->trap(host_context, code);\n"
+       << "   abort();\n"
+       << "}\n\n"
+       << "void wasm_rt_allocate_memory(wasm_rt_memory_t* mem, uint32_t initial_pages, uint32_t max_pages) {\n"
+       << "   host->allocate_memory(host_context, mem, initial_pages, max_pages);\n"
+       << "}\n\n"
+       << "uint32_t wasm_rt_grow_memory(wasm_rt_memory_t* mem, uint32_t pages) {\n"
+       << "   return host->grow_memory(host_context, mem, pages);\n"
+       << "}\n\n"
+       << "/* init() runs before every apply, so the table is only allocated once */\n"
+       << "void wasm_rt_allocate_table(wasm_rt_table_t* table, uint32_t elements, uint32_t max_elements) {\n"
+       << "   if(!table->data)\n"
+       << "      table->data = table_data = calloc(elements ? elements : 1, sizeof(wasm_rt_elem_t));\n"
+       << "   else\n"
+       << "      memset(table->data, 0, elements * sizeof(wasm_rt_elem_t));\n"
+       << "   table->size = elements;\n"
+       << "   table->max_size = max_elements;\n"
+       << "}\n\n"
+       << "__attribute__((destructor)) static void release_table(void) {\n"
+       << "   free(table_data);\n"
+       << "}\n\n";
+
+   // func types are compared structurally by call_indirect, so equal signatures share an index
+   size_t max_signature = 0;
+   for(const wabt::FuncType* type : module.func_types)
+      max_signature = std::max<size_t>(max_signature, type->GetNumParams() + type->GetNumResults());
+   out << "static char func_type_sigs[" << std::max<size_t>(module.func_types.size(), 1) << "][" << max_signature + 2 << "];\n"
+       << "static uint32_t func_type_count;\n\n"
+       << "uint32_t wasm_rt_register_func_type(uint32_t params, uint32_t results, ...) {\n"
+       << "   char sig[" << max_signature + 2 << "];\n"
+       << "   uint32_t i, n = 0;\n"
+       << "   va_list types;\n"
+       << "   va_start(types, results);\n"
+       << "   for(i = 0; i < params + results; ++i) {\n"
+       << "      if(i == params)\n"
+       << "         sig[n++] = ':';\n"
+       << "      sig[n++] = \"ijfd\"[va_arg(types, int)];\n"
+       << "   }\n"
+       << "   va_end(types);\n"
+       << "   sig[n] = 0;\n"
+       << "   for(i = 0; i < func_type_count; ++i)\n"
+       << "      if(strcmp(func_type_sigs[i], sig) == 0)\n"
+       << "         return i;\n"
+       << "   strcpy(func_type_sigs[func_type_count], sig);\n"
+       << "   return func_type_count++;\n"
+       << "}\n\n";
+
+   std::vector<const wabt::Import*> imports;
+   for(const wabt::Import* import : module.imports) {
+      GST_ASSERT( import->kind() == wabt::ExternalKind::Func, wasm_serialization_error,
+                  "wasm2c only supports function imports, ${m}.${n} is not a function", ("m", import->module_name)("n", import->field_name) );
+      const auto& sig = wabt::cast<wabt::FuncImport>(import)->func.decl.sig;
+      auto info = find_intrinsic(import->module_name, import->field_name);
+      GST_ASSERT( info, wasm_serialization_error, "${m}.${n} unresolveable", ("m", import->module_name)("n", import->field_name) );
+      GST_ASSERT( info->sig.param_types == sig.param_types && info->sig.result_types == sig.result_types, wasm_serialization_error,
+                  "${m}.${n} has an unexpected signature", ("m", import->module_name)("n", import->field_name) );
+      GST_ASSERT( sig.GetNumResults() <= 1, wasm_serialization_error, "multiple results are not supported" );
+
+      const auto index = imports.size();
+      const std::string result = sig.GetNumResults() ? c_type(sig.GetResultType(0)) : "void";
+      std::string params;
+      for(wabt::Index i = 0; i < sig.GetNumParams(); ++i)
+         params += std::string(i ? ", " : "") + c_type(sig.GetParamType(i)) + " a" + std::to_string(i);
+
+      out << "/* import: '" << import->module_name << "' '" << import->field_name << "' */\n"
+          << "static " << result << " import_" << index << "(" << (params.empty() ? "void" : params) << ") {\n"
+          << "   uint64_t args[" << std::max<wabt::Index>(sig.GetNumParams(), 1) << "] = {0};\n";
+      for(wabt::Index i = 0; i < sig.GetNumParams(); ++i) {
+         if(sig.GetParamType(i) == wabt::Type::F32 || sig.GetParamType(i) == wabt::Type::F64)
+            out << "   memcpy(&args[" << i << "], &a" << i << ", sizeof(a" << i << "));\n";
+         else
+            out << "   args[" << i << "] = a" << i << ";\n";
+      }
+      if(!sig.GetNumResults()) {
+         out << "   host->call(host_context, " << index << ", args);\n";
+      } else if(sig.GetResultType(0) == wabt::Type::F32 || sig.GetResultType(0) == wabt::Type::F64) {
+         out << "   uint64_t bits = host->call(host_context, " << index << ", args);\n"
+             << "   " << result << " r;\n"
+             << "   memcpy(&r, &bits, sizeof(r));\n"
+             << "   return r;\n";
+      } else {
+         out << "   return (" << result << ")host->call(host_context, " << index << ", args);\n";
+      }
+      out << "}\n"
+          << result << " (*" << mangle_name(import->module_name) << mangle_name(import->field_name)
+          << mangle_name(mangle_types(sig.result_types) + mangle_types(sig.param_types)) << ")("
+          << (params.empty() ? "void" : params) << ") = import_" << index << ";\n\n";
+      imports.push_back(import);
+   }
+
+   out << "GSTIO_EXPORT const uint32_t gstio_wasm2c_import_count = " << imports.size() << ";\n"
+       << "GSTIO_EXPORT const char* const gstio_wasm2c_import_modules[] = {";
+   for(const auto* import : imports)
+      out << c_string_literal(import->module_name) << ", ";
+   out << "0};\n"
+       << "GSTIO_EXPORT const char* const gstio_wasm2c_import_names[] = {";
+   for(const auto* import : imports)
+      out << c_string_literal(import->field_name) << ", ";
+   out << "0};\n\n"
+       << "GSTIO_EXPORT void gstio_wasm2c_bind(const struct gstio_wasm2c_host* h) {\n"
+       << "   host = h;\n"
+       << "}\n\n"
+       << "/* the host runs one apply of a shared object at a time */\n"
+       << "GSTIO_EXPORT void gstio_wasm2c_apply(void* context, uint64_t receiver, uint64_t code, uint64_t action) {\n"
+       << "   host_context = context;\n"
+       << "   wasm_rt_call_stack_depth = 0;\n"
+       << "   WASM_RT_ADD_PREFIX(init)();\n"
+       << "   (*WASM_RT_ADD_PREFIX(Z_applyZ_vjjj))(receiver, code, action);\n"
+       << "}\n";
+   return out.str();
+}
+
+/// flags every contract is compiled with; part of the object key, so changing them rebuilds all objects
+const std::vector<std::string>& compile_flags() {
+   static const std::vector<std::string> flags = {
+      "-O2", "-shared", "-fPIC", "-fexceptions", "-fvisibility=hidden", "-ffp-contract=off", "-fno-fast-math",
+      "-DWASM_RT_MODULE_PREFIX=gstio_contract_",
+      "-DWASM_RT_MAX_CALL_STACK_DEPTH=" + std::to_string(wasm_constraints::maximum_call_depth + 2) };
+   return flags;
+}
+
+} // anonymous namespace
+
+wasm2c_runtime::wasm2c_runtime(const fc::path& object_dir) : _object_dir(object_dir) {
+   if(_object_dir == fc::path()) {
+      _temp_dir = std::make_unique<fc::temp_directory>();
+      _object_dir = _temp_dir->path();
+   } else if(!fc::is_directory(_object_dir)) {
+      fc::create_directories(_object_dir);
+   }
+   std::ofstream(( _object_dir / "wasm-rt.h" ).generic_string().c_str(), std::ios::out | std::ofstream::trunc) << wasm_rt_header;
+
+   // only the compiler this node was built with is ever run, and only while it is the same binary
+   const fc::path compiler = pinned_compiler;
+   if(compiler == fc::path() || !fc::exists(compiler)) {
+      wlog( "wasm2c compiler ${c} not found, contracts will run on wabt", ("c", compiler.generic_string()) );
+      return;
+   }
+   string compiler_binary;
+   fc::read_file_contents(compiler, compiler_binary);
+   const auto compiler_hash = fc::sha256::hash(compiler_binary);
+   if(compiler_hash.str() != pinned_compiler_sha256) {
+      wlog( "wasm2c compiler ${c} changed since nodgst was built, contracts will run on wabt", ("c", compiler.generic_string()) );
+      return;
+   }
+   _compiler = compiler;
+
+   fc::sha256::encoder enc;
+   fc::raw::pack(enc, compiler_hash);
+   fc::raw::pack(enc, compile_flags());
+   fc::raw::pack(enc, std::string(wasm_rt_header));
+   _toolchain_id = enc.result();
+}
+
+wasm2c_runtime::~wasm2c_runtime() {
+   _compile_pool.stop();
+   _compile_pool.join();
+}
+
+std::unique_ptr<wasm_instantiated_module_interface> wasm2c_runtime::instantiate_module(const char* code_bytes, size_t code_size, std::vector<uint8_t> initial_memory) {
+   if(_compiler == fc::path())
+      return _fallback.instantiate_module(code_bytes, code_size, std::move(initial_memory));
+
+   fc::sha256::encoder enc;
+   fc::raw::pack(enc, _toolchain_id);
+   enc.write(code_bytes, code_size);
+   const auto module_id = enc.result();
+   const auto object = _object_dir / (module_id.str() + ".so");
+   if(fc::exists(object)) {
+      try {
+         return std::make_unique<wasm2c_instantiated_module>(load(object));
+      } catch( const fc::exception& e ) {
+         wlog( "discarding wasm2c object ${o}: ${e}", ("o", object.generic_string())("e", e.to_string()) );
+         fc::remove(object);
+      }
+   }
+
+   auto fallback = _fallback.instantiate_module(code_bytes, code_size, std::move(initial_memory));
+   std::vector<char> code(code_bytes, code_bytes + code_size);
+   auto pending = async_thread_pool(_compile_pool, [this, module_id, code{std::move(code)}]() {
+      return compile(module_id, code);
+   });
+   return std::make_unique<wasm2c_instantiated_module>(*this, std::move(fallback), std::move(pending));
+}
+
+std::shared_ptr<native_module> wasm2c_runtime::load(const fc::path& object) {
+   std::lock_guard<std::mutex> g(_loaded_mutex);
+   auto& loaded = _loaded[object.generic_string()];
+   auto module = loaded.lock();
+   if(!module) {
+      module = std::make_shared<native_module>(object);
+      loaded = module;
+   }
+   return module;
+}
+
+fc::path wasm2c_runtime::compile(const fc::sha256& module_id, const std::vector<char>& code) {
+   const string name = module_id.str();
+   const auto c_file     = _object_dir / (name + ".c");
+   const auto header     = _object_dir / (name + ".h");
+   const auto glue_file  = _object_dir / (name + "-glue.c");
+   const auto log_file   = _object_dir / (name + ".log");
+   const auto tmp_object = _object_dir / (name + ".so.tmp");
+   const auto object     = _object_dir / (name + ".so");
+   auto cleanup = fc::make_scoped_exit([&]() {
+      for(const auto& p : {c_file, header, glue_file, log_file, tmp_object})
+         fc::remove(p);
+   });
+
+   wabt::Errors errors;
+   wabt::Module module;
+   wabt::ReadBinaryOptions read_options;
+   wabt::Result res = wabt::ReadBinaryIr(name.c_str(), code.data(), code.size(), read_options, &errors, &module);
+   if(wabt::Succeeded(res))
+      res = wabt::ValidateModule(&module, &errors, wabt::ValidateOptions());
+   if(wabt::Succeeded(res))
+      res = wabt::GenerateNames(&module);
+   GST_ASSERT( wabt::Succeeded(res), wasm_serialization_error, "wasm2c unable to read module: ${e}",
+               ("e", wabt::FormatErrorsToString(errors, wabt::Location::Type::Binary)) );
+   wabt::ApplyNames(&module);
+
+   const wabt::Export* apply_export = module.GetExport("apply");
+   GST_ASSERT( apply_export && apply_export->kind == wabt::ExternalKind::Func, wasm_serialization_error, "module has no apply function" );
+   const auto& apply_sig = module.GetFunc(apply_export->var)->decl.sig;
+   GST_ASSERT( apply_sig.param_types == wabt::TypeVector(3, wabt::Type::I64) && apply_sig.result_types.empty(),
+               wasm_serialization_error, "apply function has an unexpected signature" );
+
+   {
+      wabt::FileStream c_stream(c_file.generic_string());
+      wabt::FileStream h_stream(header.generic_string());
+      res = wabt::WriteC(&c_stream, &h_stream, (name + ".h").c_str(), &module, wabt::WriteCOptions());
+      GST_ASSERT( wabt::Succeeded(res), wasm_serialization_error, "wasm2c unable to write C source" );
+   }
+   std::ofstream(glue_file.generic_string().c_str(), std::ios::out | std::ofstream::trunc) << glue_source(module, name + ".h");
+
+   std::vector<std::string> args = compile_flags();
+   args.insert(args.end(), { "-I", _object_dir.generic_string(),
+                             "-o", tmp_object.generic_string(),
+                             c_file.generic_string(), glue_file.generic_string() });
+   // nothing of the node's environment reaches the compiler, its tools are only looked up next to it
+   bp::environment env;
+   env["PATH"] = _compiler.parent_path().generic_string();
+   int status = bp::system( boost::filesystem::path(_compiler.generic_string()), bp::args(args), env,
+                            bp::start_dir = _object_dir.generic_string(),
+                            bp::std_in.close(),
+                            bp::std_out > bp::null,
+                            bp::std_err > boost::filesystem::path(log_file.generic_string()) );
+   if(status != 0) {
+      string log;
+      fc::read_file_contents(log_file, log);
+      GST_THROW( wasm_exception, "${c} failed for ${n}: ${l}", ("c", _compiler.generic_string())("n", name)("l", log) );
+   }
+
+   // rename is atomic, so a shared object found at startup is always complete
+   fc::rename(tmp_object, object);
+   return object;
+}
+
+void wasm2c_runtime::immediately_exit_currently_running_module() {
+   throw wasm_exit();
+}
+
+}}}}
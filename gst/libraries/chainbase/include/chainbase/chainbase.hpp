@@ -8,6 +8,7 @@
 #include <boost/interprocess/containers/string.hpp>
 #include <boost/interprocess/allocators/allocator.hpp>
 #include <boost/interprocess/sync/interprocess_sharable_mutex.hpp>
+#include <boost/interprocess/sync/scoped_lock.hpp>
 #include <boost/interprocess/sync/sharable_lock.hpp>
 #include <boost/interprocess/sync/file_lock.hpp>
 
@@ -24,6 +25,7 @@
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
+#include <thread>
 #include <typeindex>
 #include <typeinfo>
 
@@ -150,6 +152,86 @@ namespace chainbase {
          int64_t                      revision = 0;
    };
 
+   /**
+    *  How a generic_index records the changes made during undo sessions.
+    *
+    *  map: each session keeps the previous value of every object it changed in maps keyed by id (undo_state). Changing
+    *       an object twice stores one value, but every change costs a lookup and a tree node in the segment.
+    *  log: all sessions append their changes to one log (undo_log). Recording a change needs no lookup, undo replays
+    *       the log backwards, squash only drops a session boundary and commit truncates the front of the log.
+    */
+   enum class undo_mode : uint8_t {
+      map = 0,
+      log = 1
+   };
+
+   /**
+    *  Where the state of a database lives while it is open.
+    *
+    *  mapped: shared_memory.bin is mapped and the kernel writes changed pages back to it.
+    *  heap:   shared_memory.bin is read into anonymous memory, optionally backed by hugepages, when the database is
+    *          opened and written back when it is closed cleanly. The file keeps its dirty flag while the database is open.
+    *  locked: like heap, and the memory is locked with mlock so that it is never paged out.
+    */
+   enum class map_mode : uint8_t {
+      mapped = 0,
+      heap   = 1,
+      locked = 2
+   };
+
+   /**
+    *  Append-only undo log shared by all undo sessions of an index. Changes are appended in the order they were made,
+    *  values holds the previous value of every modified or removed object in the same order. Positions are counted
+    *  from the creation of the log so that commit can drop entries from the front.
+    */
+   template< typename value_type >
+   class undo_log
+   {
+      public:
+         typedef typename value_type::id_type id_type;
+
+         enum class change_kind : uint8_t {
+            created,
+            modified,
+            removed
+         };
+
+         struct change {
+            id_type      id;
+            change_kind  kind;
+         };
+
+         struct session_start {
+            int64_t   revision = 0;
+            id_type   old_next_id = 0;
+            uint64_t  first_change = 0;
+            uint64_t  first_value = 0;
+         };
+
+         template<typename T>
+         undo_log( allocator<T> al )
+         :changes( allocator<change>( al.get_segment_manager() ) ),
+          values( allocator<value_type>( al.get_segment_manager() ) ),
+          sessions( allocator<session_start>( al.get_segment_manager() ) ){}
+
+         uint64_t end_change()const { return changes_begin + changes.size(); }
+         uint64_t end_value()const  { return values_begin + values.size(); }
+
+         /// drops changes and values recorded before the given positions
+         void truncate( uint64_t change_pos, uint64_t value_pos ) {
+            changes.erase( changes.begin(), changes.begin() + (change_pos - changes_begin) );
+            values.erase( values.begin(), values.begin() + (value_pos - values_begin) );
+            changes_begin = change_pos;
+            values_begin  = value_pos;
+         }
+
+         boost::interprocess::deque< change, allocator<change> >                changes;
+         boost::interprocess::deque< value_type, allocator<value_type> >        values;
+         boost::interprocess::deque< session_start, allocator<session_start> > sessions;
+         uint64_t                                                               changes_begin = 0;
+         uint64_t                                                               values_begin = 0;
+   };
+
    /**
     * The code we want to implement is this:
     *
@@ -188,15 +270,31 @@ namespace chainbase {
          typedef typename index_type::value_type                       value_type;
          typedef bip::allocator< generic_index, segment_manager_type > allocator_type;
          typedef undo_state< value_type >                              undo_state_type;
+         typedef undo_log< value_type >                                undo_log_type;
 
          generic_index( allocator<value_type> a )
-         :_stack(a),_indices( a ),_size_of_value_type( sizeof(typename MultiIndexType::node_type) ),_size_of_this(sizeof(*this)){}
+         :_stack(a),_log(a),_indices( a ),_size_of_value_type( sizeof(typename MultiIndexType::node_type) ),_size_of_this(sizeof(*this)){}
+
+         /**
+          *  Version of the layout of this class in shared memory, part of the name the index is stored under. Version 1
+          *  is legacy_generic_index.
+          */
+         static const uint32_t layout_version = 2;
 
          void validate()const {
             if( sizeof(typename MultiIndexType::node_type) != _size_of_value_type || sizeof(*this) != _size_of_this )
                BOOST_THROW_EXCEPTION( std::runtime_error("content of memory does not match data expected by executable") );
          }
 
+         /** takes over the objects and undo history of an index stored in the legacy layout, which is left empty */
+         template<typename Legacy>
+         void migrate_from( Legacy& legacy ) {
+            _stack.swap( legacy._stack );
+            _indices.swap( legacy._indices );
+            _revision = legacy._revision;
+            _next_id  = legacy._next_id;
+         }
+
          /**
           * Construct a new element in the multi_index_container.
           * Set the ID to the next available ID, then increment _next_id and fire off on_create().
@@ -221,6 +319,34 @@ namespace chainbase {
             return *insert_result.first;
          }
 
+         /**
+          * Construct a new element with a given ID, used to recreate objects whose changes were recorded elsewhere.
+          * _next_id is moved past the ID when needed so that later calls to emplace() cannot reuse it.
+          */
+         template<typename Constructor>
+         const value_type& emplace_with_id( typename value_type::id_type id, Constructor&& c ) {
+            auto constructor = [&]( value_type& v ) {
+               v.id = id;
+               c( v );
+            };
+
+            auto insert_result = _indices.emplace( constructor, _indices.get_allocator() );
+
+            if( !insert_result.second ) {
+               BOOST_THROW_EXCEPTION( std::logic_error("could not insert object, most likely a uniqueness constraint was violated") );
+            }
+
+            if( !(id < _next_id) )
+               _next_id = id._id + 1;
+            on_create( *insert_result.first );
+            return *insert_result.first;
+         }
+
+         typename value_type::id_type next_id()const { return _next_id; }
+
+         /** the previous value is restored when the current undo session is undone */
+         void set_next_id( typename value_type::id_type id ) { _next_id = id; }
+
          template<typename Modifier>
          void modify( const value_type& obj, Modifier&& m ) {
             on_modify( obj );
@@ -296,6 +422,20 @@ namespace chainbase {
 
          session start_undo_session( bool enabled ) {
             if( enabled ) {
+               // the undo representation can only change while there is no undo history
+               if( !this->enabled() )
+                  _undo_mode = _requested_undo_mode;
+
+               if( _undo_mode == undo_mode::log ) {
+                  typename undo_log_type::session_start start;
+                  start.revision     = ++_revision;
+                  start.old_next_id  = _next_id;
+                  start.first_change = _log.end_change();
+                  start.first_value  = _log.end_value();
+                  _log.sessions.push_back( start );
+                  return session( *this, _revision );
+               }
+
                _stack.emplace_back( _indices.get_allocator() );
                _stack.back().old_next_id = _next_id;
                _stack.back().revision = ++_revision;
@@ -313,6 +453,7 @@ namespace chainbase {
           */
          void undo() {
             if( !enabled() ) return;
+            if( _undo_mode == undo_mode::log ) return undo_log_session();
 
             const auto& head = _stack.back();
 
@@ -347,6 +488,14 @@ namespace chainbase {
          void squash()
          {
             if( !enabled() ) return;
+            if( _undo_mode == undo_mode::log ) {
+               // the changes of the squashed session now belong to the previous one
+               _log.sessions.pop_back();
+               if( _log.sessions.empty() )
+                  _log.truncate( _log.end_change(), _log.end_value() );
+               --_revision;
+               return;
+            }
             if( _stack.size() == 1 ) {
                _stack.pop_front();
                --_revision;
@@ -452,6 +601,16 @@ namespace chainbase {
           */
          void commit( int64_t revision )
          {
+            if( _undo_mode == undo_mode::log ) {
+               while( _log.sessions.size() && _log.sessions.front().revision <= revision )
+                  _log.sessions.pop_front();
+               if( _log.sessions.empty() )
+                  _log.truncate( _log.end_change(), _log.end_value() );
+               else
+                  _log.truncate( _log.sessions.front().first_change, _log.sessions.front().first_value );
+               return;
+            }
+
             while( _stack.size() && _stack[0].revision <= revision )
             {
                _stack.pop_front();
@@ -469,7 +628,7 @@ namespace chainbase {
 
          void set_revision( uint64_t revision )
          {
-            if( _stack.size() != 0 )
+            if( enabled() )
                BOOST_THROW_EXCEPTION( std::logic_error("cannot set revision while there is an existing undo stack") );
 
             if( revision > std::numeric_limits<int64_t>::max() )
@@ -489,7 +648,12 @@ namespace chainbase {
             int64_t begin = _revision;
             int64_t end   = _revision;
 
-            if( _stack.size() > 0 ) {
+            if( _undo_mode == undo_mode::log ) {
+               if( _log.sessions.size() > 0 ) {
+                  begin = _log.sessions.front().revision - 1;
+                  end   = _log.sessions.back().revision;
+               }
+            } else if( _stack.size() > 0 ) {
                begin = _stack.front().revision - 1;
                end   = _stack.back().revision;
             }
@@ -497,14 +661,77 @@ namespace chainbase {
             return {begin, end};
          }
 
+         /** undo history kept in undo_mode::map, empty in undo_mode::log */
          const auto& stack()const { return _stack; }
+         const undo_log_type& log()const { return _log; }
+
+         undo_mode get_undo_mode()const { return _undo_mode; }
+
+         /**
+          *  Selects how undo history is recorded. When there is undo history in the other representation, the change
+          *  takes effect once that history has been committed or undone.
+          */
+         void set_undo_mode( undo_mode mode )
+         {
+            _requested_undo_mode = mode;
+            if( !enabled() )
+               _undo_mode = mode;
+         }
 
       private:
-         bool enabled()const { return _stack.size(); }
+         bool enabled()const { return _undo_mode == undo_mode::log ? _log.sessions.size() : _stack.size(); }
+
+         void undo_log_session() {
+            const auto start = _log.sessions.back();
+
+            for( auto pos = _log.end_change(); pos > start.first_change; --pos ) {
+               const auto& c = _log.changes.back();
+               switch( c.kind ) {
+                  case undo_log_type::change_kind::created:
+                     _indices.erase( _indices.find( c.id ) );
+                     break;
+                  case undo_log_type::change_kind::modified: {
+                     auto ok = _indices.modify( _indices.find( c.id ), [&]( value_type& v ) {
+                        v = std::move( _log.values.back() );
+                     });
+                     if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not modify object, most likely a uniqueness constraint was violated" ) );
+                     _log.values.pop_back();
+                     break;
+                  }
+                  case undo_log_type::change_kind::removed: {
+                     bool ok = _indices.emplace( std::move( _log.values.back() ) ).second;
+                     if( !ok ) BOOST_THROW_EXCEPTION( std::logic_error( "Could not restore object, most likely a uniqueness constraint was violated" ) );
+                     _log.values.pop_back();
+                     break;
+                  }
+               }
+               _log.changes.pop_back();
+            }
+            _next_id = start.old_next_id;
+
+            _log.sessions.pop_back();
+            --_revision;
+         }
+
+         /** true when the latest change of the current session already lets undo restore v */
+         bool log_covers( const value_type& v )const {
+            if( _log.end_change() == _log.sessions.back().first_change )
+               return false;
+            const auto& last = _log.changes.back();
+            return last.id == v.id && last.kind != undo_log_type::change_kind::removed;
+         }
 
          void on_modify( const value_type& v ) {
             if( !enabled() ) return;
 
+            if( _undo_mode == undo_mode::log ) {
+               // repeated modifications are only recorded once when they are not interleaved with other changes
+               if( log_covers( v ) ) return;
+               _log.values.push_back( v );
+               _log.changes.push_back( { v.id, undo_log_type::change_kind::modified } );
+               return;
+            }
+
             auto& head = _stack.back();
 
             if( head.new_ids.find( v.id ) != head.new_ids.end() )
@@ -520,6 +747,12 @@ namespace chainbase {
          void on_remove( const value_type& v ) {
             if( !enabled() ) return;
 
+            if( _undo_mode == undo_mode::log ) {
+               _log.values.push_back( v );
+               _log.changes.push_back( { v.id, undo_log_type::change_kind::removed } );
+               return;
+            }
+
             auto& head = _stack.back();
             if( head.new_ids.count(v.id) ) {
                head.new_ids.erase( v.id );
@@ -541,12 +774,21 @@ namespace chainbase {
 
          void on_create( const value_type& v ) {
             if( !enabled() ) return;
+
+            if( _undo_mode == undo_mode::log ) {
+               _log.changes.push_back( { v.id, undo_log_type::change_kind::created } );
+               return;
+            }
+
             auto& head = _stack.back();
 
             head.new_ids.insert( v.id );
          }
 
          boost::interprocess::deque< undo_state_type, allocator<undo_state_type> > _stack;
+         undo_log_type                                                             _log;
+         undo_mode                                                                 _undo_mode = undo_mode::map;
+         undo_mode                                                                 _requested_undo_mode = undo_mode::map;
 
          /**
           *  Each new session increments the revision, a squash will decrement the revision by combining
@@ -561,6 +803,32 @@ namespace chainbase {
          uint32_t                        _size_of_this = 0;
    };
 
+   /**
+    *  Layout of generic_index before undo_mode::log was added. database::add_index migrates indices found in this
+    *  layout when the database is opened for writing.
+    */
+   template<typename MultiIndexType>
+   struct legacy_generic_index
+   {
+      typedef typename MultiIndexType::value_type value_type;
+      typedef undo_state< value_type >            undo_state_type;
+
+      legacy_generic_index( allocator<value_type> a )
+      :_stack(a),_indices( a ),_size_of_value_type( sizeof(typename MultiIndexType::node_type) ),_size_of_this(sizeof(*this)){}
+
+      void validate()const {
+         if( sizeof(typename MultiIndexType::node_type) != _size_of_value_type || sizeof(*this) != _size_of_this )
+            BOOST_THROW_EXCEPTION( std::runtime_error("content of memory does not match data expected by executable") );
+      }
+
+      boost::interprocess::deque< undo_state_type, allocator<undo_state_type> > _stack;
+      int64_t                         _revision = 0;
+      typename value_type::id_type    _next_id = 0;
+      MultiIndexType                  _indices;
+      uint32_t                        _size_of_value_type = 0;
+      uint32_t                        _size_of_this = 0;
+   };
+
    class abstract_session {
       public:
          virtual ~abstract_session(){};
@@ -674,6 +942,15 @@ namespace chainbase {
    };
 
 
+   /**
+    *  The thread holding the write lock of a database, a moved database starts out unlocked
+    */
+   struct write_lock_owner : std::atomic<std::thread::id> {
+      write_lock_owner() : std::atomic<std::thread::id>( std::thread::id() ) {}
+      write_lock_owner( write_lock_owner&& ) : write_lock_owner() {}
+      write_lock_owner& operator=( write_lock_owner&& ) { store( std::thread::id() ); return *this; }
+   };
+
    /**
     *  This class
     */
@@ -687,14 +964,58 @@ namespace chainbase {
 
          using database_index_row_count_multiset = std::multiset<std::pair<unsigned, std::string>>;
 
-         database(const bfs::path& dir, open_flags write = read_only, uint64_t shared_file_size = 0, bool allow_dirty = false);
+         /**
+          * hugepage_size selects the page size backing the state in heap and locked modes, 0 for regular pages;
+          * read only databases are always mapped
+          */
+         database(const bfs::path& dir, open_flags write = read_only, uint64_t shared_file_size = 0, bool allow_dirty = false,
+                  undo_mode mode = undo_mode::map, map_mode mapping = map_mode::mapped, uint64_t hugepage_size = 0);
          ~database();
          database(database&&) = default;
          database& operator=(database&&) = default;
          bool is_read_only() const { return _read_only; }
+         undo_mode get_undo_mode() const { return _undo_mode; }
+         map_mode get_map_mode() const { return _heap ? _map_mode : map_mode::mapped; }
          void flush();
          void set_require_locking( bool enable_require_locking );
 
+         /**
+          * Runs callback while other threads may only read, readers see the database as it was before or
+          * after callback. The thread holding the write lock may take it again.
+          */
+         template<typename Lambda>
+         auto with_write_lock( Lambda&& callback ) -> decltype( callback() )
+         {
+            if( _write_lock_owner.load() == std::this_thread::get_id() )
+               return callback();
+
+            bip::scoped_lock< read_write_mutex > lock( _rw_manager->current_lock() );
+            _write_lock_owner.store( std::this_thread::get_id() );
+#ifdef CHAINBASE_CHECK_LOCKING
+            ++_write_lock_count;
+#endif
+            struct release {
+               database& db;
+               ~release() {
+#ifdef CHAINBASE_CHECK_LOCKING
+                  --db._write_lock_count;
+#endif
+                  db._write_lock_owner.store( std::thread::id() );
+               }
+            } on_exit{ *this };
+            return callback();
+         }
+
+         /**
+          * Runs callback while no other thread holds the write lock
+          */
+         template<typename Lambda>
+         auto with_read_lock( Lambda&& callback ) const -> decltype( callback() )
+         {
+            read_lock lock( _rw_manager->current_lock() );
+            return callback();
+         }
+
 #ifdef CHAINBASE_CHECK_LOCKING
          void require_lock_fail( const char* method, const char* lock_type, const char* tname )const;
 
@@ -784,17 +1105,39 @@ namespace chainbase {
                BOOST_THROW_EXCEPTION( std::logic_error( type_name + "::type_id is already in use" ) );
             }
 
-            index_type* idx_ptr = _segment->find< index_type >( type_name.c_str() ).first;
+            // legacy indices are stored under the bare type name, later layouts under the name and their version
+            std::string index_name = type_name + " v" + std::to_string( index_type::layout_version );
+
+            // a read only mapping cannot take the lock of the segment
+            auto find = [&]( auto* type, const std::string& name ) {
+               typedef std::remove_pointer_t<decltype(type)> object_type;
+               return _read_only ? _segment_manager->find_no_lock< object_type >( name.c_str() ).first
+                                 : _segment_manager->find< object_type >( name.c_str() ).first;
+            };
+
+            index_type* idx_ptr = find( (index_type*)nullptr, index_name );
             bool first_time_adding = false;
             if( !idx_ptr ) {
+               typedef legacy_generic_index<MultiIndexType> legacy_index_type;
+               auto legacy = find( (legacy_index_type*)nullptr, type_name );
                if( _read_only ) {
-                  BOOST_THROW_EXCEPTION( std::runtime_error( "unable to find index for " + type_name + " in read only database" ) );
+                  BOOST_THROW_EXCEPTION( std::runtime_error( legacy ?
+                     "index for " + type_name + " uses a legacy layout, open the database for writing once to migrate it" :
+                     "unable to find index for " + type_name + " in read only database" ) );
+               }
+               idx_ptr = _segment_manager->construct< index_type >( index_name.c_str() )( index_alloc( _segment_manager ) );
+               if( legacy ) {
+                  legacy->validate();
+                  idx_ptr->migrate_from( *legacy );
+                  _segment_manager->destroy< legacy_index_type >( type_name.c_str() );
+               } else {
+                  first_time_adding = true;
                }
-               first_time_adding = true;
-               idx_ptr = _segment->construct< index_type >( type_name.c_str() )( index_alloc( _segment->get_segment_manager() ) );
              }
 
             idx_ptr->validate();
+            if( !_read_only )
+               idx_ptr->set_undo_mode( _undo_mode );
 
             // Ensure the undo stack of added index is consistent with the other indices in the database
             if( _index_list.size() > 0 ) {
@@ -837,16 +1180,16 @@ namespace chainbase {
          }
 
          auto get_segment_manager() -> decltype( ((bip::managed_mapped_file*)nullptr)->get_segment_manager()) {
-            return _segment->get_segment_manager();
+            return _segment_manager;
          }
 
          auto get_segment_manager()const -> std::add_const_t< decltype( ((bip::managed_mapped_file*)nullptr)->get_segment_manager() ) > {
-            return _segment->get_segment_manager();
+            return _segment_manager;
          }
 
          size_t get_free_memory()const
          {
-            return _segment->get_segment_manager()->get_free_memory();
+            return _segment_manager->get_free_memory();
          }
 
          template<typename MultiIndexType>
@@ -965,10 +1308,26 @@ namespace chainbase {
          }
 
       private:
+         /**
+          * Anonymous memory holding a copy of the whole mapped segment in heap and locked modes
+          */
+         struct heap_memory {
+            heap_memory( size_t size, bool lock, uint64_t hugepage_size );
+            ~heap_memory();
+
+            char*   address = nullptr;
+            size_t  size = 0;
+         };
+
          unique_ptr<bip::managed_mapped_file>                        _segment;
          unique_ptr<bip::managed_mapped_file>                        _meta;
+         unique_ptr<heap_memory>                                     _heap;
+         bip::managed_mapped_file::segment_manager*                  _segment_manager = nullptr;
+         map_mode                                                    _map_mode = map_mode::mapped;
          read_write_mutex_manager*                                   _rw_manager = nullptr;
+         write_lock_owner                                            _write_lock_owner;
          bool                                                        _read_only = false;
+         undo_mode                                                   _undo_mode = undo_mode::map;
          bip::file_lock                                              _flock;
 
          /**
@@ -990,6 +1349,8 @@ namespace chainbase {
 #endif
 
          void                                                        _msync_database();
+         void                                                        _load_heap( uint64_t hugepage_size );
+         bool                                                        _write_back_heap();
    };
 
    template<typename Object, typename... Args>
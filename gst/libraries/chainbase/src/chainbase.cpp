@@ -4,6 +4,8 @@
 #include <iostream>
 
 #include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 namespace chainbase {
 
@@ -34,7 +36,9 @@ namespace chainbase {
       uint32_t                boost_version;
    };
 
-   database::database(const bfs::path& dir, open_flags flags, uint64_t shared_file_size, bool allow_dirty ) {
+   database::database(const bfs::path& dir, open_flags flags, uint64_t shared_file_size, bool allow_dirty, undo_mode mode,
+                      map_mode mapping, uint64_t hugepage_size )
+   :_undo_mode(mode),_map_mode(mapping) {
       bool write = flags & database::read_write;
 
       if (!bfs::exists(dir)) {
@@ -163,16 +167,22 @@ namespace chainbase {
          *db_is_dirty = *meta_is_dirty = true;
          _msync_database();
       }
+
+      _segment_manager = _segment->get_segment_manager();
+      if( write && _map_mode != map_mode::mapped )
+         _load_heap( hugepage_size );
    }
 
    database::~database()
    {
-      if(!_read_only) {
+      // if the heap cannot be written back the dirty flag stays set and the state is rebuilt on the next start
+      if(!_read_only && (!_heap || _write_back_heap())) {
          _msync_database();
          *_segment->get_segment_manager()->find<bool>(_db_dirty_flag_string).first = false;
          *_meta->get_segment_manager()->find<bool>(_db_dirty_flag_string).first = false;
          _msync_database();
       }
+      _heap.reset();
       _segment.reset();
       _meta.reset();
       _index_list.clear();
@@ -181,7 +191,8 @@ namespace chainbase {
    }
 
    void database::flush() {
-      if( _segment )
+      // in heap mode the file is only brought up to date when the database is closed
+      if( _segment && !_heap )
          _segment->flush();
       if( _meta )
          _meta->flush();
@@ -198,6 +209,98 @@ namespace chainbase {
 #endif
    }
 
+   database::heap_memory::heap_memory( size_t s, bool lock, uint64_t hugepage_size ) {
+      void* addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+      if( hugepage_size ) {
+         if( hugepage_size & (hugepage_size - 1) )
+            BOOST_THROW_EXCEPTION( std::runtime_error( "hugepage size must be a power of two" ) );
+         size_t rounded = (s + hugepage_size - 1) / hugepage_size * hugepage_size;
+         int huge_flags = MAP_HUGETLB | (__builtin_ctzll( hugepage_size ) << MAP_HUGE_SHIFT);
+         addr = mmap( nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | huge_flags, -1, 0 );
+         if( addr != MAP_FAILED )
+            s = rounded;
+         else
+            std::cerr << "could not allocate " << rounded << " bytes of " << hugepage_size
+                      << " byte hugepages for the database, using regular pages\n";
+      }
+#else
+      if( hugepage_size )
+         std::cerr << "hugepages are not supported on this platform, using regular pages for the database\n";
+#endif
+      if( addr == MAP_FAILED )
+         addr = mmap( nullptr, s, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+      if( addr == MAP_FAILED )
+         BOOST_THROW_EXCEPTION( std::runtime_error( "could not allocate memory for the database" ) );
+
+      address = static_cast<char*>( addr );
+      size = s;
+
+      if( lock && mlock( address, size ) ) {
+         munmap( address, size );
+         BOOST_THROW_EXCEPTION( std::runtime_error( "could not lock the database in memory, check the locked memory limit (ulimit -l)" ) );
+      }
+   }
+
+   database::heap_memory::~heap_memory() {
+      munmap( address, size );
+   }
+
+   void database::_load_heap( uint64_t hugepage_size ) {
+      const size_t size = _segment->get_size();
+      _heap.reset( new heap_memory( size, _map_mode == map_mode::locked, hugepage_size ) );
+
+      // read through the file rather than the mapping so the file's pages do not stay resident next to the copy
+      const auto path = ( _data_dir / "shared_memory.bin" ).generic_string();
+      int fd = ::open( path.c_str(), O_RDONLY );
+      if( fd < 0 )
+         BOOST_THROW_EXCEPTION( std::runtime_error( "could not open " + path ) );
+      for( size_t done = 0; done < size; ) {
+         auto r = ::pread( fd, _heap->address + done, size - done, done );
+         if( r < 0 && errno == EINTR )
+            continue;
+         if( r <= 0 ) {
+            ::close( fd );
+            BOOST_THROW_EXCEPTION( std::runtime_error( "could not read " + path + " into memory" ) );
+         }
+         done += r;
+      }
+      ::close( fd );
+
+      // every pointer inside the segment is an offset pointer, so the copy is usable at its new address
+      auto offset = reinterpret_cast<char*>( _segment->get_segment_manager() ) - static_cast<char*>( _segment->get_address() );
+      _segment_manager = reinterpret_cast<bip::managed_mapped_file::segment_manager*>( _heap->address + offset );
+   }
+
+   bool database::_write_back_heap() {
+      const size_t size = _segment->get_size();
+      const auto path = ( _data_dir / "shared_memory.bin" ).generic_string();
+
+      // pwrite replaces whole pages without faulting the old contents of the file in first
+      int fd = ::open( path.c_str(), O_WRONLY );
+      if( fd < 0 ) {
+         perror( "Failed to open DB file to write back heap" );
+         return false;
+      }
+      for( size_t done = 0; done < size; ) {
+         auto r = ::pwrite( fd, _heap->address + done, size - done, done );
+         if( r < 0 && errno == EINTR )
+            continue;
+         if( r <= 0 ) {
+            perror( "Failed to write back DB file" );
+            ::close( fd );
+            return false;
+         }
+         done += r;
+      }
+      bool synced = ::fsync( fd ) == 0;
+      if( !synced )
+         perror( "Failed to fsync DB file" );
+      ::close( fd );
+      _segment_manager = _segment->get_segment_manager();
+      return synced;
+   }
+
    void database::set_require_locking( bool enable_require_locking )
    {
 #ifdef CHAINBASE_CHECK_LOCKING
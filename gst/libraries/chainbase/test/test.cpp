@@ -7,7 +7,10 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/member.hpp>
 
+#include <chrono>
 #include <iostream>
+#include <random>
+#include <thread>
 
 using namespace chainbase;
 using namespace boost::multi_index;
@@ -132,3 +135,216 @@ BOOST_AUTO_TEST_CASE( open_and_create ) {
 }
 
 // BOOST_AUTO_TEST_SUITE_END()
+
+namespace {
+   typedef std::vector<std::tuple<int64_t, int, int>> book_rows;
+
+   book_rows rows( const chainbase::database& db ) {
+      book_rows result;
+      for( const auto& b : db.get_index<book_index>().indices() )
+         result.emplace_back( b.id._id, b.a, b.b );
+      return result;
+   }
+
+   /**
+    * Blocks of transactions as the controller runs them: every block is an undo session holding one nested session per
+    * transaction, transactions are squashed into the block or undone, blocks are pushed or undone and older blocks
+    * are committed. Returns the revision and rows after every block.
+    */
+   std::vector<std::pair<int64_t, book_rows>> run_blocks( chainbase::database& db, uint32_t blocks, uint32_t trxs, uint32_t changes ) {
+      std::vector<std::pair<int64_t, book_rows>> history;
+      std::mt19937 rng( 42 );
+      int64_t next_id = db.get_index<book_index>().indices().size();
+
+      for( uint32_t blk = 0; blk < blocks; ++blk ) {
+         auto block_session = db.start_undo_session( true );
+         for( uint32_t trx = 0; trx < trxs; ++trx ) {
+            auto trx_session = db.start_undo_session( true );
+            for( uint32_t i = 0; i < changes; ++i ) {
+               auto r = rng() % 10;
+               const book* obj = next_id ? db.find<book>( book::id_type( rng() % next_id ) ) : nullptr;
+               if( r < 2 || !obj ) {
+                  db.create<book>( [&]( book& b ) { b.a = rng() % 100; b.b = rng() % 100; } );
+                  ++next_id;
+               } else if( r < 9 ) {
+                  db.modify( *obj, [&]( book& b ) { b.a += 1; b.b = rng() % 100; } );
+               } else {
+                  db.remove( *obj );
+               }
+            }
+            if( rng() % 8 == 0 )
+               trx_session.undo();
+            else
+               trx_session.squash();
+            next_id = db.get_index<book_index>().indices().empty() ? 0 : db.get_index<book_index>().indices().rbegin()->id._id + 1;
+         }
+         if( rng() % 6 == 0 )
+            block_session.undo();
+         else
+            block_session.push();
+         next_id = db.get_index<book_index>().indices().empty() ? 0 : db.get_index<book_index>().indices().rbegin()->id._id + 1;
+
+         if( db.revision() > 10 )
+            db.commit( db.revision() - 10 );
+         history.emplace_back( db.revision(), rows( db ) );
+      }
+      return history;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( undo_modes_agree ) {
+   std::vector<std::vector<std::pair<int64_t, book_rows>>> results;
+   for( auto mode : { undo_mode::map, undo_mode::log } ) {
+      boost::filesystem::path temp = boost::filesystem::unique_path();
+      try {
+         chainbase::database db( temp, database::read_write, 1024*1024*64, false, mode );
+         db.add_index< book_index >();
+         for( int i = 0; i < 100; ++i )
+            db.create<book>( [&]( book& b ) { b.a = i; b.b = i; } );
+         results.push_back( run_blocks( db, 200, 10, 20 ) );
+         auto range = db.get_index<book_index>().undo_stack_revision_range();
+         BOOST_REQUIRE_EQUAL( db.revision(), range.second );
+
+         // undoing everything returns to the state of the last committed revision
+         db.undo_all();
+         BOOST_REQUIRE_EQUAL( db.revision(), range.first );
+         auto committed = std::find_if( results.back().rbegin(), results.back().rend(),
+                                        [&]( const auto& r ) { return r.first == range.first; } );
+         BOOST_REQUIRE( committed != results.back().rend() );
+         BOOST_REQUIRE( rows( db ) == committed->second );
+
+         // the undo representation only changes once the undo history is gone
+         db.get_mutable_index<book_index>().set_undo_mode( mode == undo_mode::map ? undo_mode::log : undo_mode::map );
+         BOOST_REQUIRE( db.get_index<book_index>().get_undo_mode() != mode );
+      } catch ( ... ) {
+         bfs::remove_all( temp );
+         throw;
+      }
+      bfs::remove_all( temp );
+   }
+   BOOST_REQUIRE( results[0] == results[1] );
+}
+
+BOOST_AUTO_TEST_CASE( legacy_layout_migration ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      const std::string type_name = boost::core::demangle( typeid( book ).name() );
+      {
+         // an index as written before undo_mode::log, with an undo session in progress
+         chainbase::database db( temp, database::read_write, 1024*1024*8 );
+         typedef legacy_generic_index<book_index> legacy_index;
+         auto legacy = db.get_segment_manager()->construct<legacy_index>( type_name.c_str() )( chainbase::allocator<book>( db.get_segment_manager() ) );
+         for( int i = 0; i < 10; ++i )
+            legacy->_indices.emplace( [&]( book& b ) { b.id = i; b.a = i; b.b = -i; }, chainbase::allocator<book>( db.get_segment_manager() ) );
+         legacy->_next_id = 10;
+         legacy->_stack.emplace_back( chainbase::allocator<book>( db.get_segment_manager() ) );
+         legacy->_stack.back().revision = 6;
+         legacy->_stack.back().old_next_id = 9;
+         legacy->_stack.back().new_ids.insert( 9 );
+         legacy->_revision = 6;
+      }
+
+      BOOST_CHECK_THROW( chainbase::database( temp, database::read_only ).add_index< book_index >(), std::runtime_error );
+
+      {
+         chainbase::database db( temp, database::read_write, 1024*1024*8 );
+         db.add_index< book_index >();
+         BOOST_REQUIRE( !db.get_segment_manager()->find<legacy_generic_index<book_index>>( type_name.c_str() ).first );
+         BOOST_REQUIRE_EQUAL( db.revision(), 6 );
+         BOOST_REQUIRE_EQUAL( db.get_index<book_index>().indices().size(), 10u );
+         BOOST_REQUIRE_EQUAL( db.get<book>( 3 ).b, -3 );
+
+         // the undo history survives the migration
+         db.undo();
+         BOOST_REQUIRE_EQUAL( db.revision(), 5 );
+         BOOST_REQUIRE_EQUAL( db.get_index<book_index>().indices().size(), 9u );
+         BOOST_REQUIRE_EQUAL( db.create<book>( []( book& ) {} ).id._id, 9 );
+      }
+
+      chainbase::database db( temp, database::read_only );
+      db.add_index< book_index >();
+      BOOST_REQUIRE_EQUAL( db.get_index<book_index>().indices().size(), 10u );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
+
+BOOST_AUTO_TEST_CASE( heap_mode_round_trip ) {
+   // 2 MiB hugepages are usually not reserved on test machines, which exercises the fallback to regular pages
+   for( uint64_t hugepage_size : { uint64_t(0), uint64_t(2*1024*1024) } ) {
+      boost::filesystem::path temp = boost::filesystem::unique_path();
+      try {
+         {
+            chainbase::database db( temp, database::read_write, 1024*1024*8, false, undo_mode::map, map_mode::heap, hugepage_size );
+            BOOST_REQUIRE( db.get_map_mode() == map_mode::heap );
+            db.add_index< book_index >();
+            for( int i = 0; i < 1000; ++i )
+               db.create<book>( [&]( book& b ) { b.a = i; b.b = -i; } );
+            db.flush();
+
+            // nothing reaches the file before the database is closed, and the file stays dirty until then
+            BOOST_CHECK_THROW( chainbase::database( temp, database::read_only ), std::runtime_error );
+         }
+
+         chainbase::database db( temp, database::read_write, 1024*1024*8 );
+         BOOST_REQUIRE( db.get_map_mode() == map_mode::mapped );
+         db.add_index< book_index >();
+         const auto& idx = db.get_index<book_index>().indices();
+         BOOST_REQUIRE_EQUAL( idx.size(), 1000u );
+         int i = 0;
+         for( const auto& b : idx ) {
+            BOOST_REQUIRE_EQUAL( b.a, i );
+            BOOST_REQUIRE_EQUAL( b.b, -i );
+            ++i;
+         }
+      } catch ( ... ) {
+         bfs::remove_all( temp );
+         throw;
+      }
+      bfs::remove_all( temp );
+   }
+}
+
+BOOST_AUTO_TEST_CASE( read_and_write_locks ) {
+   boost::filesystem::path temp = boost::filesystem::unique_path();
+   try {
+      chainbase::database db( temp, database::read_write, 1024*1024*8 );
+      db.add_index< book_index >();
+      db.create<book>( []( book& b ) { b.a = 0; b.b = 0; } );
+
+      // readers never see a book with a != b while a writer updates both
+      std::atomic<bool> done{false};
+      std::atomic<int> torn{0}, reads{0};
+      std::vector<std::thread> readers;
+      for( int i = 0; i < 4; ++i ) {
+         readers.emplace_back( [&]() {
+            while( !done ) {
+               db.with_read_lock( [&]() {
+                  const auto& b = db.get( book::id_type(0) );
+                  if( b.a != b.b ) ++torn;
+               } );
+               ++reads;
+            }
+         } );
+      }
+      for( int i = 1; i <= 20000; ++i ) {
+         db.with_write_lock( [&]() {
+            db.with_write_lock( [&]() { // taken again by the same thread
+               db.modify( db.get( book::id_type(0) ), [&]( book& b ) { b.a = i; } );
+            } );
+            db.modify( db.get( book::id_type(0) ), [&]( book& b ) { b.b = i; } );
+         } );
+      }
+      done = true;
+      for( auto& t : readers )
+         t.join();
+      BOOST_REQUIRE_EQUAL( torn.load(), 0 );
+      BOOST_REQUIRE_GT( reads.load(), 0 );
+   } catch ( ... ) {
+      bfs::remove_all( temp );
+      throw;
+   }
+   bfs::remove_all( temp );
+}
@@ -24,6 +24,17 @@ class sha256
     static sha256 hash( const string& );
     static sha256 hash( const sha256& );
 
+    /// implementations of hash_pairs, the SIMD ones are only available on x86 CPUs that have them
+    enum class pair_hasher { generic, sse41, avx2, shani };
+    static pair_hasher best_pair_hasher();
+    static bool        pair_hasher_supported( pair_hasher h );
+
+    /**
+     * Hashes count 64 byte messages at once, message i being in[2*i] followed by in[2*i+1],
+     * into out[i]. out may point to in, the results then replace the first half of the input.
+     */
+    static void hash_pairs( const sha256* in, sha256* out, size_t count, pair_hasher h = best_pair_hasher() );
+
     template<typename T>
     static sha256 hash( const T& t ) 
     { 
@@ -37,6 +37,10 @@ namespace fc
          static variant  from_string( const string& utf8_str, parse_type ptype = legacy_parser, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
          static variants variants_from_string( const string& utf8_str, parse_type ptype = legacy_parser, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
          static string   to_string( const variant& v, output_formatting format = stringify_large_ints_and_doubles );
+         /** appends the json of v to out, for writers that produce parts of a document without a variant for all of it */
+         static void     append( string& out, const variant& v, output_formatting format = stringify_large_ints_and_doubles );
+         /** appends str to out as a quoted and escaped json string */
+         static void     append_string( string& out, const string& str );
          static string   to_pretty_string( const variant& v, output_formatting format = stringify_large_ints_and_doubles );
 
          static bool     is_valid( const std::string& json_str, parse_type ptype = legacy_parser, uint32_t max_depth = DEFAULT_MAX_RECURSION_DEPTH );
@@ -14,8 +14,9 @@ namespace fc
     *  Keys are kept in the order they are inserted.
     *  This dictionary implements copy-on-write
     *
-    *  @note This class is not optimized for random-access on large
-    *        sets of key-value pairs.
+    *  @note Small objects are searched linearly. The first lookup in a
+    *        larger one sorts the positions of its keys so that lookups
+    *        take logarithmic time.
     */
    class variant_object
    {
@@ -93,6 +94,8 @@ namespace fc
 
    private:
       std::shared_ptr< std::vector< entry > > _key_value;
+      /** positions of the entries ordered by key, built by the first find() in a large object */
+      mutable std::shared_ptr< const std::vector< uint32_t > > _index;
       friend class mutable_variant_object;
    };
    /** @ingroup Serializable */
@@ -109,8 +112,9 @@ namespace fc
    *  Keys are kept in the order they are inserted.
    *  This dictionary implements copy-on-write
    *
-   *  @note This class is not optimized for random-access on large
-   *        sets of key-value pairs.
+   *  @note Like variant_object, large objects keep the positions of
+   *        their keys sorted once they have been searched. Appending
+   *        keeps that index up to date, erase() drops it.
    */
    class mutable_variant_object
    {
@@ -221,7 +225,11 @@ namespace fc
       mutable_variant_object& operator=( const mutable_variant_object& );
       mutable_variant_object& operator=( const variant_object& );
    private:
+      size_t find_position( const char* key )const;
+      void   appended();
+
       std::unique_ptr< std::vector< entry > > _key_value;
+      mutable std::unique_ptr< std::vector< uint32_t > > _index;
       friend class variant_object;
    };
    /** @ingroup Serializable */
@@ -0,0 +1,258 @@
+#include <fc/crypto/sha256.hpp>
+#include <fc/exception/exception.hpp>
+#include <array>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define FC_SHA256_PAIRS_X86
+#endif
+
+/**
+ * Every message hashed here is exactly 64 bytes, so each hash is one block of data followed by
+ * one block of padding whose message schedule never changes. The lane implementations hash 4
+ * or 8 messages at once with one message per 32 bit lane; the SHA extensions hash one message
+ * at a time.
+ */
+
+#define FC_SHA256_INLINE inline __attribute__((always_inline))
+
+// the lane helpers are always inlined into functions built for the vector width they use
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+namespace fc {
+
+namespace {
+
+   constexpr uint32_t k[64] = {
+      0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+      0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+      0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+      0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+      0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+      0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+      0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+      0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+   };
+
+   constexpr uint32_t initial_state[8] = {
+      0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+   };
+
+   constexpr uint32_t ror( uint32_t x, int n ) { return (x >> n) | (x << (32 - n)); }
+
+   /// message schedule of the padding block of a 64 byte message with the round constants added
+   constexpr std::array<uint32_t,64> make_padding_schedule() {
+      std::array<uint32_t,64> w{};
+      w[0]  = 0x80000000;
+      w[15] = 512;
+      for( int t = 16; t < 64; ++t ) {
+         uint32_t s0 = ror( w[t-15], 7 ) ^ ror( w[t-15], 18 ) ^ (w[t-15] >> 3);
+         uint32_t s1 = ror( w[t-2], 17 ) ^ ror( w[t-2], 19 ) ^ (w[t-2] >> 10);
+         w[t] = w[t-16] + s0 + w[t-7] + s1;
+      }
+      for( int t = 0; t < 64; ++t )
+         w[t] += k[t];
+      return w;
+   }
+
+   constexpr std::array<uint32_t,64> padding_schedule = make_padding_schedule();
+
+   // V is uint32_t or a vector of uint32_t lanes, everything below is written once for both
+
+   template<typename V> FC_SHA256_INLINE V rotr( V x, int n ) { return (x >> n) | (x << (32 - n)); }
+   template<typename V> FC_SHA256_INLINE V big_sigma0( V x ) { return rotr( x, 2 ) ^ rotr( x, 13 ) ^ rotr( x, 22 ); }
+   template<typename V> FC_SHA256_INLINE V big_sigma1( V x ) { return rotr( x, 6 ) ^ rotr( x, 11 ) ^ rotr( x, 25 ); }
+   template<typename V> FC_SHA256_INLINE V small_sigma0( V x ) { return rotr( x, 7 ) ^ rotr( x, 18 ) ^ (x >> 3); }
+   template<typename V> FC_SHA256_INLINE V small_sigma1( V x ) { return rotr( x, 17 ) ^ rotr( x, 19 ) ^ (x >> 10); }
+
+   template<typename V>
+   FC_SHA256_INLINE void round( V* s, V kw ) {
+      V t1 = s[7] + big_sigma1( s[4] ) + (((s[5] ^ s[6]) & s[4]) ^ s[6]) + kw;
+      V t2 = big_sigma0( s[0] ) + (((s[0] | s[1]) & s[2]) | (s[0] & s[1]));
+      s[7] = s[6]; s[6] = s[5]; s[5] = s[4]; s[4] = s[3] + t1;
+      s[3] = s[2]; s[2] = s[1]; s[1] = s[0]; s[0] = t1 + t2;
+   }
+
+   /// hashes the N messages starting at in into out[0..N), all input is read before any output is written
+   template<typename V, size_t N>
+   FC_SHA256_INLINE void hash_lanes( const sha256* in, sha256* out ) {
+      const unsigned char* data = reinterpret_cast<const unsigned char*>( in );
+
+      V w[16];
+      for( int t = 0; t < 16; ++t ) {
+         uint32_t words[N];
+         for( size_t j = 0; j < N; ++j ) {
+            uint32_t word;
+            memcpy( &word, data + 64 * j + 4 * t, sizeof(word) );
+            words[j] = __builtin_bswap32( word );
+         }
+         memcpy( &w[t], words, sizeof(w[t]) );
+      }
+
+      V s[8], mid[8];
+      for( int i = 0; i < 8; ++i )
+         s[i] = V{} + initial_state[i];
+
+      for( int t = 0; t < 64; ++t ) {
+         if( t >= 16 )
+            w[t & 15] += small_sigma1( w[(t - 2) & 15] ) + w[(t - 7) & 15] + small_sigma0( w[(t - 15) & 15] );
+         round( s, w[t & 15] + k[t] );
+      }
+      for( int i = 0; i < 8; ++i )
+         s[i] = mid[i] = s[i] + initial_state[i];
+
+      for( int t = 0; t < 64; ++t )
+         round( s, V{} + padding_schedule[t] );
+
+      uint32_t words[8][N];
+      for( int i = 0; i < 8; ++i ) {
+         s[i] += mid[i];
+         memcpy( words[i], &s[i], sizeof(s[i]) );
+      }
+      for( size_t j = 0; j < N; ++j ) {
+         unsigned char* digest = reinterpret_cast<unsigned char*>( out + j );
+         for( int i = 0; i < 8; ++i ) {
+            uint32_t word = __builtin_bswap32( words[i][j] );
+            memcpy( digest + 4 * i, &word, sizeof(word) );
+         }
+      }
+   }
+
+   void hash_generic( const sha256* in, sha256* out, size_t count ) {
+      for( size_t i = 0; i < count; ++i )
+         hash_lanes<uint32_t,1>( in + 2 * i, out + i );
+   }
+
+#ifdef FC_SHA256_PAIRS_X86
+   typedef uint32_t lanes4 __attribute__((vector_size(16)));
+   typedef uint32_t lanes8 __attribute__((vector_size(32)));
+
+   __attribute__((target("sse4.1")))
+   void hash_sse41( const sha256* in, sha256* out, size_t count ) {
+      size_t i = 0;
+      for( ; i + 4 <= count; i += 4 )
+         hash_lanes<lanes4,4>( in + 2 * i, out + i );
+      for( ; i < count; ++i )
+         hash_lanes<uint32_t,1>( in + 2 * i, out + i );
+   }
+
+   __attribute__((target("avx2")))
+   void hash_avx2( const sha256* in, sha256* out, size_t count ) {
+      size_t i = 0;
+      for( ; i + 8 <= count; i += 8 )
+         hash_lanes<lanes8,8>( in + 2 * i, out + i );
+      for( ; i + 4 <= count; i += 4 )
+         hash_lanes<lanes4,4>( in + 2 * i, out + i );
+      for( ; i < count; ++i )
+         hash_lanes<uint32_t,1>( in + 2 * i, out + i );
+   }
+
+   /// four rounds starting at round 4*g with the schedule words and constants already added in wk
+   __attribute__((target("sha,sse4.1")))
+   FC_SHA256_INLINE void shani_rounds( __m128i& abef, __m128i& cdgh, __m128i wk ) {
+      cdgh = _mm_sha256rnds2_epu32( cdgh, abef, wk );
+      abef = _mm_sha256rnds2_epu32( abef, cdgh, _mm_shuffle_epi32( wk, 0x0E ) );
+   }
+
+   __attribute__((target("sha,sse4.1")))
+   void hash_shani( const sha256* in, sha256* out, size_t count ) {
+      const __m128i byte_swap = _mm_set_epi64x( 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL );
+
+      // the SHA instructions keep the state as ABEF and CDGH
+      __m128i dcba = _mm_shuffle_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( &initial_state[0] ) ), 0xB1 );
+      __m128i efgh = _mm_shuffle_epi32( _mm_loadu_si128( reinterpret_cast<const __m128i*>( &initial_state[4] ) ), 0x1B );
+      const __m128i abef_init = _mm_alignr_epi8( dcba, efgh, 8 );
+      const __m128i cdgh_init = _mm_blend_epi16( efgh, dcba, 0xF0 );
+
+      for( size_t i = 0; i < count; ++i ) {
+         const __m128i* data = reinterpret_cast<const __m128i*>( in + 2 * i );
+         __m128i w[4];
+         for( int g = 0; g < 4; ++g )
+            w[g] = _mm_shuffle_epi8( _mm_loadu_si128( data + g ), byte_swap );
+
+         __m128i abef = abef_init, cdgh = cdgh_init;
+         for( int g = 0; g < 16; ++g ) {
+            if( g >= 4 ) {
+               __m128i next = _mm_sha256msg1_epu32( w[g & 3], w[(g + 1) & 3] );
+               next = _mm_add_epi32( next, _mm_alignr_epi8( w[(g + 3) & 3], w[(g + 2) & 3], 4 ) );
+               w[g & 3] = _mm_sha256msg2_epu32( next, w[(g + 3) & 3] );
+            }
+            shani_rounds( abef, cdgh, _mm_add_epi32( w[g & 3], _mm_loadu_si128( reinterpret_cast<const __m128i*>( &k[4 * g] ) ) ) );
+         }
+         const __m128i abef_mid = abef = _mm_add_epi32( abef, abef_init );
+         const __m128i cdgh_mid = cdgh = _mm_add_epi32( cdgh, cdgh_init );
+
+         for( int g = 0; g < 16; ++g )
+            shani_rounds( abef, cdgh, _mm_loadu_si128( reinterpret_cast<const __m128i*>( &padding_schedule[4 * g] ) ) );
+         abef = _mm_add_epi32( abef, abef_mid );
+         cdgh = _mm_add_epi32( cdgh, cdgh_mid );
+
+         __m128i feba = _mm_shuffle_epi32( abef, 0x1B );
+         __m128i dchg = _mm_shuffle_epi32( cdgh, 0xB1 );
+         __m128i* digest = reinterpret_cast<__m128i*>( out + i );
+         _mm_storeu_si128( digest,     _mm_shuffle_epi8( _mm_blend_epi16( feba, dchg, 0xF0 ), byte_swap ) );
+         _mm_storeu_si128( digest + 1, _mm_shuffle_epi8( _mm_alignr_epi8( dchg, feba, 8 ), byte_swap ) );
+      }
+   }
+
+   bool cpu_has( sha256::pair_hasher h ) {
+      unsigned eax, ebx, ecx, edx;
+      if( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) )
+         return false;
+      const bool sse41 = ecx & bit_SSE4_1;
+      const bool osxsave = ecx & bit_OSXSAVE;
+      if( h == sha256::pair_hasher::sse41 )
+         return sse41;
+
+      if( !__get_cpuid_count( 7, 0, &eax, &ebx, &ecx, &edx ) )
+         return false;
+      if( h == sha256::pair_hasher::shani )
+         return sse41 && (ebx & bit_SHA);
+
+      // AVX2 also needs the operating system to save the upper halves of the ymm registers
+      if( !osxsave || !(ebx & bit_AVX2) )
+         return false;
+      uint32_t xcr0_lo, xcr0_hi;
+      __asm__( "xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0) );
+      return (xcr0_lo & 0x6) == 0x6;
+   }
+#endif
+
+}
+
+   bool sha256::pair_hasher_supported( pair_hasher h ) {
+      if( h == pair_hasher::generic )
+         return true;
+#ifdef FC_SHA256_PAIRS_X86
+      return cpu_has( h );
+#else
+      return false;
+#endif
+   }
+
+   sha256::pair_hasher sha256::best_pair_hasher() {
+      static const pair_hasher best = []() {
+         for( auto h : { pair_hasher::shani, pair_hasher::avx2, pair_hasher::sse41 } )
+            if( pair_hasher_supported( h ) )
+               return h;
+         return pair_hasher::generic;
+      }();
+      return best;
+   }
+
+   void sha256::hash_pairs( const sha256* in, sha256* out, size_t count, pair_hasher h ) {
+      switch( h ) {
+#ifdef FC_SHA256_PAIRS_X86
+         case pair_hasher::shani: return hash_shani( in, out, count );
+         case pair_hasher::avx2:  return hash_avx2( in, out, count );
+         case pair_hasher::sse41: return hash_sse41( in, out, count );
+#endif
+         case pair_hasher::generic: return hash_generic( in, out, count );
+         default:
+            FC_THROW_EXCEPTION( exception, "sha256 pair hasher not available on this platform" );
+      }
+   }
+
+} // fc
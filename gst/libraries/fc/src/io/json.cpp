@@ -7,6 +7,7 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <charconv>
 
 #include <boost/filesystem/fstream.hpp>
 
@@ -22,7 +23,7 @@ namespace fc
     template<typename T, json::parse_type parser_type> variants arrayFromStream( T& in, uint32_t max_depth );
     template<typename T, json::parse_type parser_type> variant number_from_stream( T& in );
     template<typename T> variant token_from_stream( T& in );
-    void escape_string( const std::string& str, std::ostream& os );
+    template<typename T> void escape_string( const std::string& str, T& os );
     template<typename T> void to_stream( T& os, const variants& a, json::output_formatting format );
     template<typename T> void to_stream( T& os, const variant_object& o, json::output_formatting format );
     template<typename T> void to_stream( T& os, const variant& v, json::output_formatting format );
@@ -491,7 +492,8 @@ namespace fc
     *
     *  All other characters are printed as UTF8.
     */
-   void escape_string( const string& str, std::ostream& os )
+   template<typename T>
+   void escape_string( const string& str, T& os )
    {
       os << '"';
       for( auto itr = str.begin(); itr != str.end(); ++itr )
@@ -661,11 +663,51 @@ namespace fc
       }
    }
 
+   /**
+    *  The subset of std::ostream that to_stream() and escape_string() use, writing straight into a string
+    *  instead of going through the locale and buffers of a std::stringstream.
+    */
+   class string_appender
+   {
+      public:
+         explicit string_appender( std::string& out ) : _out(out) {}
+
+         string_appender& operator<<( char c )               { _out += c; return *this; }
+         string_appender& operator<<( const char* s )        { _out += s; return *this; }
+         string_appender& operator<<( const std::string& s ) { _out += s; return *this; }
+         string_appender& operator<<( int64_t i )            { return append_integer( i ); }
+         string_appender& operator<<( uint64_t i )           { return append_integer( i ); }
+
+      private:
+         template<typename I>
+         string_appender& append_integer( I i )
+         {
+            char buf[24];
+            auto result = std::to_chars( buf, buf + sizeof(buf), i );
+            _out.append( buf, result.ptr );
+            return *this;
+         }
+
+         std::string& _out;
+   };
+
    std::string   json::to_string( const variant& v, output_formatting format )
    {
-      std::stringstream ss;
-      fc::to_stream( ss, v, format );
-      return ss.str();
+      std::string result;
+      append( result, v, format );
+      return result;
+   }
+
+   void json::append( std::string& out, const variant& v, output_formatting format )
+   {
+      string_appender os( out );
+      fc::to_stream( os, v, format );
+   }
+
+   void json::append_string( std::string& out, const std::string& str )
+   {
+      string_appender os( out );
+      escape_string( str, os );
    }
 
 
@@ -1,9 +1,60 @@
 #include <fc/variant_object.hpp>
 #include <fc/exception/exception.hpp>
 
+#include <algorithm>
+#include <atomic>
 
 namespace fc
 {
+   namespace
+   {
+      // objects up to this size are searched linearly, larger ones through a sorted index of their keys
+      const size_t max_linear_find_size = 8;
+
+      typedef std::vector< variant_object::entry > entries;
+      typedef std::vector< uint32_t >               key_index;
+
+      size_t linear_find( const entries& e, const char* key )
+      {
+         for( size_t i = 0; i < e.size(); ++i )
+            if( e[i].key() == key )
+               return i;
+         return e.size();
+      }
+
+      // stable, so that equal keys stay in insertion order and the first one is found like in a linear search
+      key_index build_key_index( const entries& e )
+      {
+         key_index index( e.size() );
+         for( uint32_t i = 0; i < index.size(); ++i )
+            index[i] = i;
+         std::stable_sort( index.begin(), index.end(), [&]( uint32_t a, uint32_t b ) {
+            return e[a].key() < e[b].key();
+         });
+         return index;
+      }
+
+      size_t indexed_find( const key_index& index, const entries& e, const char* key )
+      {
+         auto itr = std::lower_bound( index.begin(), index.end(), key, [&]( uint32_t pos, const char* k ) {
+            return e[pos].key().compare( k ) < 0;
+         });
+         if( itr != index.end() && e[*itr].key() == key )
+            return *itr;
+         return e.size();
+      }
+
+      // adds the position of the last entry, after the entries with an equal key
+      void index_last( key_index& index, const entries& e )
+      {
+         uint32_t pos = e.size() - 1;
+         auto itr = std::upper_bound( index.begin(), index.end(), pos, [&]( uint32_t a, uint32_t b ) {
+            return e[a].key() < e[b].key();
+         });
+         index.insert( itr, pos );
+      }
+   }
+
    // ---------------------------------------------------------------
    // entry
 
@@ -67,14 +118,17 @@ namespace fc
 
    variant_object::iterator variant_object::find( const char* key )const
    {
-      for( auto itr = begin(); itr != end(); ++itr )
+      if( _key_value->size() <= max_linear_find_size )
+         return begin() + linear_find( *_key_value, key );
+
+      // copies of this object may be searched from several threads, the first to finish its index publishes it
+      auto index = std::atomic_load( &_index );
+      if( !index )
       {
-         if( itr->key() == key )
-         {
-            return itr;
-         }
+         index = std::make_shared<const key_index>( build_key_index( *_key_value ) );
+         std::atomic_store( &_index, index );
       }
-      return end();
+      return begin() + indexed_find( *index, *_key_value, key );
    }
 
    const variant& variant_object::operator[]( const string& key )const
@@ -107,13 +161,13 @@ namespace fc
    }
 
    variant_object::variant_object( const variant_object& obj )
-   :_key_value( obj._key_value )
+   :_key_value( obj._key_value ), _index( std::atomic_load( &obj._index ) )
    {
       FC_ASSERT( _key_value != nullptr );
    }
 
    variant_object::variant_object( variant_object&& obj)
-   : _key_value( fc::move(obj._key_value) )
+   : _key_value( fc::move(obj._key_value) ), _index( fc::move(obj._index) )
    {
       obj._key_value = std::make_shared<std::vector<entry>>();
       FC_ASSERT( _key_value != nullptr );
@@ -125,7 +179,7 @@ namespace fc
    }
 
    variant_object::variant_object( mutable_variant_object&& obj )
-   : _key_value(fc::move(obj._key_value))
+   : _key_value(fc::move(obj._key_value)), _index(fc::move(obj._index))
    {
       FC_ASSERT( _key_value != nullptr );
    }
@@ -135,6 +189,7 @@ namespace fc
       if (this != &obj)
       {
          fc_swap(_key_value, obj._key_value );
+         fc_swap(_index, obj._index );
          FC_ASSERT( _key_value != nullptr );
       }
       return *this;
@@ -145,6 +200,7 @@ namespace fc
       if (this != &obj)
       {
          _key_value = obj._key_value;
+         _index = std::atomic_load( &obj._index );
       }
       return *this;
    }
@@ -152,13 +208,16 @@ namespace fc
    variant_object& variant_object::operator=( mutable_variant_object&& obj )
    {
       _key_value = fc::move(obj._key_value);
+      _index = fc::move(obj._index);
       obj._key_value.reset( new std::vector<entry>() );
       return *this;
    }
 
    variant_object& variant_object::operator=( const mutable_variant_object& obj )
    {
-      *_key_value = *obj._key_value;
+      // copies of this object share _key_value and must keep their content
+      _key_value = std::make_shared<std::vector<entry>>(*obj._key_value);
+      _index.reset();
       return *this;
    }
 
@@ -203,14 +262,7 @@ namespace fc
 
    mutable_variant_object::iterator mutable_variant_object::find( const char* key )const
    {
-      for( auto itr = begin(); itr != end(); ++itr )
-      {
-         if( itr->key() == key )
-         {
-            return itr;
-         }
-      }
-      return end();
+      return begin() + find_position( key );
    }
 
    mutable_variant_object::iterator mutable_variant_object::find( const string& key )
@@ -220,14 +272,22 @@ namespace fc
 
    mutable_variant_object::iterator mutable_variant_object::find( const char* key )
    {
-      for( auto itr = begin(); itr != end(); ++itr )
-      {
-         if( itr->key() == key )
-         {
-            return itr;
-         }
-      }
-      return end();
+      return begin() + find_position( key );
+   }
+
+   size_t mutable_variant_object::find_position( const char* key )const
+   {
+      if( _key_value->size() <= max_linear_find_size )
+         return linear_find( *_key_value, key );
+      if( !_index )
+         _index.reset( new key_index( build_key_index( *_key_value ) ) );
+      return indexed_find( *_index, *_key_value, key );
+   }
+
+   void mutable_variant_object::appended()
+   {
+      if( _index )
+         index_last( *_index, *_key_value );
    }
 
    const variant& mutable_variant_object::operator[]( const string& key )const
@@ -251,6 +311,7 @@ namespace fc
       auto itr = find( key );
       if( itr != end() ) return itr->value();
       _key_value->emplace_back(entry(key, variant()));
+      appended();
       return _key_value->back().value();
    }
 
@@ -281,13 +342,14 @@ namespace fc
    }
 
    mutable_variant_object::mutable_variant_object( mutable_variant_object&& obj )
-      : _key_value(fc::move(obj._key_value))
+      : _key_value(fc::move(obj._key_value)), _index(fc::move(obj._index))
    {
    }
 
    mutable_variant_object& mutable_variant_object::operator=( const variant_object& obj )
    {
       *_key_value = *obj._key_value;
+      _index.reset();
       return *this;
    }
 
@@ -296,6 +358,7 @@ namespace fc
       if (this != &obj)
       {
          _key_value = fc::move(obj._key_value);
+         _index = fc::move(obj._index);
       }
       return *this;
    }
@@ -305,6 +368,7 @@ namespace fc
       if (this != &obj)
       {
          *_key_value = *obj._key_value;
+         _index.reset();
       }
       return *this;
    }
@@ -316,13 +380,11 @@ namespace fc
 
    void  mutable_variant_object::erase( const string& key )
    {
-      for( auto itr = begin(); itr != end(); ++itr )
+      auto itr = find( key.c_str() );
+      if( itr != end() )
       {
-         if( itr->key() == key )
-         {
-            _key_value->erase(itr);
-            return;
-         }
+         _key_value->erase(itr);
+         _index.reset();
       }
    }
 
@@ -337,6 +399,7 @@ namespace fc
       else
       {
          _key_value->push_back( entry( fc::move(key), fc::move(var) ) );
+         appended();
       }
       return *this;
    }
@@ -347,6 +410,7 @@ namespace fc
    mutable_variant_object& mutable_variant_object::operator()( string key, variant var )
    {
       _key_value->push_back( entry( fc::move(key), fc::move(var) ) );
+      appended();
       return *this;
    }
 
@@ -67,6 +67,9 @@ namespace gstio { namespace testing {
 
    bool expect_assert_message(const fc::exception& ex, string expected);
 
+   /// applies the --wavm, --wabt or --wasm2c argument of the test run, if any, to cfg
+   void set_wasm_runtime_from_args(controller::config& cfg);
+
    /**
     *  @class tester
     *  @brief provides utility function to simplify the creation of unit tests
@@ -352,12 +355,7 @@ namespace gstio { namespace testing {
          vcfg.genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
          vcfg.genesis.initial_key = get_public_key( config::system_account_name, "active" );
 
-         for(int i = 0; i < boost::unit_test::framework::master_test_suite().argc; ++i) {
-            if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wavm"))
-               vcfg.wasm_runtime = chain::wasm_interface::vm_type::wavm;
-            else if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wabt"))
-               vcfg.wasm_runtime = chain::wasm_interface::vm_type::wabt;
-         }
+         set_wasm_runtime_from_args(vcfg);
          return vcfg;
       }
 
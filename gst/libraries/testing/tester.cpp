@@ -79,6 +79,17 @@ namespace gstio { namespace testing {
       memcpy( data.data(), obj.value.data(), obj.value.size() );
    }
 
+   void set_wasm_runtime_from_args(controller::config& cfg) {
+      for(int i = 0; i < boost::unit_test::framework::master_test_suite().argc; ++i) {
+         if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wavm"))
+            cfg.wasm_runtime = chain::wasm_interface::vm_type::wavm;
+         else if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wabt"))
+            cfg.wasm_runtime = chain::wasm_interface::vm_type::wabt;
+         else if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wasm2c"))
+            cfg.wasm_runtime = chain::wasm_interface::vm_type::wasm2c;
+      }
+   }
+
    bool base_tester::is_same_chain( base_tester& other ) {
      return control->head_block_id() == other.control->head_block_id();
    }
@@ -96,12 +107,7 @@ namespace gstio { namespace testing {
       cfg.genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
       cfg.genesis.initial_key = get_public_key( config::system_account_name, "active" );
 
-      for(int i = 0; i < boost::unit_test::framework::master_test_suite().argc; ++i) {
-         if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wavm"))
-            cfg.wasm_runtime = chain::wasm_interface::vm_type::wavm;
-         else if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wabt"))
-            cfg.wasm_runtime = chain::wasm_interface::vm_type::wabt;
-      }
+      set_wasm_runtime_from_args(cfg);
 
       open(nullptr);
 
@@ -48,6 +48,50 @@ struct async_result_visitor : public fc::visitor<std::string> {
           } \
        }}
 
+#define CALL_READ_ONLY(api_name, api_handle, api_namespace, call_name, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle, &chain_plug](string, string body, url_response_callback cb) mutable { \
+      chain_plug.post_read_only( [api_handle, body{std::move(body)}, cb{std::move(cb)}]() mutable { \
+          api_handle.validate(); \
+          try { \
+             if (body.empty()) body = "{}"; \
+             auto result = api_handle.call_name(fc::json::from_string(body).as<api_namespace::call_name ## _params>()); \
+             cb(http_response_code, fc::json::to_string(result)); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+          } \
+       }); \
+   }}
+
+// calls call_name_json(), which returns the response already written as JSON text
+#define CALL_JSON(api_name, api_handle, api_namespace, call_name, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle](string, string body, url_response_callback cb) mutable { \
+          api_handle.validate(); \
+          try { \
+             if (body.empty()) body = "{}"; \
+             auto result = api_handle.call_name ## _json(fc::json::from_string(body).as<api_namespace::call_name ## _params>()); \
+             cb(http_response_code, std::move(result)); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+          } \
+       }}
+
+#define CALL_READ_ONLY_JSON(api_name, api_handle, api_namespace, call_name, http_response_code) \
+{std::string("/v1/" #api_name "/" #call_name), \
+   [api_handle, &chain_plug](string, string body, url_response_callback cb) mutable { \
+      chain_plug.post_read_only( [api_handle, body{std::move(body)}, cb{std::move(cb)}]() mutable { \
+          api_handle.validate(); \
+          try { \
+             if (body.empty()) body = "{}"; \
+             auto result = api_handle.call_name ## _json(fc::json::from_string(body).as<api_namespace::call_name ## _params>()); \
+             cb(http_response_code, std::move(result)); \
+          } catch (...) { \
+             http_plugin::handle_exception(#api_name, #call_name, body, cb); \
+          } \
+       }); \
+   }}
+
 #define CALL_ASYNC(api_name, api_handle, api_namespace, call_name, call_result, http_response_code) \
 {std::string("/v1/" #api_name "/" #call_name), \
    [api_handle](string, string body, url_response_callback cb) mutable { \
@@ -69,6 +113,9 @@ struct async_result_visitor : public fc::visitor<std::string> {
 }
 
 #define CHAIN_RO_CALL(call_name, http_response_code) CALL(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
+#define CHAIN_RO_CALL_READ_ONLY(call_name, http_response_code) CALL_READ_ONLY(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
+#define CHAIN_RO_CALL_JSON(call_name, http_response_code) CALL_JSON(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
+#define CHAIN_RO_CALL_READ_ONLY_JSON(call_name, http_response_code) CALL_READ_ONLY_JSON(chain, ro_api, chain_apis::read_only, call_name, http_response_code)
 #define CHAIN_RW_CALL(call_name, http_response_code) CALL(chain, rw_api, chain_apis::read_write, call_name, http_response_code)
 #define CHAIN_RO_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, ro_api, chain_apis::read_only, call_name, call_result, http_response_code)
 #define CHAIN_RW_CALL_ASYNC(call_name, call_result, http_response_code) CALL_ASYNC(chain, rw_api, chain_apis::read_write, call_name, call_result, http_response_code)
@@ -76,6 +123,7 @@ struct async_result_visitor : public fc::visitor<std::string> {
 void chain_api_plugin::plugin_startup() {
    ilog( "starting chain_api_plugin" );
    my.reset(new chain_api_plugin_impl(app().get_plugin<chain_plugin>().chain()));
+   auto& chain_plug = app().get_plugin<chain_plugin>();
    auto ro_api = app().get_plugin<chain_plugin>().get_read_only_api();
    auto rw_api = app().get_plugin<chain_plugin>().get_read_write_api();
 
@@ -84,24 +132,25 @@ void chain_api_plugin::plugin_startup() {
 
    _http_plugin.add_api({
       CHAIN_RO_CALL(get_info, 200l),
-      CHAIN_RO_CALL(get_block, 200),
+      CHAIN_RO_CALL(get_cache_stats, 200),
+      CHAIN_RO_CALL_JSON(get_block, 200),
       CHAIN_RO_CALL(get_block_header_state, 200),
-      CHAIN_RO_CALL(get_account, 200),
-      CHAIN_RO_CALL(get_code, 200),
-      CHAIN_RO_CALL(get_code_hash, 200),
-      CHAIN_RO_CALL(get_abi, 200),
-      CHAIN_RO_CALL(get_raw_code_and_abi, 200),
-      CHAIN_RO_CALL(get_raw_abi, 200),
-      CHAIN_RO_CALL(get_table_rows, 200),
-      CHAIN_RO_CALL(get_table_by_scope, 200),
-      CHAIN_RO_CALL(get_currency_balance, 200),
-      CHAIN_RO_CALL(get_table_scopes_rows, 200),
-      CHAIN_RO_CALL(get_currency_stats, 200),
-      CHAIN_RO_CALL(get_producers, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_account, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_code, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_code_hash, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_abi, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_raw_code_and_abi, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_raw_abi, 200),
+      CHAIN_RO_CALL_READ_ONLY_JSON(get_table_rows, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_table_by_scope, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_currency_balance, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_table_scopes_rows, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_currency_stats, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_producers, 200),
       CHAIN_RO_CALL(get_producer_schedule, 200),
-      CHAIN_RO_CALL(get_scheduled_transactions, 200),
-      CHAIN_RO_CALL(abi_json_to_bin, 200),
-      CHAIN_RO_CALL(abi_bin_to_json, 200),
+      CHAIN_RO_CALL_READ_ONLY(get_scheduled_transactions, 200),
+      CHAIN_RO_CALL_READ_ONLY(abi_json_to_bin, 200),
+      CHAIN_RO_CALL_READ_ONLY(abi_bin_to_json, 200),
       CHAIN_RO_CALL(get_required_keys, 200),
       CHAIN_RO_CALL(get_transaction_id, 200),
       CHAIN_RW_CALL_ASYNC(push_block, chain_apis::read_write::push_block_results, 202),
@@ -19,6 +19,8 @@
 #include <gstio/chain/gstio_contract.hpp>
 
 #include <boost/signals2/connection.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -27,6 +29,80 @@
 #include <signal.h>
 #include <cstdlib>
 
+namespace chainbase {
+
+std::ostream& operator<<(std::ostream& osm, chainbase::undo_mode m) {
+   if ( m == chainbase::undo_mode::map ) {
+      osm << "map";
+   } else if ( m == chainbase::undo_mode::log ) {
+      osm << "log";
+   }
+
+   return osm;
+}
+
+void validate(boost::any& v,
+              const std::vector<std::string>& values,
+              chainbase::undo_mode* /* target_type */,
+              int)
+{
+  using namespace boost::program_options;
+
+  // Make sure no previous assignment to 'v' was made.
+  validators::check_first_occurrence(v);
+
+  // Extract the first string from 'values'. If there is more than
+  // one string, it's an error, and exception will be thrown.
+  std::string const& s = validators::get_single_string(values);
+
+  if ( s == "map" ) {
+     v = boost::any(chainbase::undo_mode::map);
+  } else if ( s == "log" ) {
+     v = boost::any(chainbase::undo_mode::log);
+  } else {
+     throw validation_error(validation_error::invalid_option_value);
+  }
+}
+
+std::ostream& operator<<(std::ostream& osm, chainbase::map_mode m) {
+   if ( m == chainbase::map_mode::mapped ) {
+      osm << "mapped";
+   } else if ( m == chainbase::map_mode::heap ) {
+      osm << "heap";
+   } else if ( m == chainbase::map_mode::locked ) {
+      osm << "locked";
+   }
+
+   return osm;
+}
+
+void validate(boost::any& v,
+              const std::vector<std::string>& values,
+              chainbase::map_mode* /* target_type */,
+              int)
+{
+  using namespace boost::program_options;
+
+  // Make sure no previous assignment to 'v' was made.
+  validators::check_first_occurrence(v);
+
+  // Extract the first string from 'values'. If there is more than
+  // one string, it's an error, and exception will be thrown.
+  std::string const& s = validators::get_single_string(values);
+
+  if ( s == "mapped" ) {
+     v = boost::any(chainbase::map_mode::mapped);
+  } else if ( s == "heap" ) {
+     v = boost::any(chainbase::map_mode::heap);
+  } else if ( s == "locked" ) {
+     v = boost::any(chainbase::map_mode::locked);
+  } else {
+     throw validation_error(validation_error::invalid_option_value);
+  }
+}
+
+}
+
 namespace gstio {
 
 //declare operator<< and validate funciton for read_mode in the same namespace as read_mode itself
@@ -163,7 +239,10 @@ public:
    //txn_msg_rate_limits              rate_limits;
    fc::optional<vm_type>            wasm_runtime;
    fc::microseconds                 abi_serializer_max_time_ms;
+   fc::optional<abi_serializer_cache> abi_cache;
    fc::optional<bfs::path>          snapshot_path;
+   uint16_t                         read_only_threads = 0;
+   fc::optional<boost::asio::thread_pool> read_only_thread_pool;
 
 
    // retained references to channels for easy publication
@@ -208,18 +287,55 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
    cfg.add_options()
          ("blocks-dir", bpo::value<bfs::path>()->default_value("blocks"),
           "the location of the blocks directory (absolute path or relative to application data dir)")
+         ("blocks-log-segment-size", bpo::value<uint32_t>()->default_value(0),
+          "Number of blocks per sealed segment of the block log, 0 keeps all blocks in blocks.log")
+         ("compress-blocks-log-segments", bpo::bool_switch()->default_value(false),
+          "Compress sealed segments of the block log with zlib")
+         ("blocks-log-retained-segments", bpo::value<uint32_t>()->default_value(0),
+          "Number of sealed block log segments kept in the blocks directory before older ones are moved to the blocks archive directory, 0 for no limit")
+         ("blocks-archive-dir", bpo::value<bfs::path>(),
+          "the location of the blocks archive directory (absolute path or relative to the blocks directory), defaults to 'archive' in the blocks directory")
+         ("blocks-archive-remove-on-reset", bpo::bool_switch()->default_value(false),
+          "Remove the archived block log segments when the block log is reset, otherwise a reset fails while the blocks archive directory holds any")
+         ("blocks-log-decompressed-cache-size-mb", bpo::value<uint64_t>()->default_value(config::default_blocks_decompressed_cache_size / (1024  * 1024)),
+          "Maximum size (in MiB) of compressed block log segments held decompressed in memory, a single segment is always allowed")
          ("checkpoint", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
-         ("wasm-runtime", bpo::value<gstio::chain::wasm_interface::vm_type>()->value_name("wavm/wabt"), "Override default WASM runtime")
+         ("wasm-runtime", bpo::value<gstio::chain::wasm_interface::vm_type>()->value_name("wavm/wabt/wasm2c"), "Override default WASM runtime")
+         ("wasm-cache-size-mb", bpo::value<uint64_t>()->default_value(config::default_wasm_cache_size / (1024  * 1024)),
+          "Approximate maximum size (in MiB) of instantiated contracts kept in the WASM cache, 0 for unbounded; least recently used contracts are evicted first")
+         ("wasm-cache-max-entries", bpo::value<uint32_t>()->default_value(config::default_wasm_cache_max_entries),
+          "Maximum number of instantiated contracts kept in the WASM cache, 0 for unbounded")
+         ("wasm-cache-pin-account", boost::program_options::value<vector<string>>()->composing()->multitoken(),
+          "Account whose contract is never evicted from the WASM cache, in addition to gstio and gstio.token (may specify multiple times)")
+         ("disable-wasm-code-cache", bpo::bool_switch()->default_value(false),
+          "Do not persist injected contracts in the code_cache directory of the application data dir")
+         ("wasm-code-cache-size-mb", bpo::value<uint64_t>()->default_value(config::default_wasm_code_cache_size / (1024  * 1024)),
+          "Maximum size (in MiB) of the code_cache directory, 0 for unbounded; least recently used contracts are deleted first")
          ("abi-serializer-max-time-ms", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_max_time_ms),
           "Override default maximum ABI serialization time allowed in ms")
+         ("abi-serializer-cache-size", bpo::value<uint32_t>()->default_value(config::default_abi_serializer_cache_size),
+          "Maximum number of validated contract ABIs shared by the chain API, history and mongodb plugins, 0 to validate on every use")
          ("chain-state-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_size / (1024  * 1024)), "Maximum size (in MiB) of the chain state database")
          ("chain-state-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_state_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the chain state database drops below this size (in MiB).")
+         ("database-undo-mode", boost::program_options::value<chainbase::undo_mode>()->default_value(chainbase::undo_mode::map),
+          "How the chain state database records undo history, takes effect once existing undo history is gone.\n"
+          "In \"map\" mode every undo session keeps the previous values of changed objects in maps keyed by id.\n"
+          "In \"log\" mode changes are appended to one log, which makes recording changes, squashing and committing cheaper; not supported by state_history_plugin.\n")
+         ("database-map-mode", boost::program_options::value<chainbase::map_mode>()->default_value(chainbase::map_mode::mapped),
+          "Where the chain state database lives while the node runs.\n"
+          "In \"mapped\" mode the state file is mapped and the operating system writes changed pages back to it.\n"
+          "In \"heap\" mode the state file is read into memory at startup and written back on clean shutdown; an unclean shutdown leaves the database dirty.\n"
+          "In \"locked\" mode the state is kept in memory as in \"heap\" mode and locked so it is never paged out; requires a sufficient locked memory limit.\n")
+         ("database-hugepage-size-kb", bpo::value<uint64_t>()->default_value(0),
+          "Back the chain state database with hugepages of this size (in KiB, usually 2048 or 1048576) in \"heap\" and \"locked\" modes; 0 uses regular pages. Falls back to regular pages when not enough hugepages are reserved.")
          ("reversible-blocks-db-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_cache_size / (1024  * 1024)), "Maximum size (in MiB) of the reversible blocks database")
          ("reversible-blocks-db-guard-size-mb", bpo::value<uint64_t>()->default_value(config::default_reversible_guard_size / (1024  * 1024)), "Safely shut down node when free space remaining in the reverseible blocks database drops below this size (in MiB).")
          ("signature-cpu-billable-pct", bpo::value<uint32_t>()->default_value(config::default_sig_cpu_bill_pct / config::percent_1),
           "Percentage of actual signature recovery cpu to bill. Whole number percentages, e.g. 50 for 50%")
          ("chain-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in controller thread pool")
+         ("read-only-threads", bpo::value<uint16_t>()->default_value(0),
+          "Number of threads running read only chain API calls concurrently with block processing, 0 runs them on the main thread")
          ("contracts-console", bpo::bool_switch()->default_value(false),
           "print contract's output to console")
          ("actor-whitelist", boost::program_options::value<vector<string>>()->composing()->multitoken(),
@@ -273,6 +389,8 @@ void chain_plugin::set_program_options(options_description& cli, options_descrip
           "recovers reversible block database if that database is in a bad state")
          ("force-all-checks", bpo::bool_switch()->default_value(false),
           "do not skip any checks that can be skipped while replaying irreversible blocks")
+         ("replay-lookahead-blocks", bpo::value<uint32_t>()->default_value(config::default_replay_lookahead_blocks),
+          "Number of blocks unpacked, and when force-all-checks is set signature recovered, ahead of execution while replaying the block log. 0 replays blocks serially")
          ("disable-replay-opts", bpo::bool_switch()->default_value(false),
           "disable optimizations that specifically target replay")
          ("replay-blockchain", bpo::bool_switch()->default_value(false),
@@ -402,8 +520,21 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
 
       if(options.count("abi-serializer-max-time-ms"))
          my->abi_serializer_max_time_ms = fc::microseconds(options.at("abi-serializer-max-time-ms").as<uint32_t>() * 1000);
+      my->abi_cache.emplace( options.at( "abi-serializer-cache-size" ).as<uint32_t>() );
 
       my->chain_config->blocks_dir = my->blocks_dir;
+      my->chain_config->blocks_log_segment_size = options.at( "blocks-log-segment-size" ).as<uint32_t>();
+      my->chain_config->compress_blocks_log_segments = options.at( "compress-blocks-log-segments" ).as<bool>();
+      my->chain_config->blocks_log_retained_segments = options.at( "blocks-log-retained-segments" ).as<uint32_t>();
+      if( options.count( "blocks-archive-dir" )) {
+         auto ad = options.at( "blocks-archive-dir" ).as<bfs::path>();
+         if( ad.is_relative())
+            my->chain_config->blocks_archive_dir = my->blocks_dir / ad;
+         else
+            my->chain_config->blocks_archive_dir = ad;
+      }
+      my->chain_config->remove_blocks_archive_on_reset = options.at( "blocks-archive-remove-on-reset" ).as<bool>();
+      my->chain_config->blocks_decompressed_cache_size = options.at( "blocks-log-decompressed-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
       my->chain_config->state_dir = app().data_dir() / config::default_state_dir_name;
       my->chain_config->read_only = my->readonly;
 
@@ -413,6 +544,19 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( options.count( "chain-state-db-guard-size-mb" ))
          my->chain_config->state_guard_size = options.at( "chain-state-db-guard-size-mb" ).as<uint64_t>() * 1024 * 1024;
 
+      if( options.count( "database-undo-mode" ))
+         my->chain_config->state_undo_mode = options.at( "database-undo-mode" ).as<chainbase::undo_mode>();
+
+      if( options.count( "database-map-mode" ))
+         my->chain_config->state_map_mode = options.at( "database-map-mode" ).as<chainbase::map_mode>();
+
+      if( options.count( "database-hugepage-size-kb" )) {
+         uint64_t hugepage_size = options.at( "database-hugepage-size-kb" ).as<uint64_t>() * 1024;
+         GST_ASSERT( (hugepage_size & (hugepage_size - 1)) == 0, plugin_config_exception,
+                     "database-hugepage-size-kb must be a power of two" );
+         my->chain_config->state_hugepage_size = hugepage_size;
+      }
+
       if( options.count( "reversible-blocks-db-size-mb" ))
          my->chain_config->reversible_cache_size =
                options.at( "reversible-blocks-db-size-mb" ).as<uint64_t>() * 1024 * 1024;
@@ -426,6 +570,9 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
                      "chain-threads ${num} must be greater than 0", ("num", my->chain_config->thread_pool_size) );
       }
 
+      if( options.count( "read-only-threads" ))
+         my->read_only_threads = options.at( "read-only-threads" ).as<uint16_t>();
+
       my->chain_config->sig_cpu_bill_pct = options.at("signature-cpu-billable-pct").as<uint32_t>();
       GST_ASSERT( my->chain_config->sig_cpu_bill_pct >= 0 && my->chain_config->sig_cpu_bill_pct <= 100, plugin_config_exception,
                   "signature-cpu-billable-pct must be 0 - 100, ${pct}", ("pct", my->chain_config->sig_cpu_bill_pct) );
@@ -434,7 +581,21 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
       if( my->wasm_runtime )
          my->chain_config->wasm_runtime = *my->wasm_runtime;
 
+      if( options.count( "wasm-cache-size-mb" ))
+         my->chain_config->wasm_cache_size = options.at( "wasm-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
+
+      if( options.count( "wasm-cache-max-entries" ))
+         my->chain_config->wasm_cache_max_entries = options.at( "wasm-cache-max-entries" ).as<uint32_t>();
+
+      LOAD_VALUE_SET( options, "wasm-cache-pin-account", my->chain_config->wasm_cache_pinned_accounts );
+
+      if( !options.at( "disable-wasm-code-cache" ).as<bool>() )
+         my->chain_config->wasm_code_cache_dir = app().data_dir() / config::default_wasm_code_cache_dir_name;
+      if( options.count( "wasm-code-cache-size-mb" ))
+         my->chain_config->wasm_code_cache_size = options.at( "wasm-code-cache-size-mb" ).as<uint64_t>() * 1024 * 1024;
+
       my->chain_config->force_all_checks = options.at( "force-all-checks" ).as<bool>();
+      my->chain_config->replay_lookahead_blocks = options.at( "replay-lookahead-blocks" ).as<uint32_t>();
       my->chain_config->disable_replay_opts = options.at( "disable-replay-opts" ).as<bool>();
       my->chain_config->contracts_console = options.at( "contracts-console" ).as<bool>();
       my->chain_config->allow_ram_billing_in_notify = options.at( "disable-ram-billing-notify-checks" ).as<bool>();
@@ -488,6 +649,8 @@ void chain_plugin::plugin_initialize(const variables_map& options) {
             wlog( "The --truncate-at-block option does not make sense when deleting all blocks." );
          clear_directory_contents( my->chain_config->state_dir );
          fc::remove_all( my->blocks_dir );
+         if( my->chain_config->blocks_archive_dir != fc::path() )
+            fc::remove_all( my->chain_config->blocks_archive_dir );
       } else if( options.at( "hard-replay-blockchain" ).as<bool>()) {
          ilog( "Hard replay requested: deleting state database" );
          clear_directory_contents( my->chain_config->state_dir );
@@ -727,24 +890,46 @@ void chain_plugin::plugin_startup()
    ilog("Blockchain started; head block is #${num}, genesis timestamp is ${ts}",
         ("num", my->chain->head_block_num())("ts", (std::string)my->chain_config->genesis.initial_timestamp));
 
+   if( my->read_only_threads > 0 ) {
+      ilog( "running read only chain API calls on ${n} threads", ("n", my->read_only_threads) );
+      my->read_only_thread_pool.emplace( my->read_only_threads );
+   }
+
    my->chain_config.reset();
 } FC_CAPTURE_AND_RETHROW() }
 
 void chain_plugin::plugin_shutdown() {
+   if( my->read_only_thread_pool ) {
+      my->read_only_thread_pool->stop();
+      my->read_only_thread_pool->join();
+   }
    my->pre_accepted_block_connection.reset();
    my->accepted_block_header_connection.reset();
    my->accepted_block_connection.reset();
    my->irreversible_block_connection.reset();
    my->accepted_transaction_connection.reset();
    my->applied_transaction_connection.reset();
+   ilog( "WASM cache stats: ${stats}", ("stats", my->chain->get_wasm_interface().get_cache_stats()) );
+   ilog( "ABI serializer cache stats: ${stats}", ("stats", my->abi_cache->get_stats()) );
    my->chain->get_thread_pool().stop();
    my->chain->get_thread_pool().join();
    my->chain.reset();
 }
 
-chain_apis::read_write::read_write(controller& db, const fc::microseconds& abi_serializer_max_time)
+void chain_plugin::post_read_only( std::function<void()> f ) {
+   if( !my->read_only_thread_pool ) {
+      f();
+      return;
+   }
+   boost::asio::post( *my->read_only_thread_pool, [this, f{std::move(f)}]() {
+      chain().db().with_read_lock( f );
+   } );
+}
+
+chain_apis::read_write::read_write(controller& db, const fc::microseconds& abi_serializer_max_time, abi_serializer_cache* abi_cache)
 : db(db)
 , abi_serializer_max_time(abi_serializer_max_time)
+, abi_cache(abi_cache)
 {
 }
 
@@ -981,6 +1166,19 @@ fc::microseconds chain_plugin::get_abi_serializer_max_time() const {
    return my->abi_serializer_max_time_ms;
 }
 
+abi_serializer_cache* chain_plugin::get_abi_serializer_cache() const {
+   return my->abi_cache ? &*my->abi_cache : nullptr;
+}
+
+abi_serializer_cache::abi_serializer_ptr chain_plugin::get_abi_serializer( const account_name& account ) const {
+   if( account.good() ) {
+      try {
+         return my->abi_cache->get( chain().db(), account, my->abi_serializer_max_time_ms );
+      } FC_CAPTURE_AND_LOG((account))
+   }
+   return abi_serializer_cache::abi_serializer_ptr();
+}
+
 void chain_plugin::log_guard_exception(const chain::guard_exception&e ) {
    if (e.code() == chain::database_guard_exception::code_value) {
       elog("Database has reached an unsafe level of usage, shutting down to avoid corrupting the database.  "
@@ -1046,6 +1244,14 @@ read_only::get_info_results read_only::get_info(const read_only::get_info_params
    };
 }
 
+read_only::get_cache_stats_results read_only::get_cache_stats(const read_only::get_cache_stats_params&) const {
+   get_cache_stats_results result;
+   result.wasm = db.get_wasm_interface().get_cache_stats();
+   if( abi_cache )
+      result.abi = abi_cache->get_stats();
+   return result;
+}
+
 uint64_t read_only::get_table_index_name(const read_only::get_table_rows_params& p, bool& primary) {
    using boost::algorithm::starts_with;
    // see multi_index packing of index name
@@ -1153,6 +1359,21 @@ string get_table_type( const abi_def& abi, const name& table_name ) {
 }
 
 read_only::get_table_rows_result read_only::get_table_rows( const read_only::get_table_rows_params& p )const {
+   return get_table_rows_as<get_table_rows_result>( p );
+}
+
+string read_only::get_table_rows_json( const read_only::get_table_rows_params& p )const {
+   auto result = get_table_rows_as<get_table_rows_json_result>( p );
+   string out;
+   out.reserve( result.rows.size() + 32 );
+   out += "{\"rows\":[";
+   out += result.rows;
+   out += result.more ? "],\"more\":true}" : "],\"more\":false}";
+   return out;
+}
+
+template<typename Result>
+Result read_only::get_table_rows_as( const read_only::get_table_rows_params& p )const {
    const abi_def abi = gstio::chain_apis::get_abi( db, p.code );
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wstrict-aliasing"
@@ -1162,38 +1383,42 @@ read_only::get_table_rows_result read_only::get_table_rows( const read_only::get
       GST_ASSERT( p.table == table_with_index, chain::contract_table_query_exception, "Invalid table name ${t}", ( "t", p.table ));
       auto table_type = get_table_type( abi, p.table );
       if( table_type == KEYi64 || p.key_type == "i64" || p.key_type == "name" ) {
-         return get_table_rows_ex<key_value_index>(p,abi);
+         const auto abis = get_abi_serializer( p.code );
+         GST_ASSERT( abis, chain::contract_table_query_exception, "No ABI found for ${contract}", ("contract", p.code) );
+         return get_table_rows_ex<Result, key_value_index>(p, *abis);
       }
       GST_ASSERT( false, chain::contract_table_query_exception,  "Invalid table type ${type}", ("type",table_type)("abi",abi));
    } else {
       GST_ASSERT( !p.key_type.empty(), chain::contract_table_query_exception, "key type required for non-primary index" );
+      const auto abis = get_abi_serializer( p.code );
+      GST_ASSERT( abis, chain::contract_table_query_exception, "No ABI found for ${contract}", ("contract", p.code) );
 
       if (p.key_type == chain_apis::i64 || p.key_type == "name") {
-         return get_table_rows_by_seckey<index64_index, uint64_t>(p, abi, [](uint64_t v)->uint64_t {
+         return get_table_rows_by_seckey<Result, index64_index, uint64_t>(p, *abis, [](uint64_t v)->uint64_t {
             return v;
          });
       }
       else if (p.key_type == chain_apis::i128) {
-         return get_table_rows_by_seckey<index128_index, uint128_t>(p, abi, [](uint128_t v)->uint128_t {
+         return get_table_rows_by_seckey<Result, index128_index, uint128_t>(p, *abis, [](uint128_t v)->uint128_t {
             return v;
          });
       }
       else if (p.key_type == chain_apis::i256) {
          if ( p.encode_type == chain_apis::hex) {
             using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-            return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+            return get_table_rows_by_seckey<Result, conv::index_type, conv::input_type>(p, *abis, conv::function());
          }
          using  conv = keytype_converter<chain_apis::i256>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return get_table_rows_by_seckey<Result, conv::index_type, conv::input_type>(p, *abis, conv::function());
       }
       else if (p.key_type == chain_apis::float64) {
-         return get_table_rows_by_seckey<index_double_index, double>(p, abi, [](double v)->float64_t {
+         return get_table_rows_by_seckey<Result, index_double_index, double>(p, *abis, [](double v)->float64_t {
             float64_t f = *(float64_t *)&v;
             return f;
          });
       }
       else if (p.key_type == chain_apis::float128) {
-         return get_table_rows_by_seckey<index_long_double_index, double>(p, abi, [](double v)->float128_t{
+         return get_table_rows_by_seckey<Result, index_long_double_index, double>(p, *abis, [](double v)->float128_t{
             float64_t f = *(float64_t *)&v;
             float128_t f128;
             f64_to_f128M(f, &f128);
@@ -1202,11 +1427,11 @@ read_only::get_table_rows_result read_only::get_table_rows( const read_only::get
       }
       else if (p.key_type == chain_apis::sha256) {
          using  conv = keytype_converter<chain_apis::sha256,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return get_table_rows_by_seckey<Result, conv::index_type, conv::input_type>(p, *abis, conv::function());
       }
       else if(p.key_type == chain_apis::ripemd160) {
          using  conv = keytype_converter<chain_apis::ripemd160,chain_apis::hex>;
-         return get_table_rows_by_seckey<conv::index_type, conv::input_type>(p, abi, conv::function());
+         return get_table_rows_by_seckey<Result, conv::index_type, conv::input_type>(p, *abis, conv::function());
       }
       GST_ASSERT(false, chain::contract_table_query_exception,  "Unsupported secondary index type: ${t}", ("t", p.key_type));
    }
@@ -1469,7 +1694,9 @@ fc::variant get_global_row( const database& db, const abi_def& abi, const abi_se
 read_only::get_producers_result read_only::get_producers( const read_only::get_producers_params& p ) const try {
    const abi_def abi = gstio::chain_apis::get_abi(db, config::system_account_name);
    const auto table_type = get_table_type(abi, N(producers));
-   const abi_serializer abis{ abi, abi_serializer_max_time };
+   const auto abi_ptr = get_abi_serializer( config::system_account_name );
+   GST_ASSERT( abi_ptr, abi_not_found_exception, "No ABI found for ${contract}", ("contract", config::system_account_name) );
+   const abi_serializer& abis = *abi_ptr;
    GST_ASSERT(table_type == KEYi64, chain::contract_table_query_exception, "Invalid table type ${type} for table producers", ("type",table_type));
 
    const auto& d = db.db();
@@ -1545,16 +1772,10 @@ read_only::get_producer_schedule_result read_only::get_producer_schedule( const
 template<typename Api>
 struct resolver_factory {
    static auto make(const Api* api, const fc::microseconds& max_serialization_time) {
-      return [api, max_serialization_time](const account_name &name) -> optional<abi_serializer> {
-         const auto* accnt = api->db.db().template find<account_object, by_name>(name);
-         if (accnt != nullptr) {
-            abi_def abi;
-            if (abi_serializer::to_abi(accnt->abi, abi)) {
-               return abi_serializer(abi, max_serialization_time);
-            }
-         }
-
-         return optional<abi_serializer>();
+      return [api, max_serialization_time](const account_name &name) -> abi_serializer_cache::abi_serializer_ptr {
+         if( api->abi_cache )
+            return api->abi_cache->get( api->db.db(), name, max_serialization_time );
+         return abi_serializer_cache::create( api->db.db(), name, max_serialization_time );
       };
    }
 };
@@ -1564,6 +1785,10 @@ auto make_resolver(const Api* api, const fc::microseconds& max_serialization_tim
    return resolver_factory<Api>::make(api, max_serialization_time);
 }
 
+abi_serializer_cache::abi_serializer_ptr read_only::get_abi_serializer( const account_name& account )const {
+   return make_resolver(this, abi_serializer_max_time)( account );
+}
+
 
 read_only::get_scheduled_transactions_result
 read_only::get_scheduled_transactions( const read_only::get_scheduled_transactions_params& p ) const {
@@ -1672,6 +1897,35 @@ fc::variant read_only::get_block(const read_only::get_block_params& params) cons
            ("stats",stats);
 }
 
+string read_only::get_block_json(const read_only::get_block_params& params) const {
+   signed_block_ptr block;
+
+   GST_ASSERT(!params.block_num_or_id.empty() && params.block_num_or_id.size() <= 64, chain::block_id_type_exception, "Invalid Block number or ID, must be greater than 0 and less than 64 characters" );
+   try {
+      block = db.fetch_block_by_id(fc::variant(params.block_num_or_id).as<block_id_type>());
+      if (!block) {
+         block = db.fetch_block_by_number(fc::to_uint64(params.block_num_or_id));
+      }
+
+   } GST_RETHROW_EXCEPTIONS(chain::block_id_type_exception, "Invalid block ID: ${block_num_or_id}", ("block_num_or_id", params.block_num_or_id))
+
+   GST_ASSERT( block, unknown_block_exception, "Could not find block: ${block}", ("block", params.block_num_or_id));
+
+   string out;
+   abi_serializer::to_json(*block, out, make_resolver(this, abi_serializer_max_time), abi_serializer_max_time);
+
+   // reopen the object to add the fields get_block() adds to its variant
+   out.pop_back();
+   out += ",\"id\":";
+   fc::json::append( out, fc::variant(block->id()) );
+   out += ",\"block_num\":";
+   fc::json::append( out, fc::variant(block->block_num()) );
+   out += ",\"ref_block_prefix\":";
+   fc::json::append( out, fc::variant(uint32_t(block->id()._hash[1])) );
+   out += '}';
+   return out;
+}
+
 fc::variant read_only::get_block_header_state(const get_block_header_state_params& params) const {
    block_state_ptr b;
    optional<uint64_t> block_num;
@@ -1726,7 +1980,7 @@ void read_write::push_transaction(const read_write::push_transaction_params& par
             try {
                fc::variant output;
                try {
-                  output = db.to_variant_with_abi( *trx_trace_ptr, abi_serializer_max_time );
+                  abi_serializer::to_variant( *trx_trace_ptr, output, make_resolver(this, abi_serializer_max_time), abi_serializer_max_time );
                } catch( chain::abi_exception& ) {
                   output = *trx_trace_ptr;
                }
@@ -1899,11 +2153,8 @@ read_only::get_account_results read_only::get_account( const get_account_params&
       ++perm;
    }
 
-   const auto& code_account = db.db().get<account_object,by_name>( config::system_account_name );
-
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
+   if( const auto abi_ptr = get_abi_serializer( config::system_account_name ) ) {
+      const abi_serializer& abis = *abi_ptr;
 
       const auto token_code = N(gstio.token);
 
@@ -1987,16 +2238,15 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
    const auto code_account = db.db().find<account_object,by_name>( params.code );
    GST_ASSERT(code_account != nullptr, contract_query_exception, "Contract can't be found ${contract}", ("contract", params.code));
 
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account->abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
-      auto action_type = abis.get_action_type(params.action);
+   if( const auto abis = get_abi_serializer( params.code ) ) {
+      auto action_type = abis->get_action_type(params.action);
       GST_ASSERT(!action_type.empty(), action_validate_exception, "Unknown action ${action} in contract ${contract}", ("action", params.action)("contract", params.code));
       try {
-         result.binargs = abis.variant_to_binary( action_type, params.args, abi_serializer_max_time, shorten_abi_errors );
+         result.binargs = abis->variant_to_binary( action_type, params.args, abi_serializer_max_time, shorten_abi_errors );
       } GST_RETHROW_EXCEPTIONS(chain::invalid_action_args_exception,
                                 "'${args}' is invalid args for action '${action}' code '${code}'. expected '${proto}'",
-                                ("args", params.args)("action", params.action)("code", params.code)("proto", action_abi_to_variant(abi, action_type)))
+                                ("args", params.args)("action", params.action)("code", params.code)
+                                ("proto", action_abi_to_variant(gstio::chain_apis::get_abi(db, params.code), action_type)))
    } else {
       GST_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
    }
@@ -2006,11 +2256,9 @@ read_only::abi_json_to_bin_result read_only::abi_json_to_bin( const read_only::a
 
 read_only::abi_bin_to_json_result read_only::abi_bin_to_json( const read_only::abi_bin_to_json_params& params )const {
    abi_bin_to_json_result result;
-   const auto& code_account = db.db().get<account_object,by_name>( params.code );
-   abi_def abi;
-   if( abi_serializer::to_abi(code_account.abi, abi) ) {
-      abi_serializer abis( abi, abi_serializer_max_time );
-      result.args = abis.binary_to_variant( abis.get_action_type( params.action ), params.binargs, abi_serializer_max_time, shorten_abi_errors );
+   (void)db.db().get<account_object,by_name>( params.code );
+   if( const auto abis = get_abi_serializer( params.code ) ) {
+      result.args = abis->binary_to_variant( abis->get_action_type( params.action ), params.binargs, abi_serializer_max_time, shorten_abi_errors );
    } else {
       GST_ASSERT(false, abi_not_found_exception, "No ABI found for ${contract}", ("contract", params.code));
    }
@@ -13,7 +13,9 @@
 #include <gstio/chain/resource_limits.hpp>
 #include <gstio/chain/transaction.hpp>
 #include <gstio/chain/abi_serializer.hpp>
+#include <gstio/chain/abi_serializer_cache.hpp>
 #include <gstio/chain/plugin_interface.hpp>
+#include <gstio/chain/wasm_interface.hpp>
 #include <gstio/chain/types.hpp>
 
 #include <boost/container/flat_set.hpp>
@@ -42,6 +44,7 @@ namespace gstio {
    using chain::action_name;
    using chain::abi_def;
    using chain::abi_serializer;
+   using chain::abi_serializer_cache;
 
 namespace chain_apis {
 struct empty{};
@@ -72,13 +75,14 @@ double convert_to_type(const string& str, const string& desc);
 class read_only {
    const controller& db;
    const fc::microseconds abi_serializer_max_time;
+   abi_serializer_cache* abi_cache = nullptr;
    bool  shorten_abi_errors = true;
 
 public:
    static const string KEYi64;
 
-   read_only(const controller& db, const fc::microseconds& abi_serializer_max_time)
-      : db(db), abi_serializer_max_time(abi_serializer_max_time) {}
+   read_only(const controller& db, const fc::microseconds& abi_serializer_max_time, abi_serializer_cache* abi_cache = nullptr)
+      : db(db), abi_serializer_max_time(abi_serializer_max_time), abi_cache(abi_cache) {}
 
    void validate() const {}
 
@@ -107,6 +111,14 @@ public:
    };
    get_info_results get_info(const get_info_params&) const;
 
+   using get_cache_stats_params = empty;
+
+   struct get_cache_stats_results {
+      chain::wasm_interface::cache_stats            wasm;
+      optional<abi_serializer_cache::stats>         abi;   ///< not set when the API has no ABI serializer cache
+   };
+   get_cache_stats_results get_cache_stats(const get_cache_stats_params&) const;
+
    struct producer_info {
       name                       producer_name;
    };
@@ -253,6 +265,8 @@ public:
    };
 
    fc::variant get_block(const get_block_params& params) const;
+   /// same response as get_block(), written as JSON text without building the variant tree of the block
+   string get_block_json(const get_block_params& params) const;
 
    struct get_block_header_state_params {
       string block_num_or_id;
@@ -281,7 +295,15 @@ public:
       bool                more = false; ///< true if last element in data is not the end and sizeof data() < limit
    };
 
+   /// rows of get_table_rows_result, already written as a comma separated list of JSON values
+   struct get_table_rows_json_result {
+      string rows;
+      bool   more = false;
+   };
+
    get_table_rows_result get_table_rows( const get_table_rows_params& params )const;
+   /// same response as get_table_rows(), written as JSON text with rows decoded straight from their binary form
+   string get_table_rows_json( const get_table_rows_params& params )const;
 
    struct get_table_by_scope_params {
       name        code; // mandatory
@@ -417,15 +439,50 @@ public:
 
    static uint64_t get_table_index_name(const read_only::get_table_rows_params& p, bool& primary);
 
-   template <typename IndexType, typename SecKeyType, typename ConvFn>
-   read_only::get_table_rows_result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_def& abi, ConvFn conv )const {
-      read_only::get_table_rows_result result;
+   template<typename Result>
+   Result get_table_rows_as( const read_only::get_table_rows_params& p )const;
+
+   void add_table_row( read_only::get_table_rows_result& result, const read_only::get_table_rows_params& p, const abi_serializer& abis,
+                       const vector<char>& data, account_name payer )const {
+      fc::variant data_var;
+      if( p.json ) {
+         data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
+      } else {
+         data_var = fc::variant( data );
+      }
+
+      if( p.show_payer && *p.show_payer ) {
+         result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", payer) );
+      } else {
+         result.rows.emplace_back( std::move(data_var) );
+      }
+   }
+
+   void add_table_row( read_only::get_table_rows_json_result& result, const read_only::get_table_rows_params& p, const abi_serializer& abis,
+                       const vector<char>& data, account_name payer )const {
+      auto& out = result.rows;
+      if( !out.empty() ) out += ',';
+      const bool show_payer = p.show_payer && *p.show_payer;
+      if( show_payer ) out += "{\"data\":";
+      if( p.json ) {
+         abis.binary_to_json( abis.get_table_type(p.table), data, out, abi_serializer_max_time, shorten_abi_errors );
+      } else {
+         fc::json::append( out, fc::variant( data ) );
+      }
+      if( show_payer ) {
+         out += ",\"payer\":";
+         fc::json::append_string( out, payer.to_string() );
+         out += '}';
+      }
+   }
+
+   template <typename Result, typename IndexType, typename SecKeyType, typename ConvFn>
+   Result get_table_rows_by_seckey( const read_only::get_table_rows_params& p, const abi_serializer& abis, ConvFn conv )const {
+      Result result;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
       bool primary = false;
       const uint64_t table_with_index = get_table_index_name(p, primary);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
@@ -475,19 +532,7 @@ public:
                const auto* itr2 = d.find<chain::key_value_object, chain::by_scope_primary>( boost::make_tuple(t_id->id, itr->primary_key) );
                if( itr2 == nullptr ) continue;
                copy_inline_row(*itr2, data);
-
-               fc::variant data_var;
-               if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
-               } else {
-                  data_var = fc::variant( data );
-               }
-
-               if( p.show_payer && *p.show_payer ) {
-                  result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", itr->payer) );
-               } else {
-                  result.rows.emplace_back( std::move(data_var) );
-               }
+               add_table_row( result, p, abis, data, itr->payer );
 
                ++count;
             }
@@ -507,15 +552,13 @@ public:
       return result;
    }
 
-   template <typename IndexType>
-   read_only::get_table_rows_result get_table_rows_ex( const read_only::get_table_rows_params& p, const abi_def& abi )const {
-      read_only::get_table_rows_result result;
+   template <typename Result, typename IndexType>
+   Result get_table_rows_ex( const read_only::get_table_rows_params& p, const abi_serializer& abis )const {
+      Result result;
       const auto& d = db.db();
 
       uint64_t scope = convert_to_type<uint64_t>(p.scope, "scope");
 
-      abi_serializer abis;
-      abis.set_abi(abi, abi_serializer_max_time);
       const auto* t_id = d.find<chain::table_id_object, chain::by_code_scope_table>(boost::make_tuple(p.code, scope, p.table));
       if( t_id != nullptr ) {
          const auto& idx = d.get_index<IndexType, chain::by_scope_primary>();
@@ -551,19 +594,7 @@ public:
             vector<char> data;
             for( unsigned int count = 0; cur_time <= end_time && count < p.limit && itr != end_itr; ++count, ++itr, cur_time = fc::time_point::now() ) {
                copy_inline_row(*itr, data);
-
-               fc::variant data_var;
-               if( p.json ) {
-                  data_var = abis.binary_to_variant( abis.get_table_type(p.table), data, abi_serializer_max_time, shorten_abi_errors );
-               } else {
-                  data_var = fc::variant( data );
-               }
-
-               if( p.show_payer && *p.show_payer ) {
-                  result.rows.emplace_back( fc::mutable_variant_object("data", std::move(data_var))("payer", itr->payer) );
-               } else {
-                  result.rows.emplace_back( std::move(data_var) );
-               }
+               add_table_row( result, p, abis, data, itr->payer );
             }
             if( itr != end_itr ) {
                result.more = true;
@@ -583,14 +614,18 @@ public:
 
    chain::symbol extract_core_symbol()const;
 
+   /// the serializer for the current ABI of account, shared through abi_cache when there is one
+   abi_serializer_cache::abi_serializer_ptr get_abi_serializer( const account_name& account )const;
+
    friend struct resolver_factory<read_only>;
 };
 
 class read_write {
    controller& db;
    const fc::microseconds abi_serializer_max_time;
+   abi_serializer_cache* abi_cache = nullptr;
 public:
-   read_write(controller& db, const fc::microseconds& abi_serializer_max_time);
+   read_write(controller& db, const fc::microseconds& abi_serializer_max_time, abi_serializer_cache* abi_cache = nullptr);
    void validate() const;
 
    using push_block_params = chain::signed_block;
@@ -688,8 +723,8 @@ public:
    void plugin_startup();
    void plugin_shutdown();
 
-   chain_apis::read_only get_read_only_api() const { return chain_apis::read_only(chain(), get_abi_serializer_max_time()); }
-   chain_apis::read_write get_read_write_api() { return chain_apis::read_write(chain(), get_abi_serializer_max_time()); }
+   chain_apis::read_only get_read_only_api() const { return chain_apis::read_only(chain(), get_abi_serializer_max_time(), get_abi_serializer_cache()); }
+   chain_apis::read_write get_read_write_api() { return chain_apis::read_write(chain(), get_abi_serializer_max_time(), get_abi_serializer_cache()); }
 
    void accept_block( const chain::signed_block_ptr& block );
    void accept_transaction(const chain::packed_transaction& trx, chain::plugin_interface::next_function<chain::transaction_trace_ptr> next);
@@ -697,6 +732,12 @@ public:
 
    bool block_is_on_preferred_chain(const chain::block_id_type& block_id);
 
+   /**
+    * Runs f on the read-only threads while the chain state cannot change, or right away on the
+    * calling thread when read-only-threads is 0. f must only read chain state and must not throw.
+    */
+   void post_read_only( std::function<void()> f );
+
    static bool recover_reversible_blocks( const fc::path& db_dir,
                                           uint32_t cache_size,
                                           optional<fc::path> new_db_dir = optional<fc::path>(),
@@ -720,6 +761,21 @@ public:
    chain::chain_id_type get_chain_id() const;
    fc::microseconds get_abi_serializer_max_time() const;
 
+   // Only call this after plugin_initialize()!
+   abi_serializer_cache* get_abi_serializer_cache() const;
+
+   /// the serializer for the current ABI of account from the shared cache, null if there is none or it is invalid
+   abi_serializer_cache::abi_serializer_ptr get_abi_serializer( const account_name& account ) const;
+
+   template<typename T>
+   fc::variant to_variant_with_abi( const T& obj ) const {
+      fc::variant pretty_output;
+      abi_serializer::to_variant( obj, pretty_output,
+                                  [this]( account_name n ){ return get_abi_serializer( n ); },
+                                  get_abi_serializer_max_time() );
+      return pretty_output;
+   }
+
    static void handle_guard_exception(const chain::guard_exception& e);
    static void handle_db_exhaustion();
    static void handle_bad_alloc();
@@ -735,6 +791,7 @@ FC_REFLECT( gstio::chain_apis::permission, (perm_name)(parent)(required_auth) )
 FC_REFLECT(gstio::chain_apis::empty, )
 FC_REFLECT(gstio::chain_apis::read_only::get_info_results,
 (server_version)(chain_id)(head_block_num)(last_irreversible_block_num)(last_irreversible_block_id)(head_block_id)(head_block_time)(head_block_producer)(virtual_block_cpu_limit)(virtual_block_net_limit)(block_cpu_limit)(block_net_limit)(server_version_string) )
+FC_REFLECT(gstio::chain_apis::read_only::get_cache_stats_results, (wasm)(abi) )
 FC_REFLECT(gstio::chain_apis::read_only::get_block_params, (block_num_or_id))
 FC_REFLECT(gstio::chain_apis::read_only::get_block_header_state_params, (block_num_or_id))
 
@@ -376,7 +376,6 @@ namespace gstio {
          edump((params));
         auto& chain = history->chain_plug->chain();
         const auto& db = chain.db();
-        const auto abi_serializer_max_time = history->chain_plug->get_abi_serializer_max_time();
 
         const auto& idx = db.get_index<account_history_index, by_account_action_seq>();
 
@@ -431,7 +430,7 @@ namespace gstio {
                                        start_itr->action_sequence_num,
                                        start_itr->account_sequence_num,
                                        a.block_num, a.block_time,
-                                       chain.to_variant_with_abi(t, abi_serializer_max_time)
+                                       history->chain_plug->to_variant_with_abi(t)
                                        });
 
                end_time = fc::time_point::now();
@@ -447,7 +446,7 @@ namespace gstio {
                                        start_itr->action_sequence_num,
                                        start_itr->account_sequence_num,
                                        a.block_num, a.block_time,
-                                       chain.to_variant_with_abi(t, abi_serializer_max_time)
+                                       history->chain_plug->to_variant_with_abi(t)
                                        });
 
                end_time = fc::time_point::now();
@@ -464,7 +463,6 @@ namespace gstio {
 
       read_only::get_transaction_result read_only::get_transaction( const read_only::get_transaction_params& p )const {
          auto& chain = history->chain_plug->chain();
-         const auto abi_serializer_max_time = history->chain_plug->get_abi_serializer_max_time();
 
          transaction_id_type input_id;
          auto input_id_length = p.id.size();
@@ -508,7 +506,7 @@ namespace gstio {
               fc::datastream<const char*> ds( itr->packed_action_trace.data(), itr->packed_action_trace.size() );
               action_trace t;
               fc::raw::unpack( ds, t );
-              result.traces.emplace_back( chain.to_variant_with_abi(t, abi_serializer_max_time) );
+              result.traces.emplace_back( history->chain_plug->to_variant_with_abi(t) );
 
               ++itr;
             }
@@ -526,7 +524,7 @@ namespace gstio {
                         auto &pt = receipt.trx.get<packed_transaction>();
                         if (pt.id() == result.id) {
                             fc::mutable_variant_object r("receipt", receipt);
-                            r("trx", chain.to_variant_with_abi(pt.get_signed_transaction(), abi_serializer_max_time));
+                            r("trx", history->chain_plug->to_variant_with_abi(pt.get_signed_transaction()));
                             result.trx = move(r);
                             break;
                         }
@@ -554,7 +552,7 @@ namespace gstio {
                         result.block_num = *p.block_num_hint;
                         result.block_time = blk->timestamp;
                         fc::mutable_variant_object r("receipt", receipt);
-                        r("trx", chain.to_variant_with_abi(pt.get_signed_transaction(), abi_serializer_max_time));
+                        r("trx", history->chain_plug->to_variant_with_abi(pt.get_signed_transaction()));
                         result.trx = move(r);
                         found = true;
                         break;
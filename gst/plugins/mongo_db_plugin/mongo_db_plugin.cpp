@@ -4,6 +4,7 @@
  */
 #include <gstio/mongo_db_plugin/mongo_db_plugin.hpp>
 #include <gstio/chain/gstio_contract.hpp>
+#include <gstio/chain/abi_serializer_cache.hpp>
 #include <gstio/chain/config.hpp>
 #include <gstio/chain/exceptions.hpp>
 #include <gstio/chain/transaction.hpp>
@@ -90,11 +91,9 @@ public:
    void process_irreversible_block(const chain::block_state_ptr&);
    void _process_irreversible_block(const chain::block_state_ptr&);
 
-   optional<abi_serializer> get_abi_serializer( account_name n );
+   abi_serializer_cache::abi_serializer_ptr get_abi_serializer( account_name n );
    template<typename T> fc::variant to_variant_with_abi( const T& obj );
 
-   void purge_abi_cache();
-
    bool add_action_trace( mongocxx::bulk_write& bulk_action_traces, const chain::action_trace& atrace,
                           const chain::transaction_trace_ptr& t,
                           bool executed, const std::chrono::milliseconds& now,
@@ -169,23 +168,9 @@ public:
    fc::optional<chain::chain_id_type> chain_id;
    fc::microseconds abi_serializer_max_time;
 
-   struct by_account;
-   struct by_last_access;
-
-   struct abi_cache {
-      account_name                     account;
-      fc::time_point                   last_accessed;
-      fc::optional<abi_serializer>     serializer;
-   };
-
-   typedef boost::multi_index_container<abi_cache,
-         indexed_by<
-               ordered_unique< tag<by_account>,  member<abi_cache,account_name,&abi_cache::account> >,
-               ordered_non_unique< tag<by_last_access>,  member<abi_cache,fc::time_point,&abi_cache::last_accessed> >
-         >
-   > abi_cache_index_t;
-
-   abi_cache_index_t abi_cache_index;
+   // ABIs here come from the accounts collection and are adjusted for mongo, so they are not shared with
+   // the chain plugin's cache; a setabi erases the account's entry, making a single sequence number suffice
+   fc::optional<abi_serializer_cache> abi_cache;
 
    static const action_name newaccount;
    static const action_name setabi;
@@ -580,98 +565,74 @@ bsoncxx::oid make_custom_oid() {
 
 } // anonymous namespace
 
-void mongo_db_plugin_impl::purge_abi_cache() {
-   if( abi_cache_index.size() < abi_cache_size ) return;
-
-   // remove the oldest (smallest) last accessed
-   auto& idx = abi_cache_index.get<by_last_access>();
-   auto itr = idx.begin();
-   if( itr != idx.end() ) {
-      idx.erase( itr );
-   }
-}
-
-optional<abi_serializer> mongo_db_plugin_impl::get_abi_serializer( account_name n ) {
+abi_serializer_cache::abi_serializer_ptr mongo_db_plugin_impl::get_abi_serializer( account_name n ) {
    using bsoncxx::builder::basic::kvp;
    using bsoncxx::builder::basic::make_document;
    if( n.good()) {
       try {
+         return abi_cache->get( n, 0, [&]() -> abi_serializer_cache::abi_serializer_ptr {
+            auto account = _accounts.find_one( make_document( kvp("name", n.to_string())) );
+            if(account) {
+               auto view = account->view();
+               abi_def abi;
+               if( view.find( "abi" ) != view.end()) {
+                  try {
+                     abi = fc::json::from_string( bsoncxx::to_json( view["abi"].get_document())).as<abi_def>();
+                  } catch (...) {
+                     ilog( "Unable to convert account abi to abi_def for ${n}", ( "n", n ));
+                     return abi_serializer_cache::abi_serializer_ptr();
+                  }
 
-         auto itr = abi_cache_index.find( n );
-         if( itr != abi_cache_index.end() ) {
-            abi_cache_index.modify( itr, []( auto& entry ) {
-               entry.last_accessed = fc::time_point::now();
-            });
-
-            return itr->serializer;
-         }
-
-         auto account = _accounts.find_one( make_document( kvp("name", n.to_string())) );
-         if(account) {
-            auto view = account->view();
-            abi_def abi;
-            if( view.find( "abi" ) != view.end()) {
-               try {
-                  abi = fc::json::from_string( bsoncxx::to_json( view["abi"].get_document())).as<abi_def>();
-               } catch (...) {
-                  ilog( "Unable to convert account abi to abi_def for ${n}", ( "n", n ));
-                  return optional<abi_serializer>();
-               }
-
-               purge_abi_cache(); // make room if necessary
-               abi_cache entry;
-               entry.account = n;
-               entry.last_accessed = fc::time_point::now();
-               abi_serializer abis;
-               if( n == chain::config::system_account_name ) {
-                  // redefine gstio setabi.abi from bytes to abi_def
-                  // Done so that abi is stored as abi_def in mongo instead of as bytes
-                  auto itr = std::find_if( abi.structs.begin(), abi.structs.end(),
-                                           []( const auto& s ) { return s.name == "setabi"; } );
-                  if( itr != abi.structs.end() ) {
-                     auto itr2 = std::find_if( itr->fields.begin(), itr->fields.end(),
-                                               []( const auto& f ) { return f.name == "abi"; } );
-                     if( itr2 != itr->fields.end() ) {
-                        if( itr2->type == "bytes" ) {
-                           itr2->type = "abi_def";
-                           // unpack setabi.abi as abi_def instead of as bytes
-                           abis.add_specialized_unpack_pack( "abi_def",
-                                 std::make_pair<abi_serializer::unpack_function, abi_serializer::pack_function>(
-                                       []( fc::datastream<const char*>& stream, bool is_array, bool is_optional ) -> fc::variant {
-                                          GST_ASSERT( !is_array && !is_optional, chain::mongo_db_exception, "unexpected abi_def");
-                                          chain::bytes temp;
-                                          fc::raw::unpack( stream, temp );
-                                          return fc::variant( fc::raw::unpack<abi_def>( temp ) );
-                                       },
-                                       []( const fc::variant& var, fc::datastream<char*>& ds, bool is_array, bool is_optional ) {
-                                          GST_ASSERT( false, chain::mongo_db_exception, "never called" );
-                                       }
-                                 ) );
+                  abi_serializer abis;
+                  if( n == chain::config::system_account_name ) {
+                     // redefine gstio setabi.abi from bytes to abi_def
+                     // Done so that abi is stored as abi_def in mongo instead of as bytes
+                     auto itr = std::find_if( abi.structs.begin(), abi.structs.end(),
+                                              []( const auto& s ) { return s.name == "setabi"; } );
+                     if( itr != abi.structs.end() ) {
+                        auto itr2 = std::find_if( itr->fields.begin(), itr->fields.end(),
+                                                  []( const auto& f ) { return f.name == "abi"; } );
+                        if( itr2 != itr->fields.end() ) {
+                           if( itr2->type == "bytes" ) {
+                              itr2->type = "abi_def";
+                              // unpack setabi.abi as abi_def instead of as bytes
+                              abis.add_specialized_unpack_pack( "abi_def",
+                                    std::make_pair<abi_serializer::unpack_function, abi_serializer::pack_function>(
+                                          []( fc::datastream<const char*>& stream, bool is_array, bool is_optional ) -> fc::variant {
+                                             GST_ASSERT( !is_array && !is_optional, chain::mongo_db_exception, "unexpected abi_def");
+                                             chain::bytes temp;
+                                             fc::raw::unpack( stream, temp );
+                                             return fc::variant( fc::raw::unpack<abi_def>( temp ) );
+                                          },
+                                          []( const fc::variant& var, fc::datastream<char*>& ds, bool is_array, bool is_optional ) {
+                                             GST_ASSERT( false, chain::mongo_db_exception, "never called" );
+                                          }
+                                    ) );
+                           }
                         }
                      }
                   }
-               }
-               // mongo does not like empty json keys
-               // make abi_serializer use empty_name instead of "" for the action data
-               for( auto& s : abi.structs ) {
-                  if( s.name.empty() ) {
-                     s.name = "empty_struct_name";
-                  }
-                  for( auto& f : s.fields ) {
-                     if( f.name.empty() ) {
-                        f.name = "empty_field_name";
+                  // mongo does not like empty json keys
+                  // make abi_serializer use empty_name instead of "" for the action data
+                  for( auto& s : abi.structs ) {
+                     if( s.name.empty() ) {
+                        s.name = "empty_struct_name";
+                     }
+                     for( auto& f : s.fields ) {
+                        if( f.name.empty() ) {
+                           f.name = "empty_field_name";
+                        }
                      }
                   }
+                  abis.set_abi( abi, abi_serializer_max_time );
+                  return std::make_shared<abi_serializer>( std::move( abis ) );
                }
-               abis.set_abi( abi, abi_serializer_max_time );
-               entry.serializer.emplace( std::move( abis ) );
-               abi_cache_index.insert( entry );
-               return entry.serializer;
             }
-         }
+            return abi_serializer_cache::abi_serializer_ptr();
+         });
       } FC_CAPTURE_AND_LOG((n))
    }
-   return optional<abi_serializer>();
+   return abi_serializer_cache::abi_serializer_ptr();
 }
 
 template<typename T>
@@ -961,7 +922,7 @@ void mongo_db_plugin_impl::_process_accepted_block( const chain::block_state_ptr
 
    auto block_num = bs->block_num;
    if( block_num % 1000 == 0 )
-      ilog( "block_num: ${b}", ("b", block_num) );
+      ilog( "block_num: ${b}, ABI cache stats: ${stats}", ("b", block_num)("stats", abi_cache->get_stats()) );
    const auto& block_id = bs->id;
    const auto block_id_str = block_id.str();
 
@@ -1315,7 +1276,7 @@ void mongo_db_plugin_impl::update_account(const chain::action& act)
                std::chrono::microseconds{fc::time_point::now().time_since_epoch().count()} );
          auto setabi = act.data_as<chain::setabi>();
 
-         abi_cache_index.erase( setabi.account );
+         abi_cache->erase( setabi.account );
 
          auto account = find_account( _accounts, setabi.account );
          if( !account ) {
@@ -1552,6 +1513,7 @@ void mongo_db_plugin::plugin_initialize(const variables_map& options)
             my->abi_cache_size = options.at( "mongodb-abi-cache-size" ).as<uint32_t>();
             GST_ASSERT( my->abi_cache_size > 0, chain::plugin_config_exception, "mongodb-abi-cache-size > 0 required" );
          }
+         my->abi_cache.emplace( my->abi_cache_size );
          if( options.count( "mongodb-block-start" )) {
             my->start_block_num = options.at( "mongodb-block-start" ).as<uint32_t>();
          }
@@ -1661,6 +1623,8 @@ void mongo_db_plugin::plugin_shutdown()
    my->accepted_transaction_connection.reset();
    my->applied_transaction_connection.reset();
 
+   if( my->abi_cache )
+      ilog( "mongo_db_plugin ABI cache stats: ${stats}", ("stats", my->abi_cache->get_stats()) );
    my.reset();
 }
 
@@ -142,6 +142,19 @@ namespace gstio {
                                       signed_block,         // which = 7
                                       packed_transaction>;  // which = 8
 
+   /**
+    * Unpacks the message of type T following the net_message index in the body of a received message. Returns true
+    * when nothing follows it, only then does packing the message again give the received bytes so they can be relayed
+    * unchanged.
+    */
+   template<typename T>
+   bool unpack_relayable( fc::datastream<const char*>& ds, T& msg ) {
+      unsigned_int which;
+      fc::raw::unpack( ds, which );
+      fc::raw::unpack( ds, msg );
+      return ds.remaining() == 0;
+   }
+
 } // namespace gstio
 
 FC_REFLECT( gstio::select_ids<fc::sha256>, (mode)(pending)(ids) )
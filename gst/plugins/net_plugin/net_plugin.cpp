@@ -9,6 +9,7 @@
 #include <gstio/chain/controller.hpp>
 #include <gstio/chain/exceptions.hpp>
 #include <gstio/chain/block.hpp>
+#include <gstio/chain/block_log.hpp>
 #include <gstio/chain/plugin_interface.hpp>
 #include <gstio/producer_plugin/producer_plugin.hpp>
 #include <gstio/chain/contract_types.hpp>
@@ -26,6 +27,9 @@
 #include <boost/asio/ip/host_name.hpp>
 #include <boost/asio/steady_timer.hpp>
 
+#include <atomic>
+#include <mutex>
+
 using namespace gstio::chain::plugin_interface::compat;
 
 namespace gstio {
@@ -95,6 +99,19 @@ namespace gstio {
       >
    node_transaction_index;
 
+   struct known_block {
+      block_id_type id;
+      uint32_t      block_num = 0;
+   };
+
+   typedef multi_index_container<
+      gstio::known_block,
+      indexed_by<
+         ordered_unique< tag<by_id>, member<gstio::known_block, block_id_type, &gstio::known_block::id >, sha256_less >,
+         ordered_non_unique< tag<by_block_num>, member<gstio::known_block, uint32_t, &gstio::known_block::block_num > >
+         >
+      > known_block_index;
+
    class net_plugin_impl {
    public:
       unique_ptr<tcp::acceptor>        acceptor;
@@ -145,13 +162,17 @@ namespace gstio {
       producer_plugin*              producer_plug = nullptr;
       int                           started_sessions = 0;
 
+      std::mutex                    local_txns_mtx; ///< local_txns is also checked for duplicates on connection strands
       node_transaction_index        local_txns;
 
+      std::mutex                    known_blocks_mtx;
+      known_block_index             known_blocks; ///< blocks accepted by the chain, lets connection strands skip decoding them
+
       bool                          use_socket_read_watermark = false;
 
       channels::transaction_ack::channel_type::handle  incoming_transaction_ack_subscription;
 
-      uint16_t                                  thread_pool_size = 1; // currently used by server_ioc
+      uint16_t                                  thread_pool_size = 1; // runs server_ioc, which hosts the connection strands
       optional<boost::asio::thread_pool>        thread_pool;
       std::shared_ptr<boost::asio::io_context>  server_ioc;
       optional<io_work_t>                       server_ioc_work;
@@ -161,6 +182,7 @@ namespace gstio {
       void connect( const connection_ptr& c, const std::shared_ptr<tcp::resolver>& resolver, tcp::resolver::results_type endpoints );
       bool start_session(const connection_ptr& c);
       void start_listen_loop();
+      /// must be called on the connection strand
       void start_read_message(const connection_ptr& c);
 
       /** \brief Process the next message from the pending message buffer
@@ -168,10 +190,24 @@ namespace gstio {
        * Process the next message from the pending_message_buffer.
        * message_length is the already determined length of the data
        * part of the message that will handle the message.
+       * Runs on the connection strand: the message is decoded there, blocks
+       * and transactions already known are filtered out, and only the decoded
+       * message is posted to the main thread for handling.
        * Returns true is successful. Returns false if an error was
-       * encountered unpacking or processing the message.
+       * encountered unpacking the message.
        */
-      bool process_next_message(const connection_ptr& conn, uint32_t message_length);
+      bool process_next_message(const connection_ptr& conn, const socket_ptr& socket, uint32_t message_length);
+
+      /** \brief Run handler for a decoded message on the main thread
+       *
+       * The handler is dropped if the connection was closed or reconnected
+       * after the message was read from socket. A handler that throws closes
+       * the connection.
+       */
+      template<typename Handler>
+      void post_to_main(const connection_ptr& conn, const socket_ptr& socket, Handler handler);
+      /// called on a connection strand to log and close the connection on the main thread
+      void close_from_strand(const connection_ptr& conn, const socket_ptr& socket, const string& reason);
 
       void close(const connection_ptr& c);
       size_t count_open_sockets() const;
@@ -206,9 +242,13 @@ namespace gstio {
       void handle_message(const connection_ptr& c, const request_message& msg);
       void handle_message(const connection_ptr& c, const sync_request_message& msg);
       void handle_message(const connection_ptr& c, const signed_block& msg) = delete; // signed_block_ptr overload used instead
-      void handle_message(const connection_ptr& c, const signed_block_ptr& msg);
-      void handle_message(const connection_ptr& c, const packed_transaction& msg) = delete; // packed_transaction_ptr overload used instead
-      void handle_message(const connection_ptr& c, const packed_transaction_ptr& msg);
+      void handle_message(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id,
+                          const std::shared_ptr<std::vector<char>>& wire);
+      /// applies a received block, handle_message may hold it back during lib catchup until its predecessors are applied
+      void process_block(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id,
+                         const std::shared_ptr<std::vector<char>>& wire);
+      void handle_message(const connection_ptr& c, const packed_transaction& msg) = delete; // transaction_metadata_ptr overload used instead
+      void handle_message(const connection_ptr& c, const transaction_metadata_ptr& trx, const std::shared_ptr<std::vector<char>>& wire);
 
       void start_conn_timer(boost::asio::steady_timer::duration du, std::weak_ptr<connection> from_connection);
       void start_txn_timer();
@@ -304,6 +344,7 @@ namespace gstio {
    constexpr auto     def_txn_expire_wait = std::chrono::seconds(3);
    constexpr auto     def_resp_expected_wait = std::chrono::seconds(5);
    constexpr auto     def_sync_fetch_span = 100;
+   constexpr auto     def_sync_fetch_window = 4;
 
    constexpr auto     message_header_size = 4;
    constexpr uint32_t signed_block_which = 7;        // see protocol net_message
@@ -436,11 +477,13 @@ namespace gstio {
          return true;
       }
 
-      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs ) {
+      /// buffs keep the data bufs refer to alive while the write is in progress, even if the queues are cleared
+      void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs,
+                            std::vector<std::shared_ptr<vector<char>>>& buffs ) {
          if( _sync_write_queue.size() > 0 ) { // always send msgs from sync_write_queue first
-            fill_out_buffer( bufs, _sync_write_queue );
+            fill_out_buffer( bufs, buffs, _sync_write_queue );
          } else { // postpone real_time write_queue if sync queue is not empty
-            fill_out_buffer( bufs, _write_queue );
+            fill_out_buffer( bufs, buffs, _write_queue );
             GST_ASSERT( _write_queue_size == 0, plugin_exception, "write queue size expected to be zero" );
          }
       }
@@ -454,10 +497,12 @@ namespace gstio {
    private:
       struct queued_write;
       void fill_out_buffer( std::vector<boost::asio::const_buffer>& bufs,
+                            std::vector<std::shared_ptr<vector<char>>>& buffs,
                             deque<queued_write>& w_queue ) {
          while ( w_queue.size() > 0 ) {
             auto& m = w_queue.front();
             bufs.push_back( boost::asio::buffer( *m.buff ));
+            buffs.push_back( m.buff );
             _write_queue_size -= m.buff->size();
             _out_queue.emplace_back( m );
             w_queue.pop_front();
@@ -470,7 +515,7 @@ namespace gstio {
          std::function<void( boost::system::error_code, std::size_t )> callback;
       };
 
-      uint32_t _write_queue_size = 0;
+      std::atomic<uint32_t> _write_queue_size{0}; ///< also read on the connection strand to throttle reads
       deque<queued_write> _write_queue;
       deque<queued_write> _sync_write_queue; // sync_write_queue will be sent first
       deque<queued_write> _out_queue;
@@ -489,17 +534,19 @@ namespace gstio {
       peer_block_state_index  blk_state;
       transaction_state_index trx_state;
       optional<sync_state>    peer_requested;  // this peer is requesting info from us
+      block_log_range           sync_log_blocks; ///< logged blocks of peer_requested, sent without unpacking
+      block_log_range::iterator sync_log_itr;
       std::shared_ptr<boost::asio::io_context>  server_ioc; // keep ioc alive
-      boost::asio::io_context::strand           strand;
-      socket_ptr                                socket;
+      boost::asio::io_context::strand           strand; ///< all socket operations and message decoding run here
+      socket_ptr                                socket; ///< only replaced on the main thread, read with std::atomic_load on the strand
 
-      fc::message_buffer<1024*1024>    pending_message_buffer;
-      fc::optional<std::size_t>        outstanding_read_bytes;
+      fc::message_buffer<1024*1024>    pending_message_buffer; ///< only accessed on strand
+      fc::optional<std::size_t>        outstanding_read_bytes; ///< only accessed on strand
 
 
       queued_buffer           buffer_queue;
 
-      uint32_t                trx_in_progress_size = 0;
+      std::atomic<uint32_t>   trx_in_progress_size{0};
       fc::sha256              node_id;
       handshake_message       last_handshake_recv;
       handshake_message       last_handshake_sent;
@@ -514,6 +561,7 @@ namespace gstio {
       block_id_type          fork_head;
       uint32_t               fork_head_num = 0;
       optional<request_message> last_req;
+      double                 sync_rate = 0; ///< blocks per second of recent sync chunks from this peer, 0 until measured
 
       connection_status get_status()const {
          connection_status stat;
@@ -583,6 +631,7 @@ namespace gstio {
       void cancel_sync(go_away_reason);
       void flush_queues();
       bool enqueue_sync_block();
+      bool enqueue_logged_block( uint32_t num, uint32_t end, bool trigger_send );
       void request_sync_blocks(uint32_t start, uint32_t end);
 
       void cancel_wait();
@@ -646,10 +695,10 @@ namespace gstio {
       }
 
       void operator()( signed_block&& msg ) const {
-         impl.handle_message( c, std::make_shared<signed_block>( std::move( msg ) ) );
+         GST_ASSERT( false, plugin_config_exception, "signed_block should be decoded by process_next_message" );
       }
       void operator()( packed_transaction&& msg ) const {
-         impl.handle_message( c, std::make_shared<packed_transaction>( std::move( msg ) ) );
+         GST_ASSERT( false, plugin_config_exception, "packed_transaction should be decoded by process_next_message" );
       }
 
       template <typename T>
@@ -667,19 +716,45 @@ namespace gstio {
          in_sync
       };
 
+      /// a range of blocks requested from one peer during lib catchup
+      struct sync_chunk {
+         uint32_t       start = 0;
+         uint32_t       end = 0;
+         uint32_t       last_received = 0;
+         connection_ptr source;      ///< null while waiting for a peer to take over the chunk
+         uint32_t       requested_from = 0;
+         time_point     requested;
+      };
+
+      /// a block that arrived ahead of sync_next_expected_num, applied once the blocks before it are
+      struct deferred_block {
+         connection_ptr                     source;
+         signed_block_ptr                   block;
+         block_id_type                      id;
+         std::shared_ptr<std::vector<char>> wire;
+      };
+
       uint32_t       sync_known_lib_num;
       uint32_t       sync_last_requested_num;
       uint32_t       sync_next_expected_num;
       uint32_t       sync_req_span;
-      connection_ptr source;
+      uint32_t       sync_fetch_window;  ///< chunks requested from different peers at the same time
+      std::map<uint32_t, sync_chunk>      sync_chunks;  ///< by start block
+      std::map<uint32_t, deferred_block>  deferred_blocks;
       stages         state;
 
       chain_plugin* chain_plug = nullptr;
 
       constexpr auto stage_str(stages s );
 
+      std::map<uint32_t, sync_chunk>::iterator find_chunk(const connection_ptr& c);
+      connection_ptr select_source(const sync_chunk& chunk, const connection_ptr& preferred);
+      void request_chunk(sync_chunk& chunk);
+      bool release_chunk(const connection_ptr& c);
+      void reset_chunks();
+
    public:
-      explicit sync_manager(uint32_t span);
+      sync_manager(uint32_t span, uint32_t window);
       void set_state(stages s);
       bool sync_required();
       void send_handshakes();
@@ -691,6 +766,11 @@ namespace gstio {
       bool verify_catchup(const connection_ptr& c, uint32_t num, const block_id_type& id);
       void rejected_block(const connection_ptr& c, uint32_t blk_num);
       void recv_block(const connection_ptr& c, const block_id_type& blk_id, uint32_t blk_num);
+      /// accounts a block received from c against its chunk, before it is applied
+      void sync_block_received(const connection_ptr& c, uint32_t blk_num);
+      /// holds on to a block that arrived out of order during lib catchup, returns false if it can be applied now
+      bool defer_block(const connection_ptr& c, const signed_block_ptr& b, const block_id_type& id,
+                       const std::shared_ptr<std::vector<char>>& wire);
       void recv_handshake(const connection_ptr& c, const handshake_message& msg);
       void recv_notice(const connection_ptr& c, const notice_message& msg);
    };
@@ -699,15 +779,20 @@ namespace gstio {
    public:
       std::multimap<block_id_type, connection_ptr, sha256_less> received_blocks;
       std::multimap<transaction_id_type, connection_ptr, sha256_less> received_transactions;
+      /// messages as received from peers, relayed as is instead of repacking the block or transaction
+      std::map<block_id_type, std::shared_ptr<std::vector<char>>, sha256_less> received_block_buffers;
+      std::map<transaction_id_type, std::shared_ptr<std::vector<char>>, sha256_less> received_trx_buffers;
 
       void bcast_transaction(const transaction_metadata_ptr& trx);
       void rejected_transaction(const transaction_id_type& msg);
       void bcast_block(const block_state_ptr& bs);
       void rejected_block(const block_id_type& id);
 
-      void recv_block(const connection_ptr& conn, const block_id_type& msg, uint32_t bnum);
+      void recv_block(const connection_ptr& conn, const block_id_type& msg, uint32_t bnum,
+                      const std::shared_ptr<std::vector<char>>& wire = std::shared_ptr<std::vector<char>>());
       void expire_blocks( uint32_t bnum );
-      void recv_transaction(const connection_ptr& conn, const transaction_id_type& id);
+      void recv_transaction(const connection_ptr& conn, const transaction_id_type& id,
+                            const std::shared_ptr<std::vector<char>>& wire = std::shared_ptr<std::vector<char>>());
       void recv_notice(const connection_ptr& conn, const notice_message& msg, bool generated);
 
       void retry_fetch(const connection_ptr& conn);
@@ -720,7 +805,7 @@ namespace gstio {
         trx_state(),
         peer_requested(),
         server_ioc( my_impl->server_ioc ),
-        strand( app().get_io_service() ),
+        strand( *my_impl->server_ioc ),
         socket( std::make_shared<tcp::socket>( std::ref( *my_impl->server_ioc ))),
         node_id(),
         last_handshake_recv(),
@@ -746,7 +831,7 @@ namespace gstio {
         trx_state(),
         peer_requested(),
         server_ioc( my_impl->server_ioc ),
-        strand( app().get_io_service() ),
+        strand( *my_impl->server_ioc ),
         socket( s ),
         node_id(),
         last_handshake_recv(),
@@ -786,6 +871,8 @@ namespace gstio {
 
    void connection::reset() {
       peer_requested.reset();
+      sync_log_blocks = block_log_range();
+      sync_log_itr = block_log_range::iterator();
       blk_state.clear();
       trx_state.clear();
    }
@@ -796,8 +883,16 @@ namespace gstio {
 
    void connection::close() {
       if(socket) {
-         socket->close();
-         socket.reset( new tcp::socket( std::ref( *my_impl->server_ioc ) ) );
+         // reads and writes are issued on the strand, so shut the old socket down there too
+         connection_wptr weak_this = shared_from_this();
+         strand.post( [weak_this, old_socket = socket]() {
+            boost::system::error_code ec;
+            old_socket->shutdown( tcp::socket::shutdown_both, ec );
+            old_socket->close( ec );
+            auto c = weak_this.lock();
+            if( c && c->read_delay_timer ) c->read_delay_timer->cancel();
+         } );
+         std::atomic_store( &socket, std::make_shared<tcp::socket>( *my_impl->server_ioc ) );
       }
       else {
          fc_wlog( logger, "no socket to close!" );
@@ -818,7 +913,6 @@ namespace gstio {
       fc_ilog(logger, "closing ${a}, ${p}", ("a",peer_addr)("p",peer_name()));
       fc_dlog(logger, "canceling wait on ${p}", ("p",peer_name()));
       cancel_wait();
-      if( read_delay_timer ) read_delay_timer->cancel();
    }
 
    void connection::blk_send_branch() {
@@ -955,50 +1049,57 @@ namespace gstio {
          return;
       }
       std::vector<boost::asio::const_buffer> bufs;
-      buffer_queue.fill_out_buffer( bufs );
+      std::vector<std::shared_ptr<vector<char>>> buffs;
+      buffer_queue.fill_out_buffer( bufs, buffs );
 
-      boost::asio::async_write(*socket, bufs,
-            boost::asio::bind_executor(strand, [c, socket=socket, priority]( boost::system::error_code ec, std::size_t w ) {
-         app().post(priority, [c, priority, ec, w]() {
-            try {
-               auto conn = c.lock();
-               if(!conn)
-                  return;
+      strand.post( [c, socket=socket, bufs{std::move(bufs)}, buffs{std::move(buffs)}, priority]() {
+         auto conn = c.lock();
+         if( !conn || socket != std::atomic_load( &conn->socket ) ) // closed before the write was issued
+            return;
+         boost::asio::async_write(*socket, bufs,
+               boost::asio::bind_executor(conn->strand, [c, socket, buffs, priority]( boost::system::error_code ec, std::size_t w ) {
+            app().post(priority, [c, socket, priority, ec, w]() {
+               try {
+                  auto conn = c.lock();
+                  // the out queue of a connection closed since the write belongs to its next session
+                  if( !conn || socket != std::atomic_load( &conn->socket ) )
+                     return;
 
-               conn->buffer_queue.out_callback( ec, w );
+                  conn->buffer_queue.out_callback( ec, w );
 
-               if(ec) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  if( ec.value() != boost::asio::error::eof) {
-                     fc_elog( logger, "Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()) );
-                  }
-                  else {
-                     fc_wlog( logger, "connection closure detected on write to ${p}",("p",pname) );
+                  if(ec) {
+                     string pname = conn ? conn->peer_name() : "no connection name";
+                     if( ec.value() != boost::asio::error::eof) {
+                        fc_elog( logger, "Error sending to peer ${p}: ${i}", ("p",pname)("i", ec.message()) );
+                     }
+                     else {
+                        fc_wlog( logger, "connection closure detected on write to ${p}",("p",pname) );
+                     }
+                     my_impl->close(conn);
+                     return;
                   }
-                  my_impl->close(conn);
-                  return;
+                  conn->buffer_queue.clear_out_queue();
+                  conn->enqueue_sync_block();
+                  conn->do_queue_write( priority );
                }
-               conn->buffer_queue.clear_out_queue();
-               conn->enqueue_sync_block();
-               conn->do_queue_write( priority );
-            }
-            catch(const std::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               fc_elog( logger,"Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()) );
-            }
-            catch(const fc::exception &ex) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               fc_elog( logger,"Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()) );
-            }
-            catch(...) {
-               auto conn = c.lock();
-               string pname = conn ? conn->peer_name() : "no connection name";
-               fc_elog( logger,"Exception in do_queue_write to ${p}", ("p",pname) );
-            }
-         });
-      }));
+               catch(const std::exception &ex) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  fc_elog( logger,"Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.what()) );
+               }
+               catch(const fc::exception &ex) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  fc_elog( logger,"Exception in do_queue_write to ${p} ${s}", ("p",pname)("s",ex.to_string()) );
+               }
+               catch(...) {
+                  auto conn = c.lock();
+                  string pname = conn ? conn->peer_name() : "no connection name";
+                  fc_elog( logger,"Exception in do_queue_write to ${p}", ("p",pname) );
+               }
+            });
+         }));
+      });
    }
 
    void connection::cancel_sync(go_away_reason reason) {
@@ -1023,11 +1124,16 @@ namespace gstio {
       if (!peer_requested)
          return false;
       uint32_t num = ++peer_requested->last;
+      uint32_t end = peer_requested->end_block;
       bool trigger_send = num == peer_requested->start_block;
-      if(num == peer_requested->end_block) {
+      if(num == end) {
          peer_requested.reset();
       }
       try {
+         if( enqueue_logged_block( num, end, trigger_send ) ) {
+            return true;
+         }
+         // not yet irreversible, send from the fork database
          controller& cc = my_impl->chain_plug->chain();
          signed_block_ptr sb = cc.fetch_block_by_number(num);
          if(sb) {
@@ -1081,6 +1187,25 @@ namespace gstio {
       return send_buffer;
    }
 
+   // frames already packed bytes of v, such as a block read from the block log
+   static std::shared_ptr<std::vector<char>> create_send_buffer( uint32_t which, const char* packed, size_t packed_size ) {
+      const uint32_t which_size = fc::raw::pack_size( unsigned_int( which ) );
+      const uint32_t payload_size = which_size + packed_size;
+
+      const char* const header = reinterpret_cast<const char* const>(&payload_size); // avoid variable size encoding of uint32_t
+      constexpr size_t header_size = sizeof( payload_size );
+      static_assert( header_size == message_header_size, "invalid message_header_size" );
+      const size_t buffer_size = header_size + payload_size;
+
+      auto send_buffer = std::make_shared<vector<char>>( buffer_size );
+      fc::datastream<char*> ds( send_buffer->data(), buffer_size );
+      ds.write( header, header_size );
+      fc::raw::pack( ds, unsigned_int( which ) );
+      ds.write( packed, packed_size );
+
+      return send_buffer;
+   }
+
    static std::shared_ptr<std::vector<char>> create_send_buffer( const signed_block_ptr& sb ) {
       // this implementation is to avoid copy of signed_block to net_message
       // matches which of net_message for signed_block
@@ -1097,6 +1222,22 @@ namespace gstio {
       enqueue_buffer( create_send_buffer( sb ), trigger_send, priority::low, no_reason, to_sync_queue);
    }
 
+   bool connection::enqueue_logged_block( uint32_t num, uint32_t end, bool trigger_send ) {
+      if( sync_log_itr == sync_log_blocks.end() || sync_log_itr->block_num != num ) {
+         sync_log_blocks = my_impl->chain_plug->chain().fetch_block_log_range( num, end );
+         sync_log_itr = sync_log_blocks.begin();
+         if( sync_log_blocks.empty() || sync_log_itr->block_num != num ) {
+            sync_log_blocks = block_log_range();
+            sync_log_itr = block_log_range::iterator();
+            return false;
+         }
+      }
+      enqueue_buffer( create_send_buffer( signed_block_which, sync_log_itr->data, sync_log_itr->size ),
+                      trigger_send, priority::low, no_reason, true );
+      ++sync_log_itr;
+      return true;
+   }
+
    void connection::enqueue_buffer( const std::shared_ptr<std::vector<char>>& send_buffer,
                                     bool trigger_send, int priority, go_away_reason close_after_send,
                                     bool to_sync_queue)
@@ -1212,16 +1353,18 @@ namespace gstio {
 
    //-----------------------------------------------------------
 
-    sync_manager::sync_manager( uint32_t req_span )
+    sync_manager::sync_manager( uint32_t req_span, uint32_t window )
       :sync_known_lib_num( 0 )
       ,sync_last_requested_num( 0 )
       ,sync_next_expected_num( 1 )
       ,sync_req_span( req_span )
-      ,source()
+      ,sync_fetch_window( window )
       ,state(in_sync)
    {
       chain_plug = app().find_plugin<chain_plugin>();
       GST_ASSERT( chain_plug, chain::missing_chain_plugin_exception, ""  );
+      GST_ASSERT( sync_req_span > 0, chain::plugin_config_exception, "sync-fetch-span must be greater than 0" );
+      GST_ASSERT( sync_fetch_window > 0, chain::plugin_config_exception, "sync-fetch-window must be greater than 0" );
    }
 
    constexpr auto sync_manager::stage_str(stages s) {
@@ -1253,14 +1396,13 @@ namespace gstio {
 
    void sync_manager::reset_lib_num(const connection_ptr& c) {
       if(state == in_sync) {
-         source.reset();
+         reset_chunks();
       }
       if( c->current() ) {
          if( c->last_handshake_recv.last_irreversible_block_num > sync_known_lib_num) {
             sync_known_lib_num =c->last_handshake_recv.last_irreversible_block_num;
          }
-      } else if( c == source ) {
-         sync_last_requested_num = 0;
+      } else if( release_chunk( c ) ) {
          request_next_chunk();
       }
    }
@@ -1273,86 +1415,106 @@ namespace gstio {
               chain_plug->chain().fork_db_head_block_num() < sync_last_requested_num );
    }
 
-   void sync_manager::request_next_chunk( const connection_ptr& conn ) {
-      uint32_t head_block = chain_plug->chain().fork_db_head_block_num();
+   std::map<uint32_t, sync_manager::sync_chunk>::iterator sync_manager::find_chunk( const connection_ptr& c ) {
+      for( auto i = sync_chunks.begin(); i != sync_chunks.end(); ++i ) {
+         if( i->second.source == c ) {
+            return i;
+         }
+      }
+      return sync_chunks.end();
+   }
 
-      if (head_block < sync_last_requested_num && source && source->current()) {
-         fc_ilog(logger, "ignoring request, head is ${h} last req = ${r} source is ${p}",
-                  ("h",head_block)("r",sync_last_requested_num)("p",source->peer_name()));
-         return;
+   connection_ptr sync_manager::select_source( const sync_chunk& chunk, const connection_ptr& preferred ) {
+      // a peer serves a single sync request at a time, so only idle peers that have the whole chunk qualify
+      auto usable = [&]( const connection_ptr& c ) {
+         return c && c->current() && c->last_handshake_recv.last_irreversible_block_num >= chunk.end &&
+                find_chunk( c ) == sync_chunks.end();
+      };
+      if( usable( preferred ) ) {
+         return preferred;
+      }
+      // peers not yet measured come first so each gets a chance, then the fastest
+      connection_ptr best;
+      for( const auto& c : my_impl->connections ) {
+         if( !usable( c ) ) {
+            continue;
+         }
+         if( !best || (best->sync_rate != 0 && (c->sync_rate == 0 || c->sync_rate > best->sync_rate)) ) {
+            best = c;
+         }
       }
+      return best;
+   }
 
-      /* ----------
-       * next chunk provider selection criteria
-       * a provider is supplied and able to be used, use it.
-       * otherwise select the next available from the list, round-robin style.
-       */
+   void sync_manager::request_chunk( sync_chunk& chunk ) {
+      uint32_t start = chunk.last_received + 1;
+      fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
+              ("n",chunk.source->peer_name())("s",start)("e",chunk.end));
+      chunk.requested_from = start;
+      chunk.requested = fc::time_point::now();
+      chunk.source->request_sync_blocks(start, chunk.end);
+   }
 
-      if (conn && conn->current() ) {
-         source = conn;
+   bool sync_manager::release_chunk( const connection_ptr& c ) {
+      auto i = find_chunk( c );
+      if( i == sync_chunks.end() ) {
+         return false;
       }
-      else {
-         if (my_impl->connections.size() == 1) {
-            if (!source) {
-               source = *my_impl->connections.begin();
-            }
+      i->second.source.reset();
+      return true;
+   }
+
+   void sync_manager::reset_chunks() {
+      sync_chunks.clear();
+      deferred_blocks.clear();
+   }
+
+   void sync_manager::request_next_chunk( const connection_ptr& conn ) {
+      /* ----------
+       * up to sync_fetch_window chunks are outstanding at once, each from a different peer.
+       * chunks left behind by a peer are handed over first, resuming after the last block received.
+       * new chunks are never requested further than the window past sync_next_expected_num,
+       * which bounds the number of blocks held back until the blocks before them are applied.
+       */
+      for( auto& sc : sync_chunks ) {
+         sync_chunk& chunk = sc.second;
+         if( chunk.source ) {
+            continue;
          }
-         else {
-            // init to a linear array search
-            auto cptr = my_impl->connections.begin();
-            auto cend = my_impl->connections.end();
-            // do we remember the previous source?
-            if (source) {
-               //try to find it in the list
-               cptr = my_impl->connections.find(source);
-               cend = cptr;
-               if (cptr == my_impl->connections.end()) {
-                  //not there - must have been closed! cend is now connections.end, so just flatten the ring.
-                  source.reset();
-                  cptr = my_impl->connections.begin();
-               } else {
-                  //was found - advance the start to the next. cend is the old source.
-                  if (++cptr == my_impl->connections.end() && cend != my_impl->connections.end() ) {
-                     cptr = my_impl->connections.begin();
-                  }
-               }
-            }
+         chunk.source = select_source( chunk, conn );
+         if( !chunk.source ) {
+            break;
+         }
+         request_chunk( chunk );
+      }
 
-            //scan the list of peers looking for another able to provide sync blocks.
-            auto cstart_it = cptr;
-            do {
-               //select the first one which is current and break out.
-               if((*cptr)->current()) {
-                  source = *cptr;
-                  break;
-               }
-               if(++cptr == my_impl->connections.end())
-                     cptr = my_impl->connections.begin();
-            } while(cptr != cstart_it);
-            // no need to check the result, either source advanced or the whole list was checked and the old source is reused.
+      uint32_t fetch_limit = sync_next_expected_num + sync_fetch_window * sync_req_span - 1;
+      while( sync_chunks.size() < sync_fetch_window && sync_last_requested_num < sync_known_lib_num ) {
+         sync_chunk chunk;
+         chunk.start = std::max( sync_last_requested_num + 1, sync_next_expected_num );
+         chunk.end = std::min( chunk.start + sync_req_span - 1, sync_known_lib_num );
+         chunk.last_received = chunk.start - 1;
+         if( chunk.end < chunk.start || chunk.end > fetch_limit ) {
+            break;
+         }
+         chunk.source = select_source( chunk, conn );
+         if( !chunk.source ) {
+            break;
          }
+         request_chunk( chunk );
+         sync_last_requested_num = chunk.end;
+         sync_chunks[chunk.start] = chunk;
       }
 
+      bool in_flight = std::any_of( sync_chunks.begin(), sync_chunks.end(),
+                                    []( const auto& sc ) { return sc.second.source != nullptr; } );
       // verify there is an available source
-      if (!source || !source->current() ) {
+      if( !in_flight && (!sync_chunks.empty() || sync_last_requested_num < sync_known_lib_num) ) {
          fc_elog( logger, "Unable to continue syncing at this time");
          sync_known_lib_num = chain_plug->chain().last_irreversible_block_num();
          sync_last_requested_num = 0;
+         reset_chunks();
          set_state(in_sync); // probably not, but we can't do anything else
-         return;
-      }
-
-      if( sync_last_requested_num != sync_known_lib_num ) {
-         uint32_t start = sync_next_expected_num;
-         uint32_t end = start + sync_req_span - 1;
-         if( end > sync_known_lib_num )
-            end = sync_known_lib_num;
-         if( end > 0 && end >= start ) {
-            fc_ilog(logger, "requesting range ${s} to ${e}, from ${n}",
-                    ("n",source->peer_name())("s",start)("e",end));
-            source->request_sync_blocks(start, end);
-            sync_last_requested_num = end;
-         }
       }
    }
 
@@ -1381,6 +1543,7 @@ namespace gstio {
       if (state == in_sync) {
          set_state(lib_catchup);
          sync_next_expected_num = chain_plug->chain().last_irreversible_block_num() + 1;
+         sync_last_requested_num = sync_next_expected_num - 1;
       }
 
       fc_ilog(logger, "Catching up with chain, our last req is ${cc}, theirs is ${t} peer ${p}",
@@ -1393,9 +1556,10 @@ namespace gstio {
       fc_ilog(logger, "reassign_fetch, our last req is ${cc}, next expected is ${ne} peer ${p}",
               ( "cc",sync_last_requested_num)("ne",sync_next_expected_num)("p",c->peer_name()));
 
-      if (c == source) {
+      if( release_chunk( c ) ) {
          c->cancel_sync(reason);
-         sync_last_requested_num = 0;
+         // rank a peer that let its request time out behind every measured peer
+         c->sync_rate = std::numeric_limits<double>::min();
          request_next_chunk();
       }
    }
@@ -1429,7 +1593,10 @@ namespace gstio {
          notice_message note;
          note.known_blocks.mode = none;
          note.known_trx.mode = catch_up;
-         note.known_trx.pending = my_impl->local_txns.size();
+         {
+            std::lock_guard<std::mutex> g( my_impl->local_txns_mtx );
+            note.known_trx.pending = my_impl->local_txns.size();
+         }
          c->enqueue( note );
          return;
       }
@@ -1546,7 +1713,7 @@ namespace gstio {
       if (state != in_sync ) {
          fc_ilog(logger, "block ${bn} not accepted from ${p}",("bn",blk_num)("p",c->peer_name()));
          sync_last_requested_num = 0;
-         source.reset();
+         reset_chunks();
          my_impl->close(c);
          set_state(in_sync);
          send_handshakes();
@@ -1565,7 +1732,7 @@ namespace gstio {
       if (state == head_catchup) {
          fc_dlog(logger, "sync_manager in head_catchup state");
          set_state(in_sync);
-         source.reset();
+         reset_chunks();
 
          block_id_type null_id;
          for (const auto& cp : my_impl->connections) {
@@ -1589,18 +1756,65 @@ namespace gstio {
          if( blk_num == sync_known_lib_num ) {
             fc_dlog( logger, "All caught up with last known last irreversible block resending handshake");
             set_state(in_sync);
+            reset_chunks();
             send_handshakes();
          }
-         else if (blk_num == sync_last_requested_num) {
-            request_next_chunk();
-         }
          else {
-            fc_dlog(logger,"calling sync_wait on connection ${p}",("p",c->peer_name()));
-            c->sync_wait();
+            auto next = deferred_blocks.find( sync_next_expected_num );
+            if( next != deferred_blocks.end() ) {
+               deferred_block db = std::move( next->second );
+               deferred_blocks.erase( next );
+               app().post( priority::medium, [db]() {
+                  my_impl->process_block( db.source, db.block, db.id, db.wire );
+               } );
+            }
+            // the window has moved, top up the outstanding chunks
+            request_next_chunk();
          }
       }
    }
 
+   void sync_manager::sync_block_received(const connection_ptr& c, uint32_t blk_num) {
+      auto i = find_chunk( c );
+      if( i == sync_chunks.end() ) {
+         return;
+      }
+      sync_chunk& chunk = i->second;
+      if( blk_num <= chunk.last_received || blk_num > chunk.end ) {
+         return;
+      }
+      chunk.last_received = blk_num;
+      if( blk_num < chunk.end ) {
+         fc_dlog(logger,"calling sync_wait on connection ${p}",("p",c->peer_name()));
+         c->sync_wait();
+         return;
+      }
+
+      c->cancel_wait();
+      int64_t elapsed_us = std::max<int64_t>( (fc::time_point::now() - chunk.requested).count(), 1 );
+      double rate = (chunk.end - chunk.requested_from + 1) * 1000000.0 / elapsed_us;
+      c->sync_rate = c->sync_rate == 0 ? rate : (c->sync_rate + rate) / 2;
+      fc_dlog(logger, "received range ${s} to ${e} from ${p}, ${r} blocks/sec",
+              ("s",chunk.start)("e",chunk.end)("p",c->peer_name())("r",c->sync_rate));
+      sync_chunks.erase( i );
+      request_next_chunk( c );
+   }
+
+   bool sync_manager::defer_block(const connection_ptr& c, const signed_block_ptr& b, const block_id_type& id,
+                                  const std::shared_ptr<std::vector<char>>& wire) {
+      if( state != lib_catchup ) {
+         return false;
+      }
+      uint32_t blk_num = b->block_num();
+      if( blk_num <= sync_next_expected_num || blk_num > sync_last_requested_num ) {
+         return false;
+      }
+      fc_dlog(logger, "deferring block ${bn} from ${p}, next expected is ${ne}",
+              ("bn",blk_num)("p",c->peer_name())("ne",sync_next_expected_num));
+      deferred_blocks.emplace( blk_num, deferred_block{ c, b, id, wire } );
+      return true;
+   }
+
    //------------------------------------------------------------------------
 
    void dispatch_manager::bcast_block(const block_state_ptr& bs) {
@@ -1611,10 +1825,16 @@ namespace gstio {
       }
       received_blocks.erase(range.first, range.second);
 
+      std::shared_ptr<std::vector<char>> send_buffer;
+      auto wire = received_block_buffers.find(bs->id);
+      if( wire != received_block_buffers.end() ) {
+         send_buffer = std::move( wire->second );
+         received_block_buffers.erase( wire );
+      }
+
       uint32_t bnum = bs->block_num;
       peer_block_state pbstate{bs->id, bnum};
 
-      std::shared_ptr<std::vector<char>> send_buffer;
       for( auto& cp : my_impl->connections ) {
          if( skips.find( cp ) != skips.end() || !cp->current() ) {
             continue;
@@ -1634,8 +1854,12 @@ namespace gstio {
 
    }
 
-   void dispatch_manager::recv_block(const connection_ptr& c, const block_id_type& id, uint32_t bnum) {
+   void dispatch_manager::recv_block(const connection_ptr& c, const block_id_type& id, uint32_t bnum,
+                                     const std::shared_ptr<std::vector<char>>& wire) {
       received_blocks.insert(std::make_pair(id, c));
+      if( wire ) {
+         received_block_buffers.emplace(id, wire);
+      }
       if (c &&
           c->last_req &&
           c->last_req->req_blocks.mode != none &&
@@ -1652,6 +1876,7 @@ namespace gstio {
       fc_dlog( logger, "rejected block ${id}", ("id", id) );
       auto range = received_blocks.equal_range(id);
       received_blocks.erase(range.first, range.second);
+      received_block_buffers.erase(id);
    }
 
    void dispatch_manager::expire_blocks( uint32_t lib_num ) {
@@ -1664,6 +1889,13 @@ namespace gstio {
             ++i;
          }
       }
+      for( auto i = received_block_buffers.begin(); i != received_block_buffers.end(); ) {
+         if( block_header::num_from_id( i->first ) <= lib_num ) {
+            i = received_block_buffers.erase( i );
+         } else {
+            ++i;
+         }
+      }
    }
 
    void dispatch_manager::bcast_transaction(const transaction_metadata_ptr& ptrx) {
@@ -1676,18 +1908,29 @@ namespace gstio {
       }
       received_transactions.erase(range.first, range.second);
 
-      if( my_impl->local_txns.get<by_id>().find( id ) != my_impl->local_txns.end() ) { //found
-         fc_dlog(logger, "found trxid in local_trxs" );
-         return;
-      }
-
       time_point_sec trx_expiration = ptrx->packed_trx->expiration();
       const packed_transaction& trx = *ptrx->packed_trx;
 
-      auto buff = create_send_buffer( trx );
+      std::shared_ptr<std::vector<char>> buff;
+      auto wire = received_trx_buffers.find(id);
+      if( wire != received_trx_buffers.end() ) {
+         buff = std::move( wire->second );
+         received_trx_buffers.erase( wire );
+      }
+      {
+         std::lock_guard<std::mutex> g( my_impl->local_txns_mtx );
+         if( my_impl->local_txns.get<by_id>().find( id ) != my_impl->local_txns.end() ) { //found
+            fc_dlog(logger, "found trxid in local_trxs" );
+            return;
+         }
 
-      node_transaction_state nts = {id, trx_expiration, 0, buff};
-      my_impl->local_txns.insert(std::move(nts));
+         if( !buff ) {
+            buff = create_send_buffer( trx );
+         }
+
+         node_transaction_state nts = {id, trx_expiration, 0, buff};
+         my_impl->local_txns.insert(std::move(nts));
+      }
 
       my_impl->send_transaction_to_all( buff, [&id, &skips, trx_expiration](const connection_ptr& c) -> bool {
          if( skips.find(c) != skips.end() || c->syncing ) {
@@ -1704,8 +1947,12 @@ namespace gstio {
 
    }
 
-   void dispatch_manager::recv_transaction(const connection_ptr& c, const transaction_id_type& id) {
+   void dispatch_manager::recv_transaction(const connection_ptr& c, const transaction_id_type& id,
+                                           const std::shared_ptr<std::vector<char>>& wire) {
       received_transactions.insert(std::make_pair(id, c));
+      if( wire ) {
+         received_trx_buffers.emplace(id, wire);
+      }
       if (c &&
           c->last_req &&
           c->last_req->req_trx.mode != none &&
@@ -1722,6 +1969,7 @@ namespace gstio {
       fc_dlog(logger,"not sending rejected transaction ${tid}",("tid",id));
       auto range = received_transactions.equal_range(id);
       received_transactions.erase(range.first, range.second);
+      received_trx_buffers.erase(id);
    }
 
    void dispatch_manager::recv_notice(const connection_ptr& c, const notice_message& msg, bool generated) {
@@ -1875,26 +2123,31 @@ namespace gstio {
          return;
       }
       c->connecting = true;
-      c->pending_message_buffer.reset();
       c->buffer_queue.clear_out_queue();
       connection_wptr weak_conn = c;
-      boost::asio::async_connect( *c->socket, endpoints,
-         boost::asio::bind_executor( c->strand,
-            [weak_conn, resolver, socket=c->socket, this]( const boost::system::error_code& err, const tcp::endpoint& endpoint ) {
-         app().post( priority::low, [weak_conn, this, err]() {
-            auto c = weak_conn.lock();
-            if( !c ) return;
-            if( !err && c->socket->is_open()) {
-               if( start_session( c )) {
-                  c->send_handshake();
+      c->strand.post( [weak_conn, resolver, endpoints, socket=c->socket, this]() {
+         auto c = weak_conn.lock();
+         if( !c || socket != std::atomic_load( &c->socket ) ) return; // closed again before the connect was issued
+         c->pending_message_buffer.reset();
+         c->outstanding_read_bytes.reset();
+         boost::asio::async_connect( *socket, endpoints,
+            boost::asio::bind_executor( c->strand,
+               [weak_conn, resolver, socket, this]( const boost::system::error_code& err, const tcp::endpoint& endpoint ) {
+            app().post( priority::low, [weak_conn, this, err]() {
+               auto c = weak_conn.lock();
+               if( !c ) return;
+               if( !err && c->socket->is_open()) {
+                  if( start_session( c )) {
+                     c->send_handshake();
+                  }
+               } else {
+                  elog( "connection failed to ${peer}: ${error}", ("peer", c->peer_name())( "error", err.message()) );
+                  c->connecting = false;
+                  my_impl->close( c );
                }
-            } else {
-               elog( "connection failed to ${peer}: ${error}", ("peer", c->peer_name())( "error", err.message()) );
-               c->connecting = false;
-               my_impl->close( c );
-            }
-         } );
-      } ) );
+            } );
+         } ) );
+      } );
    }
 
    bool net_plugin_impl::start_session(const connection_ptr& con) {
@@ -1908,7 +2161,7 @@ namespace gstio {
          return false;
       }
       else {
-         start_read_message( con );
+         con->strand.post( [this, con]() { start_read_message( con ); } );
          ++started_sessions;
          return true;
          // for now, we can just use the application main loop.
@@ -1985,10 +2238,43 @@ namespace gstio {
       });
    }
 
-   void net_plugin_impl::start_read_message(const connection_ptr& conn) {
+   static string peer_endpoint( const socket_ptr& socket ) {
+      boost::system::error_code ec;
+      auto rep = socket->remote_endpoint( ec );
+      return ec ? string( "<unknown>" ) : boost::lexical_cast<std::string>( rep );
+   }
+
+   template<typename Handler>
+   void net_plugin_impl::post_to_main(const connection_ptr& conn, const socket_ptr& socket, Handler handler) {
+      connection_wptr weak_conn = conn;
+      app().post( priority::medium, [this, weak_conn, socket, handler{std::move(handler)}]() {
+         auto conn = weak_conn.lock();
+         if( !conn || conn->socket != socket ) {
+            return; // closed or reconnected since the message was read
+         }
+         try {
+            handler( conn );
+         } catch( const fc::exception& e ) {
+            edump( (e.to_detail_string()) );
+            close( conn );
+         } catch( const std::exception& e ) {
+            fc_elog( logger, "Exception in handling message from ${p} ${s}", ("p", conn->peer_name())("s", e.what()) );
+            close( conn );
+         }
+      } );
+   }
 
+   void net_plugin_impl::close_from_strand(const connection_ptr& conn, const socket_ptr& socket, const string& reason) {
+      post_to_main( conn, socket, [this, reason]( const connection_ptr& c ) {
+         fc_elog( logger, "${r}, closing connection to ${p}", ("r", reason)("p", c->peer_name()) );
+         close( c );
+      } );
+   }
+
+   void net_plugin_impl::start_read_message(const connection_ptr& conn) {
+      socket_ptr socket = std::atomic_load( &conn->socket );
       try {
-         if(!conn->socket) {
+         if( !socket->is_open() ) {
             return;
          }
          connection_wptr weak_conn = conn;
@@ -1999,7 +2285,7 @@ namespace gstio {
             const size_t max_socket_read_watermark = 4096;
             std::size_t socket_read_watermark = std::min<std::size_t>(minimum_read, max_socket_read_watermark);
             boost::asio::socket_base::receive_low_watermark read_watermark_opt(socket_read_watermark);
-            conn->socket->set_option(read_watermark_opt);
+            socket->set_option(read_watermark_opt);
          }
 
          auto completion_handler = [minimum_read](boost::system::error_code ec, std::size_t bytes_transferred) -> std::size_t {
@@ -2010,135 +2296,132 @@ namespace gstio {
             }
          };
 
-         if( conn->buffer_queue.write_queue_size() > def_max_write_queue_size ||
-             conn->trx_in_progress_size > def_max_trx_in_progress_size )
+         const uint32_t write_queue_size = conn->buffer_queue.write_queue_size();
+         const uint32_t trx_in_progress_size = conn->trx_in_progress_size;
+         if( write_queue_size > def_max_write_queue_size ||
+             trx_in_progress_size > def_max_trx_in_progress_size )
          {
             // too much queued up, reschedule
-            if( conn->buffer_queue.write_queue_size() > def_max_write_queue_size ) {
-               peer_wlog( conn, "write_queue full ${s} bytes", ("s", conn->buffer_queue.write_queue_size()) );
+            if( write_queue_size > def_max_write_queue_size ) {
+               fc_wlog( logger, "write_queue full ${s} bytes for ${p}", ("s", write_queue_size)("p", peer_endpoint( socket )) );
             } else {
-               peer_wlog( conn, "max trx in progress ${s} bytes", ("s", conn->trx_in_progress_size) );
+               fc_wlog( logger, "max trx in progress ${s} bytes for ${p}", ("s", trx_in_progress_size)("p", peer_endpoint( socket )) );
             }
-            if( conn->buffer_queue.write_queue_size() > 2*def_max_write_queue_size ||
-                conn->trx_in_progress_size > 2*def_max_trx_in_progress_size )
+            if( write_queue_size > 2*def_max_write_queue_size ||
+                trx_in_progress_size > 2*def_max_trx_in_progress_size )
             {
-               fc_elog( logger, "queues over full, giving up on connection ${p}", ("p", conn->peer_name()) );
-               fc_elog( logger, "  write_queue ${s} bytes", ("s", conn->buffer_queue.write_queue_size()) );
-               fc_elog( logger, "  max trx in progress ${s} bytes", ("s", conn->trx_in_progress_size) );
-               my_impl->close( conn );
+               close_from_strand( conn, socket, "queues over full (write_queue " + std::to_string( write_queue_size ) +
+                                                " bytes, trx in progress " + std::to_string( trx_in_progress_size ) + " bytes)" );
                return;
             }
             if( !conn->read_delay_timer ) return;
             conn->read_delay_timer->expires_from_now( def_read_delay_for_full_write_queue );
-            conn->read_delay_timer->async_wait( [this, weak_conn]( boost::system::error_code ec ) {
-               app().post( priority::low, [this, weak_conn, ec]() {
-                  auto conn = weak_conn.lock();
-                  if( !conn ) return;
-                  if( !ec ) {
-                     start_read_message( conn );
-                  } else {
-                     fc_elog( logger, "Read delay timer error: ${e}, closing connection: ${p}",
-                              ("e", ec.message())("p",conn->peer_name()) );
-                     close( conn );
-                  }
-               } );
-            } );
+            conn->read_delay_timer->async_wait( boost::asio::bind_executor( conn->strand,
+                  [this, weak_conn, socket]( boost::system::error_code ec ) {
+               auto conn = weak_conn.lock();
+               if( !conn || socket != std::atomic_load( &conn->socket ) ) return;
+               if( !ec ) {
+                  start_read_message( conn );
+               } else {
+                  close_from_strand( conn, socket, "Read delay timer error: " + ec.message() );
+               }
+            } ) );
             return;
          }
 
-         boost::asio::async_read(*conn->socket,
+         boost::asio::async_read(*socket,
             conn->pending_message_buffer.get_buffer_sequence_for_boost_async_read(), completion_handler,
             boost::asio::bind_executor( conn->strand,
-              [this,weak_conn,socket=conn->socket]( boost::system::error_code ec, std::size_t bytes_transferred ) {
-            app().post( priority::medium, [this,weak_conn, socket, ec, bytes_transferred]() {
-               auto conn = weak_conn.lock();
-               if (!conn || !conn->socket || !conn->socket->is_open() || !socket->is_open()) {
-                  return;
-               }
+              [this,weak_conn,socket]( boost::system::error_code ec, std::size_t bytes_transferred ) {
+            auto conn = weak_conn.lock();
+            if (!conn || socket != std::atomic_load( &conn->socket ) || !socket->is_open()) {
+               return;
+            }
 
-               conn->outstanding_read_bytes.reset();
+            conn->outstanding_read_bytes.reset();
 
-               try {
-                  if( !ec ) {
-                     if (bytes_transferred > conn->pending_message_buffer.bytes_to_write()) {
-                        fc_elog( logger,"async_read_some callback: bytes_transfered = ${bt}, buffer.bytes_to_write = ${btw}",
-                                 ("bt",bytes_transferred)("btw",conn->pending_message_buffer.bytes_to_write()) );
-                     }
-                     GST_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
-                     conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
-                     while (conn->pending_message_buffer.bytes_to_read() > 0) {
-                        uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
+            try {
+               if( !ec ) {
+                  if (bytes_transferred > conn->pending_message_buffer.bytes_to_write()) {
+                     fc_elog( logger,"async_read_some callback: bytes_transfered = ${bt}, buffer.bytes_to_write = ${btw}",
+                              ("bt",bytes_transferred)("btw",conn->pending_message_buffer.bytes_to_write()) );
+                  }
+                  GST_ASSERT(bytes_transferred <= conn->pending_message_buffer.bytes_to_write(), plugin_exception, "");
+                  conn->pending_message_buffer.advance_write_ptr(bytes_transferred);
+                  while (conn->pending_message_buffer.bytes_to_read() > 0) {
+                     uint32_t bytes_in_buffer = conn->pending_message_buffer.bytes_to_read();
+
+                     if (bytes_in_buffer < message_header_size) {
+                        conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
+                        break;
+                     } else {
+                        uint32_t message_length;
+                        auto index = conn->pending_message_buffer.read_index();
+                        conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
+                        if(message_length > def_send_buffer_size*2 || message_length == 0) {
+                           fc_elog( logger,"incoming message length unexpected (${i}), from ${p}",
+                                    ("i", message_length)("p", peer_endpoint( socket )) );
+                           close_from_strand( conn, socket, "incoming message length unexpected" );
+                           return;
+                        }
 
-                        if (bytes_in_buffer < message_header_size) {
-                           conn->outstanding_read_bytes.emplace(message_header_size - bytes_in_buffer);
-                           break;
-                        } else {
-                           uint32_t message_length;
-                           auto index = conn->pending_message_buffer.read_index();
-                           conn->pending_message_buffer.peek(&message_length, sizeof(message_length), index);
-                           if(message_length > def_send_buffer_size*2 || message_length == 0) {
-                              boost::system::error_code ec;
-                              fc_elog( logger,"incoming message length unexpected (${i}), from ${p}",
-                                       ("i", message_length)("p",boost::lexical_cast<std::string>(conn->socket->remote_endpoint(ec))) );
-                              close(conn);
+                        auto total_message_bytes = message_length + message_header_size;
+
+                        if (bytes_in_buffer >= total_message_bytes) {
+                           conn->pending_message_buffer.advance_read_ptr(message_header_size);
+                           if (!process_next_message(conn, socket, message_length)) {
                               return;
                            }
-
-                           auto total_message_bytes = message_length + message_header_size;
-
-                           if (bytes_in_buffer >= total_message_bytes) {
-                              conn->pending_message_buffer.advance_read_ptr(message_header_size);
-                              if (!process_next_message(conn, message_length)) {
-                                 return;
-                              }
-                           } else {
-                              auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
-                              auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
-                              if (outstanding_message_bytes > available_buffer_bytes) {
-                                 conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
-                              }
-
-                              conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
-                              break;
+                        } else {
+                           auto outstanding_message_bytes = total_message_bytes - bytes_in_buffer;
+                           auto available_buffer_bytes = conn->pending_message_buffer.bytes_to_write();
+                           if (outstanding_message_bytes > available_buffer_bytes) {
+                              conn->pending_message_buffer.add_space( outstanding_message_bytes - available_buffer_bytes );
                            }
+
+                           conn->outstanding_read_bytes.emplace(outstanding_message_bytes);
+                           break;
                         }
                      }
-                     start_read_message(conn);
+                  }
+                  start_read_message(conn);
+               } else {
+                  if (ec.value() != boost::asio::error::eof) {
+                     close_from_strand( conn, socket, "Error reading message: " + ec.message() );
                   } else {
-                     auto pname = conn->peer_name();
-                     if (ec.value() != boost::asio::error::eof) {
-                        fc_elog( logger, "Error reading message from ${p}: ${m}",("p",pname)( "m", ec.message() ) );
-                     } else {
-                        fc_ilog( logger, "Peer ${p} closed connection",("p",pname) );
-                     }
-                     close( conn );
+                     post_to_main( conn, socket, [this]( const connection_ptr& c ) {
+                        fc_ilog( logger, "Peer ${p} closed connection",("p",c->peer_name()) );
+                        close( c );
+                     } );
                   }
                }
-               catch(const std::exception &ex) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  fc_elog( logger, "Exception in handling read data from ${p} ${s}",("p",pname)("s",ex.what()) );
-                  close( conn );
-               }
-               catch(const fc::exception &ex) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  fc_elog( logger, "Exception in handling read data ${s}", ("p",pname)("s",ex.to_string()) );
-                  close( conn );
-               }
-               catch (...) {
-                  string pname = conn ? conn->peer_name() : "no connection name";
-                  fc_elog( logger, "Undefined exception hanlding the read data from connection ${p}",( "p",pname) );
-                  close( conn );
-               }
-            });
+            }
+            catch(const std::exception &ex) {
+               close_from_strand( conn, socket, string( "Exception in handling read data: " ) + ex.what() );
+            }
+            catch(const fc::exception &ex) {
+               close_from_strand( conn, socket, "Exception in handling read data: " + ex.to_string() );
+            }
+            catch (...) {
+               close_from_strand( conn, socket, "Undefined exception handling the read data" );
+            }
          }));
       } catch (...) {
-         string pname = conn ? conn->peer_name() : "no connection name";
-         fc_elog( logger, "Undefined exception handling reading ${p}",("p",pname) );
-         close( conn );
+         close_from_strand( conn, socket, "Undefined exception handling reading" );
       }
    }
 
-   bool net_plugin_impl::process_next_message(const connection_ptr& conn, uint32_t message_length) {
+   // moves the next message out of pending_message_buffer, framed as it came in so it can be relayed without repacking
+   static std::shared_ptr<std::vector<char>> take_message( const connection_ptr& conn, uint32_t message_length ) {
+      auto wire = std::make_shared<std::vector<char>>( message_header_size + message_length );
+      memcpy( wire->data(), &message_length, message_header_size );
+      auto index = conn->pending_message_buffer.read_index();
+      conn->pending_message_buffer.peek( wire->data() + message_header_size, message_length, index );
+      conn->pending_message_buffer.advance_read_ptr( message_length );
+      return wire;
+   }
+
+   bool net_plugin_impl::process_next_message(const connection_ptr& conn, const socket_ptr& socket, uint32_t message_length) {
       try {
          // if next message is a block we already have, exit early
          auto peek_ds = conn->pending_message_buffer.create_peek_datastream();
@@ -2148,30 +2431,65 @@ namespace gstio {
             block_header bh;
             fc::raw::unpack( peek_ds, bh );
 
-            controller& cc = chain_plug->chain();
             block_id_type blk_id = bh.id();
             uint32_t blk_num = bh.block_num();
-            if( cc.fetch_block_by_id( blk_id ) ) {
-               sync_master->recv_block( conn, blk_id, blk_num );
+            bool known = false;
+            {
+               std::lock_guard<std::mutex> g( known_blocks_mtx );
+               known = known_blocks.find( blk_id ) != known_blocks.end();
+            }
+            if( known ) {
                conn->pending_message_buffer.advance_read_ptr( message_length );
+               post_to_main( conn, socket, [this, blk_id, blk_num]( const connection_ptr& c ) {
+                  sync_master->sync_block_received( c, blk_num );
+                  sync_master->recv_block( c, blk_id, blk_num );
+               } );
                return true;
             }
+
+            auto wire = take_message( conn, message_length );
+            fc::datastream<const char*> ds( wire->data() + message_header_size, message_length );
+            auto block = std::make_shared<signed_block>();
+            if( !unpack_relayable( ds, *block ) )
+               wire.reset(); // repacked when relayed
+            post_to_main( conn, socket, [this, block, blk_id, wire]( const connection_ptr& c ) {
+               handle_message( c, block, blk_id, wire );
+            } );
+            return true;
          }
 
-         auto ds = conn->pending_message_buffer.create_datastream();
-         net_message msg;
-         fc::raw::unpack( ds, msg );
-         msg_handler m( *this, conn );
-         if( msg.contains<signed_block>() ) {
-            m( std::move( msg.get<signed_block>() ) );
-         } else if( msg.contains<packed_transaction>() ) {
-            m( std::move( msg.get<packed_transaction>() ) );
-         } else {
-            msg.visit( m );
+         if( which == packed_transaction_which ) {
+            auto wire = take_message( conn, message_length );
+            fc::datastream<const char*> ds( wire->data() + message_header_size, message_length );
+            auto trx = std::make_shared<packed_transaction>();
+            if( !unpack_relayable( ds, *trx ) )
+               wire.reset(); // repacked when relayed
+
+            auto ptrx = std::make_shared<transaction_metadata>( trx );
+            bool known = false;
+            {
+               std::lock_guard<std::mutex> g( local_txns_mtx );
+               known = local_txns.get<by_id>().find( ptrx->id ) != local_txns.end();
+            }
+            if( known ) {
+               fc_dlog( logger, "got a duplicate transaction - dropping" );
+               return true;
+            }
+            post_to_main( conn, socket, [this, ptrx, wire]( const connection_ptr& c ) {
+               handle_message( c, ptrx, wire );
+            } );
+            return true;
          }
+
+         auto ds = conn->pending_message_buffer.create_datastream();
+         auto msg = std::make_shared<net_message>();
+         fc::raw::unpack( ds, *msg );
+         post_to_main( conn, socket, [this, msg]( const connection_ptr& c ) {
+            msg_handler m( *this, c );
+            msg->visit( m );
+         } );
       } catch( const fc::exception& e ) {
-         edump( (e.to_detail_string()) );
-         close( conn );
+         close_from_strand( conn, socket, "Unable to unpack message: " + e.to_detail_string() );
          return false;
       }
       return true;
@@ -2490,7 +2808,8 @@ namespace gstio {
              trx->get_signatures().size() * sizeof(signature_type);
    }
 
-   void net_plugin_impl::handle_message(const connection_ptr& c, const packed_transaction_ptr& trx) {
+   void net_plugin_impl::handle_message(const connection_ptr& c, const transaction_metadata_ptr& ptrx,
+                                        const std::shared_ptr<std::vector<char>>& wire) {
       fc_dlog(logger, "got a packed transaction, cancel wait");
       peer_ilog(c, "received packed_transaction");
       controller& cc = my_impl->chain_plug->chain();
@@ -2503,14 +2822,16 @@ namespace gstio {
          return;
       }
 
-      auto ptrx = std::make_shared<transaction_metadata>( trx );
       const auto& tid = ptrx->id;
 
-      if(local_txns.get<by_id>().find(tid) != local_txns.end()) {
-         fc_dlog(logger, "got a duplicate transaction - dropping");
-         return;
+      {
+         std::lock_guard<std::mutex> g( local_txns_mtx );
+         if(local_txns.get<by_id>().find(tid) != local_txns.end()) {
+            fc_dlog(logger, "got a duplicate transaction - dropping");
+            return;
+         }
       }
-      dispatcher->recv_transaction(c, tid);
+      dispatcher->recv_transaction(c, tid, wire);
       c->trx_in_progress_size += calc_trx_size( ptrx->packed_trx );
       chain_plug->accept_transaction(ptrx, [c, this, ptrx](const static_variant<fc::exception_ptr, transaction_trace_ptr>& result) {
          c->trx_in_progress_size -= calc_trx_size( ptrx->packed_trx );
@@ -2531,12 +2852,21 @@ namespace gstio {
       });
    }
 
-   void net_plugin_impl::handle_message(const connection_ptr& c, const signed_block_ptr& msg) {
-      controller &cc = chain_plug->chain();
-      block_id_type blk_id = msg->id();
-      uint32_t blk_num = msg->block_num();
+   void net_plugin_impl::handle_message(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id,
+                                        const std::shared_ptr<std::vector<char>>& wire) {
       fc_dlog(logger, "canceling wait on ${p}", ("p",c->peer_name()));
       c->cancel_wait();
+      sync_master->sync_block_received(c, msg->block_num());
+      if( sync_master->defer_block(c, msg, blk_id, wire) ) {
+         return;
+      }
+      process_block(c, msg, blk_id, wire);
+   }
+
+   void net_plugin_impl::process_block(const connection_ptr& c, const signed_block_ptr& msg, const block_id_type& blk_id,
+                                       const std::shared_ptr<std::vector<char>>& wire) {
+      controller &cc = chain_plug->chain();
+      uint32_t blk_num = msg->block_num();
 
       try {
          if( cc.fetch_block_by_id(blk_id)) {
@@ -2548,7 +2878,7 @@ namespace gstio {
          fc_elog( logger,"Caught an unknown exception trying to recall blockID" );
       }
 
-      dispatcher->recv_block(c, blk_id, blk_num);
+      dispatcher->recv_block(c, blk_id, blk_num, wire);
       fc::microseconds age( fc::time_point::now() - msg->timestamp);
       peer_ilog(c, "received signed_block : #${n} block age in secs = ${age}",
               ("n",blk_num)("age",age.to_seconds()));
@@ -2579,9 +2909,12 @@ namespace gstio {
       if( reason == no_reason ) {
          for (const auto &recpt : msg->transactions) {
             auto id = (recpt.trx.which() == 0) ? recpt.trx.get<transaction_id_type>() : recpt.trx.get<packed_transaction>().id();
-            auto ltx = local_txns.get<by_id>().find(id);
-            if( ltx != local_txns.end()) {
-               local_txns.modify( ltx, ubn );
+            {
+               std::lock_guard<std::mutex> g( local_txns_mtx );
+               auto ltx = local_txns.get<by_id>().find(id);
+               if( ltx != local_txns.end()) {
+                  local_txns.modify( ltx, ubn );
+               }
             }
             auto ctx = c->trx_state.get<by_id>().find(id);
             if( ctx != c->trx_state.end()) {
@@ -2654,13 +2987,23 @@ namespace gstio {
       start_txn_timer();
 
       auto now = time_point::now();
-      auto start_size = local_txns.size();
-
-      expire_local_txns();
+      size_t start_size = 0, end_size = 0;
+      {
+         std::lock_guard<std::mutex> g( local_txns_mtx );
+         start_size = local_txns.size();
+         expire_local_txns();
+         end_size = local_txns.size();
+      }
 
       controller& cc = chain_plug->chain();
       uint32_t lib = cc.last_irreversible_block_num();
       dispatcher->expire_blocks( lib );
+      {
+         // blocks at or below lib are still found by fetch_block_by_id on the main thread
+         std::lock_guard<std::mutex> g( known_blocks_mtx );
+         auto& stale_known = known_blocks.get<by_block_num>();
+         stale_known.erase( stale_known.begin(), stale_known.upper_bound( lib ) );
+      }
       for ( auto &c : connections ) {
          auto &stale_txn = c->trx_state.get<by_block_num>();
          stale_txn.erase( stale_txn.lower_bound(1), stale_txn.upper_bound(lib) );
@@ -2670,9 +3013,10 @@ namespace gstio {
          stale_blk.erase( stale_blk.lower_bound(1), stale_blk.upper_bound(lib) );
       }
       fc_dlog(logger, "expire_txns ${n}us size ${s} removed ${r}",
-            ("n", time_point::now() - now)("s", start_size)("r", start_size - local_txns.size()) );
+            ("n", time_point::now() - now)("s", start_size)("r", start_size - end_size) );
    }
 
+   // local_txns_mtx must be held
    void net_plugin_impl::expire_local_txns() {
       auto& old = local_txns.get<by_expiry>();
       auto ex_lo = old.lower_bound( fc::time_point_sec(0) );
@@ -2724,6 +3068,10 @@ namespace gstio {
 
    void net_plugin_impl::accepted_block(const block_state_ptr& block) {
       fc_dlog(logger,"signaled, id = ${id}",("id", block->id));
+      {
+         std::lock_guard<std::mutex> g( known_blocks_mtx );
+         known_blocks.insert( known_block{block->id, block->block_num} );
+      }
       dispatcher->bcast_block(block);
    }
 
@@ -2888,8 +3236,10 @@ namespace gstio {
          ( "network-version-match", bpo::value<bool>()->default_value(false),
            "DEPRECATED, needless restriction. True to require exact match of peer network version.")
          ( "net-threads", bpo::value<uint16_t>()->default_value(my->thread_pool_size),
-           "Number of worker threads in net_plugin thread pool" )
+           "Number of worker threads in net_plugin thread pool, used for socket I/O and decoding of peer messages" )
          ( "sync-fetch-span", bpo::value<uint32_t>()->default_value(def_sync_fetch_span), "number of blocks to retrieve in a chunk from any individual peer during synchronization")
+         ( "sync-fetch-window", bpo::value<uint32_t>()->default_value(def_sync_fetch_window),
+           "number of chunks requested at the same time, each from a different peer, during synchronization")
          ( "use-socket-read-watermark", bpo::value<bool>()->default_value(false), "Enable expirimental socket read watermark optimization")
          ( "peer-log-format", bpo::value<string>()->default_value( "[\"${_name}\" ${_ip}:${_port}]" ),
            "The string used to format peers when logging messages about them.  Variables are escaped with ${<variable name>}.\n"
@@ -2918,7 +3268,8 @@ namespace gstio {
          if( my->network_version_match )
             wlog( "network-version-match is DEPRECATED as it is a needless restriction" );
 
-         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>()));
+         my->sync_master.reset( new sync_manager( options.at( "sync-fetch-span" ).as<uint32_t>(),
+                                                  options.at( "sync-fetch-window" ).as<uint32_t>()));
          my->dispatcher.reset( new dispatch_manager );
 
          my->connector_period = std::chrono::seconds( options.at( "connection-cleanup-period" ).as<int>());
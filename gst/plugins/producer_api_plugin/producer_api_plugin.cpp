@@ -74,6 +74,8 @@ void producer_api_plugin::plugin_startup() {
             INVOKE_R_V(producer, paused), 201),
        CALL(producer, producer, get_runtime_options,
             INVOKE_R_V(producer, get_runtime_options), 201),
+       CALL(producer, producer, get_incoming_queue_stats,
+            INVOKE_R_V(producer, get_incoming_queue_stats), 201),
        CALL(producer, producer, update_runtime_options,
             INVOKE_V_R(producer, update_runtime_options, producer_plugin::runtime_options), 201),
        CALL(producer, producer, add_greylist_accounts,
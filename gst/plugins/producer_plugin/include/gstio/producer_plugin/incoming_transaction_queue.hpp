@@ -0,0 +1,129 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+#pragma once
+
+#include <gstio/chain/trace.hpp>
+#include <gstio/chain/transaction_metadata.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
+
+#include <deque>
+#include <unordered_set>
+#include <vector>
+
+namespace gstio {
+
+/**
+ * Incoming transactions waiting to be applied, bounded in memory and queued per account.
+ * Transactions are taken round-robin across the accounts that first authorized them, so a single
+ * account flooding the node only delays its own transactions. Once max_bytes is exceeded the newest
+ * transactions of the account holding the most memory are dropped to make room.
+ */
+class incoming_transaction_queue {
+   public:
+      /// same as plugin_interface::next_function<transaction_trace_ptr>, without depending on appbase
+      using next_function = std::function<void(const fc::static_variant<fc::exception_ptr, chain::transaction_trace_ptr>&)>;
+
+      struct entry {
+         chain::transaction_metadata_ptr  trx;
+         bool                             persist_until_expired = false;
+         next_function                    next;
+         uint64_t                         size = 0;
+      };
+
+      void set_max_bytes( uint64_t max ) { max_bytes = max; }
+
+      size_t   size()const { return ids.size(); }
+      bool     empty()const { return ids.empty(); }
+      uint64_t bytes_size()const { return bytes; }
+      size_t   accounts_size()const { return queues.size(); }
+      bool     contains( const chain::transaction_id_type& id )const { return ids.find( id ) != ids.end(); }
+
+      /// @return the entries dropped to stay within max_bytes, which may include e itself
+      std::vector<entry> push( entry e ) {
+         const chain::account_name account = e.trx->packed_trx->get_transaction().first_authorizor();
+         e.size = entry_size( e );
+         auto& by_acct = queues.get<by_account>();
+         auto q = by_acct.find( account );
+         if( q == by_acct.end() ) {
+            // new accounts join the rotation at its end
+            q = by_acct.insert( account_queue{ account } ).first;
+         }
+         ids.insert( e.trx->id );
+         bytes += e.size;
+         by_acct.modify( q, [&]( account_queue& aq ) { aq.bytes += e.size; } );
+         q->entries.emplace_back( std::move( e ) );
+
+         std::vector<entry> dropped;
+         while( bytes > max_bytes && !queues.empty() ) {
+            auto largest = std::prev( queues.get<by_bytes>().end() );
+            dropped.emplace_back( std::move( largest->entries.back() ) );
+            largest->entries.pop_back();
+            remove( queues.project<by_rotation>( largest ), dropped.back() );
+         }
+         return dropped;
+      }
+
+      /// @pre !empty()
+      entry pop() {
+         auto& rotation = queues.get<by_rotation>();
+         auto q = rotation.begin();
+         entry e = std::move( q->entries.front() );
+         q->entries.pop_front();
+         rotation.relocate( rotation.end(), q );
+         remove( q, e );
+         return e;
+      }
+
+   private:
+      struct account_queue {
+         chain::account_name        account;
+         uint64_t                   bytes = 0;
+         mutable std::deque<entry>  entries;   ///< not part of any key
+      };
+
+      struct by_rotation;
+      struct by_account;
+      struct by_bytes;
+      using queues_type = boost::multi_index_container<
+         account_queue,
+         boost::multi_index::indexed_by<
+            boost::multi_index::sequenced< boost::multi_index::tag<by_rotation> >,   ///< next to be served first
+            boost::multi_index::hashed_unique< boost::multi_index::tag<by_account>,
+               BOOST_MULTI_INDEX_MEMBER(account_queue, chain::account_name, account), std::hash<chain::account_name> >,
+            boost::multi_index::ordered_non_unique< boost::multi_index::tag<by_bytes>,
+               BOOST_MULTI_INDEX_MEMBER(account_queue, uint64_t, bytes) >
+         >
+      >;
+
+      /// packed and unpacked copies of the transaction plus the bookkeeping around them
+      static uint64_t entry_size( const entry& e ) {
+         const auto& ptrx = *e.trx->packed_trx;
+         return sizeof(entry) + sizeof(chain::transaction_metadata) + sizeof(chain::packed_transaction) +
+                2 * (uint64_t(ptrx.get_unprunable_size()) + ptrx.get_prunable_size());
+      }
+
+      /// accounts for e having been taken out of q, accounts without transactions leave the rotation
+      void remove( typename queues_type::iterator q, const entry& e ) {
+         ids.erase( ids.find( e.trx->id ) );
+         bytes -= e.size;
+         if( q->entries.empty() ) {
+            queues.erase( q );
+         } else {
+            queues.modify( q, [&]( account_queue& aq ) { aq.bytes -= e.size; } );
+         }
+      }
+
+      queues_type                                         queues;    ///< accounts with queued transactions
+      std::unordered_multiset<chain::transaction_id_type> ids;
+      uint64_t                                            bytes = 0;
+      uint64_t                                            max_bytes = 0;
+};
+
+} // namespace gstio
@@ -37,6 +37,15 @@ public:
       fc::optional< flat_set<public_key_type> > key_blacklist;
    };
 
+   struct incoming_queue_stats {
+      uint32_t queued = 0;
+      uint64_t queued_bytes = 0;
+      uint32_t accounts = 0;
+      uint64_t dropped_queue_full = 0;
+      uint64_t dropped_expired = 0;
+      uint64_t dropped_duplicate = 0;
+   };
+
    struct greylist_params {
       std::vector<account_name> accounts;
    };
@@ -73,6 +82,8 @@ public:
    void update_runtime_options(const runtime_options& options);
    runtime_options get_runtime_options() const;
 
+   incoming_queue_stats get_incoming_queue_stats() const;
+
    void add_greylist_accounts(const greylist_params& params);
    void remove_greylist_accounts(const greylist_params& params);
    greylist_params get_greylist() const;
@@ -91,6 +102,7 @@ private:
 } //gstio
 
 FC_REFLECT(gstio::producer_plugin::runtime_options, (max_transaction_time)(max_irreversible_block_age)(produce_time_offset_us)(last_block_time_offset_us)(max_scheduled_transaction_time_per_block_ms)(subjective_cpu_leeway_us)(incoming_defer_ratio));
+FC_REFLECT(gstio::producer_plugin::incoming_queue_stats, (queued)(queued_bytes)(accounts)(dropped_queue_full)(dropped_expired)(dropped_duplicate));
 FC_REFLECT(gstio::producer_plugin::greylist_params, (accounts));
 FC_REFLECT(gstio::producer_plugin::whitelist_blacklist, (actor_whitelist)(actor_blacklist)(contract_whitelist)(contract_blacklist)(action_blacklist)(key_blacklist) )
 FC_REFLECT(gstio::producer_plugin::integrity_hash_information, (head_block_id)(integrity_hash))
@@ -3,6 +3,7 @@
  *  @copyright defined in gst/LICENSE
  */
 #include <gstio/producer_plugin/producer_plugin.hpp>
+#include <gstio/producer_plugin/incoming_transaction_queue.hpp>
 #include <gstio/chain/producer_object.hpp>
 #include <gstio/chain/plugin_interface.hpp>
 #include <gstio/chain/global_property_object.hpp>
@@ -28,6 +29,7 @@
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/signals2/connection.hpp>
 
+
 namespace bmi = boost::multi_index;
 using bmi::indexed_by;
 using bmi::ordered_non_unique;
@@ -369,10 +371,42 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
          }
       }
 
-      std::deque<std::tuple<transaction_metadata_ptr, bool, next_function<transaction_trace_ptr>>> _pending_incoming_transactions;
+      incoming_transaction_queue                    _pending_incoming_transactions;
+      producer_plugin::incoming_queue_stats         _incoming_queue_stats;
+
+      void drop_incoming_transaction(const transaction_metadata_ptr& trx, const next_function<transaction_trace_ptr>& next, const fc::exception_ptr& reason) {
+         fc_dlog(_trx_trace_log, "[TRX_TRACE] Incoming transaction queue is DROPPING tx: ${txid} : ${why}",
+                 ("txid", trx->id)("why", reason->what()));
+         next(reason);
+         _transaction_ack_channel.publish(priority::low, std::pair<fc::exception_ptr, transaction_metadata_ptr>(reason, trx));
+      }
+
+      void queue_incoming_transaction(const transaction_metadata_ptr& trx, bool persist_until_expired, const next_function<transaction_trace_ptr>& next) {
+         auto dropped = _pending_incoming_transactions.push( {trx, persist_until_expired, next} );
+         for( const auto& e : dropped ) {
+            ++_incoming_queue_stats.dropped_queue_full;
+            drop_incoming_transaction(e.trx, e.next, std::static_pointer_cast<fc::exception>(std::make_shared<too_many_tx_at_once>(
+                  FC_LOG_MESSAGE(error, "incoming transaction queue full, dropped transaction ${id}", ("id", e.trx->id)) )));
+         }
+      }
 
       void on_incoming_transaction_async(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
          chain::controller& chain = chain_plug->chain();
+         // drop what can never be applied before spending any time on signature recovery
+         const auto& id = trx->id;
+         if( fc::time_point(trx->packed_trx->expiration()) < fc::time_point::now() ) {
+            ++_incoming_queue_stats.dropped_expired;
+            drop_incoming_transaction(trx, next, std::static_pointer_cast<fc::exception>(std::make_shared<expired_tx_exception>(
+                  FC_LOG_MESSAGE(error, "expired transaction ${id}", ("id", id)) )));
+            return;
+         }
+         if( _pending_incoming_transactions.contains(id) || chain.is_known_unexpired_transaction(id) ) {
+            ++_incoming_queue_stats.dropped_duplicate;
+            drop_incoming_transaction(trx, next, std::static_pointer_cast<fc::exception>(std::make_shared<tx_duplicate>(
+                  FC_LOG_MESSAGE(error, "duplicate transaction ${id}", ("id", id)) )));
+            return;
+         }
+
          const auto& cfg = chain.get_global_properties().configuration;
          signing_keys_future_type future = transaction_metadata::start_recover_keys( trx, *_thread_pool,
                chain.get_chain_id(), fc::microseconds( cfg.max_transaction_cpu_usage ) );
@@ -388,7 +422,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
       void process_incoming_transaction_async(const transaction_metadata_ptr& trx, bool persist_until_expired, next_function<transaction_trace_ptr> next) {
          chain::controller& chain = chain_plug->chain();
          if (!chain.pending_block_state()) {
-            _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+            queue_incoming_transaction(trx, persist_until_expired, next);
             return;
          }
 
@@ -425,11 +459,13 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
 
          const auto& id = trx->id;
          if( fc::time_point(trx->packed_trx->expiration()) < block_time ) {
+            ++_incoming_queue_stats.dropped_expired;
             send_response(std::static_pointer_cast<fc::exception>(std::make_shared<expired_tx_exception>(FC_LOG_MESSAGE(error, "expired transaction ${id}", ("id", id)) )));
             return;
          }
 
          if( chain.is_known_unexpired_transaction(id) ) {
+            ++_incoming_queue_stats.dropped_duplicate;
             send_response(std::static_pointer_cast<fc::exception>(std::make_shared<tx_duplicate>(FC_LOG_MESSAGE(error, "duplicate transaction ${id}", ("id", id)) )));
             return;
          }
@@ -446,7 +482,7 @@ class producer_plugin_impl : public std::enable_shared_from_this<producer_plugin
             auto trace = chain.push_transaction(trx, deadline);
             if (trace->except) {
                if (failure_is_subjective(*trace->except, deadline_is_subjective)) {
-                  _pending_incoming_transactions.emplace_back(trx, persist_until_expired, next);
+                  queue_incoming_transaction(trx, persist_until_expired, next);
                   if (_pending_block_mode == pending_block_mode::producing) {
                      fc_dlog(_trx_trace_log, "[TRX_TRACE] Block ${block_num} for producer ${prod} COULD NOT FIT, tx: ${txid} RETRYING ",
                              ("block_num", chain.head_block_num() + 1)
@@ -575,6 +611,8 @@ void producer_plugin::set_program_options(
           "Maximum wall-clock time, in milliseconds, spent retiring scheduled transactions in any block before returning to normal transaction processing.")
          ("incoming-defer-ratio", bpo::value<double>()->default_value(1.0),
           "ratio between incoming transations and deferred transactions when both are exhausted")
+         ("incoming-transaction-queue-size-mb", bpo::value<uint16_t>()->default_value( 1024 ),
+          "Maximum size (in MiB) of the incoming transaction queue. When exceeded, the newest transactions of the account using the most of the queue are dropped")
          ("producer-threads", bpo::value<uint16_t>()->default_value(config::default_controller_thread_pool_size),
           "Number of worker threads in producer thread pool")
          ("snapshots-dir", bpo::value<bfs::path>()->default_value("snapshots"),
@@ -711,6 +749,11 @@ void producer_plugin::plugin_initialize(const boost::program_options::variables_
 
    my->_incoming_defer_ratio = options.at("incoming-defer-ratio").as<double>();
 
+   auto incoming_queue_size_mb = options.at( "incoming-transaction-queue-size-mb" ).as<uint16_t>();
+   GST_ASSERT( incoming_queue_size_mb > 0, plugin_config_exception,
+               "incoming-transaction-queue-size-mb ${num} must be greater than 0", ("num", incoming_queue_size_mb));
+   my->_pending_incoming_transactions.set_max_bytes( uint64_t(incoming_queue_size_mb) * 1024 * 1024 );
+
    auto thread_pool_size = options.at( "producer-threads" ).as<uint16_t>();
    GST_ASSERT( thread_pool_size > 0, plugin_config_exception,
                "producer-threads ${num} must be greater than 0", ("num", thread_pool_size));
@@ -899,6 +942,14 @@ producer_plugin::runtime_options producer_plugin::get_runtime_options() const {
    };
 }
 
+producer_plugin::incoming_queue_stats producer_plugin::get_incoming_queue_stats() const {
+   auto result = my->_incoming_queue_stats;
+   result.queued = my->_pending_incoming_transactions.size();
+   result.queued_bytes = my->_pending_incoming_transactions.bytes_size();
+   result.accounts = my->_pending_incoming_transactions.accounts_size();
+   return result;
+}
+
 void producer_plugin::add_greylist_accounts(const greylist_params& params) {
    chain::controller& chain = my->chain_plug->chain();
    for (auto &acc : params.accounts) {
@@ -1415,11 +1466,10 @@ bool producer_plugin_impl::process_scheduled_and_incoming_trxs( const fc::time_p
       while (incoming_trx_weight >= 1.0 && pending_incoming_process_limit && _pending_incoming_transactions.size()) {
          if (deadline <= fc::time_point::now()) break;
 
-         auto e = _pending_incoming_transactions.front();
-         _pending_incoming_transactions.pop_front();
+         auto e = _pending_incoming_transactions.pop();
          --pending_incoming_process_limit;
          incoming_trx_weight -= 1.0;
-         process_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+         process_incoming_transaction_async(e.trx, e.persist_until_expired, e.next);
       }
 
       if (deadline <= fc::time_point::now()) {
@@ -1470,16 +1520,17 @@ bool producer_plugin_impl::process_incoming_trxs( const fc::time_point& deadline
 {
    bool exhausted = false;
    if (!_pending_incoming_transactions.empty()) {
-      fc_dlog(_log, "Processing ${n} pending transactions", ("n", _pending_incoming_transactions.size()));
+      fc_dlog(_log, "Processing ${n} pending transactions from ${a} accounts, ${b} bytes",
+              ("n", _pending_incoming_transactions.size())("a", _pending_incoming_transactions.accounts_size())
+              ("b", _pending_incoming_transactions.bytes_size()));
       while (pending_incoming_process_limit && _pending_incoming_transactions.size()) {
          if (deadline <= fc::time_point::now()) {
             exhausted = true;
             break;
          }
-         auto e = _pending_incoming_transactions.front();
-         _pending_incoming_transactions.pop_front();
+         auto e = _pending_incoming_transactions.pop();
          --pending_incoming_process_limit;
-         process_incoming_transaction_async(std::get<0>(e), std::get<1>(e), std::get<2>(e));
+         process_incoming_transaction_async(e.trx, e.persist_until_expired, e.next);
       }
    }
    return !exhausted;
@@ -0,0 +1,52 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+#pragma once
+
+#include <gstio/chain/types.hpp>
+#include <gstio/state_history_plugin/state_history_log.hpp>
+
+namespace gstio {
+
+/// how the payload of a state history log entry is compressed, stored in front of the payload
+enum class state_history_codec : uint8_t {
+   none = 0,
+   zlib = 1,
+   zstd = 2, ///< only available when built with zstd support in boost::iostreams
+};
+
+struct state_history_compression {
+   state_history_codec codec = state_history_codec::zlib;
+   int                 level = -1; ///< -1 selects the default level of the codec
+};
+
+/// parses "none", "zlib", "zstd", optionally followed by ":<level>", e.g. "zlib:1" or "zstd:3"
+state_history_compression parse_state_history_compression(const std::string& s);
+std::string               to_string(const state_history_compression& compression);
+const char*               to_string(state_history_codec codec);
+bool                      is_supported(state_history_codec codec);
+
+chain::bytes state_history_compress(const state_history_compression& compression, const char* data, size_t size);
+chain::bytes state_history_decompress(state_history_codec codec, const char* data, size_t size);
+
+inline chain::bytes state_history_compress(const state_history_compression& compression, const chain::bytes& in) {
+   return state_history_compress(compression, in.data(), in.size());
+}
+
+inline chain::bytes state_history_decompress(state_history_codec codec, const chain::bytes& in) {
+   return state_history_decompress(codec, in.data(), in.size());
+}
+
+/// entries of version 0 hold zlib compressed payloads, version 1 entries start with their state_history_codec
+static constexpr uint8_t codec_tagged_entry_version = 1;
+
+/// appends the entry of block_num holding payload compressed with codec to log
+void write_compressed_entry(state_history_log& log, uint32_t block_num, const chain::block_id_type& block_id,
+                            const chain::block_id_type& prev_id, state_history_codec codec, const chain::bytes& payload);
+
+/// returns the stream of log positioned at the compressed payload of block_num, which has size bytes
+std::fstream& get_compressed_entry(state_history_log& log, uint32_t block_num, state_history_codec& codec,
+                                   uint32_t& size);
+
+} // namespace gstio
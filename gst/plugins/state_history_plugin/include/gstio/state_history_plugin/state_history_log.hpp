@@ -35,9 +35,14 @@ namespace gstio {
  * each summary:
  *    uint64_t       position of entry in *.log
  *
- * state payload:
+ * state payload (entry version 0):
  *    uint32_t    size of deltas
- *    char[]      deltas
+ *    char[]      zlib compressed deltas
+ *
+ * state payload (entry version 1):
+ *    uint8_t     state_history_codec of deltas
+ *    uint32_t    size of deltas
+ *    char[]      compressed deltas
  */
 
 // todo: look into switching this to serialization instead of memcpy
@@ -192,7 +197,7 @@ class state_history_log {
          state_history_log_header header;
          log.seekg(0);
          log.read((char*)&header, sizeof(header));
-         GST_ASSERT(header.version == 0 && sizeof(header) + header.payload_size + sizeof(uint64_t) <= size,
+         GST_ASSERT(header.version <= 1 && sizeof(header) + header.payload_size + sizeof(uint64_t) <= size,
                     chain::plugin_exception, "corrupt ${name}.log (1)", ("name", name));
          _begin_block  = header.block_num;
          last_block_id = header.block_id;
@@ -55,6 +55,22 @@ struct get_blocks_request_v0 {
    bool                        fetch_deltas           = false;
 };
 
+/// like get_blocks_request_v0, but the traces and deltas of the results keep their codec when it is in accept_codecs
+/// (values of state_history_codec) and the results are get_blocks_result_v1. Other payloads are sent zlib compressed.
+struct get_blocks_request_v1 : get_blocks_request_v0 {
+   std::vector<uint8_t> accept_codecs = {};
+};
+
+/// like get_blocks_request_v1, but the results are get_blocks_result_v2 holding up to max_blocks_per_message
+/// consecutive blocks each, and max_messages_in_flight counts these messages. When filter_tables is not empty the deltas
+/// only hold the tables it names, when filter_contracts is not empty the contract_* tables only hold the rows of these
+/// contracts.
+struct get_blocks_request_v2 : get_blocks_request_v1 {
+   uint32_t                 max_blocks_per_message = 1;
+   std::vector<std::string> filter_tables          = {};
+   std::vector<chain::name> filter_contracts       = {};
+};
+
 struct get_blocks_ack_request_v0 {
    uint32_t num_messages = 0;
 };
@@ -69,8 +85,32 @@ struct get_blocks_result_v0 {
    fc::optional<bytes>          deltas;
 };
 
-using state_request = fc::static_variant<get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0>;
-using state_result  = fc::static_variant<get_status_result_v0, get_blocks_result_v0>;
+struct get_blocks_result_v1 : get_blocks_result_v0 {
+   uint8_t traces_codec = 0;
+   uint8_t deltas_codec = 0;
+};
+
+/// one block of a get_blocks_result_v2, with the fields of get_blocks_result_v1 that are not shared by the batch
+struct block_result_v0 {
+   fc::optional<block_position> this_block;
+   fc::optional<block_position> prev_block;
+   fc::optional<bytes>          block;
+   fc::optional<bytes>          traces;
+   fc::optional<bytes>          deltas;
+   uint8_t                      traces_codec = 0;
+   uint8_t                      deltas_codec = 0;
+};
+
+struct get_blocks_result_v2 {
+   block_position               head;
+   block_position               last_irreversible;
+   std::vector<block_result_v0> blocks;
+};
+
+using state_request = fc::static_variant<get_status_request_v0, get_blocks_request_v0, get_blocks_ack_request_v0,
+                                         get_blocks_request_v1, get_blocks_request_v2>;
+using state_result  = fc::static_variant<get_status_result_v0, get_blocks_result_v0, get_blocks_result_v1,
+                                        get_blocks_result_v2>;
 
 class state_history_plugin : public plugin<state_history_plugin> {
  public:
@@ -97,5 +137,7 @@ FC_REFLECT(gstio::block_position, (block_num)(block_id));
 FC_REFLECT_EMPTY(gstio::get_status_request_v0);
 FC_REFLECT(gstio::get_status_result_v0, (head)(last_irreversible)(trace_begin_block)(trace_end_block)(chain_state_begin_block)(chain_state_end_block));
 FC_REFLECT(gstio::get_blocks_request_v0, (start_block_num)(end_block_num)(max_messages_in_flight)(have_positions)(irreversible_only)(fetch_block)(fetch_traces)(fetch_deltas));
+FC_REFLECT_DERIVED(gstio::get_blocks_request_v1, (gstio::get_blocks_request_v0), (accept_codecs));
+FC_REFLECT_DERIVED(gstio::get_blocks_request_v2, (gstio::get_blocks_request_v1), (max_blocks_per_message)(filter_tables)(filter_contracts));
 FC_REFLECT(gstio::get_blocks_ack_request_v0, (num_messages));
 // clang-format on
@@ -75,6 +75,17 @@ datastream<ST>& operator<<(datastream<ST>& ds, const history_serial_big_vector_w
    return ds;
 }
 
+template <typename ST, typename T>
+datastream<ST>& operator>>(datastream<ST>& ds, history_serial_big_vector_wrapper<T>& obj) {
+   fc::unsigned_int size;
+   fc::raw::unpack(ds, size);
+   FC_ASSERT(size.value <= 1024 * 1024 * 1024);
+   obj.obj.resize(size.value);
+   for (auto& x : obj.obj)
+      fc::raw::unpack(ds, x);
+   return ds;
+}
+
 template <typename ST>
 void history_pack_big_bytes(datastream<ST>& ds, const gstio::chain::bytes& v) {
    FC_ASSERT(v.size() <= 1024 * 1024 * 1024);
@@ -582,4 +593,34 @@ datastream<ST>& operator<<(datastream<ST>& ds, const gstio::get_blocks_result_v0
    return ds;
 }
 
+template <typename ST>
+datastream<ST>& operator<<(datastream<ST>& ds, const gstio::get_blocks_result_v1& obj) {
+   ds << static_cast<const gstio::get_blocks_result_v0&>(obj);
+   fc::raw::pack(ds, obj.traces_codec);
+   fc::raw::pack(ds, obj.deltas_codec);
+   return ds;
+}
+
+template <typename ST>
+datastream<ST>& operator<<(datastream<ST>& ds, const gstio::block_result_v0& obj) {
+   fc::raw::pack(ds, obj.this_block);
+   fc::raw::pack(ds, obj.prev_block);
+   history_pack_big_bytes(ds, obj.block);
+   history_pack_big_bytes(ds, obj.traces);
+   history_pack_big_bytes(ds, obj.deltas);
+   fc::raw::pack(ds, obj.traces_codec);
+   fc::raw::pack(ds, obj.deltas_codec);
+   return ds;
+}
+
+template <typename ST>
+datastream<ST>& operator<<(datastream<ST>& ds, const gstio::get_blocks_result_v2& obj) {
+   fc::raw::pack(ds, obj.head);
+   fc::raw::pack(ds, obj.last_irreversible);
+   fc::raw::pack(ds, fc::unsigned_int((uint32_t)obj.blocks.size()));
+   for (auto& block : obj.blocks)
+      ds << block;
+   return ds;
+}
+
 } // namespace fc
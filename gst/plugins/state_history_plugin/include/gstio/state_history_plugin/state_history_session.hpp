@@ -0,0 +1,54 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+#pragma once
+
+#include <gstio/state_history_plugin/state_history_compression.hpp>
+#include <gstio/state_history_plugin/state_history_log.hpp>
+#include <gstio/state_history_plugin/state_history_plugin.hpp>
+
+namespace gstio {
+
+/// appends the serialization of v to out
+template <typename T>
+void append_packed(std::vector<char>& out, const T& v) {
+   auto pos = out.size();
+   out.resize(pos + fc::raw::pack_size(v));
+   fc::datastream<char*> ds(out.data() + pos, out.size() - pos);
+   fc::raw::pack(ds, v);
+}
+
+/// appends v as the traces, deltas or block of a get_blocks_result
+void append_big_bytes(std::vector<char>& out, const fc::optional<bytes>& v);
+
+/// a log entry copied into a message as a packed fc::optional<bytes>, whose payload has to be filtered or recompressed
+/// before the message is sent
+struct message_entry {
+   size_t              pos          = 0;                         ///< of the entry in the message
+   state_history_codec codec        = state_history_codec::zlib; ///< of the entry in the log
+   state_history_codec result_codec = state_history_codec::zlib; ///< the client accepts
+   bool                filter       = false;                     ///< the entry holds table deltas to filter
+};
+
+/// message with its entries filtered with filter_deltas and recompressed with their result_codec, entries are ordered
+/// by pos. This is done on the thread pool, it can take much longer than copying the entries.
+std::vector<char> transcode_entries(const std::vector<char>& message, const std::vector<message_entry>& entries,
+                                    const std::vector<std::string>& filter_tables = {},
+                                    const std::vector<chain::name>& filter_contracts = {});
+
+/// current limited to the newest block whose entries are in every log req fetches from, logs are nullptr when they are
+/// disabled. The entries of a block are written after it was accepted, so head may be ahead of the logs. The caller
+/// holds the lock of the logs.
+uint32_t newest_sendable_block(uint32_t current, const get_blocks_request_v0& req, const state_history_log* trace_log,
+                               const state_history_log* chain_state_log);
+
+/// number of blocks the next get_blocks_result_v2 holds when current is the newest block that can be sent
+uint32_t num_blocks_to_send(const get_blocks_request_v2& req, uint32_t current);
+
+/// the packed table deltas in packed limited to filter_tables and the contract_* rows of filter_contracts, empty filters
+/// keep everything
+bytes filter_deltas(const bytes& packed, const std::vector<std::string>& filter_tables,
+                    const std::vector<chain::name>& filter_contracts);
+
+} // namespace gstio
@@ -0,0 +1,142 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+
+#include <gstio/chain/exceptions.hpp>
+#include <gstio/state_history_plugin/state_history_compression.hpp>
+
+#include <boost/iostreams/device/back_inserter.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/filtering_stream.hpp>
+#ifdef GSTIO_STATE_HISTORY_ZSTD
+#include <boost/iostreams/filter/zstd.hpp>
+#endif
+
+namespace gstio {
+using namespace chain;
+namespace bio = boost::iostreams;
+
+template <typename Filter>
+static bytes filter_bytes(Filter&& filter, const char* data, size_t size) {
+   bytes                  out;
+   bio::filtering_ostream stream;
+   stream.push(std::forward<Filter>(filter));
+   stream.push(bio::back_inserter(out));
+   bio::write(stream, data, size);
+   bio::close(stream);
+   return out;
+}
+
+state_history_compression parse_state_history_compression(const std::string& s) {
+   state_history_compression result;
+   auto                      colon = s.find(':');
+   auto                      name  = s.substr(0, colon);
+   if (name == "none")
+      result.codec = state_history_codec::none;
+   else if (name == "zlib")
+      result.codec = state_history_codec::zlib;
+   else if (name == "zstd")
+      result.codec = state_history_codec::zstd;
+   else
+      GST_THROW(plugin_config_exception, "unknown state history compression ${s}", ("s", s));
+   GST_ASSERT(is_supported(result.codec), plugin_config_exception,
+              "this build does not support ${c} compression", ("c", name));
+
+   if (colon != std::string::npos) {
+      GST_ASSERT(result.codec != state_history_codec::none, plugin_config_exception,
+                 "state history compression none has no level");
+      try {
+         result.level = std::stoi(s.substr(colon + 1));
+      } catch (...) {
+         GST_THROW(plugin_config_exception, "invalid level in state history compression ${s}", ("s", s));
+      }
+      auto max_level = result.codec == state_history_codec::zlib ? 9 : 22;
+      GST_ASSERT(result.level >= 1 && result.level <= max_level, plugin_config_exception,
+                 "level of ${c} compression must be between 1 and ${max}", ("c", name)("max", max_level));
+   }
+   return result;
+}
+
+std::string to_string(const state_history_compression& compression) {
+   std::string result = to_string(compression.codec);
+   if (compression.level >= 0)
+      result += ":" + std::to_string(compression.level);
+   return result;
+}
+
+const char* to_string(state_history_codec codec) {
+   switch (codec) {
+   case state_history_codec::none: return "none";
+   case state_history_codec::zlib: return "zlib";
+   case state_history_codec::zstd: return "zstd";
+   }
+   return "unknown";
+}
+
+bool is_supported(state_history_codec codec) {
+#ifdef GSTIO_STATE_HISTORY_ZSTD
+   return codec <= state_history_codec::zstd;
+#else
+   return codec <= state_history_codec::zlib;
+#endif
+}
+
+bytes state_history_compress(const state_history_compression& compression, const char* data, size_t size) {
+   switch (compression.codec) {
+   case state_history_codec::none: return bytes(data, data + size);
+   case state_history_codec::zlib:
+      return filter_bytes(
+          bio::zlib_compressor(compression.level >= 0 ? compression.level : bio::zlib::default_compression), data,
+          size);
+#ifdef GSTIO_STATE_HISTORY_ZSTD
+   case state_history_codec::zstd:
+      return filter_bytes(
+          bio::zstd_compressor(compression.level >= 0 ? compression.level : bio::zstd::default_compression), data,
+          size);
+#endif
+   default: break;
+   }
+   GST_THROW(plugin_exception, "unsupported state history codec ${c}", ("c", (uint32_t)compression.codec));
+}
+
+bytes state_history_decompress(state_history_codec codec, const char* data, size_t size) {
+   switch (codec) {
+   case state_history_codec::none: return bytes(data, data + size);
+   case state_history_codec::zlib: return filter_bytes(bio::zlib_decompressor(), data, size);
+#ifdef GSTIO_STATE_HISTORY_ZSTD
+   case state_history_codec::zstd: return filter_bytes(bio::zstd_decompressor(), data, size);
+#endif
+   default: break;
+   }
+   GST_THROW(plugin_exception, "unsupported state history codec ${c}", ("c", (uint32_t)codec));
+}
+
+void write_compressed_entry(state_history_log& log, uint32_t block_num, const block_id_type& block_id,
+                            const block_id_type& prev_id, state_history_codec codec, const bytes& payload) {
+   GST_ASSERT(payload.size() == (uint32_t)payload.size(), plugin_exception, "log entry is too big");
+   state_history_log_header header{.block_num    = block_num,
+                                   .block_id     = block_id,
+                                   .payload_size = sizeof(uint8_t) + sizeof(uint32_t) + payload.size(),
+                                   .version      = codec_tagged_entry_version};
+   log.write_entry(header, prev_id, [&](auto& stream) {
+      stream.write((char*)&codec, sizeof(codec));
+      uint32_t s = (uint32_t)payload.size();
+      stream.write((char*)&s, sizeof(s));
+      if (!payload.empty())
+         stream.write(payload.data(), payload.size());
+   });
+}
+
+std::fstream& get_compressed_entry(state_history_log& log, uint32_t block_num, state_history_codec& codec,
+                                   uint32_t& size) {
+   state_history_log_header header;
+   auto&                    stream = log.get_entry(block_num, header);
+   codec                           = state_history_codec::zlib;
+   if (header.version >= codec_tagged_entry_version)
+      stream.read((char*)&codec, sizeof(codec));
+   stream.read((char*)&size, sizeof(size));
+   return stream;
+}
+
+} // namespace gstio
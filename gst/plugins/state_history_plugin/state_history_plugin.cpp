@@ -4,8 +4,12 @@
  */
 
 #include <gstio/chain/config.hpp>
+#include <gstio/chain/state_delta.hpp>
+#include <gstio/chain/thread_utils.hpp>
+#include <gstio/state_history_plugin/state_history_compression.hpp>
 #include <gstio/state_history_plugin/state_history_log.hpp>
 #include <gstio/state_history_plugin/state_history_serialization.hpp>
+#include <gstio/state_history_plugin/state_history_session.hpp>
 
 #include <boost/asio/bind_executor.hpp>
 #include <boost/asio/ip/host_name.hpp>
@@ -13,11 +17,11 @@
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
-#include <boost/iostreams/device/back_inserter.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
-#include <boost/iostreams/filtering_stream.hpp>
 #include <boost/signals2/connection.hpp>
 
+#include <condition_variable>
+#include <mutex>
+
 using tcp    = boost::asio::ip::tcp;
 namespace ws = boost::beast::websocket;
 
@@ -42,21 +46,40 @@ auto catch_and_log(F f) {
    }
 }
 
-namespace bio = boost::iostreams;
-static bytes zlib_compress_bytes(bytes in) {
-   bytes                  out;
-   bio::filtering_ostream comp;
-   comp.push(bio::zlib_compressor(bio::zlib::default_compression));
-   comp.push(bio::back_inserter(out));
-   bio::write(comp, in.data(), in.size());
-   bio::close(comp);
-   return out;
+/// recompresses payload, which is compressed with codec, with result_codec
+static void recompress(fc::optional<bytes>& payload, state_history_codec codec, state_history_codec result_codec) {
+   if (payload && codec != result_codec)
+      payload = state_history_compress(state_history_compression{result_codec},
+                                       state_history_decompress(codec, *payload));
 }
 
+/// compressed payloads of the log entries of one block, in the order they are written
+struct block_log_entries {
+   uint32_t            block_num = 0;
+   block_id_type       block_id;
+   block_id_type       prev_id;
+   std::future<bytes>  traces;
+   std::future<bytes>  chain_state;
+   std::future<bytes>  state_deltas;
+};
+
 struct state_history_plugin_impl : std::enable_shared_from_this<state_history_plugin_impl> {
    chain_plugin*                                        chain_plug = nullptr;
    fc::optional<state_history_log>                      trace_log;
    fc::optional<state_history_log>                      chain_state_log;
+   fc::optional<state_history_log>                      state_delta_log;
+   uint32_t                                             state_delta_hash_interval = 0;
+   state_history_compression                            compression;
+   bool                                                 chain_state_log_started   = false;
+   std::mutex                                           log_mtx; ///< guards the logs, written by write_thread
+   fc::optional<boost::asio::thread_pool>               thread_pool;  ///< packs and compresses log entries
+   fc::optional<boost::asio::thread_pool>               write_thread; ///< writes the entries of one block at a time
+   std::mutex                                           queue_mtx;
+   std::condition_variable                              queue_cv;
+   uint32_t                                             queued_blocks     = 0;
+   uint32_t                                             max_queued_blocks = 0;
+   uint32_t                                             max_blocks_per_message = 0;
+   bool                                                 write_failed = false; ///< only used by write_thread
    bool                                                 stopping = false;
    fc::optional<scoped_connection>                      applied_transaction_connection;
    fc::optional<scoped_connection>                      accepted_block_connection;
@@ -66,19 +89,106 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    std::map<transaction_id_type, transaction_trace_ptr> cached_traces;
    transaction_trace_ptr                                onblock_trace;
 
-   void get_log_entry(state_history_log& log, uint32_t block_num, fc::optional<bytes>& result) {
+   void get_log_entry(state_history_log& log, uint32_t block_num, fc::optional<bytes>& result,
+                      state_history_codec& codec) {
+      std::lock_guard<std::mutex> g(log_mtx);
       if (block_num < log.begin_block() || block_num >= log.end_block())
          return;
-      state_history_log_header header;
-      auto&                    stream = log.get_entry(block_num, header);
-      uint32_t                 s;
-      stream.read((char*)&s, sizeof(s));
+      uint32_t s;
+      auto&    stream = get_compressed_entry(log, block_num, codec, s);
       result.emplace();
       result->resize(s);
       if (s)
          stream.read(result->data(), s);
    }
 
+   // appends the entry of block_num to out as an optional bytes, reading its payload from the log straight into out
+   bool append_log_entry(state_history_log& log, uint32_t block_num, std::vector<char>& out,
+                         state_history_codec& codec) {
+      std::lock_guard<std::mutex> g(log_mtx);
+      if (block_num < log.begin_block() || block_num >= log.end_block()) {
+         append_packed(out, false);
+         return false;
+      }
+      uint32_t s;
+      auto&    stream = get_compressed_entry(log, block_num, codec, s);
+      append_packed(out, true);
+      append_packed(out, fc::unsigned_int(s));
+      auto pos = out.size();
+      out.resize(pos + s);
+      if (s)
+         stream.read(out.data() + pos, s);
+      return true;
+   }
+
+   // the complete state changes recorded for block, if state_delta_log has them for this very block
+   fc::optional<block_state_deltas> get_state_deltas(const signed_block_ptr& block) {
+      if (!state_delta_log)
+         return {};
+      auto block_num = block->block_num();
+      {
+         std::lock_guard<std::mutex> g(log_mtx);
+         if (block_num < state_delta_log->begin_block() || block_num >= state_delta_log->end_block() ||
+             state_delta_log->get_block_id(block_num) != block->id())
+            return {};
+      }
+      fc::optional<bytes> entry;
+      state_history_codec codec;
+      get_log_entry(*state_delta_log, block_num, entry, codec);
+      if (!entry)
+         return {};
+      return fc::raw::unpack<block_state_deltas>(state_history_decompress(codec, *entry));
+   }
+
+   // compresses and decompresses the newest entries of the existing logs with every supported codec
+   void benchmark_codecs(uint32_t num_blocks) {
+      std::vector<bytes> samples;
+      size_t             total = 0;
+      for (auto* log : {trace_log ? &*trace_log : nullptr, chain_state_log ? &*chain_state_log : nullptr}) {
+         if (!log)
+            continue;
+         auto begin = std::max(log->begin_block(), log->end_block() - std::min(log->end_block(), num_blocks));
+         for (auto block_num = begin; block_num < log->end_block(); ++block_num) {
+            fc::optional<bytes> entry;
+            state_history_codec codec;
+            get_log_entry(*log, block_num, entry, codec);
+            if (!entry || entry->empty())
+               continue;
+            samples.push_back(state_history_decompress(codec, *entry));
+            total += samples.back().size();
+         }
+      }
+      GST_ASSERT(total > 0, plugin_config_exception,
+                 "--benchmark-state-history-codecs needs --trace-history or --chain-state-history logs with entries");
+
+      std::vector<std::string> candidates = {"none", "zlib:1", "zlib", "zlib:9"};
+      if (is_supported(state_history_codec::zstd)) {
+         candidates.push_back("zstd:1");
+         candidates.push_back("zstd");
+      }
+      auto mb_per_sec = [&](fc::microseconds us) { return us.count() ? double(total) / us.count() : 0.0; };
+      ilog("benchmarking state history codecs on ${n} entries, ${size} bytes", ("n", samples.size())("size", total));
+      for (const auto& candidate : candidates) {
+         auto               c = parse_state_history_compression(candidate);
+         std::vector<bytes> compressed;
+         compressed.reserve(samples.size());
+         size_t compressed_size = 0;
+         auto   start           = fc::time_point::now();
+         for (const auto& sample : samples) {
+            compressed.push_back(state_history_compress(c, sample));
+            compressed_size += compressed.back().size();
+         }
+         auto write_time = fc::time_point::now() - start;
+         start           = fc::time_point::now();
+         for (const auto& entry : compressed)
+            state_history_decompress(c.codec, entry);
+         auto read_time = fc::time_point::now() - start;
+         ilog("${c}: ratio ${ratio}, compress ${w} MB/s, decompress ${r} MB/s",
+              ("c", candidate)("ratio", double(compressed_size) / total)("w", mb_per_sec(write_time))
+              ("r", mb_per_sec(read_time)));
+      }
+   }
+
    void get_block(uint32_t block_num, fc::optional<bytes>& result) {
       chain::signed_block_ptr p;
       try {
@@ -90,10 +200,13 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    }
 
    fc::optional<chain::block_id_type> get_block_id(uint32_t block_num) {
-      if (trace_log && block_num >= trace_log->begin_block() && block_num < trace_log->end_block())
-         return trace_log->get_block_id(block_num);
-      if (chain_state_log && block_num >= chain_state_log->begin_block() && block_num < chain_state_log->end_block())
-         return chain_state_log->get_block_id(block_num);
+      {
+         std::lock_guard<std::mutex> g(log_mtx);
+         if (trace_log && block_num >= trace_log->begin_block() && block_num < trace_log->end_block())
+            return trace_log->get_block_id(block_num);
+         if (chain_state_log && block_num >= chain_state_log->begin_block() && block_num < chain_state_log->end_block())
+            return chain_state_log->get_block_id(block_num);
+      }
       try {
          auto block = chain_plug->chain().fetch_block_by_number(block_num);
          if (block)
@@ -109,8 +222,10 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       bool                                       sending  = false;
       bool                                       sent_abi = false;
       std::vector<std::vector<char>>             send_queue;
-      fc::optional<get_blocks_request_v0>        current_request;
+      fc::optional<get_blocks_request_v2>        current_request;
+      uint32_t                                   request_version     = 0; ///< version of the request current_request came from
       bool                                       need_to_send_update = false;
+      bool                                       preparing = false; ///< a message is being recompressed on the thread pool
 
       session(std::shared_ptr<state_history_plugin_impl> plugin)
           : plugin(std::move(plugin)) {}
@@ -182,6 +297,7 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
          get_status_result_v0 result;
          result.head              = {chain.head_block_num(), chain.head_block_id()};
          result.last_irreversible = {chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
+         std::lock_guard<std::mutex> g(plugin->log_mtx);
          if (plugin->trace_log) {
             result.trace_begin_block = plugin->trace_log->begin_block();
             result.trace_end_block   = plugin->trace_log->end_block();
@@ -194,6 +310,23 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       }
 
       void operator()(get_blocks_request_v0& req) {
+         get_blocks_request_v2 v2;
+         static_cast<get_blocks_request_v0&>(v2) = req;
+         start_request(std::move(v2), 0);
+      }
+
+      void operator()(get_blocks_request_v1& req) {
+         get_blocks_request_v2 v2;
+         static_cast<get_blocks_request_v1&>(v2) = req;
+         start_request(std::move(v2), 1);
+      }
+
+      void operator()(get_blocks_request_v2& req) {
+         req.max_blocks_per_message = std::max(1u, std::min(req.max_blocks_per_message, plugin->max_blocks_per_message));
+         start_request(std::move(req), 2);
+      }
+
+      void start_request(get_blocks_request_v2 req, uint32_t version) {
          for (auto& cp : req.have_positions) {
             if (req.start_block_num <= cp.block_num)
                continue;
@@ -202,7 +335,8 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
                req.start_block_num = std::min(req.start_block_num, cp.block_num);
          }
          req.have_positions.clear();
-         current_request = req;
+         current_request = std::move(req);
+         request_version = version;
          send_update(true);
       }
 
@@ -216,15 +350,35 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       void send_update(bool changed = false) {
          if (changed)
             need_to_send_update = true;
-         if (!send_queue.empty() || !need_to_send_update || !current_request ||
+         if (preparing || !send_queue.empty() || !need_to_send_update || !current_request ||
              !current_request->max_messages_in_flight)
             return;
-         auto&                chain = plugin->chain_plug->chain();
-         get_blocks_result_v0 result;
-         result.head              = {chain.head_block_num(), chain.head_block_id()};
-         result.last_irreversible = {chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
-         uint32_t current =
-             current_request->irreversible_only ? result.last_irreversible.block_num : result.head.block_num;
+         auto&          chain = plugin->chain_plug->chain();
+         block_position head{chain.head_block_num(), chain.head_block_id()};
+         block_position last_irreversible{chain.last_irreversible_block_num(), chain.last_irreversible_block_id()};
+         uint32_t       current = current_request->irreversible_only ? last_irreversible.block_num : head.block_num;
+         {
+            std::lock_guard<std::mutex> g(plugin->log_mtx);
+            current = newest_sendable_block(current, *current_request,
+                                            plugin->trace_log ? &*plugin->trace_log : nullptr,
+                                            plugin->chain_state_log ? &*plugin->chain_state_log : nullptr);
+         }
+         if (request_version >= 2)
+            send_blocks(head, last_irreversible, current);
+         else
+            send_block(head, last_irreversible, current);
+         --current_request->max_messages_in_flight;
+         need_to_send_update = current_request->start_block_num <= current &&
+                               current_request->start_block_num < current_request->end_block_num;
+      }
+
+      void send_block(const block_position& head, const block_position& last_irreversible, uint32_t current) {
+         get_blocks_result_v1 result;
+         auto                 traces_codec = state_history_codec::zlib;
+         auto                 deltas_codec = state_history_codec::zlib;
+         bool                 recompressed = false;
+         result.head              = head;
+         result.last_irreversible = last_irreversible;
          if (current_request->start_block_num <= current &&
              current_request->start_block_num < current_request->end_block_num) {
             auto block_id = plugin->get_block_id(current_request->start_block_num);
@@ -236,16 +390,133 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
                if (current_request->fetch_block)
                   plugin->get_block(current_request->start_block_num, result.block);
                if (current_request->fetch_traces && plugin->trace_log)
-                  plugin->get_log_entry(*plugin->trace_log, current_request->start_block_num, result.traces);
+                  plugin->get_log_entry(*plugin->trace_log, current_request->start_block_num, result.traces,
+                                        traces_codec);
                if (current_request->fetch_deltas && plugin->chain_state_log)
-                  plugin->get_log_entry(*plugin->chain_state_log, current_request->start_block_num, result.deltas);
+                  plugin->get_log_entry(*plugin->chain_state_log, current_request->start_block_num, result.deltas,
+                                        deltas_codec);
+               result.traces_codec = (uint8_t)accepted_codec(traces_codec);
+               result.deltas_codec = (uint8_t)accepted_codec(deltas_codec);
+               recompressed        = !accepts(traces_codec) || !accepts(deltas_codec);
             }
             ++current_request->start_block_num;
          }
-         send(std::move(result));
-         --current_request->max_messages_in_flight;
-         need_to_send_update = current_request->start_block_num <= current &&
-                               current_request->start_block_num < current_request->end_block_num;
+         auto pack = [v1 = request_version >= 1](get_blocks_result_v1& result) {
+            if (v1)
+               return fc::raw::pack(state_result{std::move(result)});
+            return fc::raw::pack(state_result{static_cast<get_blocks_result_v0&&>(std::move(result))});
+         };
+         if (!recompressed) {
+            send_queue.push_back(pack(result));
+            return send();
+         }
+         send_from_thread_pool([result = std::move(result), traces_codec, deltas_codec, pack]() mutable {
+            recompress(result.traces, traces_codec, (state_history_codec)result.traces_codec);
+            recompress(result.deltas, deltas_codec, (state_history_codec)result.deltas_codec);
+            return pack(result);
+         });
+      }
+
+      // serializes a get_blocks_result_v2 directly into the message, copying the log entries only once
+      void send_blocks(const block_position& head, const block_position& last_irreversible, uint32_t current) {
+         auto              num_blocks = num_blocks_to_send(*current_request, current);
+         std::vector<char> message;
+         append_packed(message, fc::unsigned_int(state_result::position<get_blocks_result_v2>()));
+         append_packed(message, head);
+         append_packed(message, last_irreversible);
+         append_packed(message, fc::unsigned_int(num_blocks));
+         std::vector<message_entry> transcoded;
+         for (uint32_t i = 0; i < num_blocks; ++i)
+            append_block(message, current_request->start_block_num++, transcoded);
+         if (transcoded.empty()) {
+            send_queue.push_back(std::move(message));
+            return send();
+         }
+         send_from_thread_pool([message = std::move(message), transcoded = std::move(transcoded),
+                                tables    = current_request->filter_tables,
+                                contracts = current_request->filter_contracts]() {
+            return transcode_entries(message, transcoded, tables, contracts);
+         });
+      }
+
+      // appends the block_result_v0 of block_num, adding the entries that have to be filtered or recompressed to
+      // transcoded
+      void append_block(std::vector<char>& message, uint32_t block_num, std::vector<message_entry>& transcoded) {
+         auto block_id = plugin->get_block_id(block_num);
+         if (!block_id)
+            return append_packed(message, block_result_v0{});
+         append_packed(message, fc::optional<block_position>(block_position{block_num, *block_id}));
+         fc::optional<block_position> prev_block;
+         if (auto prev_block_id = plugin->get_block_id(block_num - 1))
+            prev_block = block_position{block_num - 1, *prev_block_id};
+         append_packed(message, prev_block);
+         fc::optional<bytes> block;
+         if (current_request->fetch_block)
+            plugin->get_block(block_num, block);
+         append_big_bytes(message, block);
+         auto* trace_log       = current_request->fetch_traces && plugin->trace_log ? &*plugin->trace_log : nullptr;
+         auto* chain_state_log =
+             current_request->fetch_deltas && plugin->chain_state_log ? &*plugin->chain_state_log : nullptr;
+         auto traces_codec = append_entry(message, trace_log, block_num, false, transcoded);
+         auto deltas_codec = append_entry(message, chain_state_log, block_num, true, transcoded);
+         append_packed(message, (uint8_t)traces_codec);
+         append_packed(message, (uint8_t)deltas_codec);
+      }
+
+      // appends the entry of block_num in log as it is in the log, adding it to transcoded when the request needs it
+      // filtered or recompressed. Returns the codec the entry has in the result.
+      state_history_codec append_entry(std::vector<char>& message, state_history_log* log, uint32_t block_num,
+                                       bool deltas, std::vector<message_entry>& transcoded) {
+         auto codec = state_history_codec::zlib;
+         auto pos   = message.size();
+         if (!log) {
+            append_packed(message, false);
+            return codec;
+         }
+         if (!plugin->append_log_entry(*log, block_num, message, codec))
+            return codec;
+         bool filter = deltas && (!current_request->filter_tables.empty() || !current_request->filter_contracts.empty());
+         if (filter || !accepts(codec))
+            transcoded.push_back({pos, codec, accepted_codec(codec), filter});
+         return accepted_codec(codec);
+      }
+
+      bool accepts(state_history_codec codec) {
+         return codec == state_history_codec::zlib ||
+                (request_version >= 1 && std::find(current_request->accept_codecs.begin(),
+                                                   current_request->accept_codecs.end(),
+                                                   (uint8_t)codec) != current_request->accept_codecs.end());
+      }
+
+      /// codec, or zlib which every client can inflate when the client does not accept codec
+      state_history_codec accepted_codec(state_history_codec codec) {
+         return accepts(codec) ? codec : state_history_codec::zlib;
+      }
+
+      // runs work on the thread pool and sends the message it returns, the next message is prepared after it
+      template <typename F>
+      void send_from_thread_pool(F work) {
+         preparing = true;
+         boost::asio::post(*plugin->thread_pool, [self = shared_from_this(), this, work = std::move(work)]() mutable {
+            std::vector<char>  message;
+            std::exception_ptr error;
+            try {
+               message = work();
+            } catch (...) {
+               error = std::current_exception();
+            }
+            app().post(priority::medium, [self = std::move(self), this, message = std::move(message), error]() mutable {
+               preparing = false;
+               if (plugin->stopping || !plugin->sessions.count(this))
+                  return;
+               catch_and_close([&] {
+                  if (error)
+                     std::rethrow_exception(error);
+                  send_queue.push_back(std::move(message));
+                  send();
+               });
+            });
+         });
       }
 
       template <typename F>
@@ -356,19 +627,82 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
    }
 
    void on_accepted_block(const block_state_ptr& block_state) {
-      store_traces(block_state);
-      store_chain_state(block_state);
+      auto entries       = std::make_shared<block_log_entries>();
+      entries->block_num = block_state->block->block_num();
+      entries->block_id  = block_state->block->id();
+      entries->prev_id   = block_state->block->previous;
+      store_traces(block_state, *entries);
+      store_chain_state(block_state, *entries);
+      store_state_deltas(block_state, *entries);
+      queue_entries(std::move(entries));
+   }
+
+   /// waits while max_queued_blocks blocks are waiting to be written, so that a slow disk slows down the chain
+   /// instead of growing the queue without bound
+   void queue_entries(std::shared_ptr<block_log_entries> entries) {
+      {
+         std::unique_lock<std::mutex> g(queue_mtx);
+         queue_cv.wait(g, [&] { return queued_blocks < max_queued_blocks; });
+         ++queued_blocks;
+      }
+      boost::asio::post(*write_thread, [self = shared_from_this(), entries]() { self->write_entries(*entries); });
+   }
+
+   // runs on write_thread, entries are written in the order the blocks were accepted
+   void write_entries(block_log_entries& entries) {
+      bool written = false;
+      // the logs can not have a gap, so nothing is written after a failure
+      if (!write_failed) {
+         catch_and_log([&] {
+            write_log_entries(entries);
+            written = true;
+         });
+      }
+      {
+         std::lock_guard<std::mutex> g(queue_mtx);
+         --queued_blocks;
+      }
+      queue_cv.notify_all();
+
+      if (written) {
+         // sessions wait for the entries of a block instead of reading past the end of the logs
+         app().post(priority::medium, [self = shared_from_this(), block_num = entries.block_num]() {
+            self->on_entries_written(block_num);
+         });
+      } else if (!write_failed) {
+         write_failed = true;
+         elog("unable to write the state history of block ${n}, shutting down", ("n", entries.block_num));
+         app().post(priority::high, [] { app().quit(); });
+      }
+   }
+
+   void write_log_entries(block_log_entries& entries) {
+      auto write = [&](fc::optional<state_history_log>& log, std::future<bytes>& payload) {
+         if (!payload.valid())
+            return;
+         auto                        bin = payload.get();
+         std::lock_guard<std::mutex> g(log_mtx);
+         write_compressed_entry(*log, entries.block_num, entries.block_id, entries.prev_id, compression.codec, bin);
+      };
+      write(trace_log, entries.traces);
+      write(chain_state_log, entries.chain_state);
+      write(state_delta_log, entries.state_deltas);
+   }
+
+   void on_entries_written(uint32_t block_num) {
+      if (stopping)
+         return;
       for (auto& s : sessions) {
          auto& p = s.second;
          if (p) {
-            if (p->current_request && block_state->block_num < p->current_request->start_block_num)
-               p->current_request->start_block_num = block_state->block_num;
+            if (p->current_request && block_num < p->current_request->start_block_num)
+               p->current_request->start_block_num = block_num;
             p->send_update(true);
          }
       }
    }
 
-   void store_traces(const block_state_ptr& block_state) {
+   void store_traces(const block_state_ptr& block_state, block_log_entries& entries) {
       if (!trace_log)
          return;
       std::vector<transaction_trace_ptr> traces;
@@ -388,25 +722,20 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       cached_traces.clear();
       onblock_trace.reset();
 
+      // the serializers look up names in the state database, so the traces are packed before the next block
       auto& db         = chain_plug->chain().db();
-      auto  traces_bin = zlib_compress_bytes(fc::raw::pack(make_history_serial_wrapper(db, traces)));
-      GST_ASSERT(traces_bin.size() == (uint32_t)traces_bin.size(), plugin_exception, "traces is too big");
-
-      state_history_log_header header{.block_num    = block_state->block->block_num(),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + traces_bin.size()};
-      trace_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)traces_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!traces_bin.empty())
-            stream.write(traces_bin.data(), traces_bin.size());
+      auto  traces_bin = fc::raw::pack(make_history_serial_wrapper(db, traces));
+      entries.traces   = async_thread_pool(*thread_pool, [compression = compression, traces_bin{std::move(traces_bin)}]() {
+         return state_history_compress(compression, traces_bin);
       });
    }
 
-   void store_chain_state(const block_state_ptr& block_state) {
+   void store_chain_state(const block_state_ptr& block_state, block_log_entries& entries) {
       if (!chain_state_log)
          return;
-      bool fresh = chain_state_log->begin_block() == chain_state_log->end_block();
+      // the log itself may still be empty while the first entries are being written
+      bool fresh = !chain_state_log_started;
+      chain_state_log_started = true;
       if (fresh)
          ilog("Placing initial state in block ${n}", ("n", block_state->block->block_num()));
 
@@ -485,18 +814,26 @@ struct state_history_plugin_impl : std::enable_shared_from_this<state_history_pl
       process_table("resource_limits_state", db.get_index<resource_limits::resource_limits_state_index>(), pack_row);
       process_table("resource_limits_config", db.get_index<resource_limits::resource_limits_config_index>(), pack_row);
 
-      auto deltas_bin = zlib_compress_bytes(fc::raw::pack(deltas));
-      GST_ASSERT(deltas_bin.size() == (uint32_t)deltas_bin.size(), plugin_exception, "deltas is too big");
-      state_history_log_header header{.block_num    = block_state->block->block_num(),
-                                      .block_id     = block_state->block->id(),
-                                      .payload_size = sizeof(uint32_t) + deltas_bin.size()};
-      chain_state_log->write_entry(header, block_state->block->previous, [&](auto& stream) {
-         uint32_t s = (uint32_t)deltas_bin.size();
-         stream.write((char*)&s, sizeof(s));
-         if (!deltas_bin.empty())
-            stream.write(deltas_bin.data(), deltas_bin.size());
+      entries.chain_state = async_thread_pool(*thread_pool, [compression = compression, deltas{std::move(deltas)}]() {
+         return state_history_compress(compression, fc::raw::pack(deltas));
       });
    } // store_chain_state
+
+   void store_state_deltas(const block_state_ptr& block_state, block_log_entries& entries) {
+      if (!state_delta_log)
+         return;
+      auto&              chain = chain_plug->chain();
+      block_state_deltas recorded;
+      recorded.deltas = extract_state_deltas(chain.db());
+      // while switching forks the head of the fork database is not this block and the hash would not match on replay
+      if (state_delta_hash_interval && block_state->block_num % state_delta_hash_interval == 0 &&
+          chain.fork_db_head_block_id() == block_state->id)
+         recorded.integrity_hash = chain.calculate_integrity_hash();
+
+      entries.state_deltas = async_thread_pool(*thread_pool, [compression = compression, recorded{std::move(recorded)}]() {
+         return state_history_compress(compression, fc::raw::pack(recorded));
+      });
+   } // store_state_deltas
 };   // state_history_plugin_impl
 
 state_history_plugin::state_history_plugin()
@@ -511,6 +848,28 @@ void state_history_plugin::set_program_options(options_description& cli, options
    cli.add_options()("delete-state-history", bpo::bool_switch()->default_value(false), "clear state history files");
    options("trace-history", bpo::bool_switch()->default_value(false), "enable trace history");
    options("chain-state-history", bpo::bool_switch()->default_value(false), "enable chain state history");
+   options("state-delta-history", bpo::bool_switch()->default_value(false),
+           "record the complete state changes of every block so that a replay can apply them instead of executing "
+           "the blocks");
+   options("state-delta-history-hash-interval", bpo::value<uint32_t>()->default_value(10000),
+           "record the integrity hash of the state every this many blocks in the state delta history, replays "
+           "from state deltas check it. Computing the hash walks the whole state database (0 to disable)");
+   options("state-history-threads", bpo::value<uint16_t>()->default_value(2),
+           "number of threads packing and compressing state history entries");
+   options("state-history-max-queued-blocks", bpo::value<uint32_t>()->default_value(16),
+           "maximum number of blocks whose state history is waiting to be compressed and written, block application "
+           "waits when it is reached");
+   options("state-history-compression", bpo::value<string>()->default_value("zlib"),
+           "compression of new state history entries: none, zlib or zstd (when built with zstd support), optionally "
+           "followed by :<level>, e.g. zlib:1. Entries already in the logs keep their compression");
+   cli.add_options()("benchmark-state-history-codecs", bpo::value<uint32_t>()->implicit_value(1000),
+                     "compress and decompress the entries of the newest blocks (1000 by default) in the trace and "
+                     "chain state history with every available compression, report their throughput and exit");
+   cli.add_options()("replay-from-state-deltas", bpo::bool_switch()->default_value(false),
+                     "when replaying the block log, apply the state changes recorded by --state-delta-history "
+                     "instead of executing the blocks they cover");
+   options("state-history-max-blocks-per-message", bpo::value<uint32_t>()->default_value(1000),
+           "upper bound on the max_blocks_per_message of get_blocks_request_v2");
    options("state-history-endpoint", bpo::value<string>()->default_value("127.0.0.1:8080"),
            "the endpoint upon which to listen for incoming connections. Caution: only expose this port to "
            "your internal network.");
@@ -521,9 +880,25 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
       GST_ASSERT(options.at("disable-replay-opts").as<bool>(), plugin_exception,
                  "state_history_plugin requires --disable-replay-opts");
 
+      auto threads = options.at("state-history-threads").as<uint16_t>();
+      GST_ASSERT(threads > 0, plugin_config_exception, "state-history-threads ${num} must be greater than 0",
+                 ("num", threads));
+      my->max_queued_blocks = options.at("state-history-max-queued-blocks").as<uint32_t>();
+      GST_ASSERT(my->max_queued_blocks > 0, plugin_config_exception,
+                 "state-history-max-queued-blocks ${num} must be greater than 0", ("num", my->max_queued_blocks));
+      my->max_blocks_per_message = options.at("state-history-max-blocks-per-message").as<uint32_t>();
+      GST_ASSERT(my->max_blocks_per_message > 0, plugin_config_exception,
+                 "state-history-max-blocks-per-message ${num} must be greater than 0",
+                 ("num", my->max_blocks_per_message));
+      my->compression = parse_state_history_compression(options.at("state-history-compression").as<string>());
+      my->thread_pool.emplace(threads);
+      my->write_thread.emplace(1);
+
       my->chain_plug = app().find_plugin<chain_plugin>();
       GST_ASSERT(my->chain_plug, chain::missing_chain_plugin_exception, "");
       auto& chain = my->chain_plug->chain();
+      GST_ASSERT(chain.db().get_undo_mode() == chainbase::undo_mode::map, plugin_exception,
+                 "state_history_plugin reads the undo history of the state database and requires --database-undo-mode=map");
       my->applied_transaction_connection.emplace(
           chain.applied_transaction.connect([&](const transaction_trace_ptr& p) { my->on_applied_transaction(p); }));
       my->accepted_block_connection.emplace(
@@ -555,6 +930,25 @@ void state_history_plugin::plugin_initialize(const variables_map& options) {
       if (options.at("chain-state-history").as<bool>())
          my->chain_state_log.emplace("chain_state_history", (state_history_dir / "chain_state_history.log").string(),
                                      (state_history_dir / "chain_state_history.index").string());
+      my->chain_state_log_started =
+          my->chain_state_log && my->chain_state_log->begin_block() != my->chain_state_log->end_block();
+      if (options.at("state-delta-history").as<bool>()) {
+         my->state_delta_log.emplace("state_delta_history", (state_history_dir / "state_delta_history.log").string(),
+                                     (state_history_dir / "state_delta_history.index").string());
+         my->state_delta_hash_interval = options.at("state-delta-history-hash-interval").as<uint32_t>();
+      }
+
+      if (options.count("benchmark-state-history-codecs")) {
+         my->benchmark_codecs(options.at("benchmark-state-history-codecs").as<uint32_t>());
+         GST_THROW(node_management_success, "benchmarked state history codecs");
+      }
+
+      if (options.at("replay-from-state-deltas").as<bool>()) {
+         GST_ASSERT(my->state_delta_log, plugin_config_exception,
+                    "--replay-from-state-deltas requires --state-delta-history");
+         chain.set_replay_state_delta_source(
+             [&](const signed_block_ptr& block) { return my->get_state_deltas(block); });
+      }
    }
    FC_LOG_AND_RETHROW()
 } // state_history_plugin::plugin_initialize
@@ -564,6 +958,11 @@ void state_history_plugin::plugin_startup() { my->listen(); }
 void state_history_plugin::plugin_shutdown() {
    my->applied_transaction_connection.reset();
    my->accepted_block_connection.reset();
+   // finish writing the blocks that were already accepted
+   if (my->thread_pool)
+      my->thread_pool->join();
+   if (my->write_thread)
+      my->write_thread->join();
    while (!my->sessions.empty())
       my->sessions.begin()->second->close();
    my->stopping = true;
@@ -0,0 +1,92 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+
+#include <gstio/state_history_plugin/state_history_serialization.hpp>
+#include <gstio/state_history_plugin/state_history_session.hpp>
+
+namespace gstio {
+
+void append_big_bytes(std::vector<char>& out, const fc::optional<bytes>& v) {
+   fc::datastream<size_t> ps;
+   history_pack_big_bytes(ps, v);
+   auto pos = out.size();
+   out.resize(pos + ps.tellp());
+   fc::datastream<char*> ds(out.data() + pos, out.size() - pos);
+   history_pack_big_bytes(ds, v);
+}
+
+std::vector<char> transcode_entries(const std::vector<char>& message, const std::vector<message_entry>& entries,
+                                    const std::vector<std::string>& filter_tables,
+                                    const std::vector<chain::name>& filter_contracts) {
+   std::vector<char> result;
+   result.reserve(message.size());
+   size_t copied = 0;
+   for (auto& entry : entries) {
+      fc::datastream<const char*> ds(message.data() + entry.pos, message.size() - entry.pos);
+      bool                        present;
+      fc::unsigned_int            size;
+      fc::raw::unpack(ds, present);
+      fc::raw::unpack(ds, size);
+      GST_ASSERT(present && size.value <= ds.remaining(), chain::plugin_exception, "corrupt entry in message");
+      result.insert(result.end(), message.begin() + copied, message.begin() + entry.pos);
+      auto payload = state_history_decompress(entry.codec, ds.pos(), size.value);
+      if (entry.filter)
+         payload = filter_deltas(payload, filter_tables, filter_contracts);
+      append_big_bytes(result, state_history_compress(state_history_compression{entry.result_codec}, payload));
+      copied = ds.pos() - message.data() + size.value;
+   }
+   result.insert(result.end(), message.begin() + copied, message.end());
+   return result;
+}
+
+uint32_t newest_sendable_block(uint32_t current, const get_blocks_request_v0& req, const state_history_log* trace_log,
+                               const state_history_log* chain_state_log) {
+   auto limit = [&](bool fetch, const state_history_log* log) {
+      if (fetch && log)
+         current = std::min(current, log->end_block() ? log->end_block() - 1 : 0);
+   };
+   limit(req.fetch_traces, trace_log);
+   limit(req.fetch_deltas, chain_state_log);
+   return current;
+}
+
+uint32_t num_blocks_to_send(const get_blocks_request_v2& req, uint32_t current) {
+   if (req.start_block_num > current || req.start_block_num >= req.end_block_num)
+      return 0;
+   return std::min({req.max_blocks_per_message, current - req.start_block_num + 1,
+                    req.end_block_num - req.start_block_num});
+}
+
+bytes filter_deltas(const bytes& packed, const std::vector<std::string>& filter_tables,
+                    const std::vector<chain::name>& filter_contracts) {
+   auto                     deltas = fc::raw::unpack<std::vector<table_delta>>(packed);
+   std::vector<table_delta> result;
+   for (auto& delta : deltas) {
+      if (!filter_tables.empty() &&
+          std::find(filter_tables.begin(), filter_tables.end(), delta.name) == filter_tables.end())
+         continue;
+      if (!filter_contracts.empty() && !delta.name.compare(0, 9, "contract_")) {
+         // every contract_* row starts with its struct version and the code of its table
+         auto& rows = delta.rows.obj;
+         rows.erase(std::remove_if(rows.begin(), rows.end(),
+                                   [&](const std::pair<bool, bytes>& row) {
+                                      fc::datastream<const char*> ds(row.second.data(), row.second.size());
+                                      fc::unsigned_int            struct_version;
+                                      uint64_t                    code;
+                                      fc::raw::unpack(ds, struct_version);
+                                      fc::raw::unpack(ds, code);
+                                      return std::find(filter_contracts.begin(), filter_contracts.end(),
+                                                       chain::name(code)) == filter_contracts.end();
+                                   }),
+                    rows.end());
+         if (rows.empty())
+            continue;
+      }
+      result.push_back(std::move(delta));
+   }
+   return fc::raw::pack(result);
+}
+
+} // namespace gstio
@@ -108,11 +108,12 @@ void blocklog::read_log() {
           *out << fc::json::to_pretty_string(v) << "\n";
    };
    bool contains_obj = false;
-   while((block_num <= last_block) && (next = block_logger.read_block_by_num( block_num ))) {
+   for (const auto& entry : block_logger.read_block_range( block_num, last_block )) {
       if (as_json_array && contains_obj)
          *out << ",";
+      next = entry.block();
       print_block(next);
-      ++block_num;
+      block_num = entry.block_num + 1;
       contains_obj = true;
    }
    if (reversible_blocks) {
@@ -122,4 +122,33 @@ BOOST_FIXTURE_TEST_CASE( get_block_with_invalid_abi, TESTER ) try {
 
 } FC_LOG_AND_RETHROW() /// get_block_with_invalid_abi
 
+BOOST_FIXTURE_TEST_CASE( get_block_json_matches_get_block, TESTER ) try {
+   produce_blocks(2);
+
+   create_accounts( {N(asserter)} );
+   produce_block();
+   set_code( N(asserter), contracts::asserter_wasm() );
+   set_abi( N(asserter), contracts::asserter_abi().data() );
+   produce_blocks(1);
+
+   push_action( N(asserter), N(procassert), N(asserter), mutable_variant_object()
+      ("condition", 1)
+      ("message", "Should Not Assert!")
+   );
+   produce_blocks(1);
+
+   chain_apis::read_only plugin(*(this->control), fc::microseconds::maximum());
+   auto head = control->head_block_state();
+   for( const auto& block_num_or_id : { std::to_string( head->block_num ), std::string( head->id ), std::string( "1" ) } ) {
+      chain_apis::read_only::get_block_params param{block_num_or_id};
+      BOOST_TEST_CONTEXT( block_num_or_id ) {
+         BOOST_REQUIRE_EQUAL( plugin.get_block_json( param ), json::to_string( plugin.get_block( param ) ) );
+      }
+   }
+   // the block holding the action is decoded with the abi of its contract
+   chain_apis::read_only::get_block_params param{std::to_string( head->block_num )};
+   BOOST_TEST( plugin.get_block_json( param ).find( "Should Not Assert!" ) != std::string::npos );
+
+} FC_LOG_AND_RETHROW() /// get_block_json_matches_get_block
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,274 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <gstio/state_history_plugin/state_history_serialization.hpp>
+#include <gstio/state_history_plugin/state_history_session.hpp>
+
+#include <fc/filesystem.hpp>
+
+using namespace gstio;
+using namespace gstio::chain;
+
+namespace {
+   block_id_type make_block_id( uint32_t block_num ) {
+      return fc::sha256::hash( std::to_string( block_num ) );
+   }
+
+   // appends entries with an empty payload for the blocks [begin, end)
+   void write_blocks( state_history_log& log, uint32_t begin, uint32_t end ) {
+      for( auto block_num = begin; block_num < end; ++block_num ) {
+         state_history_log_header header{ .block_num = block_num, .block_id = make_block_id( block_num ) };
+         log.write_entry( header, make_block_id( block_num - 1 ), []( auto& ) {} );
+      }
+   }
+
+   bytes sample_payload() {
+      bytes result;
+      for( uint32_t i = 0; i < 10000; ++i )
+         result.push_back( char( i % 7 + (i / 1000) ) );
+      return result;
+   }
+
+   vector<state_history_compression> supported_compressions() {
+      vector<state_history_compression> result{ { state_history_codec::none }, { state_history_codec::zlib },
+                                                { state_history_codec::zlib, 1 }, { state_history_codec::zlib, 9 } };
+      if( is_supported( state_history_codec::zstd ) ) {
+         result.push_back( { state_history_codec::zstd } );
+         result.push_back( { state_history_codec::zstd, 19 } );
+      }
+      return result;
+   }
+
+   // a contract_* row of the table of code
+   std::pair<bool, bytes> contract_row( account_name code, uint64_t primary_key ) {
+      return { true, fc::raw::pack( fc::unsigned_int( 0 ), code.value, uint64_t(N(table)), primary_key ) };
+   }
+
+   table_delta make_delta( const std::string& name, std::vector<std::pair<bool, bytes>> rows ) {
+      table_delta delta;
+      delta.name     = name;
+      delta.rows.obj = std::move( rows );
+      return delta;
+   }
+
+   vector<table_delta> sample_deltas() {
+      return { make_delta( "account", { { true, bytes{ 'a' } } } ),
+               make_delta( "contract_row", { contract_row( N(alice), 1 ), contract_row( N(bob), 2 ),
+                                             contract_row( N(alice), 3 ) } ),
+               make_delta( "contract_index64", { contract_row( N(bob), 4 ) } ),
+               make_delta( "permission", { { false, bytes{ 'p' } } } ) };
+   }
+
+   // table names and the primary keys of the contract rows
+   vector<std::string> summarize( const bytes& packed ) {
+      vector<std::string> result;
+      for( const auto& delta : fc::raw::unpack<vector<table_delta>>( packed ) ) {
+         std::string s = delta.name;
+         if( !delta.name.compare( 0, 9, "contract_" ) ) {
+            for( const auto& row : delta.rows.obj ) {
+               fc::datastream<const char*> ds( row.second.data(), row.second.size() );
+               fc::unsigned_int struct_version;
+               uint64_t code, table, primary_key;
+               fc::raw::unpack( ds, struct_version );
+               fc::raw::unpack( ds, code );
+               fc::raw::unpack( ds, table );
+               fc::raw::unpack( ds, primary_key );
+               s += " " + std::to_string( primary_key );
+            }
+         }
+         result.push_back( s );
+      }
+      return result;
+   }
+
+   struct logs {
+      fc::temp_directory dir;
+      state_history_log  trace_log{ "trace_history", (dir.path() / "trace_history.log").string(),
+                                    (dir.path() / "trace_history.index").string() };
+      state_history_log  chain_state_log{ "chain_state_history", (dir.path() / "chain_state_history.log").string(),
+                                          (dir.path() / "chain_state_history.index").string() };
+   };
+}
+
+BOOST_AUTO_TEST_SUITE(state_history_tests)
+
+BOOST_AUTO_TEST_CASE(blocks_at_head_wait_for_their_entries) {
+   logs l;
+   get_blocks_request_v0 req;
+   req.fetch_traces = true;
+   req.fetch_deltas = true;
+
+   // nothing was written yet
+   BOOST_REQUIRE_EQUAL( newest_sendable_block( 10, req, &l.trace_log, &l.chain_state_log ), 0u );
+
+   // head is 10, the traces of blocks 2-8 and the chain state of blocks 2-6 are written
+   write_blocks( l.trace_log, 2, 9 );
+   write_blocks( l.chain_state_log, 2, 7 );
+   BOOST_REQUIRE_EQUAL( newest_sendable_block( 10, req, &l.trace_log, &l.chain_state_log ), 6u );
+
+   // only the logs the request fetches from limit it
+   req.fetch_deltas = false;
+   BOOST_REQUIRE_EQUAL( newest_sendable_block( 10, req, &l.trace_log, &l.chain_state_log ), 8u );
+   req.fetch_traces = false;
+   BOOST_REQUIRE_EQUAL( newest_sendable_block( 10, req, &l.trace_log, &l.chain_state_log ), 10u );
+
+   // disabled logs never get entries
+   req.fetch_traces = true;
+   req.fetch_deltas = true;
+   BOOST_REQUIRE_EQUAL( newest_sendable_block( 10, req, nullptr, nullptr ), 10u );
+
+   // the logs may hold blocks past the last irreversible block or a head that switched to a shorter fork
+   BOOST_REQUIRE_EQUAL( newest_sendable_block( 4, req, &l.trace_log, &l.chain_state_log ), 4u );
+
+   // the blocks at head are sent once their entries are written
+   write_blocks( l.chain_state_log, 7, 11 );
+   write_blocks( l.trace_log, 9, 11 );
+   BOOST_REQUIRE_EQUAL( newest_sendable_block( 10, req, &l.trace_log, &l.chain_state_log ), 10u );
+}
+
+BOOST_AUTO_TEST_CASE(codec_round_trip) {
+   auto payload = sample_payload();
+   for( const auto& c : supported_compressions() ) {
+      BOOST_TEST_CONTEXT( to_string( c ) ) {
+         auto compressed = state_history_compress( c, payload );
+         if( c.codec != state_history_codec::none )
+            BOOST_REQUIRE_LT( compressed.size(), payload.size() );
+         BOOST_REQUIRE( state_history_decompress( c.codec, compressed ) == payload );
+         BOOST_REQUIRE( state_history_decompress( c.codec, state_history_compress( c, bytes() ) ).empty() );
+
+         auto parsed = parse_state_history_compression( to_string( c ) );
+         BOOST_REQUIRE( parsed.codec == c.codec );
+         BOOST_REQUIRE_EQUAL( parsed.level, c.level );
+      }
+   }
+   BOOST_REQUIRE_THROW( parse_state_history_compression( "lz4" ), plugin_config_exception );
+   BOOST_REQUIRE_THROW( parse_state_history_compression( "zlib:10" ), plugin_config_exception );
+   BOOST_REQUIRE_THROW( parse_state_history_compression( "none:1" ), plugin_config_exception );
+}
+
+BOOST_AUTO_TEST_CASE(log_entries_keep_their_codec) {
+   logs l;
+   auto payload = sample_payload();
+
+   // entries written before codecs were selectable are version 0 and zlib compressed without a codec in front
+   auto zlib_payload = state_history_compress( state_history_compression{}, payload );
+   state_history_log_header header{ .block_num    = 2,
+                                    .block_id     = make_block_id( 2 ),
+                                    .payload_size = sizeof(uint32_t) + zlib_payload.size(),
+                                    .version      = 0 };
+   l.trace_log.write_entry( header, make_block_id( 1 ), [&]( auto& stream ) {
+      uint32_t s = (uint32_t)zlib_payload.size();
+      stream.write( (char*)&s, sizeof(s) );
+      stream.write( zlib_payload.data(), zlib_payload.size() );
+   } );
+
+   auto compressions = supported_compressions();
+   uint32_t block_num = 3;
+   for( const auto& c : compressions ) {
+      write_compressed_entry( l.trace_log, block_num, make_block_id( block_num ), make_block_id( block_num - 1 ),
+                              c.codec, state_history_compress( c, payload ) );
+      ++block_num;
+   }
+
+   auto read = [&]( uint32_t block_num, state_history_codec& codec ) {
+      uint32_t size;
+      auto& stream = get_compressed_entry( l.trace_log, block_num, codec, size );
+      bytes compressed( size );
+      stream.read( compressed.data(), size );
+      return state_history_decompress( codec, compressed );
+   };
+   state_history_codec codec;
+   BOOST_REQUIRE( read( 2, codec ) == payload );
+   BOOST_REQUIRE( codec == state_history_codec::zlib );
+   for( uint32_t i = 0; i < compressions.size(); ++i ) {
+      BOOST_REQUIRE( read( 3 + i, codec ) == payload );
+      BOOST_REQUIRE( codec == compressions[i].codec );
+   }
+}
+
+BOOST_AUTO_TEST_CASE(recompress_entries_of_message) {
+   auto payload = sample_payload();
+   fc::optional<bytes> block{ bytes{ 'b', 'l', 'o', 'c', 'k' } };
+   vector<char> message;
+   append_packed( message, uint32_t(1234) );
+   vector<message_entry> entries;
+   for( const auto& c : supported_compressions() ) {
+      entries.push_back( { message.size(), c.codec, state_history_codec::zlib } );
+      append_big_bytes( message, state_history_compress( c, payload ) );
+      append_big_bytes( message, block );
+   }
+
+   auto result = transcode_entries( message, entries );
+   fc::datastream<const char*> ds( result.data(), result.size() );
+   uint32_t header;
+   fc::raw::unpack( ds, header );
+   BOOST_REQUIRE_EQUAL( header, 1234u );
+   for( uint32_t i = 0; i < entries.size(); ++i ) {
+      fc::optional<bytes> entry, unchanged;
+      fc::raw::unpack( ds, entry );
+      fc::raw::unpack( ds, unchanged );
+      BOOST_REQUIRE( entry );
+      BOOST_REQUIRE( state_history_decompress( state_history_codec::zlib, *entry ) == payload );
+      BOOST_REQUIRE( unchanged == block );
+   }
+   BOOST_REQUIRE_EQUAL( ds.remaining(), 0u );
+}
+
+BOOST_AUTO_TEST_CASE(max_blocks_per_message) {
+   get_blocks_request_v2 req;
+   req.start_block_num        = 10;
+   req.end_block_num          = 100;
+   req.max_blocks_per_message = 5;
+   BOOST_REQUIRE_EQUAL( num_blocks_to_send( req, 50 ), 5u );
+   // never past the newest block that can be sent
+   BOOST_REQUIRE_EQUAL( num_blocks_to_send( req, 12 ), 3u );
+   BOOST_REQUIRE_EQUAL( num_blocks_to_send( req, 10 ), 1u );
+   BOOST_REQUIRE_EQUAL( num_blocks_to_send( req, 9 ), 0u );
+   // nor past the end of the request
+   req.end_block_num = 13;
+   BOOST_REQUIRE_EQUAL( num_blocks_to_send( req, 50 ), 3u );
+   req.start_block_num = 13;
+   BOOST_REQUIRE_EQUAL( num_blocks_to_send( req, 50 ), 0u );
+
+   req.start_block_num        = 1;
+   req.end_block_num          = std::numeric_limits<uint32_t>::max();
+   req.max_blocks_per_message = 1;
+   BOOST_REQUIRE_EQUAL( num_blocks_to_send( req, 50 ), 1u );
+}
+
+BOOST_AUTO_TEST_CASE(filter_tables) {
+   auto packed = fc::raw::pack( sample_deltas() );
+   BOOST_REQUIRE( summarize( filter_deltas( packed, {}, {} ) ) ==
+                  vector<std::string>( { "account", "contract_row 1 2 3", "contract_index64 4", "permission" } ) );
+   BOOST_REQUIRE( summarize( filter_deltas( packed, { "permission", "contract_row" }, {} ) ) ==
+                  vector<std::string>( { "contract_row 1 2 3", "permission" } ) );
+   BOOST_REQUIRE( summarize( filter_deltas( packed, { "resource_usage" }, {} ) ).empty() );
+}
+
+BOOST_AUTO_TEST_CASE(filter_contracts) {
+   auto packed = fc::raw::pack( sample_deltas() );
+   // only contract_* tables lose rows, tables left without rows are dropped
+   BOOST_REQUIRE( summarize( filter_deltas( packed, {}, { N(alice) } ) ) ==
+                  vector<std::string>( { "account", "contract_row 1 3", "permission" } ) );
+   BOOST_REQUIRE( summarize( filter_deltas( packed, {}, { N(bob), N(carol) } ) ) ==
+                  vector<std::string>( { "account", "contract_row 2", "contract_index64 4", "permission" } ) );
+   BOOST_REQUIRE( summarize( filter_deltas( packed, { "contract_row" }, { N(bob) } ) ) ==
+                  vector<std::string>( { "contract_row 2" } ) );
+
+   // entries of a message are filtered while they are recompressed
+   auto         zlib = state_history_compression{};
+   vector<char> message;
+   append_big_bytes( message, state_history_compress( zlib, packed ) );
+   auto result = transcode_entries( message, { { 0, zlib.codec, zlib.codec, true } }, {}, { N(alice) } );
+   fc::datastream<const char*> ds( result.data(), result.size() );
+   fc::optional<bytes> entry;
+   fc::raw::unpack( ds, entry );
+   BOOST_REQUIRE( entry );
+   BOOST_REQUIRE( summarize( state_history_decompress( zlib.codec, *entry ) ) ==
+                  vector<std::string>( { "account", "contract_row 1 3", "permission" } ) );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -17,6 +17,7 @@
 
 #include <gstio/chain/contract_types.hpp>
 #include <gstio/chain/abi_serializer.hpp>
+#include <gstio/chain/abi_serializer_cache.hpp>
 #include <gstio/chain/gstio_contract.hpp>
 #include <gstio/testing/tester.hpp>
 
@@ -55,6 +56,9 @@ void verify_round_trip_conversion( const abi_serializer& abis, const type_name&
    BOOST_REQUIRE_EQUAL(fc::to_hex(bytes), hex);
    auto var2 = abis.binary_to_variant(type, bytes, max_serialization_time);
    BOOST_REQUIRE_EQUAL(fc::json::to_string(var2), expected_json);
+   std::string json2;
+   abis.binary_to_json(type, bytes, json2, max_serialization_time);
+   BOOST_REQUIRE_EQUAL(json2, expected_json);
    auto bytes2 = abis.variant_to_binary(type, var2, max_serialization_time);
    BOOST_REQUIRE_EQUAL(fc::to_hex(bytes2), hex);
 }
@@ -1563,6 +1567,10 @@ BOOST_AUTO_TEST_CASE(packed_transaction)
    fc::variant var;
    abi_serializer::to_variant(packed_txn, var, get_resolver(fc::json::from_string(packed_transaction_abi).as<abi_def>()), max_serialization_time);
 
+   std::string json;
+   abi_serializer::to_json(packed_txn, json, get_resolver(fc::json::from_string(packed_transaction_abi).as<abi_def>()), max_serialization_time);
+   BOOST_REQUIRE_EQUAL(json, fc::json::to_string(var));
+
    chain::packed_transaction packed_txn2;
    abi_serializer::from_variant(var, packed_txn2, get_resolver(fc::json::from_string(packed_transaction_abi).as<abi_def>()), max_serialization_time);
 
@@ -2212,6 +2220,40 @@ BOOST_AUTO_TEST_CASE(abi_very_deep_structs)
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(abi_large_nested_benchmark)
+{
+   try {
+      abi_serializer abis( fc::json::from_string( large_nested_abi ).as<abi_def>(), max_serialization_time );
+
+      // every sN holds three copies of sN-1, so s8 packs 3^8 int64 leaves
+      fc::variant var( int64_t(7) );
+      for( int i = 0; i <= 8; ++i )
+         var = mutable_variant_object()("f1", var);
+      auto bin = abis.variant_to_binary( "s8", var, max_serialization_time );
+      BOOST_REQUIRE_EQUAL( bin.size(), 6561 * sizeof(int64_t) );
+
+      const int rounds = 20;
+      fc::variant unpacked;
+      auto start = fc::time_point::now();
+      for( int i = 0; i < rounds; ++i )
+         unpacked = abis.binary_to_variant( "s8", bin, max_serialization_time );
+      auto to_variant = fc::time_point::now() - start;
+      start = fc::time_point::now();
+      for( int i = 0; i < rounds; ++i )
+         abis.variant_to_binary( "s8", unpacked, max_serialization_time );
+      auto to_binary = fc::time_point::now() - start;
+
+      BOOST_REQUIRE( abis.variant_to_binary( "s8", unpacked, max_serialization_time ) == bin );
+      BOOST_TEST_MESSAGE( "large_nested s8 (" << bin.size() << " bytes): " << to_variant.count() / rounds << " us binary_to_variant, "
+                          << to_binary.count() / rounds << " us variant_to_binary" );
+
+      // copies compile plans against their own definitions
+      abi_serializer copy( abis );
+      abis = abi_serializer();
+      BOOST_REQUIRE( copy.variant_to_binary( "s8", var, max_serialization_time ) == bin );
+   } FC_LOG_AND_RETHROW()
+}
+
 // Infinite recursion of abi_serializer in struct definitions
 BOOST_AUTO_TEST_CASE(abi_very_deep_structs_1ms)
 {
@@ -2222,6 +2264,29 @@ BOOST_AUTO_TEST_CASE(abi_very_deep_structs_1ms)
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(abi_deep_struct_chain)
+{
+   try {
+      // c00 nests 40 structs deep, more than a plan or a serialization may recurse
+      abi_def def;
+      def.version = "gstio::abi/1.0";
+      for( int i = 0; i < 40; ++i ) {
+         auto type_name = [](int n) { return string("c") + char('0' + n / 10) + char('0' + n % 10); };
+         def.structs.push_back( struct_def{ type_name( i ), "", { field_def{ "f", i == 39 ? string("int8") : type_name( i + 1 ) } } } );
+      }
+      abi_serializer abis( def, max_serialization_time );
+      abi_serializer copy( abis );
+
+      fc::variant var( int8_t(3) );
+      for( int i = 39; i >= 30; --i )
+         var = mutable_variant_object()("f", var);
+      auto bin = copy.variant_to_binary( "c30", var, max_serialization_time );
+      BOOST_REQUIRE_EQUAL( fc::json::to_string( copy.binary_to_variant( "c30", bin, max_serialization_time ) ), fc::json::to_string( var ) );
+
+      BOOST_CHECK_THROW( abis.binary_to_variant( "c00", bin, max_serialization_time ), abi_recursion_depth_exception );
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_CASE(abi_deep_structs_validate)
 {
    try {
@@ -2720,4 +2785,75 @@ BOOST_AUTO_TEST_CASE(abi_deserialize_detailed_error_messages)
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE(abi_serializer_cache_lru)
+{
+   try {
+      abi_serializer_cache cache( 2 );
+      uint32_t made = 0;
+      auto make = [&]() { ++made; return std::make_shared<const abi_serializer>(); };
+
+      auto a1 = cache.get( N(alice), 1, make );
+      BOOST_CHECK( a1 == cache.get( N(alice), 1, make ) );
+      BOOST_CHECK_EQUAL( made, 1u );
+
+      // a newer sequence replaces the entry, an older one is built but not cached
+      auto a2 = cache.get( N(alice), 2, make );
+      BOOST_CHECK( a1 != a2 );
+      BOOST_CHECK( a2 != cache.get( N(alice), 1, make ) );
+      BOOST_CHECK( a2 == cache.get( N(alice), 2, make ) );
+      BOOST_CHECK_EQUAL( made, 3u );
+
+      cache.get( N(bob), 1, make );
+      cache.get( N(carol), 1, make ); // evicts alice
+      cache.get( N(alice), 2, make );
+      BOOST_CHECK_EQUAL( made, 6u );
+
+      cache.erase( N(alice) );
+      cache.get( N(alice), 2, make );
+      BOOST_CHECK_EQUAL( made, 7u );
+
+      auto s = cache.get_stats();
+      BOOST_CHECK_EQUAL( s.hits, 2u );
+      BOOST_CHECK_EQUAL( s.misses, 7u );
+      BOOST_CHECK_EQUAL( s.evictions, 2u );
+      BOOST_CHECK_EQUAL( s.size, 2u );
+
+      // missing ABIs are looked up again, they may show up at the same sequence
+      cache.get( N(dave), 0, [&]() { ++made; return abi_serializer_cache::abi_serializer_ptr(); } );
+      BOOST_CHECK( cache.get( N(dave), 0, make ) );
+      BOOST_CHECK_EQUAL( made, 9u );
+
+      abi_serializer_cache disabled( 0 );
+      BOOST_CHECK( disabled.get( N(alice), 1, make ) != disabled.get( N(alice), 1, make ) );
+      BOOST_CHECK_EQUAL( disabled.get_stats().size, 0u );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE(abi_serializer_cache_setabi)
+{
+   try {
+      gstio::testing::tester t;
+      t.create_accounts( {N(abicache)} );
+      t.produce_block();
+
+      abi_serializer_cache cache( 8 );
+      const auto& db = t.control->db();
+      BOOST_CHECK( !cache.get( db, N(abicache), max_serialization_time ) );
+
+      t.set_abi( N(abicache), my_abi );
+      t.produce_block();
+      auto first = cache.get( db, N(abicache), max_serialization_time );
+      BOOST_REQUIRE( first );
+      BOOST_CHECK( first == cache.get( db, N(abicache), max_serialization_time ) );
+      BOOST_CHECK( first->get_struct( "A" ).fields.size() > 0 );
+
+      t.set_abi( N(abicache), R"=====({"version": "gstio::abi/1.0", "structs": [{"name": "B", "base": "", "fields": [{"name": "b", "type": "uint8"}]}]})=====" );
+      t.produce_block();
+      auto second = cache.get( db, N(abicache), max_serialization_time );
+      BOOST_REQUIRE( second );
+      BOOST_CHECK( first != second );
+      BOOST_CHECK( second->get_struct( "B" ).fields.size() == 1 );
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
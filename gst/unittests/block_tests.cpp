@@ -4,6 +4,8 @@
  */
 #include <boost/test/unit_test.hpp>
 #include <gstio/testing/tester.hpp>
+#include <gstio/chain/block_log.hpp>
+#include <gstio/net_plugin/protocol.hpp>
 
 using namespace gstio;
 using namespace testing;
@@ -163,4 +165,170 @@ BOOST_AUTO_TEST_CASE(untrusted_producer_test)
    }) ;
 }
 
+BOOST_AUTO_TEST_CASE(relayable_message_test) try {
+   tester chain;
+   auto b = chain.produce_block();
+   // a signed_block net_message, as packed for sending
+   auto pack_message = []( const signed_block& blk ) {
+      auto message = fc::raw::pack( fc::unsigned_int( gstio::net_message::tag<signed_block>::value ) );
+      auto packed = fc::raw::pack( blk );
+      message.insert( message.end(), packed.begin(), packed.end() );
+      return message;
+   };
+   auto body = pack_message( *b );
+
+   signed_block unpacked;
+   fc::datastream<const char*> exact( body.data(), body.size() );
+   BOOST_REQUIRE( gstio::unpack_relayable( exact, unpacked ) );
+   BOOST_REQUIRE( pack_message( unpacked ) == body );
+
+   // trailing bytes still unpack to the same block, but relaying them would forward more than the block
+   auto padded = body;
+   padded.resize( body.size() + 16 );
+   fc::datastream<const char*> ds( padded.data(), padded.size() );
+   BOOST_REQUIRE( !gstio::unpack_relayable( ds, unpacked ) );
+   BOOST_REQUIRE_EQUAL( unpacked.id(), b->id() );
+   BOOST_REQUIRE( pack_message( unpacked ) == body );
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE(block_log_range_test) try {
+   tester chain;
+   chain.produce_blocks(20);
+   auto lib = chain.control->last_irreversible_block_num();
+   BOOST_REQUIRE_GT( lib, 10 );
+
+   block_log blog( chain.get_config().blocks_dir );
+
+   uint32_t expected = 2;
+   for( const auto& entry : blog.read_block_range( 2, 10 ) ) {
+      BOOST_REQUIRE_EQUAL( entry.block_num, expected );
+      BOOST_REQUIRE_EQUAL( entry.pos, blog.get_block_pos( expected ) );
+      auto b = chain.control->fetch_block_by_number( expected );
+      BOOST_REQUIRE( fc::raw::pack( *b ) == std::vector<char>( entry.data, entry.data + entry.size ) );
+      BOOST_REQUIRE_EQUAL( entry.block()->id(), b->id() );
+      ++expected;
+   }
+   BOOST_REQUIRE_EQUAL( expected, 11u );
+
+   // the range is clamped to the blocks in the log
+   auto range = blog.read_block_range( 0, std::numeric_limits<uint32_t>::max() );
+   BOOST_REQUIRE_EQUAL( range.first(), blog.first_block_num() );
+   BOOST_REQUIRE_EQUAL( range.last(), blog.head()->block_num() );
+   BOOST_REQUIRE_EQUAL( uint32_t(std::distance( range.begin(), range.end() )), range.last() - range.first() + 1 );
+   BOOST_REQUIRE( blog.read_block_range( lib + 1000, lib + 2000 ).empty() );
+
+   // the controller serves the same bytes, reversible blocks are not in the log yet
+   auto served = chain.control->fetch_block_log_range( 1, chain.control->head_block_num() );
+   BOOST_REQUIRE_EQUAL( served.last(), lib );
+   for( const auto& entry : served ) {
+      auto b = chain.control->fetch_block_by_number( entry.block_num );
+      BOOST_REQUIRE( fc::raw::pack( *b ) == std::vector<char>( entry.data, entry.data + entry.size ) );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE(block_log_segments_test) try {
+   tester chain;
+   chain.produce_blocks(30);
+   auto lib = chain.control->last_irreversible_block_num();
+   BOOST_REQUIRE_GT( lib, 26 );
+
+   fc::temp_directory tempdir;
+   block_log_config cfg;
+   cfg.blocks_per_segment = 8;
+   cfg.compress_segments = true;
+   cfg.retained_segments = 1;
+
+   auto check_blocks = [&]( block_log& blog ) {
+      BOOST_REQUIRE_EQUAL( blog.first_block_num(), 1u );
+      BOOST_REQUIRE_EQUAL( blog.head()->block_num(), lib );
+      uint32_t expected = 1;
+      for( const auto& entry : blog.read_block_range( 1, lib ) ) {
+         BOOST_REQUIRE_EQUAL( entry.block()->id(), chain.control->fetch_block_by_number( expected )->id() );
+         ++expected;
+      }
+      BOOST_REQUIRE_EQUAL( expected, lib + 1 );
+      BOOST_REQUIRE_EQUAL( blog.read_block_by_num( 12 )->id(), chain.control->fetch_block_by_number( 12 )->id() );
+   };
+
+   {
+      block_log blog( tempdir.path(), cfg );
+      blog.reset( chain.get_config().genesis, chain.control->fetch_block_by_number( 1 ) );
+      for( uint32_t n = 2; n <= lib; ++n )
+         blog.append( chain.control->fetch_block_by_number( n ) );
+      check_blocks( blog );
+      BOOST_REQUIRE_EQUAL( block_log::extract_genesis_state( tempdir.path() ).compute_chain_id(), chain.control->get_chain_id() );
+   }
+
+   // sealed segments are picked up again and a lost segment index is rebuilt
+   fc::remove( tempdir.path() / "blocks-0000000009-0000000016.index" );
+   fc::remove( tempdir.path() / "archive" / "blocks-0000000009-0000000016.index" );
+   {
+      block_log blog( tempdir.path(), cfg );
+      check_blocks( blog );
+      // archived segments are only removed by a reset when allowed, the log is left intact otherwise
+      BOOST_REQUIRE_THROW( blog.reset( chain.get_config().genesis, chain.control->fetch_block_by_number( 1 ) ), block_log_exception );
+      check_blocks( blog );
+   }
+
+   // decompressed segments in use are capped, but a single one is always allowed
+   {
+      auto capped = cfg;
+      capped.decompressed_cache_size = 1;
+      block_log blog( tempdir.path(), capped );
+      check_blocks( blog );
+      auto first = blog.read_block_range( 1, 8 );
+      auto itr = first.begin();
+      auto second = blog.read_block_range( 9, 16 );
+      BOOST_REQUIRE_THROW( second.begin(), block_log_exception );
+      itr = block_log_range::iterator();
+      BOOST_REQUIRE_EQUAL( second.begin()->block_num, 9u );
+   }
+
+   {
+      auto removing = cfg;
+      removing.remove_archive_on_reset = true;
+      block_log blog( tempdir.path(), removing );
+      blog.reset( chain.get_config().genesis, chain.control->fetch_block_by_number( 1 ) );
+      BOOST_REQUIRE_EQUAL( blog.head()->block_num(), 1u );
+      BOOST_REQUIRE( !fc::exists( tempdir.path() / "archive" / "blocks-0000000001-0000000008.log.zlib" ) );
+   }
+} FC_LOG_AND_RETHROW()
+
+BOOST_AUTO_TEST_CASE(replay_pipelined_test) try {
+   tester chain;
+   // a transaction every 100 blocks gives the key recovery stage signatures to recover
+   for( uint32_t i = 0; i < 6; ++i ) {
+      chain.create_account( account_name( std::string( "replay" ) + char( 'a' + i ) ) );
+      chain.produce_blocks( 100 );
+   }
+   auto lib = chain.control->last_irreversible_block_num();
+   BOOST_REQUIRE_GT( lib, 500 );
+
+   // replays the irreversible blocks of the chain into a new state, shutdown is asked for at every 500th block
+   fc::temp_directory tempdir;
+   int ordinal = 0;
+   auto replay = [&]( uint32_t lookahead, bool shutdown, uint32_t expected_head ) {
+      auto cfg = chain.get_config();
+      cfg.blocks_dir = tempdir.path() / std::to_string( ordinal ) / config::default_blocks_dir_name;
+      cfg.state_dir = tempdir.path() / std::to_string( ordinal ) / config::default_state_dir_name;
+      ++ordinal;
+      cfg.replay_lookahead_blocks = lookahead;
+      cfg.force_all_checks = true;
+      fc::create_directories( cfg.blocks_dir );
+      fc::copy( chain.get_config().blocks_dir / "blocks.log", cfg.blocks_dir / "blocks.log" );
+      fc::copy( chain.get_config().blocks_dir / "blocks.index", cfg.blocks_dir / "blocks.index" );
+
+      controller replayed( cfg );
+      replayed.add_indices();
+      replayed.startup( [shutdown]() { return shutdown; } );
+      BOOST_REQUIRE_EQUAL( replayed.head_block_num(), expected_head );
+      BOOST_REQUIRE_EQUAL( replayed.head_block_id(), chain.control->fetch_block_by_number( expected_head )->id() );
+      return replayed.calculate_integrity_hash();
+   };
+
+   auto serial = replay( 0, false, lib );
+   BOOST_REQUIRE_EQUAL( replay( 2, false, lib ).str(), serial.str() );
+   BOOST_REQUIRE_EQUAL( replay( 2, true, 500 ).str(), replay( 0, true, 500 ).str() );
+} FC_LOG_AND_RETHROW()
+
 BOOST_AUTO_TEST_SUITE_END()
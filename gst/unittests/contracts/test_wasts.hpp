@@ -646,4 +646,24 @@ static const char large_maligned_host_ptr[] = R"=====(
    ))
  )
 )
-)=====";
\ No newline at end of file
+)=====";
+static const char runtime_benchmark_wast[] = R"=====(
+(module
+ (export "apply" (func $apply))
+ (memory $0 1)
+ (func $apply (param $0 i64)(param $1 i64)(param $2 i64)
+  (local $i i32)
+  (local $acc i64)
+  (set_local $acc (get_local $0))
+  (block $done
+   (loop $next
+    (br_if $done (i32.ge_u (get_local $i) (i32.const 100000)))
+    (set_local $acc (i64.add (i64.mul (get_local $acc) (i64.const 6364136223846793005)) (i64.const 1442695040888963407)))
+    (i64.store (i32.and (i32.wrap/i64 (get_local $acc)) (i32.const 0xfff8)) (get_local $acc))
+    (set_local $i (i32.add (get_local $i) (i32.const 1)))
+    (br $next)
+   )
+  )
+ )
+)
+)=====";
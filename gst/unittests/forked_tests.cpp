@@ -354,6 +354,37 @@ BOOST_AUTO_TEST_CASE( prune_remove_branch ) try {
 } FC_LOG_AND_RETHROW() 
 
 
+/**
+ *  This test verifies that the fork database journal of a running node, as left behind by an
+ *  unclean shutdown, restores the same reversible blocks and head.
+ */
+BOOST_AUTO_TEST_CASE( fork_db_journal_recovery ) try {
+   tester c;
+   c.produce_blocks(10);
+   c.create_accounts( {N(dan),N(sam),N(pam),N(scott)} );
+   c.set_producers( {N(dan),N(sam),N(pam),N(scott)} );
+   c.produce_blocks(50);
+
+   const auto& live = c.control->fork_db();
+   BOOST_REQUIRE_GT( c.control->head_block_num(), c.control->last_irreversible_block_num() + 1 );
+
+   fc::temp_directory crashed;
+   fc::copy( c.get_config().state_dir / config::forkdb_journal_filename, crashed.path() / config::forkdb_journal_filename );
+   fork_database restored( crashed.path() );
+
+   BOOST_REQUIRE( restored.head() );
+   BOOST_REQUIRE_EQUAL( restored.head()->id, live.head()->id );
+   for( uint32_t n = c.control->last_irreversible_block_num() + 1; n <= c.control->head_block_num(); ++n ) {
+      auto b = restored.get_block_in_current_chain_by_num( n );
+      BOOST_REQUIRE( b );
+      BOOST_REQUIRE_EQUAL( b->id, live.get_block_in_current_chain_by_num( n )->id );
+      BOOST_REQUIRE_EQUAL( b->validated, true );
+   }
+   BOOST_REQUIRE( fc::exists( crashed.path() / config::forkdb_journal_filename ) );
+
+} FC_LOG_AND_RETHROW()
+
+
 BOOST_AUTO_TEST_CASE( read_modes ) try {
    tester c;
    c.produce_block();
@@ -0,0 +1,84 @@
+/**
+ *  @file
+ *  @copyright defined in gst/LICENSE
+ */
+#include <boost/test/unit_test.hpp>
+
+#include <gstio/producer_plugin/incoming_transaction_queue.hpp>
+
+using namespace gstio;
+using namespace gstio::chain;
+
+namespace {
+   transaction_metadata_ptr make_trx( account_name actor, uint32_t nonce ) {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{actor, config::active_name}}, N(gstio), N(nonce), fc::raw::pack( nonce ) );
+      return std::make_shared<transaction_metadata>( trx );
+   }
+
+   account_name authorizer( const incoming_transaction_queue::entry& e ) {
+      return e.trx->packed_trx->get_transaction().first_authorizor();
+   }
+}
+
+BOOST_AUTO_TEST_SUITE(incoming_transaction_queue_tests)
+
+BOOST_AUTO_TEST_CASE(round_robin_across_accounts) {
+   incoming_transaction_queue q;
+   q.set_max_bytes( std::numeric_limits<uint64_t>::max() );
+   for( uint32_t i = 0; i < 3; ++i )
+      q.push( { make_trx( N(alice), i ) } );
+   q.push( { make_trx( N(bob), 0 ) } );
+   q.push( { make_trx( N(carol), 0 ) } );
+   q.push( { make_trx( N(carol), 1 ) } );
+   BOOST_REQUIRE_EQUAL( q.size(), 6u );
+   BOOST_REQUIRE_EQUAL( q.accounts_size(), 3u );
+
+   // a flooding account only gets every other turn once the others run out
+   vector<account_name> expected{ N(alice), N(bob), N(carol), N(alice), N(carol), N(alice) };
+   for( const auto& account : expected )
+      BOOST_REQUIRE_EQUAL( authorizer( q.pop() ), account );
+   BOOST_REQUIRE( q.empty() );
+   BOOST_REQUIRE_EQUAL( q.accounts_size(), 0u );
+   BOOST_REQUIRE_EQUAL( q.bytes_size(), 0u );
+
+   // an account rejoins the rotation at its end
+   q.push( { make_trx( N(bob), 1 ) } );
+   q.push( { make_trx( N(alice), 3 ) } );
+   BOOST_REQUIRE_EQUAL( authorizer( q.pop() ), N(bob) );
+   BOOST_REQUIRE_EQUAL( authorizer( q.pop() ), N(alice) );
+}
+
+BOOST_AUTO_TEST_CASE(drops_newest_of_largest_account) {
+   incoming_transaction_queue q;
+   q.set_max_bytes( std::numeric_limits<uint64_t>::max() );
+   q.push( { make_trx( N(alice), 0 ) } );
+   const auto entry_size = q.bytes_size();
+   q.set_max_bytes( 4 * entry_size );
+
+   for( uint32_t i = 1; i < 4; ++i )
+      BOOST_REQUIRE( q.push( { make_trx( N(alice), i ) } ).empty() );
+
+   // bob fits by dropping the newest transaction of alice
+   auto bob = make_trx( N(bob), 0 );
+   auto dropped = q.push( { bob } );
+   BOOST_REQUIRE_EQUAL( dropped.size(), 1u );
+   BOOST_REQUIRE( dropped[0].trx->id == make_trx( N(alice), 3 )->id );
+   BOOST_REQUIRE( !q.contains( dropped[0].trx->id ) );
+   BOOST_REQUIRE( q.contains( bob->id ) );
+   BOOST_REQUIRE_EQUAL( q.bytes_size(), 4 * entry_size );
+
+   // the account holding the most memory loses its newest transaction even if it was just pushed
+   dropped = q.push( { make_trx( N(alice), 4 ) } );
+   BOOST_REQUIRE_EQUAL( dropped.size(), 1u );
+   BOOST_REQUIRE( dropped[0].trx->id == make_trx( N(alice), 4 )->id );
+   BOOST_REQUIRE_EQUAL( q.size(), 4u );
+   BOOST_REQUIRE_EQUAL( q.accounts_size(), 2u );
+
+   // draining keeps the byte count consistent
+   while( !q.empty() )
+      q.pop();
+   BOOST_REQUIRE_EQUAL( q.bytes_size(), 0u );
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 #include <gstio/chain/authority.hpp>
 #include <gstio/chain/authority_checker.hpp>
 #include <gstio/chain/chain_config.hpp>
+#include <gstio/chain/merkle.hpp>
 #include <gstio/chain/types.hpp>
 #include <gstio/testing/tester.hpp>
 
@@ -183,6 +184,39 @@ BOOST_AUTO_TEST_CASE(variant_format_string_limited)
    }
 }
 
+BOOST_AUTO_TEST_CASE(variant_object_indexed_find)
+{
+   // enough keys to search through the key index, inserted out of order and with a duplicate
+   fc::mutable_variant_object mu;
+   for( int i = 63; i >= 0; --i )
+      mu( "key" + std::to_string( i ), i );
+   mu( "key7", fc::variant( 100 ) );
+   BOOST_CHECK_EQUAL( mu["key0"].as_int64(), 0 );
+   BOOST_CHECK_EQUAL( mu["key7"].as_int64(), 7 );
+   BOOST_CHECK( mu.find( "key64" ) == mu.end() );
+
+   mu( "a", 1 );
+   mu.set( "key7", 8 );
+   BOOST_CHECK_EQUAL( mu["a"].as_int64(), 1 );
+   BOOST_CHECK_EQUAL( mu["key7"].as_int64(), 8 );
+   mu.erase( "key7" );
+   BOOST_CHECK_EQUAL( mu["key7"].as_int64(), 100 );
+
+   fc::variant_object vo( mu );
+   BOOST_CHECK_EQUAL( vo.size(), 65u );
+   BOOST_CHECK_EQUAL( vo.begin()->key(), "key63" );
+   for( int i = 0; i < 64; ++i )
+      BOOST_CHECK_EQUAL( vo[ "key" + std::to_string( i ) ].as_int64(), i == 7 ? 100 : i );
+   BOOST_CHECK( !vo.contains( "b" ) );
+
+   // copies keep their content when the original is assigned
+   fc::variant_object copy( vo );
+   fc::mutable_variant_object other( "b", 2 );
+   vo = other;
+   BOOST_CHECK( vo.contains( "b" ) );
+   BOOST_CHECK_EQUAL( copy["a"].as_int64(), 1 );
+}
+
 // Test overflow handling in asset::from_string
 BOOST_AUTO_TEST_CASE(asset_from_string_overflow)
 {
@@ -1063,6 +1097,62 @@ BOOST_AUTO_TEST_CASE(reflector_init_test) {
    } FC_LOG_AND_RETHROW()
 }
 
+/// merkle as it was computed before levels were hashed in batches
+static digest_type pairwise_merkle( vector<digest_type> ids ) {
+   if( 0 == ids.size() ) { return digest_type(); }
+   while( ids.size() > 1 ) {
+      if( ids.size() % 2 )
+         ids.push_back(ids.back());
+      for( size_t i = 0; i < ids.size() / 2; i++ )
+         ids[i] = digest_type::hash(make_canonical_pair(ids[2 * i], ids[(2 * i) + 1]));
+      ids.resize(ids.size() / 2);
+   }
+   return ids.front();
+}
+
+BOOST_AUTO_TEST_CASE(merkle_pair_hashers)
+{ try {
+   vector<digest_type> ids;
+   for( uint32_t n = 0; n <= 70; ++n ) {
+      BOOST_CHECK_EQUAL( merkle( ids ).str(), pairwise_merkle( ids ).str() );
+      ids.push_back( digest_type::hash( n ) );
+   }
+
+   vector<digest_type> pairs( ids.begin(), ids.begin() + 2 * 33 );
+   vector<digest_type> expected;
+   for( size_t i = 0; i < pairs.size() / 2; ++i )
+      expected.push_back( digest_type::hash( std::make_pair( pairs[2 * i], pairs[2 * i + 1] ) ) );
+
+   for( auto h : { fc::sha256::pair_hasher::generic, fc::sha256::pair_hasher::sse41,
+                   fc::sha256::pair_hasher::avx2, fc::sha256::pair_hasher::shani } ) {
+      if( !fc::sha256::pair_hasher_supported( h ) ) continue;
+      auto in_place = pairs;
+      fc::sha256::hash_pairs( in_place.data(), in_place.data(), in_place.size() / 2, h );
+      in_place.resize( in_place.size() / 2 );
+      BOOST_CHECK( in_place == expected );
+   }
+} FC_LOG_AND_RETHROW() }
+
+BOOST_AUTO_TEST_CASE(merkle_benchmark)
+{ try {
+   for( size_t leaves : { 1000, 10000, 100000 } ) {
+      vector<digest_type> ids;
+      for( size_t i = 0; i < leaves; ++i )
+         ids.push_back( digest_type::hash( i ) );
+
+      auto start = fc::time_point::now();
+      auto expected = pairwise_merkle( ids );
+      auto pairwise = fc::time_point::now() - start;
+      start = fc::time_point::now();
+      auto root = merkle( ids );
+      auto batched = fc::time_point::now() - start;
+
+      BOOST_REQUIRE_EQUAL( root.str(), expected.str() );
+      BOOST_TEST_MESSAGE( "merkle of " << leaves << " leaves: " << pairwise.count() << " us pairwise, "
+                          << batched.count() << " us batched" );
+   }
+} FC_LOG_AND_RETHROW() }
+
 
 BOOST_AUTO_TEST_SUITE_END()
 
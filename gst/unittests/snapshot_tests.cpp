@@ -5,6 +5,7 @@
 #include <sstream>
 
 #include <gstio/chain/snapshot.hpp>
+#include <gstio/chain/state_delta.hpp>
 #include <gstio/testing/tester.hpp>
 
 #include <boost/mpl/list.hpp>
@@ -252,4 +253,59 @@ BOOST_AUTO_TEST_CASE_TEMPLATE(test_replay_over_snapshot, SNAPSHOT_SUITE, snapsho
    BOOST_REQUIRE_EQUAL(expected_post_integrity_hash.str(), snap_chain.control->calculate_integrity_hash().str());
 }
 
+BOOST_AUTO_TEST_CASE_TEMPLATE(test_replay_from_state_deltas, SNAPSHOT_SUITE, snapshot_suites)
+{
+   tester chain;
+
+   chain.create_account(N(snapshot));
+   chain.produce_blocks(1);
+   chain.set_code(N(snapshot), contracts::snapshot_test_wasm());
+   chain.set_abi(N(snapshot), contracts::snapshot_test_abi().data());
+   chain.produce_blocks(1);
+   chain.control->abort_block();
+
+   auto writer = SNAPSHOT_SUITE::get_writer();
+   chain.control->write_snapshot(writer);
+   auto snapshot = SNAPSHOT_SUITE::finalize(writer);
+
+   // record the state changes of every following block the way state_history_plugin does
+   std::map<block_id_type, block_state_deltas> recorded;
+   chain.control->accepted_block.connect([&]( const block_state_ptr& block_state ) {
+      auto& entry = recorded[block_state->id];
+      entry.deltas = extract_state_deltas(chain.control->db());
+      entry.integrity_hash = chain.control->calculate_integrity_hash();
+   });
+
+   for (int itr = 0; itr < 12; itr++) {
+      chain.push_action(N(snapshot), N(increment), N(snapshot), mutable_variant_object()
+         ( "value", 1 )
+      );
+      chain.produce_block();
+   }
+   chain.control->abort_block();
+
+   // replay the block log over the snapshot without executing the blocks
+   auto config = chain.get_config();
+   config.blocks_dir = config.blocks_dir.parent_path() / "replayed_blocks";
+   config.state_dir = config.state_dir.parent_path() / "replayed_state";
+   fc::create_directories(config.blocks_dir);
+   fc::copy(chain.get_config().blocks_dir / "blocks.log", config.blocks_dir / "blocks.log");
+
+   uint32_t applied = 0;
+   controller replayed(config);
+   replayed.add_indices();
+   replayed.set_replay_state_delta_source([&]( const signed_block_ptr& block ) -> optional<block_state_deltas> {
+      auto itr = recorded.find(block->id());
+      if (itr == recorded.end())
+         return {};
+      ++applied;
+      return itr->second;
+   });
+   replayed.startup([]() { return false; }, SNAPSHOT_SUITE::get_reader(snapshot));
+
+   BOOST_REQUIRE_GT(applied, 0);
+   BOOST_REQUIRE(recorded.count(replayed.head_block_id()));
+   BOOST_REQUIRE_EQUAL(recorded[replayed.head_block_id()].integrity_hash->str(), replayed.calculate_integrity_hash().str());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
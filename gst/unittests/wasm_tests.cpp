@@ -3,11 +3,13 @@
  *  @copyright defined in gst/LICENSE.txt
  */
 #include <array>
+#include <thread>
 #include <utility>
 
 #include <gstio/chain/abi_serializer.hpp>
 #include <gstio/chain/exceptions.hpp>
 #include <gstio/chain/resource_limits.hpp>
+#include <gstio/chain/wasm_code_cache.hpp>
 #include <gstio/chain/wasm_gstio_constraints.hpp>
 #include <gstio/chain/wast_to_wasm.hpp>
 #include <gstio/testing/tester.hpp>
@@ -1742,6 +1744,274 @@ BOOST_FIXTURE_TEST_CASE( big_maligned_host_ptr, TESTER ) try {
    produce_blocks(1);
 } FC_LOG_AND_RETHROW()
 
+/**
+ * Ensure the instantiation cache honours its entry bound and never evicts pinned contracts
+ */
+BOOST_AUTO_TEST_CASE( instantiation_cache_eviction ) try {
+   tester chain;
+   chain.produce_blocks(2);
+   chain.create_accounts( {N(asserter), N(noop)} );
+   chain.set_code(N(asserter), contracts::asserter_wasm());
+   chain.set_code(N(noop), contracts::noop_wasm());
+   chain.set_abi(N(noop), contracts::noop_abi().data());
+   chain.produce_block();
+
+   uint32_t seq = 0;
+   auto run_asserter = [&]() {
+      signed_transaction trx;
+      trx.actions.emplace_back( vector<permission_level>{{N(asserter),config::active_name}},
+                                assertdef {1, "Should Not Assert! " + std::to_string(++seq)} );
+      chain.set_transaction_headers(trx);
+      trx.sign( chain.get_private_key( N(asserter), "active" ), chain.control->get_chain_id() );
+      chain.push_transaction( trx );
+   };
+   auto run_noop = [&]() {
+      chain.push_action( N(noop), N(anyaction), N(noop), mutable_variant_object()
+                         ("from", "noop")
+                         ("type", "some type")
+                         ("data", "some data " + std::to_string(++seq)) );
+   };
+
+   auto cfg = chain.get_config();
+   cfg.wasm_cache_max_entries = 1;
+   cfg.wasm_cache_pinned_accounts.clear();
+   chain.close();
+   chain.init(cfg);
+
+   run_asserter();
+   run_noop();
+   run_asserter();
+   {
+      auto stats = chain.control->get_wasm_interface().get_cache_stats();
+      BOOST_CHECK_EQUAL(stats.misses, 3u);
+      BOOST_CHECK_EQUAL(stats.hits, 0u);
+      BOOST_CHECK_EQUAL(stats.evictions, 2u);
+      BOOST_CHECK_EQUAL(stats.entries, 1u);
+      BOOST_CHECK_EQUAL(stats.pinned_entries, 0u);
+   }
+
+   cfg.wasm_cache_pinned_accounts = { N(noop) };
+   chain.close();
+   chain.init(cfg);
+
+   run_noop();
+   run_asserter();
+   run_noop();
+   {
+      auto stats = chain.control->get_wasm_interface().get_cache_stats();
+      BOOST_CHECK_EQUAL(stats.misses, 2u);
+      BOOST_CHECK_EQUAL(stats.hits, 1u);
+      BOOST_CHECK_EQUAL(stats.evictions, 0u);
+      BOOST_CHECK_EQUAL(stats.entries, 2u);
+      BOOST_CHECK_EQUAL(stats.pinned_entries, 1u);
+   }
+} FC_LOG_AND_RETHROW()
+
+/**
+ * Ensure code shared by pinned accounts stays pinned while one of them still runs it
+ */
+BOOST_AUTO_TEST_CASE( instantiation_cache_shared_pinned_code ) try {
+   tester chain;
+   chain.produce_blocks(2);
+   chain.create_accounts( {N(pinone), N(pintwo), N(unpinned)} );
+   chain.set_code(N(pinone), aligned_ref_wast);
+   chain.set_code(N(pintwo), aligned_ref_wast);
+   chain.set_code(N(unpinned), misaligned_const_ref_wast);
+   chain.produce_block();
+
+   uint32_t seq = 0;
+   auto run = [&]( account_name account ) {
+      signed_transaction trx;
+      action act;
+      act.account = account;
+      act.name = N();
+      act.authorization = vector<permission_level>{{account,config::active_name}};
+      act.data = fc::raw::pack(++seq);
+      trx.actions.push_back(act);
+      chain.set_transaction_headers(trx);
+      trx.sign( chain.get_private_key( account, "active" ), chain.control->get_chain_id() );
+      chain.push_transaction( trx );
+   };
+
+   auto cfg = chain.get_config();
+   cfg.wasm_cache_max_entries = 1;
+   cfg.wasm_cache_pinned_accounts = { N(pinone), N(pintwo) };
+   chain.close();
+   chain.init(cfg);
+
+   run(N(pinone));
+   run(N(pintwo));
+   // pintwo still runs the code pinone ran before
+   chain.set_code(N(pinone), misaligned_ref_wast);
+   chain.produce_block();
+   run(N(pinone));
+   {
+      auto stats = chain.control->get_wasm_interface().get_cache_stats();
+      BOOST_CHECK_EQUAL(stats.misses, 2u);
+      BOOST_CHECK_EQUAL(stats.hits, 1u);
+      BOOST_CHECK_EQUAL(stats.pinned_entries, 2u);
+   }
+
+   // the unpinned module fills the cache without evicting the shared code
+   run(N(unpinned));
+   run(N(pintwo));
+   {
+      auto stats = chain.control->get_wasm_interface().get_cache_stats();
+      BOOST_CHECK_EQUAL(stats.misses, 3u);
+      BOOST_CHECK_EQUAL(stats.hits, 2u);
+      BOOST_CHECK_EQUAL(stats.evictions, 0u);
+      BOOST_CHECK_EQUAL(stats.entries, 3u);
+      BOOST_CHECK_EQUAL(stats.pinned_entries, 2u);
+   }
+} FC_LOG_AND_RETHROW()
+
+/**
+ * Ensure injected modules are reused from the persistent code cache after a restart
+ */
+BOOST_AUTO_TEST_CASE( persistent_code_cache ) try {
+   fc::temp_directory code_cache_dir;
+   tester chain;
+   chain.produce_blocks(2);
+   chain.create_accounts( {N(noop)} );
+   chain.set_code(N(noop), contracts::noop_wasm());
+   chain.set_abi(N(noop), contracts::noop_abi().data());
+   chain.produce_block();
+
+   uint32_t seq = 0;
+   auto run_noop = [&]() {
+      chain.push_action( N(noop), N(anyaction), N(noop), mutable_variant_object()
+                         ("from", "noop")
+                         ("type", "some type")
+                         ("data", "some data " + std::to_string(++seq)) );
+   };
+
+   auto cfg = chain.get_config();
+   cfg.wasm_code_cache_dir = code_cache_dir.path();
+   chain.close();
+   chain.init(cfg);
+
+   run_noop();
+   BOOST_CHECK_EQUAL(chain.control->get_wasm_interface().get_cache_stats().disk_hits, 0u);
+
+   chain.close();
+   chain.init(cfg);
+
+   run_noop();
+   {
+      auto stats = chain.control->get_wasm_interface().get_cache_stats();
+      BOOST_CHECK_EQUAL(stats.misses, 1u);
+      BOOST_CHECK_EQUAL(stats.disk_hits, 1u);
+   }
+} FC_LOG_AND_RETHROW()
+
+/**
+ * Ensure the persistent code cache stays within its size bound, deleting least recently used entries first
+ */
+BOOST_AUTO_TEST_CASE( code_cache_size_bound ) try {
+   fc::temp_directory code_cache_dir;
+   auto make_entry = []( char c ) {
+      wasm_code_cache::entry e;
+      e.code_id = digest_type::hash( &c, 1 );
+      e.code.assign( 1000, c );
+      return e;
+   };
+   auto a = make_entry('a'), b = make_entry('b'), c = make_entry('c');
+
+   {
+      wasm_code_cache cache( code_cache_dir.path(), 2500 );
+      cache.put( a );
+      cache.put( b );
+      BOOST_CHECK_EQUAL( cache.entries(), 2u );
+      BOOST_REQUIRE( cache.get( a.code_id ) );   // b is now the least recently used
+      cache.put( c );
+      BOOST_CHECK_EQUAL( cache.entries(), 2u );
+      BOOST_CHECK_LE( cache.size(), 2500u );
+      BOOST_CHECK( !cache.get( b.code_id ) );
+      BOOST_CHECK( cache.get( a.code_id ) );
+      BOOST_CHECK( cache.get( c.code_id ) );
+   }
+
+   // entries found on disk count against a smaller bound after a restart
+   wasm_code_cache cache( code_cache_dir.path(), 1500 );
+   BOOST_CHECK_EQUAL( cache.entries(), 1u );
+   BOOST_CHECK_LE( cache.size(), 1500u );
+} FC_LOG_AND_RETHROW()
+
+/**
+ * Ensure a contract is prepared in the background when it is set, ahead of its first action
+ */
+BOOST_AUTO_TEST_CASE( precompile_on_setcode ) try {
+   tester chain;
+   chain.produce_blocks(2);
+   chain.create_accounts( {N(noop)} );
+   chain.set_code(N(noop), contracts::noop_wasm());
+   chain.set_abi(N(noop), contracts::noop_abi().data());
+   chain.produce_block();
+
+   chain.push_action( N(noop), N(anyaction), N(noop), mutable_variant_object()
+                      ("from", "noop")
+                      ("type", "some type")
+                      ("data", "some data") );
+
+   auto stats = chain.control->get_wasm_interface().get_cache_stats();
+   BOOST_CHECK_EQUAL(stats.misses, 1u);
+   BOOST_CHECK_EQUAL(stats.precompiled_hits, 1u);
+} FC_LOG_AND_RETHROW()
+
+/**
+ * Compare wavm, wabt and wasm2c on a compute bound contract; timings are reported, not checked. Disabled so that it
+ * is not part of the suite, run it with unit_test --run_test=wasm_tests/runtime_benchmark --log_level=message
+ */
+BOOST_AUTO_TEST_CASE( runtime_benchmark, * boost::unit_test::disabled() ) try {
+   const uint32_t iterations = 50;
+   for( auto vm : { wasm_interface::vm_type::wavm, wasm_interface::vm_type::wabt, wasm_interface::vm_type::wasm2c } ) {
+      fc::temp_directory code_cache_dir;
+      tester chain;
+      auto cfg = chain.get_config();
+      cfg.wasm_runtime = vm;
+      cfg.wasm_code_cache_dir = code_cache_dir.path();
+      chain.close();
+      chain.init(cfg);
+
+      chain.create_accounts( {N(bench)} );
+      chain.set_code(N(bench), runtime_benchmark_wast);
+      chain.produce_block();
+
+      uint32_t seq = 0;
+      auto run = [&]() {
+         signed_transaction trx;
+         trx.actions.emplace_back( vector<permission_level>{{N(bench),config::active_name}}, N(bench), N(run), bytes{} );
+         chain.set_transaction_headers(trx, chain.DEFAULT_EXPIRATION_DELTA + ++seq);
+         trx.sign( chain.get_private_key( N(bench), "active" ), chain.control->get_chain_id() );
+         chain.push_transaction( trx );
+      };
+      run();
+
+      if( vm == wasm_interface::vm_type::wasm2c ) {
+         // wait for the background compiler so that the timed actions run natively
+         auto deadline = fc::time_point::now() + fc::seconds(120);
+         auto has_object = [&]() {
+            for( fc::directory_iterator itr( code_cache_dir.path() / "wasm2c" ), end; itr != end; ++itr )
+               if( (*itr).extension().generic_string() == ".so" )
+                  return true;
+            return false;
+         };
+         while( !has_object() && fc::time_point::now() < deadline )
+            std::this_thread::sleep_for( std::chrono::milliseconds(100) );
+         if( !has_object() )
+            BOOST_TEST_MESSAGE( "wasm2c object was not built, timing the wabt fallback" );
+         run();
+      }
+
+      auto start = fc::time_point::now();
+      for( uint32_t i = 0; i < iterations; ++i )
+         run();
+      auto elapsed = fc::time_point::now() - start;
+      BOOST_TEST_MESSAGE( fc::variant(vm).as_string() << ": "
+                          << elapsed.count() / iterations << " us per action" );
+   }
+} FC_LOG_AND_RETHROW()
+
 // TODO: restore net_usage_tests
 #if 0
 BOOST_FIXTURE_TEST_CASE(net_usage_tests, tester ) try {
@@ -42,12 +42,7 @@ class whitelist_blacklist_tester {
          cfg.genesis.initial_timestamp = fc::time_point::from_iso_string("2020-01-01T00:00:00.000");
          cfg.genesis.initial_key = base_tester::get_public_key( config::system_account_name, "active" );
 
-         for(int i = 0; i < boost::unit_test::framework::master_test_suite().argc; ++i) {
-            if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wavm"))
-               cfg.wasm_runtime = chain::wasm_interface::vm_type::wavm;
-            else if(boost::unit_test::framework::master_test_suite().argv[i] == std::string("--wabt"))
-               cfg.wasm_runtime = chain::wasm_interface::vm_type::wabt;
-         }
+         set_wasm_runtime_from_args(cfg);
 
          return cfg;
       }